@@ -0,0 +1,365 @@
+// Tencent is pleased to support the open source community by making ncnn available.
+//
+// Copyright (C) 2019 THL A29 Limited, a Tencent company. All rights reserved.
+//
+// Licensed under the BSD 3-Clause License (the "License"); you may not use this file except
+// in compliance with the License. You may obtain a copy of the License at
+//
+// https://opensource.org/licenses/BSD-3-Clause
+//
+// Unless required by applicable law or agreed to in writing, software distributed
+// under the License is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR
+// CONDITIONS OF ANY KIND, either express or implied. See the License for the
+// specific language governing permissions and limitations under the License.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <algorithm>
+#include <string>
+#include <vector>
+
+#include "benchmark.h"
+#include "cpu.h"
+#include "net.h"
+#include "profiler.h"
+
+// ncnn private header
+#include "layer/convolution.h"
+#include "layer/convolutiondepthwise.h"
+#include "layer/deconvolution.h"
+#include "layer/deconvolutiondepthwise.h"
+#include "layer/innerproduct.h"
+#include "layer/input.h"
+#include "layer/pooling.h"
+
+// constant weight
+// not zero, so that the weight does not look pruned to use_sparse_weight
+class ModelBinFromConstant : public ncnn::ModelBin
+{
+public:
+    virtual ncnn::Mat load(int w, int /*type*/) const { ncnn::Mat m(w); m.fill(0.001f); return m; }
+};
+
+// the layers of a model with the bottom shapes they forward with
+class KernelNet : public ncnn::Net
+{
+public:
+    int load_constant_model();
+
+    // one forward with a profiler to learn the bottom shapes
+    // the input shape is the one written in the Input layer
+    int capture(std::vector<ncnn::LayerProfile>& profiles) const;
+
+    ncnn::Layer* layer(int layer_index) { return layers[layer_index]; }
+};
+
+int KernelNet::load_constant_model()
+{
+    ModelBinFromConstant mb;
+    for (size_t i=0; i<layers.size(); i++)
+    {
+        int ret = layers[i]->load_model(mb);
+        if (ret != 0)
+        {
+            fprintf(stderr, "layer load_model %d failed\n", (int)i);
+            return -1;
+        }
+    }
+
+    // the int8 layers take int8 bottoms in the requantized dataflow
+    fuse_network();
+
+    return 0;
+}
+
+int KernelNet::capture(std::vector<ncnn::LayerProfile>& profiles) const
+{
+    ncnn::Profiler profiler;
+
+    ncnn::Extractor ex = create_extractor();
+    ex.set_light_mode(false);
+    ex.set_profiler(&profiler);
+
+    for (size_t i=0; i<layers.size(); i++)
+    {
+        if (layers[i]->type != "Input")
+            continue;
+
+        const ncnn::Input* input = (const ncnn::Input*)layers[i];
+
+        ncnn::Mat in(input->w, input->h, input->c);
+        in.fill(0.5f);
+        ex.input(layers[i]->tops[0], in);
+    }
+
+    for (size_t i=0; i<blobs.size(); i++)
+    {
+        if (!blobs[i].consumers.empty())
+            continue;
+
+        ncnn::Mat out;
+        int ret = ex.extract((int)i, out);
+        if (ret != 0)
+            return ret;
+    }
+
+    profiles = profiler.layer_profiles();
+
+    return 0;
+}
+
+static int g_loop_count = 10;
+
+static ncnn::UnlockedPoolAllocator g_blob_pool_allocator;
+static ncnn::PoolAllocator g_workspace_pool_allocator;
+
+// the reference implementation in src/layer, bypassing the arch override
+// return 0 if success, -1 if the type has no generic forward to call
+static int forward_generic(const ncnn::Layer* layer, const ncnn::Mat& bottom_blob, ncnn::Mat& top_blob, const ncnn::Option& opt)
+{
+    if (layer->type == "Convolution")
+        return ((const ncnn::Convolution*)layer)->ncnn::Convolution::forward(bottom_blob, top_blob, opt);
+    if (layer->type == "ConvolutionDepthWise")
+        return ((const ncnn::ConvolutionDepthWise*)layer)->ncnn::ConvolutionDepthWise::forward(bottom_blob, top_blob, opt);
+    if (layer->type == "Deconvolution")
+        return ((const ncnn::Deconvolution*)layer)->ncnn::Deconvolution::forward(bottom_blob, top_blob, opt);
+    if (layer->type == "DeconvolutionDepthWise")
+        return ((const ncnn::DeconvolutionDepthWise*)layer)->ncnn::DeconvolutionDepthWise::forward(bottom_blob, top_blob, opt);
+    if (layer->type == "InnerProduct")
+        return ((const ncnn::InnerProduct*)layer)->ncnn::InnerProduct::forward(bottom_blob, top_blob, opt);
+    if (layer->type == "Pooling")
+        return ((const ncnn::Pooling*)layer)->ncnn::Pooling::forward(bottom_blob, top_blob, opt);
+
+    return -1;
+}
+
+// median milliseconds of the loop, impl -1 is the generic forward
+static double time_kernel(const ncnn::Layer* layer, int impl, const ncnn::Mat& bottom_blob, ncnn::Mat& top_blob, const ncnn::Option& opt)
+{
+    std::vector<double> times;
+
+    // one untimed run for the pools
+    for (int i=0; i<=g_loop_count; i++)
+    {
+        double start = ncnn::get_current_time();
+
+        int ret = impl == -1 ? forward_generic(layer, bottom_blob, top_blob, opt) : layer->forward(bottom_blob, top_blob, opt);
+        if (ret != 0)
+            return -1;
+
+        double end = ncnn::get_current_time();
+
+        if (i > 0)
+            times.push_back(end - start);
+    }
+
+    std::sort(times.begin(), times.end());
+
+    return times[times.size() / 2];
+}
+
+static void print_kernel(const char* model, const ncnn::LayerProfile& profile, const char* impl, double time, const ncnn::LayerCost& cost)
+{
+    const ncnn::BlobShape& b = profile.bottoms[0];
+    const ncnn::BlobShape& t = profile.tops[0];
+
+    const double flops = cost.macs * 2.0 + cost.flops;
+    const double bytes = (double)cost.weight_bytes + cost.bottom_bytes + cost.top_bytes;
+
+    char shape[64];
+    sprintf(shape, "%dx%dx%d%s -> %dx%dx%d", b.w, b.h, b.c, b.elemsize == 1 ? "i8" : "", t.w, t.h, t.c);
+
+    fprintf(stderr, "%16s  %-24s %-22s %-28s %-10s %9.3f  %8.2f GFLOP/s  %8.2f GB/s\n",
+            model, profile.name.c_str(), profile.type.c_str(), shape, impl, time, flops / time / 1e6, bytes / time / 1e6);
+}
+
+static bool is_kernel_type(const std::string& type, const std::vector<std::string>& types)
+{
+    return std::find(types.begin(), types.end(), type) != types.end();
+}
+
+// a layer that does the same work as an earlier one
+static bool same_kernel(const ncnn::LayerProfile& a, const ncnn::LayerProfile& b)
+{
+    if (a.type != b.type || a.bottoms.size() != 1 || b.bottoms.size() != 1)
+        return false;
+
+    const ncnn::BlobShape& ab = a.bottoms[0];
+    const ncnn::BlobShape& bb = b.bottoms[0];
+    const ncnn::BlobShape& at = a.tops[0];
+    const ncnn::BlobShape& bt = b.tops[0];
+
+    return ab.w == bb.w && ab.h == bb.h && ab.c == bb.c && ab.elemsize == bb.elemsize
+           && at.w == bt.w && at.h == bt.h && at.c == bt.c && at.elemsize == bt.elemsize
+           && a.cost.macs == b.cost.macs && a.cost.flops == b.cost.flops && a.cost.weight_bytes == b.cost.weight_bytes;
+}
+
+static void benchmark(const char* param, const std::vector<std::string>& types, const ncnn::Option& opt)
+{
+    KernelNet net;
+    // list the sparse variant too, the default heuristic still takes the constant weight as dense
+    net.use_sparse_weight = 1;
+    if (net.load_param(param) != 0 || net.load_constant_model() != 0)
+    {
+        fprintf(stderr, "load %s failed\n", param);
+        return;
+    }
+
+    std::vector<ncnn::LayerProfile> profiles;
+    if (net.capture(profiles) != 0)
+    {
+        fprintf(stderr, "forward %s failed\n", param);
+        return;
+    }
+
+    // file name without directory and extension
+    std::string model = strrchr(param, '/') ? strrchr(param, '/') + 1 : param;
+    model = model.substr(0, model.rfind(".param"));
+
+    std::vector<ncnn::LayerProfile> measured;
+    for (size_t i=0; i<profiles.size(); i++)
+    {
+        const ncnn::LayerProfile& profile = profiles[i];
+        if (!is_kernel_type(profile.type, types) || profile.bottoms.size() != 1 || profile.tops.size() != 1)
+            continue;
+
+        bool seen = false;
+        for (size_t j=0; j<measured.size(); j++)
+        {
+            seen = seen || same_kernel(measured[j], profile);
+        }
+        if (seen)
+            continue;
+
+        measured.push_back(profile);
+
+        ncnn::Layer* layer = net.layer(profile.layer_index);
+
+        const ncnn::BlobShape& shape = profile.bottoms[0];
+        ncnn::Mat bottom_blob;
+        if (shape.dims == 1)
+            bottom_blob.create(shape.w, shape.elemsize);
+        else if (shape.dims == 2)
+            bottom_blob.create(shape.w, shape.h, shape.elemsize);
+        else
+            bottom_blob.create(shape.w, shape.h, shape.c, shape.elemsize);
+
+        if (shape.elemsize == 4u)
+            bottom_blob.fill(0.5f);
+        else
+            memset(bottom_blob.data, 1, bottom_blob.total() * bottom_blob.elemsize);
+
+        ncnn::Mat top_blob;
+
+        double time = time_kernel(layer, -1, bottom_blob, top_blob, opt);
+        if (time > 0)
+            print_kernel(model.c_str(), profile, "generic", time, profile.cost);
+
+        // the arch implementation with its default heuristic, then every forced variant
+        std::vector<int> impls;
+        layer->get_impls(impls);
+        impls.insert(impls.begin(), 0);
+
+        for (size_t j=0; j<impls.size(); j++)
+        {
+            if (layer->set_impl(impls[j]) != 0)
+                continue;
+
+            time = time_kernel(layer, impls[j], bottom_blob, top_blob, opt);
+            if (time <= 0)
+                continue;
+
+            // the sparse and reduced precision kernels read a different weight
+            ncnn::LayerCost cost;
+            layer->get_cost(std::vector<ncnn::Mat>(1, bottom_blob), std::vector<ncnn::Mat>(1, top_blob), cost);
+
+            char impl[16];
+            sprintf(impl, impls[j] == 0 ? "default" : "impl %d", impls[j]);
+            print_kernel(model.c_str(), profile, impl, time, cost);
+        }
+
+        layer->set_impl(0);
+    }
+}
+
+int main(int argc, char** argv)
+{
+    int num_threads = 1;
+
+    std::vector<std::string> params;
+    std::vector<std::string> types;
+
+    for (int i=1; i<argc; i++)
+    {
+        const char* eq = strchr(argv[i], '=');
+        if (!eq)
+        {
+            fprintf(stderr, "usage: %s [key=value]...\n", argv[0]);
+            fprintf(stderr, "param=resnet50.param    model to take the layers and shapes from, repeat for more\n");
+            fprintf(stderr, "type=Convolution        layer type to measure, repeat for more\n");
+            fprintf(stderr, "loop=10                 timed runs per kernel, the median is reported\n");
+            fprintf(stderr, "threads=1               number of threads\n");
+            return -1;
+        }
+
+        std::string key(argv[i], eq - argv[i]);
+        const char* value = eq + 1;
+
+        if (key == "param")
+            params.push_back(value);
+        else if (key == "type")
+            types.push_back(value);
+        else if (key == "loop")
+            g_loop_count = std::max(atoi(value), 1);
+        else if (key == "threads")
+            num_threads = atoi(value);
+        else
+        {
+            fprintf(stderr, "unknown option %s\n", key.c_str());
+            return -1;
+        }
+    }
+
+    // the 1x1 3x3 and depthwise layers of the bundled models, fp32 and int8
+    if (params.empty())
+    {
+        params.push_back("mobilenet_v2.param");
+        params.push_back("resnet50.param");
+        params.push_back("resnet50_int8.param");
+    }
+
+    if (types.empty())
+    {
+        types.push_back("Convolution");
+        types.push_back("ConvolutionDepthWise");
+        types.push_back("Deconvolution");
+        types.push_back("DeconvolutionDepthWise");
+        types.push_back("InnerProduct");
+        types.push_back("Pooling");
+    }
+
+    g_blob_pool_allocator.set_size_compare_ratio(0.0f);
+    g_workspace_pool_allocator.set_size_compare_ratio(0.5f);
+
+    ncnn::Option opt;
+    opt.lightmode = true;
+    opt.num_threads = num_threads;
+    opt.blob_allocator = &g_blob_pool_allocator;
+    opt.workspace_allocator = &g_workspace_pool_allocator;
+
+    ncnn::set_default_option(opt);
+
+    ncnn::set_omp_dynamic(0);
+    ncnn::set_omp_num_threads(num_threads);
+
+    fprintf(stderr, "loop_count = %d\n", g_loop_count);
+    fprintf(stderr, "num_threads = %d\n", num_threads);
+
+    for (size_t i=0; i<params.size(); i++)
+    {
+        benchmark(params[i].c_str(), types, opt);
+    }
+
+    return 0;
+}
@@ -13,19 +13,30 @@
 // specific language governing permissions and limitations under the License.
 
 #include <float.h>
+#include <math.h>
 #include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <algorithm>
+#include <string>
+#include <vector>
 
 #ifdef _WIN32
 #define NOMINMAX
-#include <algorithm>
 #include <windows.h> // Sleep()
 #else
+#include <pthread.h>
 #include <unistd.h> // sleep()
 #endif
 
 #include "benchmark.h"
 #include "cpu.h"
 #include "net.h"
+#include "profiler.h"
+#include "threadpool.h"
+
+// ncnn private header
+#include "layer/input.h"
 
 #if NCNN_VULKAN
 #include "gpu.h"
@@ -40,24 +51,117 @@ public:
 GlobalGpuInstance g_global_gpu_instance;
 #endif // NCNN_VULKAN
 
+// input blob name and shape, an empty name feeds every Input layer
+struct BenchInput
+{
+    std::string name;
+    int w;
+    int h;
+    int c;
+};
+
+// one model to measure
+struct BenchModel
+{
+    std::string name;
+    std::string param;
+    // empty for constant weight
+    std::string bin;
+    // empty takes the shapes written in the Input layers
+    std::vector<BenchInput> inputs;
+    // empty extracts every blob nothing consumes
+    std::vector<std::string> outputs;
+    // per layer thread counts, loaded when the file exists, tuned and saved otherwise
+    std::string num_threads_path;
+};
+
+// one point of the option sweep
+struct BenchConfig
+{
+    // concurrent extractors on the shared net and allocators, num_threads each
+    int streams;
+    int num_threads;
+    int lightmode;
+    int winograd;
+    int sgemm;
+    int int8;
+    // run the ported layers on the ncnn thread pool instead of openmp
+    int threadpool;
+    // fewer threads for the layers with little work
+    int adaptive;
+    // every stream bound to its own cores, without smt siblings
+    int affinity;
+};
+
+// median of the loop means with its 95% confidence interval, in milliseconds
+struct BenchEstimate
+{
+    double median;
+    double ci_low;
+    double ci_high;
+};
+
+struct BenchLayerResult
+{
+    std::string name;
+    BenchEstimate time;
+};
+
+// latency in milliseconds
+struct BenchResult
+{
+    std::string model;
+    BenchConfig config;
+    int loop_count;
+    int warmup_count;
+    double time_min;
+    double time_max;
+    double time_avg;
+    double time_stddev;
+    double time_p50;
+    double time_p90;
+    double time_p99;
+    // inferences per second of all the streams
+    double fps;
+    // pool allocator lock acquisitions, and the ones that waited for another stream
+    size_t lock_count;
+    size_t lock_contended_count;
+    BenchEstimate time;
+    // only measured for the regression gate
+    std::vector<BenchLayerResult> layers;
+};
+
+// one line of the baseline file, an empty layer is the whole model
+struct BaselineEntry
+{
+    std::string model;
+    std::string config;
+    std::string layer;
+    BenchEstimate time;
+};
+
 namespace ncnn {
 
-// always return empty weights
-class ModelBinFromEmpty : public ModelBin
+// constant weight
+// not zero, so that the weight does not look pruned to use_sparse_weight
+class ModelBinFromConstant : public ModelBin
 {
 public:
-    virtual Mat load(int w, int /*type*/) const { return Mat(w); }
+    virtual Mat load(int w, int /*type*/) const { Mat m(w); m.fill(0.001f); return m; }
 };
 
 class BenchNet : public Net
 {
 public:
+    using Net::load_model;
+
+    // constant weight
     int load_model()
     {
         // load file
         int ret = 0;
 
-        ModelBinFromEmpty mb;
+        ModelBinFromConstant mb;
         for (size_t i=0; i<layers.size(); i++)
         {
             Layer* layer = layers[i];
@@ -80,17 +184,155 @@ public:
         }
 #endif // NCNN_VULKAN
 
+        // measure the int8 models with the requantized dataflow
+        fuse_network();
+
+        // priorbox and the other constant layers are memoised after the warm up
+        find_constant_layers();
+
         return ret;
     }
+
+    // resolve the input and output blobs of the model
+    // return 0 if success
+    int prepare(const BenchModel& model)
+    {
+        input_blobs.clear();
+        input_mats.clear();
+        output_blobs.clear();
+
+        for (size_t i=0; i<layers.size(); i++)
+        {
+            const Layer* layer = layers[i];
+            if (layer->type != "Input")
+                continue;
+
+            const Input* input_layer = (const Input*)layer;
+            int w = input_layer->w;
+            int h = input_layer->h;
+            int c = input_layer->c;
+
+            for (size_t j=0; j<model.inputs.size(); j++)
+            {
+                const BenchInput& input = model.inputs[j];
+                if (input.name.empty() || input.name == blobs[layer->tops[0]].name)
+                {
+                    w = input.w;
+                    h = input.h;
+                    c = input.c;
+                }
+            }
+
+            if (w <= 0 || h <= 0 || c <= 0)
+            {
+                fprintf(stderr, "input %s of %s has no shape\n", blobs[layer->tops[0]].name.c_str(), model.name.c_str());
+                return -1;
+            }
+
+            Mat in(w, h, c);
+            in.fill(0.5f);
+
+            input_blobs.push_back(layer->tops[0]);
+            input_mats.push_back(in);
+        }
+
+        if (model.outputs.empty())
+        {
+            for (size_t i=0; i<blobs.size(); i++)
+            {
+                if (blobs[i].consumers.empty())
+                    output_blobs.push_back((int)i);
+            }
+        }
+
+        for (size_t i=0; i<model.outputs.size(); i++)
+        {
+            int blob_index = find_blob_index_by_name(model.outputs[i].c_str());
+            if (blob_index == -1)
+            {
+                fprintf(stderr, "no blob %s in %s\n", model.outputs[i].c_str(), model.name.c_str());
+                return -1;
+            }
+
+            output_blobs.push_back(blob_index);
+        }
+
+        return 0;
+    }
+
+    // one inference
+    // return 0 if success
+    int run(const BenchConfig& config, Profiler* profiler, Allocator* blob_allocator = 0, const CpuSet* cpu_affinity = 0) const
+    {
+        Extractor ex = create_extractor();
+        ex.set_light_mode(config.lightmode);
+        ex.set_num_threads(config.num_threads);
+        ex.set_adaptive_threads(config.adaptive);
+        if (profiler)
+            ex.set_profiler(profiler);
+        if (blob_allocator)
+            ex.set_blob_allocator(blob_allocator);
+        if (config.threadpool)
+            ex.set_executor(get_default_thread_pool());
+        if (cpu_affinity)
+            ex.set_cpu_affinity(*cpu_affinity);
+
+        for (size_t i=0; i<input_blobs.size(); i++)
+        {
+            ex.input(input_blobs[i], input_mats[i]);
+        }
+
+        for (size_t i=0; i<output_blobs.size(); i++)
+        {
+            Mat out;
+            int ret = ex.extract(output_blobs[i], out);
+            if (ret != 0)
+                return ret;
+        }
+
+        return 0;
+    }
+
+private:
+    std::vector<int> input_blobs;
+    std::vector<Mat> input_mats;
+    std::vector<int> output_blobs;
 };
 
 } // namespace ncnn
 
 static int g_loop_count = 4;
 
+// timed loops per measurement, the estimate is the median of the loop means
+static int g_repeat = 1;
+
+// measure the layers too, for saving or comparing a baseline
+static bool g_gate = false;
+
+// relative slow down that counts as a regression
+static float g_threshold = 0.05f;
+
+// layers faster than this fraction of the model are too noisy to gate
+static const float g_layer_gate_ratio = 0.02f;
+
+// discarded runs before the timed loop, in windows of this size
+static int g_warmup = 3;
+
+// warm up until two consecutive windows agree within this ratio
+static float g_warmup_tolerance = 0.05f;
+
+// sleep seconds before every model for cooling down SOC
+static int g_cooldown = 10;
+
+// print the per layer type time and hardware counters after each model
+static int g_profile = 0;
+
 static ncnn::UnlockedPoolAllocator g_blob_pool_allocator;
 static ncnn::PoolAllocator g_workspace_pool_allocator;
 
+// the streams share one blob allocator, which has to lock
+static ncnn::PoolAllocator g_stream_blob_pool_allocator;
+
 #if NCNN_VULKAN
 static bool g_use_vulkan_compute = false;
 
@@ -99,383 +341,1062 @@ static ncnn::VkAllocator* g_blob_vkallocator = 0;
 static ncnn::VkAllocator* g_staging_vkallocator = 0;
 #endif // NCNN_VULKAN
 
-void benchmark(const char* comment, void (*init)(ncnn::Net&), void (*run)(const ncnn::Net&))
+// run the loop again with a profiler attached and report per layer type
+static void profile(const ncnn::BenchNet& net, const BenchConfig& config)
 {
-    ncnn::BenchNet net;
+    ncnn::Profiler profiler;
+    profiler.enable_hardware_counters(config.num_threads, 0, config.threadpool ? ncnn::get_default_thread_pool() : 0);
 
-#if NCNN_VULKAN
-    if (g_use_vulkan_compute)
+    for (int i=0; i<g_loop_count; i++)
     {
-        net.use_vulkan_compute = g_use_vulkan_compute;
-
-        net.set_vulkan_device(g_vkdev);
+        net.run(config, &profiler);
     }
-#endif // NCNN_VULKAN
-
-    init(net);
 
-    net.load_model();
+    const std::vector<ncnn::LayerTypeProfile> type_profiles = profiler.layer_type_profiles();
+    const double total_time = profiler.total_time();
+    const bool counters = profiler.has_hardware_counters();
 
-    g_blob_pool_allocator.clear();
-    g_workspace_pool_allocator.clear();
+    if (counters)
+        fprintf(stderr, "%20s  %5s  %8s  %6s  %9s  %5s  %11s  %12s  %9s\n", "type", "count", "time", "%", "Mcycles", "ipc", "llc/kinst", "brmis/kinst", "Mfp_ops");
+    else
+        fprintf(stderr, "%20s  %5s  %8s  %6s\n", "type", "count", "time", "%");
 
-#if NCNN_VULKAN
-    if (g_use_vulkan_compute)
+    for (size_t i=0; i<type_profiles.size(); i++)
     {
-        g_blob_vkallocator->clear();
-        g_staging_vkallocator->clear();
+        const ncnn::LayerTypeProfile& type_profile = type_profiles[i];
+        const ncnn::HardwareCounters& c = type_profile.counters;
+
+        // per inference
+        const double time = type_profile.time / g_loop_count;
+        const double percent = total_time > 0 ? type_profile.time / total_time * 100 : 0;
+
+        fprintf(stderr, "%20s  %5d  %8.3f  %6.2f", type_profile.type.c_str(), type_profile.count / g_loop_count, time, percent);
+        if (counters)
+        {
+            const double kinst = c.instructions / 1000.0;
+            fprintf(stderr, "  %9.3f  %5.2f  %11.3f  %12.3f  %9.3f",
+                    c.cycles / 1e6 / g_loop_count,
+                    c.cycles ? (double)c.instructions / c.cycles : 0.0,
+                    kinst > 0 ? c.llc_misses / kinst : 0.0,
+                    kinst > 0 ? c.branch_misses / kinst : 0.0,
+                    c.fp_ops / 1e6 / g_loop_count);
+        }
+        fprintf(stderr, "\n");
     }
-#endif // NCNN_VULKAN
+}
+
+static double run_time(const ncnn::BenchNet& net, const BenchConfig& config, ncnn::Profiler* profiler = 0)
+{
+    double start = ncnn::get_current_time();
+
+    net.run(config, profiler);
+
+    double end = ncnn::get_current_time();
+
+    return end - start;
+}
+
+struct StreamContext
+{
+    const ncnn::BenchNet* net;
+    BenchConfig config;
+    int loop_count;
+    // null leaves the stream unbound
+    const ncnn::CpuSet* cpu_affinity;
+    std::vector<double> times;
+};
 
-    // sleep 10 seconds for cooling down SOC  :(
 #ifdef _WIN32
-    Sleep(10 * 1000);
+static DWORD WINAPI stream_main(LPVOID args)
 #else
-    sleep(10);
+static void* stream_main(void* args)
 #endif
+{
+    StreamContext* context = (StreamContext*)args;
 
-    // warm up
-    run(net);
-    run(net);
-    run(net);
-
-    double time_min = DBL_MAX;
-    double time_max = -DBL_MAX;
-    double time_avg = 0;
-
-    for (int i=0; i<g_loop_count; i++)
+    for (int i=0; i<context->loop_count; i++)
     {
         double start = ncnn::get_current_time();
 
-        run(net);
+        context->net->run(context->config, 0, &g_stream_blob_pool_allocator, context->cpu_affinity);
 
         double end = ncnn::get_current_time();
 
-        double time = end - start;
-
-        time_min = std::min(time_min, time);
-        time_max = std::max(time_max, time);
-        time_avg += time;
+        context->times.push_back(end - start);
     }
 
-    time_avg /= g_loop_count;
-
-    fprintf(stderr, "%20s  min = %7.2f  max = %7.2f  avg = %7.2f\n", comment, time_min, time_max, time_avg);
+    return 0;
 }
 
-void squeezenet_init(ncnn::Net& net)
+// run loop_count inferences on every stream at once, append the latencies
+// return the wall time of all the streams
+static double run_streams(const ncnn::BenchNet& net, const BenchConfig& config, int loop_count, std::vector<double>& times)
 {
-    net.load_param("squeezenet.param");
-}
+    // one slot of threads cores per stream
+    std::vector<ncnn::CpuSet> slots;
+    if (config.affinity && ncnn::get_cpu_slots(config.num_threads, slots) < config.streams)
+    {
+        fprintf(stderr, "%d slots of %d cores available for %d streams, running unbound\n", (int)slots.size(), config.num_threads, config.streams);
+        slots.clear();
+    }
 
-void squeezenet_int8_init(ncnn::Net& net)
-{
-    net.load_param("squeezenet_int8.param");
-}
+    std::vector<StreamContext> contexts(config.streams);
+    for (int i=0; i<config.streams; i++)
+    {
+        contexts[i].net = &net;
+        contexts[i].config = config;
+        contexts[i].loop_count = loop_count;
+        contexts[i].cpu_affinity = slots.empty() ? 0 : &slots[i];
+    }
 
-void squeezenet_run(const ncnn::Net& net)
-{
-    ncnn::Extractor ex = net.create_extractor();
+    double start = ncnn::get_current_time();
 
-    ncnn::Mat in(227, 227, 3);
-    ex.input("data", in);
+#ifdef _WIN32
+    std::vector<HANDLE> handles(config.streams);
+    for (int i=0; i<config.streams; i++)
+    {
+        handles[i] = CreateThread(0, 0, stream_main, &contexts[i], 0, 0);
+    }
+    for (int i=0; i<config.streams; i++)
+    {
+        WaitForSingleObject(handles[i], INFINITE);
+        CloseHandle(handles[i]);
+    }
+#else
+    std::vector<pthread_t> threads(config.streams);
+    for (int i=0; i<config.streams; i++)
+    {
+        pthread_create(&threads[i], 0, stream_main, &contexts[i]);
+    }
+    for (int i=0; i<config.streams; i++)
+    {
+        pthread_join(threads[i], 0);
+    }
+#endif
 
-    ncnn::Mat out;
-    ex.extract("prob", out);
-}
+    double end = ncnn::get_current_time();
 
-void mobilenet_init(ncnn::Net& net)
-{
-    net.load_param("mobilenet.param");
+    for (int i=0; i<config.streams; i++)
+    {
+        times.insert(times.end(), contexts[i].times.begin(), contexts[i].times.end());
+    }
+
+    return end - start;
 }
 
-void mobilenet_int8_init(ncnn::Net& net)
+static double window_mean(const std::vector<double>& times, size_t end, int size)
 {
-    net.load_param("mobilenet_int8.param");
+    double sum = 0;
+    for (size_t i=end-size; i<end; i++)
+    {
+        sum += times[i];
+    }
+
+    return sum / size;
 }
 
-void mobilenet_run(const ncnn::Net& net)
+// return the number of warm up runs
+static int warmup(const ncnn::BenchNet& net, const BenchConfig& config)
 {
-    ncnn::Extractor ex = net.create_extractor();
+    if (g_warmup <= 0)
+        return 0;
 
-    ncnn::Mat in(224, 224, 3);
-    ex.input("data", in);
+    // the first inference allocates the pools and fills the constant layers
+    // stop once the latest window agrees with the one before, at most five windows
+    std::vector<double> times;
+    for (int i=0; i<g_warmup * 5; i++)
+    {
+        times.push_back(run_time(net, config));
 
-    ncnn::Mat out;
-    ex.extract("prob", out);
-}
+        if ((int)times.size() < g_warmup * 2)
+            continue;
 
-void mobilenet_v2_init(ncnn::Net& net)
-{
-    net.load_param("mobilenet_v2.param");
+        double last = window_mean(times, times.size(), g_warmup);
+        double prev = window_mean(times, times.size() - g_warmup, g_warmup);
+        if (fabs(last - prev) <= prev * g_warmup_tolerance)
+            break;
+    }
+
+    return (int)times.size();
 }
 
-void mobilenet_v2_int8_init(ncnn::Net& net)
+// nearest rank percentile of sorted times
+static double percentile(const std::vector<double>& sorted, double p)
 {
-    net.load_param("mobilenet_v2_int8.param");
+    int rank = (int)ceil(p / 100 * sorted.size());
+    rank = std::min(std::max(rank, 1), (int)sorted.size());
+
+    return sorted[rank - 1];
 }
 
-void mobilenet_v2_run(const ncnn::Net& net)
+// two sided 95% student t quantile
+static double t_quantile(int df)
 {
-    ncnn::Extractor ex = net.create_extractor();
+    static const double t[10] = {12.706, 4.303, 3.182, 2.776, 2.571, 2.447, 2.365, 2.306, 2.262, 2.228};
 
-    ncnn::Mat in(224, 224, 3);
-    ex.input("data", in);
+    if (df <= 10)
+        return t[df - 1];
+    if (df <= 20)
+        return 2.086;
+    if (df <= 30)
+        return 2.042;
 
-    ncnn::Mat out;
-    ex.extract("prob", out);
+    return 1.96;
 }
 
-void shufflenet_init(ncnn::Net& net)
+// median of the loop means, the interval is the t interval of the means around it
+// a single loop has no spread and gives an empty interval
+static BenchEstimate estimate(std::vector<double> means)
 {
-    net.load_param("shufflenet.param");
-}
+    std::sort(means.begin(), means.end());
 
-void shufflenet_run(const ncnn::Net& net)
-{
-    ncnn::Extractor ex = net.create_extractor();
+    const int n = (int)means.size();
 
-    ncnn::Mat in(224, 224, 3);
-    ex.input("data", in);
+    BenchEstimate e;
+    e.median = n % 2 ? means[n / 2] : (means[n / 2 - 1] + means[n / 2]) / 2;
+    e.ci_low = e.median;
+    e.ci_high = e.median;
 
-    ncnn::Mat out;
-    ex.extract("fc1000", out);
-}
+    if (n < 2)
+        return e;
 
-void mnasnet_init(ncnn::Net& net)
-{
-    net.load_param("mnasnet.param");
-}
+    double sum = 0;
+    for (int i=0; i<n; i++)
+    {
+        sum += means[i];
+    }
+    const double mean = sum / n;
 
-void mnasnet_run(const ncnn::Net& net)
-{
-    ncnn::Extractor ex = net.create_extractor();
+    double sqsum = 0;
+    for (int i=0; i<n; i++)
+    {
+        sqsum += (means[i] - mean) * (means[i] - mean);
+    }
+    const double stddev = sqrt(sqsum / (n - 1));
 
-    ncnn::Mat in(224, 224, 3);
-    ex.input("data", in);
+    const double half = t_quantile(n - 1) * stddev / sqrt((double)n);
+    e.ci_low = e.median - half;
+    e.ci_high = e.median + half;
 
-    ncnn::Mat out;
-    ex.extract("prob", out);
+    return e;
 }
 
-void proxylessnasnet_init(ncnn::Net& net)
+// per layer means of the loops, in forward order
+struct LayerSamples
 {
-    net.load_param("proxylessnasnet.param");
-}
+    int layer_index;
+    std::string name;
+    std::vector<double> means;
+};
 
-void proxylessnasnet_run(const ncnn::Net& net)
+static void add_layer_means(const ncnn::Profiler& profiler, std::vector<LayerSamples>& samples)
 {
-    ncnn::Extractor ex = net.create_extractor();
+    const std::vector<ncnn::LayerProfile> profiles = profiler.layer_profiles();
 
-    ncnn::Mat in(224, 224, 3);
-    ex.input("data", in);
+    const size_t first = samples.empty() ? 0 : samples[0].means.size();
+    for (size_t i=0; i<samples.size(); i++)
+    {
+        samples[i].means.push_back(0);
+    }
 
-    ncnn::Mat out;
-    ex.extract("prob", out);
+    for (size_t i=0; i<profiles.size(); i++)
+    {
+        const ncnn::LayerProfile& profile = profiles[i];
+
+        size_t j = 0;
+        for (; j<samples.size(); j++)
+        {
+            if (samples[j].layer_index == profile.layer_index)
+                break;
+        }
+
+        if (j == samples.size())
+        {
+            // a layer that only shows up in later loops counts zero before
+            LayerSamples s;
+            s.layer_index = profile.layer_index;
+            s.name = profile.name;
+            s.means.resize(first + 1, 0);
+            samples.push_back(s);
+        }
+
+        samples[j].means.back() += profile.time / g_loop_count;
+    }
 }
 
-void googlenet_init(ncnn::Net& net)
+// the options of a config as one word for the baseline file
+static std::string config_key(const BenchConfig& config)
 {
-    net.load_param("googlenet.param");
+    char s[256];
+    sprintf(s, "streams=%d,threads=%d,lightmode=%d,winograd=%d,sgemm=%d,int8=%d,threadpool=%d,adaptive=%d,affinity=%d", config.streams, config.num_threads, config.lightmode, config.winograd, config.sgemm, config.int8, config.threadpool, config.adaptive, config.affinity);
+
+    return s;
 }
 
-void googlenet_int8_init(ncnn::Net& net)
+static std::string config_string(const BenchConfig& config, const std::vector<BenchConfig>& configs)
 {
-    net.load_param("googlenet_int8.param");
+    // list the options that take more than one value
+    bool streams = false;
+    bool threads = false;
+    bool lightmode = false;
+    bool winograd = false;
+    bool sgemm = false;
+    bool int8 = false;
+    bool threadpool = false;
+    bool adaptive = false;
+    bool affinity = false;
+    for (size_t i=1; i<configs.size(); i++)
+    {
+        streams = streams || configs[i].streams != configs[0].streams;
+        threads = threads || configs[i].num_threads != configs[0].num_threads;
+        lightmode = lightmode || configs[i].lightmode != configs[0].lightmode;
+        winograd = winograd || configs[i].winograd != configs[0].winograd;
+        sgemm = sgemm || configs[i].sgemm != configs[0].sgemm;
+        int8 = int8 || configs[i].int8 != configs[0].int8;
+        threadpool = threadpool || configs[i].threadpool != configs[0].threadpool;
+        adaptive = adaptive || configs[i].adaptive != configs[0].adaptive;
+        affinity = affinity || configs[i].affinity != configs[0].affinity;
+    }
+
+    char s[256];
+    s[0] = '\0';
+    if (streams)
+        sprintf(s + strlen(s), "  streams = %d", config.streams);
+    if (threads)
+        sprintf(s + strlen(s), "  threads = %d", config.num_threads);
+    if (lightmode)
+        sprintf(s + strlen(s), "  lightmode = %d", config.lightmode);
+    if (winograd)
+        sprintf(s + strlen(s), "  winograd = %d", config.winograd);
+    if (sgemm)
+        sprintf(s + strlen(s), "  sgemm = %d", config.sgemm);
+    if (int8)
+        sprintf(s + strlen(s), "  int8 = %d", config.int8);
+    if (threadpool)
+        sprintf(s + strlen(s), "  threadpool = %d", config.threadpool);
+    if (adaptive)
+        sprintf(s + strlen(s), "  adaptive = %d", config.adaptive);
+    if (affinity)
+        sprintf(s + strlen(s), "  affinity = %d", config.affinity);
+
+    return s;
 }
 
-void googlenet_run(const ncnn::Net& net)
+// return 0 if success
+static int benchmark(const BenchModel& model, const std::vector<BenchConfig>& configs, std::vector<BenchResult>& results)
 {
-    ncnn::Extractor ex = net.create_extractor();
+    for (size_t i=0; i<configs.size(); i++)
+    {
+        const BenchConfig& config = configs[i];
 
-    ncnn::Mat in(224, 224, 3);
-    ex.input("data", in);
+        // the net options apply at load time, threads and light mode do not
+        if (i > 0 && config.winograd == configs[i - 1].winograd && config.sgemm == configs[i - 1].sgemm && config.int8 == configs[i - 1].int8)
+            continue;
 
-    ncnn::Mat out;
-    ex.extract("prob", out);
-}
+        ncnn::BenchNet net;
+        net.use_winograd_convolution = config.winograd;
+        net.use_sgemm_convolution = config.sgemm;
+        net.use_int8_inference = config.int8;
 
-void resnet18_init(ncnn::Net& net)
-{
-    net.load_param("resnet18.param");
+#if NCNN_VULKAN
+        if (g_use_vulkan_compute)
+        {
+            net.use_vulkan_compute = g_use_vulkan_compute;
+
+            net.set_vulkan_device(g_vkdev);
+        }
+#endif // NCNN_VULKAN
+
+        if (net.load_param(model.param.c_str()) != 0)
+        {
+            fprintf(stderr, "load_param %s failed\n", model.param.c_str());
+            return -1;
+        }
+
+        int ret = model.bin.empty() ? net.load_model() : net.load_model(model.bin.c_str());
+        if (ret != 0)
+        {
+            fprintf(stderr, "load_model %s failed\n", model.bin.c_str());
+            return -1;
+        }
+
+        if (net.prepare(model) != 0)
+            return -1;
+
+        if (!model.num_threads_path.empty())
+        {
+            FILE* fp = fopen(model.num_threads_path.c_str(), "rb");
+            if (fp)
+            {
+                fclose(fp);
+                ret = net.load_num_threads(model.num_threads_path.c_str());
+            }
+            else
+            {
+                ret = net.autotune_num_threads();
+                if (ret == 0)
+                    ret = net.save_num_threads(model.num_threads_path.c_str());
+            }
+
+            if (ret != 0)
+            {
+                fprintf(stderr, "per layer thread counts of %s failed\n", model.name.c_str());
+                return -1;
+            }
+        }
+
+        for (size_t j=i; j<configs.size(); j++)
+        {
+            const BenchConfig& run_config = configs[j];
+            if (run_config.winograd != config.winograd || run_config.sgemm != config.sgemm || run_config.int8 != config.int8)
+                break;
+
+            ncnn::set_omp_num_threads(run_config.num_threads);
+
+            g_blob_pool_allocator.clear();
+            g_workspace_pool_allocator.clear();
+            g_stream_blob_pool_allocator.clear();
+
+#if NCNN_VULKAN
+            if (g_use_vulkan_compute)
+            {
+                g_blob_vkallocator->clear();
+                g_staging_vkallocator->clear();
+            }
+#endif // NCNN_VULKAN
+
+            if (g_cooldown > 0)
+            {
+#ifdef _WIN32
+                Sleep(g_cooldown * 1000);
+#else
+                sleep(g_cooldown);
+#endif
+            }
+
+            BenchResult result;
+            result.model = model.name;
+            result.config = run_config;
+            result.loop_count = g_loop_count;
+            result.warmup_count = warmup(net, run_config);
+
+            const bool multi_stream = run_config.streams > 1;
+            if (multi_stream)
+            {
+                // fill the shared blob pool for every stream
+                std::vector<double> warmup_times;
+                run_streams(net, run_config, 1, warmup_times);
+            }
+
+            g_workspace_pool_allocator.reset_lock_count();
+            g_stream_blob_pool_allocator.reset_lock_count();
+
+            // the gate times every loop with the profiler attached, in the baseline as well as in the comparison
+            // the streams go without, their layers overlap in time
+            ncnn::Profiler profiler;
+
+            std::vector<double> times;
+            std::vector<double> means;
+            std::vector<LayerSamples> layer_samples;
+            double wall_time = 0;
+            for (int r=0; r<g_repeat; r++)
+            {
+                profiler.clear();
+
+                const size_t first = times.size();
+                if (multi_stream)
+                {
+                    wall_time += run_streams(net, run_config, g_loop_count, times);
+                }
+                else
+                {
+                    for (int k=0; k<g_loop_count; k++)
+                    {
+                        times.push_back(run_time(net, run_config, g_gate ? &profiler : 0));
+                    }
+                }
+
+                double sum = 0;
+                for (size_t k=first; k<times.size(); k++)
+                {
+                    sum += times[k];
+                }
+                means.push_back(sum / (times.size() - first));
+
+                if (!multi_stream)
+                    wall_time += sum;
+
+                if (g_gate && !multi_stream)
+                    add_layer_means(profiler, layer_samples);
+            }
+
+            result.fps = times.size() * 1000 / wall_time;
+            result.lock_count = g_workspace_pool_allocator.lock_count() + g_stream_blob_pool_allocator.lock_count();
+            result.lock_contended_count = g_workspace_pool_allocator.lock_contended_count() + g_stream_blob_pool_allocator.lock_contended_count();
+
+            result.time = estimate(means);
+            for (size_t k=0; k<layer_samples.size(); k++)
+            {
+                BenchLayerResult layer;
+                layer.name = layer_samples[k].name;
+                layer.time = estimate(layer_samples[k].means);
+                result.layers.push_back(layer);
+            }
+
+            const int count = (int)times.size();
+
+            double sum = 0;
+            for (int k=0; k<count; k++)
+            {
+                sum += times[k];
+            }
+            result.time_avg = sum / count;
+
+            double sqsum = 0;
+            for (int k=0; k<count; k++)
+            {
+                sqsum += (times[k] - result.time_avg) * (times[k] - result.time_avg);
+            }
+            result.time_stddev = sqrt(sqsum / count);
+
+            std::sort(times.begin(), times.end());
+            result.time_min = times.front();
+            result.time_max = times.back();
+            result.time_p50 = percentile(times, 50);
+            result.time_p90 = percentile(times, 90);
+            result.time_p99 = percentile(times, 99);
+
+            char extra[128];
+            extra[0] = '\0';
+            if (g_repeat > 1)
+                sprintf(extra + strlen(extra), "  mom = %7.2f [%7.2f, %7.2f]", result.time.median, result.time.ci_low, result.time.ci_high);
+            if (multi_stream)
+                sprintf(extra + strlen(extra), "  lock contention = %5.2f%%", result.lock_count ? result.lock_contended_count * 100.0 / result.lock_count : 0.0);
+
+            fprintf(stderr, "%20s  min = %7.2f  max = %7.2f  avg = %7.2f  p50 = %7.2f  p90 = %7.2f  p99 = %7.2f  fps = %7.2f%s%s\n",
+                    model.name.c_str(), result.time_min, result.time_max, result.time_avg, result.time_p50, result.time_p90, result.time_p99,
+                    result.fps, extra, config_string(run_config, configs).c_str());
+
+            results.push_back(result);
+
+            if (g_profile)
+            {
+                profile(net, run_config);
+            }
+        }
+    }
+
+    return 0;
 }
 
-void resnet18_int8_init(ncnn::Net& net)
+// the models in this directory
+static const struct
 {
-    net.load_param("resnet18_int8.param");
-}
+    const char* name;
+    const char* param;
+    int w;
+    int h;
+    const char* output;
+    bool int8;
+} g_default_models[] = {
+    {"squeezenet", "squeezenet.param", 227, 227, "prob", false},
+    {"squeezenet-int8", "squeezenet_int8.param", 227, 227, "prob", true},
+    {"mobilenet", "mobilenet.param", 224, 224, "prob", false},
+    {"mobilenet-int8", "mobilenet_int8.param", 224, 224, "prob", true},
+    {"mobilenet_v2", "mobilenet_v2.param", 224, 224, "prob", false},
+    // {"mobilenet_v2-int8", "mobilenet_v2_int8.param", 224, 224, "prob", true},
+    {"shufflenet", "shufflenet.param", 224, 224, "fc1000", false},
+    {"mnasnet", "mnasnet.param", 224, 224, "prob", false},
+    {"proxylessnasnet", "proxylessnasnet.param", 224, 224, "prob", false},
+    {"googlenet", "googlenet.param", 224, 224, "prob", false},
+    {"googlenet-int8", "googlenet_int8.param", 224, 224, "prob", true},
+    {"resnet18", "resnet18.param", 224, 224, "prob", false},
+    {"resnet18-int8", "resnet18_int8.param", 224, 224, "prob", true},
+    {"alexnet", "alexnet.param", 227, 227, "prob", false},
+    {"vgg16", "vgg16.param", 224, 224, "prob", false},
+    {"resnet50", "resnet50.param", 224, 224, "prob", false},
+    {"resnet50-int8", "resnet50_int8.param", 224, 224, "prob", true},
+    {"squeezenet-ssd", "squeezenet_ssd.param", 300, 300, "detection_out", false},
+    {"squeezenet-ssd-int8", "squeezenet_ssd_int8.param", 300, 300, "detection_out", true},
+    {"mobilenet-ssd", "mobilenet_ssd.param", 300, 300, "detection_out", false},
+    {"mobilenet-ssd-int8", "mobilenet_ssd_int8.param", 300, 300, "detection_out", true},
+    {"mobilenet-yolo", "mobilenet_yolo.param", 416, 416, "detection_out", false},
+    {"mobilenet-yolov3", "mobilenet_yolov3.param", 416, 416, "detection_out", false},
+};
 
-void resnet18_run(const ncnn::Net& net)
+static void add_default_models(std::vector<BenchModel>& models)
 {
-    ncnn::Extractor ex = net.create_extractor();
+    for (size_t i=0; i<sizeof(g_default_models) / sizeof(g_default_models[0]); i++)
+    {
+#if NCNN_VULKAN
+        // no int8 on gpu
+        if (g_use_vulkan_compute && g_default_models[i].int8)
+            continue;
+#endif // NCNN_VULKAN
 
-    ncnn::Mat in(224, 224, 3);
-    ex.input("data", in);
+        BenchModel model;
+        model.name = g_default_models[i].name;
+        model.param = g_default_models[i].param;
 
-    ncnn::Mat out;
-    ex.extract("prob", out);
-}
+        BenchInput input;
+        input.name = "data";
+        input.w = g_default_models[i].w;
+        input.h = g_default_models[i].h;
+        input.c = 3;
+        model.inputs.push_back(input);
 
-void alexnet_init(ncnn::Net& net)
-{
-    net.load_param("alexnet.param");
+        model.outputs.push_back(g_default_models[i].output);
+
+        models.push_back(model);
+    }
 }
 
-void alexnet_run(const ncnn::Net& net)
+static std::vector<int> parse_int_list(const char* s)
 {
-    ncnn::Extractor ex = net.create_extractor();
+    std::vector<int> values;
+    while (*s)
+    {
+        values.push_back(atoi(s));
 
-    ncnn::Mat in(227, 227, 3);
-    ex.input("data", in);
+        const char* comma = strchr(s, ',');
+        if (!comma)
+            break;
 
-    ncnn::Mat out;
-    ex.extract("prob", out);
+        s = comma + 1;
+    }
+
+    return values;
 }
 
-void vgg16_init(ncnn::Net& net)
+// [name:]w,h,c
+static int parse_input(const char* s, BenchInput& input)
 {
-    net.load_param("vgg16.param");
+    const char* colon = strrchr(s, ':');
+    input.name = colon ? std::string(s, colon - s) : std::string();
+
+    if (sscanf(colon ? colon + 1 : s, "%d,%d,%d", &input.w, &input.h, &input.c) != 3)
+        return -1;
+
+    return 0;
 }
 
-void vgg16_int8_init(ncnn::Net& net)
+static void fprint_json_string(FILE* fp, const std::string& s)
 {
-    net.load_param("vgg16_int8.param");
+    fputc('"', fp);
+    for (size_t i=0; i<s.size(); i++)
+    {
+        if (s[i] == '"' || s[i] == '\\')
+            fputc('\\', fp);
+        fputc(s[i], fp);
+    }
+    fputc('"', fp);
 }
 
-void vgg16_run(const ncnn::Net& net)
+static int save_json(const char* path, const std::vector<BenchResult>& results, int powersave, int gpu_device)
 {
-    ncnn::Extractor ex = net.create_extractor();
+    FILE* fp = fopen(path, "wb");
+    if (!fp)
+    {
+        fprintf(stderr, "fopen %s failed\n", path);
+        return -1;
+    }
 
-    ncnn::Mat in(224, 224, 3);
-    ex.input("data", in);
+    fprintf(fp, "{\n  \"cpu_count\": %d,\n  \"powersave\": %d,\n  \"gpu_device\": %d,\n  \"results\": [\n", ncnn::get_cpu_count(), powersave, gpu_device);
+    for (size_t i=0; i<results.size(); i++)
+    {
+        const BenchResult& result = results[i];
+        const BenchConfig& config = result.config;
+
+        fprintf(fp, "    {\"model\": ");
+        fprint_json_string(fp, result.model);
+        fprintf(fp, ", \"streams\": %d, \"threads\": %d, \"lightmode\": %d, \"winograd\": %d, \"sgemm\": %d, \"int8\": %d, \"threadpool\": %d, \"adaptive\": %d, \"affinity\": %d, \"loop\": %d, \"warmup\": %d, ",
+                config.streams, config.num_threads, config.lightmode, config.winograd, config.sgemm, config.int8, config.threadpool, config.adaptive, config.affinity, result.loop_count, result.warmup_count);
+        fprintf(fp, "\"min\": %.4f, \"max\": %.4f, \"avg\": %.4f, \"stddev\": %.4f, \"p50\": %.4f, \"p90\": %.4f, \"p99\": %.4f, \"fps\": %.4f, ",
+                result.time_min, result.time_max, result.time_avg, result.time_stddev, result.time_p50, result.time_p90, result.time_p99,
+                result.fps);
+        fprintf(fp, "\"lock\": %lu, \"lock_contended\": %lu, ", (unsigned long)result.lock_count, (unsigned long)result.lock_contended_count);
+        fprintf(fp, "\"repeat\": %d, \"median_of_means\": %.4f, \"ci_low\": %.4f, \"ci_high\": %.4f}%s\n",
+                g_repeat, result.time.median, result.time.ci_low, result.time.ci_high, i + 1 == results.size() ? "" : ",");
+    }
+    fprintf(fp, "  ]\n}\n");
 
-    ncnn::Mat out;
-    ex.extract("prob", out);
-}
+    fclose(fp);
 
-void resnet50_init(ncnn::Net& net)
-{
-    net.load_param("resnet50.param");
+    return 0;
 }
 
-void resnet50_int8_init(ncnn::Net& net)
+// model <name> <config> <median> <ci low> <ci high>
+// layer <name> <config> <layer> <median> <ci low> <ci high>
+static int save_baseline(const char* path, const std::vector<BenchResult>& results)
 {
-    net.load_param("resnet50_int8.param");
+    FILE* fp = fopen(path, "wb");
+    if (!fp)
+    {
+        fprintf(stderr, "fopen %s failed\n", path);
+        return -1;
+    }
+
+    fprintf(fp, "# benchncnn baseline, milliseconds, repeat = %d, loop = %d\n", g_repeat, g_loop_count);
+    for (size_t i=0; i<results.size(); i++)
+    {
+        const BenchResult& result = results[i];
+        const std::string config = config_key(result.config);
+
+        fprintf(fp, "model %s %s %.6f %.6f %.6f\n", result.model.c_str(), config.c_str(), result.time.median, result.time.ci_low, result.time.ci_high);
+
+        for (size_t j=0; j<result.layers.size(); j++)
+        {
+            const BenchLayerResult& layer = result.layers[j];
+            fprintf(fp, "layer %s %s %s %.6f %.6f %.6f\n", result.model.c_str(), config.c_str(), layer.name.c_str(), layer.time.median, layer.time.ci_low, layer.time.ci_high);
+        }
+    }
+
+    fclose(fp);
+
+    return 0;
 }
 
-void resnet50_run(const ncnn::Net& net)
+static int load_baseline(const char* path, std::vector<BaselineEntry>& entries)
 {
-    ncnn::Extractor ex = net.create_extractor();
+    FILE* fp = fopen(path, "rb");
+    if (!fp)
+    {
+        fprintf(stderr, "fopen %s failed\n", path);
+        return -1;
+    }
+
+    char line[1024];
+    while (fgets(line, sizeof(line), fp))
+    {
+        if (line[0] == '#' || line[0] == '\n')
+            continue;
+
+        char kind[16];
+        char model[256];
+        char config[256];
+        char layer[256];
+        BaselineEntry entry;
+
+        int nscan = sscanf(line, "%15s %255s %255s", kind, model, config);
+        if (nscan == 3 && strcmp(kind, "model") == 0)
+        {
+            nscan = sscanf(line, "%*s %*s %*s %lf %lf %lf", &entry.time.median, &entry.time.ci_low, &entry.time.ci_high);
+        }
+        else if (nscan == 3 && strcmp(kind, "layer") == 0)
+        {
+            layer[0] = '\0';
+            nscan = sscanf(line, "%*s %*s %*s %255s %lf %lf %lf", layer, &entry.time.median, &entry.time.ci_low, &entry.time.ci_high) - 1;
+            entry.layer = layer;
+        }
+        else
+        {
+            nscan = 0;
+        }
+
+        if (nscan != 3)
+        {
+            fprintf(stderr, "malformed baseline line %s", line);
+            fclose(fp);
+            return -1;
+        }
+
+        entry.model = model;
+        entry.config = config;
+        entries.push_back(entry);
+    }
 
-    ncnn::Mat in(224, 224, 3);
-    ex.input("data", in);
+    fclose(fp);
 
-    ncnn::Mat out;
-    ex.extract("prob", out);
+    return 0;
 }
 
-void squeezenet_ssd_init(ncnn::Net& net)
+static const BaselineEntry* find_baseline(const std::vector<BaselineEntry>& entries, const std::string& model, const std::string& config, const std::string& layer)
 {
-    net.load_param("squeezenet_ssd.param");
+    for (size_t i=0; i<entries.size(); i++)
+    {
+        if (entries[i].model == model && entries[i].config == config && entries[i].layer == layer)
+            return &entries[i];
+    }
+
+    return 0;
 }
 
-void squeezenet_ssd_int8_init(ncnn::Net& net)
+// slower past the threshold, and the intervals do not overlap so that it is not noise
+static bool is_regression(const BenchEstimate& base, const BenchEstimate& now)
 {
-    net.load_param("squeezenet_ssd_int8.param");
+    return now.median > base.median * (1 + g_threshold) && now.ci_low > base.ci_high;
 }
 
-void squeezenet_ssd_run(const ncnn::Net& net)
+static bool is_improvement(const BenchEstimate& base, const BenchEstimate& now)
 {
-    ncnn::Extractor ex = net.create_extractor();
-
-    ncnn::Mat in(300, 300, 3);
-    ex.input("data", in);
-
-    ncnn::Mat out;
-    ex.extract("detection_out", out);
+    return now.median < base.median * (1 - g_threshold) && now.ci_high < base.ci_low;
 }
 
-void mobilenet_ssd_init(ncnn::Net& net)
+static void print_comparison(const char* name, const BenchEstimate& base, const BenchEstimate& now, const char* status)
 {
-    net.load_param("mobilenet_ssd.param");
+    fprintf(stderr, "%20s  base = %7.2f [%7.2f, %7.2f]  now = %7.2f [%7.2f, %7.2f]  %+7.1f%%  %s\n",
+            name, base.median, base.ci_low, base.ci_high, now.median, now.ci_low, now.ci_high,
+            base.median > 0 ? (now.median / base.median - 1) * 100 : 0.0, status);
 }
 
-void mobilenet_ssd_int8_init(ncnn::Net& net)
+static const BenchResult* find_result(const std::vector<BenchResult>& results, const std::string& model, const std::string& config)
 {
-    net.load_param("mobilenet_ssd_int8.param");
+    for (size_t i=0; i<results.size(); i++)
+    {
+        if (results[i].model == model && config_key(results[i].config) == config)
+            return &results[i];
+    }
+
+    return 0;
 }
 
-void mobilenet_ssd_run(const ncnn::Net& net)
+// return the number of regressions, a baseline model and config without result counts as one
+static int compare_baseline(const std::vector<BaselineEntry>& entries, const std::vector<BenchResult>& results, const std::vector<BenchConfig>& configs)
 {
-    ncnn::Extractor ex = net.create_extractor();
+    fprintf(stderr, "compare with baseline, threshold = %.1f%%\n", g_threshold * 100);
 
-    ncnn::Mat in(300, 300, 3);
-    ex.input("data", in);
+    int regressions = 0;
+    for (size_t i=0; i<entries.size(); i++)
+    {
+        const BaselineEntry* base = &entries[i];
+        if (!base->layer.empty())
+            continue;
 
-    ncnn::Mat out;
-    ex.extract("detection_out", out);
-}
+        const BenchResult* result = find_result(results, base->model, base->config);
+        if (!result)
+        {
+            fprintf(stderr, "%20s  MISSING  %s\n", base->model.c_str(), base->config.c_str());
+            regressions++;
+            continue;
+        }
 
-void mobilenet_yolo_init(ncnn::Net& net)
-{
-    net.load_param("mobilenet_yolo.param");
-}
+        const char* status = is_regression(base->time, result->time) ? "REGRESSION" : is_improvement(base->time, result->time) ? "improved" : "ok";
+        print_comparison(result->model.c_str(), base->time, result->time, status);
 
-void mobilenet_yolo_run(const ncnn::Net& net)
-{
-    ncnn::Extractor ex = net.create_extractor();
+        if (is_regression(base->time, result->time))
+            regressions++;
 
-    ncnn::Mat in(416, 416, 3);
-    ex.input("data", in);
+        // list the layers that regressed, the tiny ones are left out
+        for (size_t j=0; j<result->layers.size(); j++)
+        {
+            const BenchLayerResult& layer = result->layers[j];
 
-    ncnn::Mat out;
-    ex.extract("detection_out", out);
-}
+            const BaselineEntry* layer_base = find_baseline(entries, base->model, base->config, layer.name);
+            if (!layer_base || layer_base->time.median < base->time.median * g_layer_gate_ratio)
+                continue;
 
-void mobilenet_yolov3_init(ncnn::Net& net)
-{
-    net.load_param("mobilenet_yolov3.param");
-}
+            if (is_regression(layer_base->time, layer.time))
+            {
+                print_comparison(layer.name.c_str(), layer_base->time, layer.time, "REGRESSION");
+                regressions++;
+            }
+        }
+    }
 
-void mobilenet_yolov3_run(const ncnn::Net& net)
-{
-    ncnn::Extractor ex = net.create_extractor();
+    // new models and configs are not gated
+    for (size_t i=0; i<results.size(); i++)
+    {
+        const BenchResult& result = results[i];
 
-    ncnn::Mat in(416, 416, 3);
-    ex.input("data", in);
+        if (!find_baseline(entries, result.model, config_key(result.config), std::string()))
+            fprintf(stderr, "%20s  no baseline%s\n", result.model.c_str(), config_string(result.config, configs).c_str());
+    }
 
-    ncnn::Mat out;
-    ex.extract("detection_out", out);
+    return regressions;
+}
+
+static void show_usage(const char* argv0)
+{
+    fprintf(stderr, "usage: %s [loop count] [num threads] [powersave] [gpu device] [profile]\n", argv0);
+    fprintf(stderr, "       %s [key=value]...\n", argv0);
+    fprintf(stderr, "param=model.param         model to measure, repeat for more, default the models in this directory\n");
+    fprintf(stderr, "bin=model.bin             weight of the last param, default constant weight\n");
+    fprintf(stderr, "shape=[name:]w,h,c        input shape of the last param, default the Input layer shape\n");
+    fprintf(stderr, "output=name               blob to extract from the last param, default the unconsumed blobs\n");
+    fprintf(stderr, "numthreads=model.threads  per layer thread counts of the last param, tuned and saved when missing\n");
+    fprintf(stderr, "loop=4                    timed runs\n");
+    fprintf(stderr, "repeat=1                  timed loops, the estimate is the median of the loop means\n");
+    fprintf(stderr, "warmup=3                  warm up window, runs until two windows agree, 0 to skip\n");
+    fprintf(stderr, "tolerance=0.05            warm up window agreement\n");
+    fprintf(stderr, "cooldown=10               seconds of sleep before every measurement\n");
+    fprintf(stderr, "streams=1,2,4             concurrent extractors to sweep, default 1\n");
+    fprintf(stderr, "threads=1,2,4             thread counts per stream to sweep, default all cores\n");
+    fprintf(stderr, "lightmode=0,1             light mode values to sweep, default 1\n");
+    fprintf(stderr, "winograd=0,1              winograd convolution values to sweep, default 1\n");
+    fprintf(stderr, "sgemm=0,1                 sgemm convolution values to sweep, default 1\n");
+    fprintf(stderr, "int8=0,1                  int8 inference values to sweep, default 1\n");
+    fprintf(stderr, "threadpool=0,1            1 runs the ported layers on the ncnn thread pool, default 0\n");
+    fprintf(stderr, "adaptive=0,1              1 gives the layers with little work fewer threads, default 0\n");
+    fprintf(stderr, "affinity=0,1              1 binds every stream to its own threads cores, default 0\n");
+    fprintf(stderr, "powersave=0               0=all cores, 1=little cores only, 2=big cores only\n");
+    fprintf(stderr, "gpu=-1                    vulkan device, -1 for cpu\n");
+    fprintf(stderr, "profile=0                 1 to print time and perf counters per layer type\n");
+    fprintf(stderr, "json=result.json          save the results\n");
+    fprintf(stderr, "baseline=base.txt         save the model and layer times as a baseline\n");
+    fprintf(stderr, "compare=base.txt          compare with a baseline, exit 1 on a regression or a missing result\n");
+    fprintf(stderr, "threshold=0.05            relative slow down that counts as a regression\n");
 }
 
 int main(int argc, char** argv)
 {
-    int loop_count = 4;
-    int num_threads = ncnn::get_cpu_count();
     int powersave = 0;
     int gpu_device = -1;
-
-    if (argc >= 2)
-    {
-        loop_count = atoi(argv[1]);
-    }
-    if (argc >= 3)
+    const char* json_path = 0;
+    const char* baseline_path = 0;
+    const char* compare_path = 0;
+
+    std::vector<BenchModel> models;
+    std::vector<int> streams_list(1, 1);
+    std::vector<int> threads_list(1, ncnn::get_cpu_count());
+    std::vector<int> lightmode_list(1, 1);
+    std::vector<int> winograd_list(1, 1);
+    std::vector<int> sgemm_list(1, 1);
+    std::vector<int> int8_list(1, 1);
+    std::vector<int> threadpool_list(1, 0);
+    std::vector<int> adaptive_list(1, 0);
+    std::vector<int> affinity_list(1, 0);
+
+    if (argc >= 2 && strchr(argv[1], '=') == 0)
     {
-        num_threads = atoi(argv[2]);
+        // [loop count] [num threads] [powersave] [gpu device] [profile]
+        if (atoi(argv[1]) <= 0)
+        {
+            show_usage(argv[0]);
+            return -1;
+        }
+
+        g_loop_count = atoi(argv[1]);
+        if (argc >= 3)
+            threads_list[0] = atoi(argv[2]);
+        if (argc >= 4)
+            powersave = atoi(argv[3]);
+        if (argc >= 5)
+            gpu_device = atoi(argv[4]);
+        if (argc >= 6)
+            g_profile = atoi(argv[5]);
     }
-    if (argc >= 4)
+    else
     {
-        powersave = atoi(argv[3]);
+        for (int i=1; i<argc; i++)
+        {
+            const char* eq = strchr(argv[i], '=');
+            if (!eq)
+            {
+                fprintf(stderr, "invalid option %s\n", argv[i]);
+                show_usage(argv[0]);
+                return -1;
+            }
+
+            std::string key(argv[i], eq - argv[i]);
+            const char* value = eq + 1;
+
+            // bin shape output and numthreads belong to the param before them
+            if ((key == "bin" || key == "shape" || key == "output" || key == "numthreads") && models.empty())
+            {
+                fprintf(stderr, "%s needs a param before it\n", key.c_str());
+                return -1;
+            }
+
+            if (key == "param")
+            {
+                BenchModel model;
+                model.param = value;
+
+                // file name without directory and extension
+                const char* slash = strrchr(value, '/');
+                model.name = slash ? slash + 1 : value;
+                size_t dot = model.name.rfind(".param");
+                if (dot != std::string::npos)
+                    model.name = model.name.substr(0, dot);
+
+                models.push_back(model);
+            }
+            else if (key == "bin")
+                models.back().bin = value;
+            else if (key == "shape")
+            {
+                BenchInput input;
+                if (parse_input(value, input) != 0)
+                {
+                    fprintf(stderr, "malformed shape %s\n", value);
+                    return -1;
+                }
+                models.back().inputs.push_back(input);
+            }
+            else if (key == "output")
+                models.back().outputs.push_back(value);
+            else if (key == "numthreads")
+                models.back().num_threads_path = value;
+            else if (key == "loop")
+                g_loop_count = atoi(value);
+            else if (key == "repeat")
+                g_repeat = atoi(value);
+            else if (key == "warmup")
+                g_warmup = atoi(value);
+            else if (key == "tolerance")
+                g_warmup_tolerance = atof(value);
+            else if (key == "cooldown")
+                g_cooldown = atoi(value);
+            else if (key == "streams")
+                streams_list = parse_int_list(value);
+            else if (key == "threads")
+                threads_list = parse_int_list(value);
+            else if (key == "lightmode")
+                lightmode_list = parse_int_list(value);
+            else if (key == "winograd")
+                winograd_list = parse_int_list(value);
+            else if (key == "sgemm")
+                sgemm_list = parse_int_list(value);
+            else if (key == "int8")
+                int8_list = parse_int_list(value);
+            else if (key == "threadpool")
+                threadpool_list = parse_int_list(value);
+            else if (key == "adaptive")
+                adaptive_list = parse_int_list(value);
+            else if (key == "affinity")
+                affinity_list = parse_int_list(value);
+            else if (key == "powersave")
+                powersave = atoi(value);
+            else if (key == "gpu")
+                gpu_device = atoi(value);
+            else if (key == "profile")
+                g_profile = atoi(value);
+            else if (key == "json")
+                json_path = value;
+            else if (key == "baseline")
+                baseline_path = value;
+            else if (key == "compare")
+                compare_path = value;
+            else if (key == "threshold")
+                g_threshold = atof(value);
+            else
+            {
+                fprintf(stderr, "unknown option %s\n", key.c_str());
+                show_usage(argv[0]);
+                return -1;
+            }
+        }
     }
-    if (argc >= 5)
+
+    if (g_loop_count <= 0 || g_repeat <= 0 || streams_list.empty() || threads_list.empty() || lightmode_list.empty() || winograd_list.empty() || sgemm_list.empty() || int8_list.empty() || threadpool_list.empty() || adaptive_list.empty() || affinity_list.empty())
     {
-        gpu_device = atoi(argv[4]);
+        show_usage(argv[0]);
+        return -1;
     }
 
-    g_loop_count = loop_count;
+    // read the baseline before the long run so that a bad path fails early
+    std::vector<BaselineEntry> baseline;
+    if (compare_path && load_baseline(compare_path, baseline) != 0)
+        return -1;
+
+    g_gate = baseline_path || compare_path;
+
+    if (g_gate && g_repeat < 3)
+        fprintf(stderr, "repeat = %d is too few for a confidence interval, use 3 or more for the regression gate\n", g_repeat);
 
     g_blob_pool_allocator.set_size_compare_ratio(0.0f);
     g_workspace_pool_allocator.set_size_compare_ratio(0.5f);
+    g_stream_blob_pool_allocator.set_size_compare_ratio(0.0f);
 
 #if NCNN_VULKAN
     g_use_vulkan_compute = gpu_device != -1;
@@ -490,7 +1411,7 @@ int main(int argc, char** argv)
 
     ncnn::Option opt;
     opt.lightmode = true;
-    opt.num_threads = num_threads;
+    opt.num_threads = threads_list[0];
     opt.blob_allocator = &g_blob_pool_allocator;
     opt.workspace_allocator = &g_workspace_pool_allocator;
 
@@ -506,83 +1427,82 @@ int main(int argc, char** argv)
     ncnn::set_cpu_powersave(powersave);
 
     ncnn::set_omp_dynamic(0);
-    ncnn::set_omp_num_threads(num_threads);
+    ncnn::set_omp_num_threads(threads_list[0]);
+
+    if (models.empty())
+        add_default_models(models);
+
+    // group the configs by the load time options so that each net loads once per group
+    std::vector<BenchConfig> configs;
+    for (size_t i=0; i<winograd_list.size(); i++)
+    {
+        for (size_t j=0; j<sgemm_list.size(); j++)
+        {
+            for (size_t k=0; k<int8_list.size(); k++)
+            {
+                for (size_t n=0; n<streams_list.size(); n++)
+                {
+                    for (size_t t=0; t<threads_list.size(); t++)
+                    {
+                        for (size_t l=0; l<lightmode_list.size(); l++)
+                        {
+                            for (size_t e=0; e<threadpool_list.size(); e++)
+                            {
+                                for (size_t a=0; a<adaptive_list.size(); a++)
+                                {
+                                    for (size_t b=0; b<affinity_list.size(); b++)
+                                    {
+                                        BenchConfig config;
+                                        config.streams = streams_list[n];
+                                        config.num_threads = threads_list[t];
+                                        config.lightmode = lightmode_list[l];
+                                        config.winograd = winograd_list[i];
+                                        config.sgemm = sgemm_list[j];
+                                        config.int8 = int8_list[k];
+                                        config.threadpool = threadpool_list[e];
+                                        config.adaptive = adaptive_list[a];
+                                        config.affinity = affinity_list[b];
+                                        configs.push_back(config);
+                                    }
+                                }
+                            }
+                        }
+                    }
+                }
+            }
+        }
+    }
 
     fprintf(stderr, "loop_count = %d\n", g_loop_count);
-    fprintf(stderr, "num_threads = %d\n", num_threads);
+    fprintf(stderr, "repeat = %d\n", g_repeat);
+    fprintf(stderr, "streams = %d\n", streams_list[0]);
+    fprintf(stderr, "num_threads = %d\n", threads_list[0]);
     fprintf(stderr, "powersave = %d\n", ncnn::get_cpu_powersave());
     fprintf(stderr, "gpu_device = %d\n", gpu_device);
+    fprintf(stderr, "profile = %d\n", g_profile);
 
-    // run
-    benchmark("squeezenet", squeezenet_init, squeezenet_run);
-
-#if NCNN_VULKAN
-    if (!g_use_vulkan_compute)
-#endif // NCNN_VULKAN
-    benchmark("squeezenet-int8", squeezenet_int8_init, squeezenet_run);
-
-    benchmark("mobilenet", mobilenet_init, mobilenet_run);
-
-#if NCNN_VULKAN
-    if (!g_use_vulkan_compute)
-#endif // NCNN_VULKAN
-    benchmark("mobilenet-int8", mobilenet_int8_init, mobilenet_run);
-
-    benchmark("mobilenet_v2", mobilenet_v2_init, mobilenet_v2_run);
-
-// #if NCNN_VULKAN
-//     if (!g_use_vulkan_compute)
-// #endif // NCNN_VULKAN
-//     benchmark("mobilenet_v2-int8", mobilenet_v2_int8_init, mobilenet_v2_run);
-
-    benchmark("shufflenet", shufflenet_init, shufflenet_run);
-
-    benchmark("mnasnet", mnasnet_init, mnasnet_run);
-
-    benchmark("proxylessnasnet", proxylessnasnet_init, proxylessnasnet_run);
-
-    benchmark("googlenet", googlenet_init, googlenet_run);
-
-#if NCNN_VULKAN
-    if (!g_use_vulkan_compute)
-#endif // NCNN_VULKAN
-    benchmark("googlenet-int8", googlenet_int8_init, googlenet_run);
-
-    benchmark("resnet18", resnet18_init, resnet18_run);
-
-#if NCNN_VULKAN
-    if (!g_use_vulkan_compute)
-#endif // NCNN_VULKAN
-    benchmark("resnet18-int8", resnet18_int8_init, resnet18_run);
-
-    benchmark("alexnet", alexnet_init, alexnet_run);
-
-    benchmark("vgg16", vgg16_init, vgg16_run);
-
-    benchmark("resnet50", resnet50_init, resnet50_run);
-
-#if NCNN_VULKAN
-    if (!g_use_vulkan_compute)
-#endif // NCNN_VULKAN
-    benchmark("resnet50-int8", resnet50_int8_init, resnet50_run);
-
-    benchmark("squeezenet-ssd", squeezenet_ssd_init, squeezenet_ssd_run);
-
-#if NCNN_VULKAN
-    if (!g_use_vulkan_compute)
-#endif // NCNN_VULKAN
-    benchmark("squeezenet-ssd-int8", squeezenet_ssd_int8_init, squeezenet_ssd_run);
+    // run, a model that fails does not stop the others
+    int failures = 0;
+    std::vector<BenchResult> results;
+    for (size_t i=0; i<models.size(); i++)
+    {
+        if (benchmark(models[i], configs, results) != 0)
+            failures++;
+    }
 
-    benchmark("mobilenet-ssd", mobilenet_ssd_init, mobilenet_ssd_run);
+    if (json_path && save_json(json_path, results, powersave, gpu_device) != 0)
+        failures++;
 
-#if NCNN_VULKAN
-    if (!g_use_vulkan_compute)
-#endif // NCNN_VULKAN
-    benchmark("mobilenet-ssd-int8", mobilenet_ssd_int8_init, mobilenet_ssd_run);
+    if (baseline_path && save_baseline(baseline_path, results) != 0)
+        failures++;
 
-    benchmark("mobilenet-yolo", mobilenet_yolo_init, mobilenet_yolo_run);
+    int regressions = 0;
+    if (compare_path)
+    {
+        regressions = compare_baseline(baseline, results, configs);
 
-    benchmark("mobilenet-yolov3", mobilenet_yolov3_init, mobilenet_yolov3_run);
+        fprintf(stderr, "%d regressions\n", regressions);
+    }
 
 #if NCNN_VULKAN
     delete g_blob_vkallocator;
@@ -591,5 +1511,8 @@ int main(int argc, char** argv)
     delete g_vkdev;
 #endif // NCNN_VULKAN
 
-    return 0;
+    if (failures)
+        fprintf(stderr, "%d failures\n", failures);
+
+    return regressions || failures ? 1 : 0;
 }
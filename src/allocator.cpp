@@ -28,6 +28,8 @@ Allocator::~Allocator()
 PoolAllocator::PoolAllocator()
 {
     size_compare_ratio = 192;// 0.75f * 256
+
+    reset_lock_count();
 }
 
 PoolAllocator::~PoolAllocator()
@@ -74,7 +76,7 @@ void PoolAllocator::set_size_compare_ratio(float scr)
 
 void* PoolAllocator::fastMalloc(size_t size)
 {
-    budgets_lock.lock();
+    lock(budgets_lock, budgets_lock_count, budgets_lock_contended);
 
     // find free budget
     std::list< std::pair<size_t, void*> >::iterator it = budgets.begin();
@@ -91,7 +93,7 @@ void* PoolAllocator::fastMalloc(size_t size)
 
             budgets_lock.unlock();
 
-            payouts_lock.lock();
+            lock(payouts_lock, payouts_lock_count, payouts_lock_contended);
 
             payouts.push_back(std::make_pair(bs, ptr));
 
@@ -106,7 +108,7 @@ void* PoolAllocator::fastMalloc(size_t size)
     // new
     void* ptr = ncnn::fastMalloc(size);
 
-    payouts_lock.lock();
+    lock(payouts_lock, payouts_lock_count, payouts_lock_contended);
 
     payouts.push_back(std::make_pair(size, ptr));
 
@@ -117,7 +119,7 @@ void* PoolAllocator::fastMalloc(size_t size)
 
 void PoolAllocator::fastFree(void* ptr)
 {
-    payouts_lock.lock();
+    lock(payouts_lock, payouts_lock_count, payouts_lock_contended);
 
     // return to budgets
     std::list< std::pair<size_t, void*> >::iterator it = payouts.begin();
@@ -131,7 +133,7 @@ void PoolAllocator::fastFree(void* ptr)
 
             payouts_lock.unlock();
 
-            budgets_lock.lock();
+            lock(budgets_lock, budgets_lock_count, budgets_lock_contended);
 
             budgets.push_back(std::make_pair(size, ptr));
 
@@ -147,6 +149,25 @@ void PoolAllocator::fastFree(void* ptr)
     ncnn::fastFree(ptr);
 }
 
+void PoolAllocator::reset_lock_count()
+{
+    budgets_lock_count = 0;
+    budgets_lock_contended = 0;
+    payouts_lock_count = 0;
+    payouts_lock_contended = 0;
+}
+
+void PoolAllocator::lock(Mutex& mutex, size_t& count, size_t& contended)
+{
+    bool waited = !mutex.trylock();
+    if (waited)
+        mutex.lock();
+
+    count++;
+    if (waited)
+        contended++;
+}
+
 UnlockedPoolAllocator::UnlockedPoolAllocator()
 {
     size_compare_ratio = 192;// 0.75f * 256
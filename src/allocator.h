@@ -126,11 +126,26 @@ public:
     Mutex() { InitializeSRWLock(&srwlock); }
     ~Mutex() {}
     void lock() { AcquireSRWLockExclusive(&srwlock); }
+    // NOTE TryAcquireSRWLockExclusive is available from windows 7
+    bool trylock() { return TryAcquireSRWLockExclusive(&srwlock) != 0; }
     void unlock() { ReleaseSRWLockExclusive(&srwlock); }
 private:
+    friend class ConditionVariable;
     // NOTE SRWLock is available from windows vista
     SRWLOCK srwlock;
 };
+
+class ConditionVariable
+{
+public:
+    ConditionVariable() { InitializeConditionVariable(&condvar); }
+    ~ConditionVariable() {}
+    void wait(Mutex& mutex) { SleepConditionVariableSRW(&condvar, &mutex.srwlock, INFINITE, 0); }
+    void broadcast() { WakeAllConditionVariable(&condvar); }
+    void signal() { WakeConditionVariable(&condvar); }
+private:
+    CONDITION_VARIABLE condvar;
+};
 #else // _WIN32
 class Mutex
 {
@@ -138,10 +153,24 @@ public:
     Mutex() { pthread_mutex_init(&mutex, 0); }
     ~Mutex() { pthread_mutex_destroy(&mutex); }
     void lock() { pthread_mutex_lock(&mutex); }
+    bool trylock() { return pthread_mutex_trylock(&mutex) == 0; }
     void unlock() { pthread_mutex_unlock(&mutex); }
 private:
+    friend class ConditionVariable;
     pthread_mutex_t mutex;
 };
+
+class ConditionVariable
+{
+public:
+    ConditionVariable() { pthread_cond_init(&cond, 0); }
+    ~ConditionVariable() { pthread_cond_destroy(&cond); }
+    void wait(Mutex& mutex) { pthread_cond_wait(&cond, &mutex.mutex); }
+    void broadcast() { pthread_cond_broadcast(&cond); }
+    void signal() { pthread_cond_signal(&cond); }
+private:
+    pthread_cond_t cond;
+};
 #endif // _WIN32
 
 class MutexLockGuard
@@ -177,9 +206,23 @@ public:
     virtual void* fastMalloc(size_t size);
     virtual void fastFree(void* ptr);
 
+    // lock acquisitions and the ones that waited for another thread since the last reset
+    // read them when no thread allocates
+    size_t lock_count() const { return budgets_lock_count + payouts_lock_count; }
+    size_t lock_contended_count() const { return budgets_lock_contended + payouts_lock_contended; }
+    void reset_lock_count();
+
 private:
+    // count the acquisition, and the contention when the lock is held by another thread
+    static void lock(Mutex& mutex, size_t& count, size_t& contended);
+
     Mutex budgets_lock;
     Mutex payouts_lock;
+    // counted under the lock they belong to
+    size_t budgets_lock_count;
+    size_t budgets_lock_contended;
+    size_t payouts_lock_count;
+    size_t payouts_lock_contended;
     unsigned int size_compare_ratio;// 0~256
     std::list< std::pair<size_t, void*> > budgets;
     std::list< std::pair<size_t, void*> > payouts;
@@ -16,7 +16,7 @@
 #define WIN32_LEAN_AND_MEAN
 #include <windows.h>
 #else // _WIN32
-#include <sys/time.h>
+#include <time.h>
 #endif // _WIN32
 
 #include "benchmark.h"
@@ -44,19 +44,28 @@ double get_current_time()
 #else // _WIN32
 double get_current_time()
 {
-    struct timeval tv;
-    gettimeofday(&tv, NULL);
+    // monotonic, not affected by wall clock adjustment
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
 
-    return tv.tv_sec * 1000.0 + tv.tv_usec / 1000.0;
+    return ts.tv_sec * 1000.0 + ts.tv_nsec / 1000000.0;
 }
 #endif // _WIN32
 
 #if NCNN_BENCHMARK
 
-void benchmark(const Layer* layer, double start, double end)
+void benchmark(const Layer* layer, const std::vector<Mat>& bottom_blobs, std::vector<Mat>& top_blobs, double start, double end)
 {
     fprintf(stderr, "%-24s %-30s %8.2lfms", layer->type.c_str(), layer->name.c_str(), end - start);
     fprintf(stderr, "    |");
+    for (size_t i=0; i<bottom_blobs.size(); i++)
+    {
+        fprintf(stderr, "    in%d: %d x %d x %d", (int)i, bottom_blobs[i].w, bottom_blobs[i].h, bottom_blobs[i].c);
+    }
+    for (size_t i=0; i<top_blobs.size(); i++)
+    {
+        fprintf(stderr, "    out%d: %d x %d x %d", (int)i, top_blobs[i].w, top_blobs[i].h, top_blobs[i].c);
+    }
     fprintf(stderr, "\n");
 }
 
@@ -26,7 +26,7 @@ double get_current_time();
 
 #if NCNN_BENCHMARK
 
-void benchmark(const Layer* layer, double start, double end);
+void benchmark(const Layer* layer, const std::vector<Mat>& bottom_blobs, std::vector<Mat>& top_blobs, double start, double end);
 void benchmark(const Layer* layer, const Mat& bottom_blob, Mat& top_blob, double start, double end);
 
 #endif // NCNN_BENCHMARK
@@ -16,13 +16,14 @@
 
 #include <stdio.h>
 #include <string.h>
+#include <algorithm>
 #include <vector>
 
 #ifdef _OPENMP
 #include <omp.h>
 #endif
 
-#ifdef __ANDROID__
+#if defined __ANDROID__ || defined __linux__
 #include <sys/syscall.h>
 #include <unistd.h>
 #include <stdint.h>
@@ -40,6 +41,52 @@
 
 namespace ncnn {
 
+CpuSet::CpuSet()
+{
+    disable_all();
+}
+
+void CpuSet::enable(int cpu)
+{
+    if (cpu < 0 || cpu >= max_cpu_count)
+        return;
+
+    bits[cpu / (8 * sizeof(unsigned long))] |= 1UL << (cpu % (8 * sizeof(unsigned long)));
+}
+
+void CpuSet::disable(int cpu)
+{
+    if (cpu < 0 || cpu >= max_cpu_count)
+        return;
+
+    bits[cpu / (8 * sizeof(unsigned long))] &= ~(1UL << (cpu % (8 * sizeof(unsigned long))));
+}
+
+void CpuSet::disable_all()
+{
+    memset(bits, 0, sizeof(bits));
+}
+
+bool CpuSet::is_enabled(int cpu) const
+{
+    if (cpu < 0 || cpu >= max_cpu_count)
+        return false;
+
+    return (bits[cpu / (8 * sizeof(unsigned long))] >> (cpu % (8 * sizeof(unsigned long)))) & 1;
+}
+
+int CpuSet::num_enabled() const
+{
+    int count = 0;
+    for (int i=0; i<max_cpu_count; i++)
+    {
+        if (is_enabled(i))
+            count++;
+    }
+
+    return count;
+}
+
 #ifdef __ANDROID__
 
 // extract the ELF HW capabilities bitmap from /proc/self/auxv
@@ -244,6 +291,312 @@ int get_cpu_count()
     return g_cpucount;
 }
 
+#if defined __ANDROID__ || defined __linux__
+static int set_sched_affinity(const CpuSet& thread_affinity_mask)
+{
+    // the kernel cpu_set_t layout, spelled out for the libc that lacks it
+    // ref http://stackoverflow.com/questions/16319725/android-set-thread-affinity
+    const int ncpubits = 8 * sizeof(unsigned long);
+    unsigned long mask[CpuSet::max_cpu_count / (8 * sizeof(unsigned long))];
+    memset(mask, 0, sizeof(mask));
+    for (int i=0; i<CpuSet::max_cpu_count; i++)
+    {
+        if (thread_affinity_mask.is_enabled(i))
+            mask[i / ncpubits] |= 1UL << (i % ncpubits);
+    }
+
+    // set affinity for thread
+#if defined __GLIBC__ || !defined __ANDROID__
+    pid_t pid = syscall(SYS_gettid);
+#else
+#ifdef PI3
+    pid_t pid = getpid();
+#else
+    pid_t pid = gettid();
+#endif
+#endif
+
+    int syscallret = syscall(__NR_sched_setaffinity, pid, sizeof(mask), mask);
+    if (syscallret)
+    {
+        fprintf(stderr, "syscall error %d\n", syscallret);
+        return -1;
+    }
+
+    return 0;
+}
+
+// parse a /sys cpu list such as 0-3,8-11
+static int read_cpu_list(const char* path, CpuSet& set)
+{
+    FILE* fp = fopen(path, "rb");
+    if (!fp)
+        return -1;
+
+    set.disable_all();
+
+    for (;;)
+    {
+        int first = -1;
+        if (fscanf(fp, "%d", &first) != 1)
+            break;
+
+        int last = first;
+        int c = fgetc(fp);
+        if (c == '-')
+        {
+            if (fscanf(fp, "%d", &last) != 1)
+                break;
+
+            c = fgetc(fp);
+        }
+
+        for (int i=first; i<=last; i++)
+        {
+            set.enable(i);
+        }
+
+        if (c != ',')
+            break;
+    }
+
+    fclose(fp);
+
+    return 0;
+}
+
+static int read_int(const char* path, int* value)
+{
+    FILE* fp = fopen(path, "rb");
+    if (!fp)
+        return -1;
+
+    int nscan = fscanf(fp, "%d", value);
+
+    fclose(fp);
+
+    return nscan == 1 ? 0 : -1;
+}
+
+static int lowest_enabled(const CpuSet& set)
+{
+    for (int i=0; i<CpuSet::max_cpu_count; i++)
+    {
+        if (set.is_enabled(i))
+            return i;
+    }
+
+    return -1;
+}
+
+// the cpus sharing the highest level data or unified cache of cpuid
+static int get_last_level_cache_id(int cpuid)
+{
+    int cache_id = -1;
+    int cache_level = 0;
+
+    for (int i=0; ; i++)
+    {
+        char path[256];
+        sprintf(path, "/sys/devices/system/cpu/cpu%d/cache/index%d/level", cpuid, i);
+
+        int level = 0;
+        if (read_int(path, &level) != 0)
+            break;
+
+        if (level <= cache_level)
+            continue;
+
+        sprintf(path, "/sys/devices/system/cpu/cpu%d/cache/index%d/type", cpuid, i);
+        FILE* fp = fopen(path, "rb");
+        if (!fp)
+            continue;
+
+        char type[32] = {0};
+        int nscan = fscanf(fp, "%31s", type);
+        fclose(fp);
+
+        if (nscan != 1 || strcmp(type, "Instruction") == 0)
+            continue;
+
+        CpuSet shared;
+        sprintf(path, "/sys/devices/system/cpu/cpu%d/cache/index%d/shared_cpu_list", cpuid, i);
+        if (read_cpu_list(path, shared) != 0)
+            continue;
+
+        cache_id = lowest_enabled(shared);
+        cache_level = level;
+    }
+
+    return cache_id;
+}
+#endif // defined __ANDROID__ || defined __linux__
+
+int get_cpu_topology(std::vector<CpuTopology>& topology)
+{
+    topology.clear();
+
+#if defined __ANDROID__ || defined __linux__
+    CpuSet online;
+    if (read_cpu_list("/sys/devices/system/cpu/online", online) != 0)
+    {
+        fprintf(stderr, "read /sys/devices/system/cpu/online failed\n");
+        return -1;
+    }
+
+    for (int i=0; i<CpuSet::max_cpu_count; i++)
+    {
+        if (!online.is_enabled(i))
+            continue;
+
+        CpuTopology t;
+        t.cpu = i;
+
+        char path[256];
+        sprintf(path, "/sys/devices/system/cpu/cpu%d/topology/physical_package_id", i);
+        if (read_int(path, &t.package_id) != 0)
+            t.package_id = 0;
+
+        CpuSet siblings;
+        sprintf(path, "/sys/devices/system/cpu/cpu%d/topology/thread_siblings_list", i);
+        t.core_id = read_cpu_list(path, siblings) == 0 ? lowest_enabled(siblings) : -1;
+        if (t.core_id < 0)
+            t.core_id = i;
+
+        t.cache_id = get_last_level_cache_id(i);
+
+        topology.push_back(t);
+    }
+
+    return 0;
+#else
+    // no /sys topology on this platform, only on linux and android
+    return -1;
+#endif
+}
+
+// physical cores sharing one socket and cache domain
+struct CpuDomain
+{
+    int package_id;
+    int cache_id;
+    std::vector<int> core_ids;
+};
+
+static void group_cores(const std::vector<CpuTopology>& topology, bool by_cache, std::vector<CpuDomain>& domains)
+{
+    domains.clear();
+
+    for (size_t i=0; i<topology.size(); i++)
+    {
+        const CpuTopology& t = topology[i];
+
+        // one entry per core, its lowest sibling
+        if (t.core_id != t.cpu)
+            continue;
+
+        const int cache_id = by_cache ? t.cache_id : -1;
+
+        size_t j = 0;
+        for (; j<domains.size(); j++)
+        {
+            if (domains[j].package_id == t.package_id && domains[j].cache_id == cache_id)
+                break;
+        }
+
+        if (j == domains.size())
+        {
+            CpuDomain domain;
+            domain.package_id = t.package_id;
+            domain.cache_id = cache_id;
+            domains.push_back(domain);
+        }
+
+        domains[j].core_ids.push_back(t.core_id);
+    }
+}
+
+static size_t max_domain_size(const std::vector<CpuDomain>& domains)
+{
+    size_t size = 0;
+    for (size_t i=0; i<domains.size(); i++)
+    {
+        size = std::max(size, domains[i].core_ids.size());
+    }
+
+    return size;
+}
+
+int get_cpu_slots(int cores_per_slot, std::vector<CpuSet>& slots, bool use_smt_siblings)
+{
+    slots.clear();
+
+    if (cores_per_slot <= 0)
+        return 0;
+
+    std::vector<CpuTopology> topology;
+    if (get_cpu_topology(topology) != 0)
+        return 0;
+
+    // the narrowest domain a slot fits in, cache domain then socket then machine
+    std::vector<CpuDomain> domains;
+    group_cores(topology, true, domains);
+
+    if ((int)max_domain_size(domains) < cores_per_slot)
+        group_cores(topology, false, domains);
+
+    if ((int)max_domain_size(domains) < cores_per_slot)
+    {
+        CpuDomain machine;
+        machine.package_id = 0;
+        machine.cache_id = -1;
+        for (size_t i=0; i<domains.size(); i++)
+        {
+            machine.core_ids.insert(machine.core_ids.end(), domains[i].core_ids.begin(), domains[i].core_ids.end());
+        }
+
+        domains.assign(1, machine);
+    }
+
+    for (size_t i=0; i<domains.size(); i++)
+    {
+        const std::vector<int>& core_ids = domains[i].core_ids;
+
+        for (size_t j=0; j+cores_per_slot<=core_ids.size(); j+=cores_per_slot)
+        {
+            CpuSet slot;
+            for (int k=0; k<cores_per_slot; k++)
+            {
+                const int core_id = core_ids[j + k];
+
+                for (size_t q=0; q<topology.size(); q++)
+                {
+                    if (topology[q].core_id != core_id)
+                        continue;
+
+                    if (use_smt_siblings || topology[q].cpu == core_id)
+                        slot.enable(topology[q].cpu);
+                }
+            }
+
+            slots.push_back(slot);
+        }
+    }
+
+    return (int)slots.size();
+}
+
+int set_cpu_thread_affinity(const CpuSet& mask)
+{
+#if defined __ANDROID__ || defined __linux__
+    return set_sched_affinity(mask);
+#else
+    // thread affinity not supported on this platform, only on linux and android
+    (void)mask;
+    return -1;
+#endif
+}
+
 #ifdef __ANDROID__
 static int get_max_freq_khz(int cpuid)
 {
@@ -294,50 +647,6 @@ static int get_max_freq_khz(int cpuid)
     return max_freq_khz;
 }
 
-static int set_sched_affinity(const std::vector<int>& cpuids)
-{
-    // cpu_set_t definition
-    // ref http://stackoverflow.com/questions/16319725/android-set-thread-affinity
-#define CPU_SETSIZE 1024
-#define __NCPUBITS  (8 * sizeof (unsigned long))
-typedef struct
-{
-   unsigned long __bits[CPU_SETSIZE / __NCPUBITS];
-} cpu_set_t;
-
-#define CPU_SET(cpu, cpusetp) \
-  ((cpusetp)->__bits[(cpu)/__NCPUBITS] |= (1UL << ((cpu) % __NCPUBITS)))
-
-#define CPU_ZERO(cpusetp) \
-  memset((cpusetp), 0, sizeof(cpu_set_t))
-
-    // set affinity for thread
-#ifdef __GLIBC__
-    pid_t pid = syscall(SYS_gettid);
-#else
-#ifdef PI3
-    pid_t pid = getpid();
-#else
-    pid_t pid = gettid();
-#endif
-#endif
-    cpu_set_t mask;
-    CPU_ZERO(&mask);
-    for (int i=0; i<(int)cpuids.size(); i++)
-    {
-        CPU_SET(cpuids[i], &mask);
-    }
-
-    int syscallret = syscall(__NR_sched_setaffinity, pid, sizeof(mask), &mask);
-    if (syscallret)
-    {
-        fprintf(stderr, "syscall error %d\n", syscallret);
-        return -1;
-    }
-
-    return 0;
-}
-
 static int sort_cpuid_by_max_frequency(std::vector<int>& cpuids, int* little_cluster_offset)
 {
     const int cpu_count = cpuids.size();
@@ -450,6 +759,12 @@ int set_cpu_powersave(int powersave)
         return -1;
     }
 
+    CpuSet thread_affinity_mask;
+    for (int i=0; i<(int)cpuids.size(); i++)
+    {
+        thread_affinity_mask.enable(cpuids[i]);
+    }
+
 #ifdef _OPENMP
     // set affinity for each thread
     int num_threads = cpuids.size();
@@ -458,7 +773,7 @@ int set_cpu_powersave(int powersave)
     #pragma omp parallel for
     for (int i=0; i<num_threads; i++)
     {
-        ssarets[i] = set_sched_affinity(cpuids);
+        ssarets[i] = set_sched_affinity(thread_affinity_mask);
     }
     for (int i=0; i<num_threads; i++)
     {
@@ -468,7 +783,7 @@ int set_cpu_powersave(int powersave)
         }
     }
 #else
-    int ssaret = set_sched_affinity(cpuids);
+    int ssaret = set_sched_affinity(thread_affinity_mask);
     if (ssaret != 0)
     {
         return -1;
@@ -524,4 +839,30 @@ void set_omp_dynamic(int dynamic)
 #endif
 }
 
+int set_omp_thread_affinity(const CpuSet& mask, int num_threads)
+{
+#ifdef _OPENMP
+    // one iteration per thread of the team
+    num_threads = std::max(num_threads, 1);
+    std::vector<int> ssarets(num_threads, 0);
+    #pragma omp parallel for num_threads(num_threads) schedule(static, 1)
+    for (int i=0; i<num_threads; i++)
+    {
+        ssarets[i] = set_cpu_thread_affinity(mask);
+    }
+    for (int i=0; i<num_threads; i++)
+    {
+        if (ssarets[i] != 0)
+        {
+            return -1;
+        }
+    }
+
+    return 0;
+#else
+    (void)num_threads;
+    return set_cpu_thread_affinity(mask);
+#endif
+}
+
 } // namespace ncnn
@@ -15,8 +15,31 @@
 #ifndef NCNN_CPU_H
 #define NCNN_CPU_H
 
+#include <vector>
+
 namespace ncnn {
 
+// a set of logical cpus, numbered as /sys/devices/system/cpu/cpuN
+class CpuSet
+{
+public:
+    // empty set
+    CpuSet();
+
+    void enable(int cpu);
+    void disable(int cpu);
+    void disable_all();
+
+    bool is_enabled(int cpu) const;
+    int num_enabled() const;
+
+    // cpu index limit
+    enum { max_cpu_count = 1024 };
+
+private:
+    unsigned long bits[max_cpu_count / (8 * sizeof(unsigned long))];
+};
+
 // test optional cpu features
 // neon = armv7 neon or aarch64 asimd
 int cpu_support_arm_neon();
@@ -28,6 +51,36 @@ int cpu_support_arm_asimdhp();
 // cpu info
 int get_cpu_count();
 
+// where one logical cpu sits
+struct CpuTopology
+{
+    int cpu;
+    // socket
+    int package_id;
+    // the lowest cpu among its smt siblings, the same for every hardware thread of one core
+    int core_id;
+    // the lowest cpu sharing its last level cache, such as one L3 slice or AMD CCX
+    // -1 if unknown, then the whole socket counts as one cache domain
+    int cache_id;
+};
+
+// read the online cpus from /sys, in ascending cpu order
+// only implemented on linux and android at the moment
+// return 0 if success
+int get_cpu_topology(std::vector<CpuTopology>& topology);
+
+// split the physical cores into slots of cores_per_slot cores, for one extractor per slot
+// a slot stays inside one cache domain when the slot fits in one, otherwise inside one socket
+// no two slots share a core, smt siblings are left idle unless use_smt_siblings
+// the cores short of a whole slot in a domain are left out
+// return the number of slots
+int get_cpu_slots(int cores_per_slot, std::vector<CpuSet>& slots, bool use_smt_siblings = false);
+
+// bind the calling thread to the cpus in mask
+// only implemented on linux and android at the moment
+// return 0 if success
+int set_cpu_thread_affinity(const CpuSet& mask);
+
 // bind all threads on little clusters if powersave enabled
 // affacts HMP arch cpu like ARM big.LITTLE
 // only implemented on android at the moment
@@ -46,6 +99,10 @@ void set_omp_num_threads(int num_threads);
 int get_omp_dynamic();
 void set_omp_dynamic(int dynamic);
 
+// bind the calling thread and the num_threads openmp threads it forks to the cpus in mask
+// return 0 if success
+int set_omp_thread_affinity(const CpuSet& mask, int num_threads);
+
 } // namespace ncnn
 
 #endif // NCNN_CPU_H
@@ -28,6 +28,10 @@ Option::Option()
     num_threads = get_cpu_count();
     blob_allocator = 0;
     workspace_allocator = 0;
+    use_fp16_storage = false;
+    profiler = 0;
+    executor = 0;
+    use_adaptive_threads = false;
 
 #if NCNN_VULKAN
     vulkan_compute = false;
@@ -62,6 +66,8 @@ Layer::Layer()
     one_blob_only = false;
     support_inplace = false;
     support_vulkan = false;
+    support_fp16_storage = false;
+    shape_only = false;
 
 #if NCNN_VULKAN
     vkdev = 0;
@@ -82,6 +88,49 @@ int Layer::load_model(const ModelBin& /*mb*/)
     return 0;
 }
 
+int Layer::get_impls(std::vector<int>& impls) const
+{
+    impls.clear();
+    return 0;
+}
+
+int Layer::set_impl(int impl)
+{
+    return impl == 0 ? 0 : -1;
+}
+
+LayerCost::LayerCost()
+{
+    macs = 0;
+    flops = 0;
+    weight_bytes = 0;
+    bottom_bytes = 0;
+    top_bytes = 0;
+}
+
+// the channel step alignment is not read or written
+static size_t blob_bytes(const Mat& m)
+{
+    return (size_t)m.w * m.h * m.c * m.elemsize;
+}
+
+int Layer::get_cost(const std::vector<Mat>& bottom_blobs, const std::vector<Mat>& top_blobs, LayerCost& cost) const
+{
+    cost = LayerCost();
+
+    for (size_t i=0; i<bottom_blobs.size(); i++)
+    {
+        cost.bottom_bytes += blob_bytes(bottom_blobs[i]);
+    }
+
+    for (size_t i=0; i<top_blobs.size(); i++)
+    {
+        cost.top_bytes += blob_bytes(top_blobs[i]);
+    }
+
+    return 0;
+}
+
 int Layer::forward(const std::vector<Mat>& bottom_blobs, std::vector<Mat>& top_blobs, const Option& opt) const
 {
     if (!support_inplace)
@@ -37,6 +37,8 @@ class VkAllocator;
 #endif // NCNN_VULKAN
 
 class Allocator;
+class Profiler;
+class ParallelExecutor;
 class Option
 {
 public:
@@ -59,6 +61,24 @@ public:
     // workspace memory allocator
     Allocator* workspace_allocator;
 
+    // store intermediate blobs in half precision on cpu
+    // layers without fp16 storage support still compute in float32 blobs
+    // disabled by default
+    bool use_fp16_storage;
+
+    // record the time and shapes of every forwarded layer when set
+    // null by default
+    Profiler* profiler;
+
+    // run the parallel loops of the ported layers on this executor, such as a ThreadPool
+    // null by default, the loops run on openmp
+    ParallelExecutor* executor;
+
+    // run a layer on fewer threads when its work in the previous forward is too small to share
+    // the thread counts from Net::autotune_num_threads or Net::load_num_threads take precedence
+    // disabled by default
+    bool use_adaptive_threads;
+
 #if NCNN_VULKAN
     // enable vulkan compute
     bool vulkan_compute;
@@ -78,6 +98,28 @@ public:
 const Option& get_default_option();
 int set_default_option(const Option& opt);
 
+// analytical cost of one layer forward
+class LayerCost
+{
+public:
+    // all zero
+    LayerCost();
+
+public:
+    // multiply-accumulate count, one mac is two flops
+    unsigned long long macs;
+
+    // flops besides the macs, such as pooling and elementwise ops
+    unsigned long long flops;
+
+    // weight and bias bytes read
+    size_t weight_bytes;
+
+    // bottom blob bytes read and top blob bytes written
+    size_t bottom_bytes;
+    size_t top_bytes;
+};
+
 class Layer
 {
 public:
@@ -94,6 +136,20 @@ public:
     // return 0 if success
     virtual int load_model(const ModelBin& mb);
 
+    // list the kernel implementations usable with the loaded param and weight
+    // empty means nothing to choose from
+    // return 0 if success
+    virtual int get_impls(std::vector<int>& impls) const;
+
+    // switch to kernel implementation impl, 0 restores the default heuristic
+    // return 0 if success
+    virtual int set_impl(int impl);
+
+    // analytical cost of one forward with these bottom and top blobs
+    // the default counts the blob bytes only
+    // return 0 if success
+    virtual int get_cost(const std::vector<Mat>& bottom_blobs, const std::vector<Mat>& top_blobs, LayerCost& cost) const;
+
 public:
     // one input and one output blob
     bool one_blob_only;
@@ -104,6 +160,13 @@ public:
     // support vulkan compute
     bool support_vulkan;
 
+    // accept and produce half precision blobs on cpu
+    bool support_fp16_storage;
+
+    // top blobs depend on the bottom shapes only, never on the bottom values
+    // net memoises the top blobs for each bottom shape
+    bool shape_only;
+
 public:
     // implement inference
     // return 0 if success
@@ -390,7 +390,8 @@ int Convolution_arm::forward(const Mat& bottom_blob, Mat& top_blob, const Option
     if (use_int8_inference)
     {
         conv_int8 = conv_int8_func_table[kernel_size-1][stride-1];
-        if (!conv_int8)
+        // the neon int8 kernels have no zero point, asymmetric bottoms go to the reference path
+        if (!conv_int8 || bottom_blob_int8_zero_point != 0)
         {
             return Convolution::forward(bottom_blob, top_blob, opt);
         }
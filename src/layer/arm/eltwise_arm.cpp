@@ -24,6 +24,20 @@ DEFINE_LAYER_CREATOR(Eltwise_arm)
 
 int Eltwise_arm::forward(const std::vector<Mat>& bottom_blobs, std::vector<Mat>& top_blobs, const Option& opt) const
 {
+    // int8 bottoms and the requantized sum, the neon kernels are float only
+    if (use_int8_inference)
+    {
+        bool has_int8 = top_blob_int8_scale != 0.f;
+        for (size_t b=0; b<bottom_blobs.size(); b++)
+        {
+            if (bottom_blobs[b].elemsize == 1u)
+                has_int8 = true;
+        }
+
+        if (has_int8)
+            return Eltwise::forward(bottom_blobs, top_blobs, opt);
+    }
+
     const Mat& bottom_blob = bottom_blobs[0];
     int w = bottom_blob.w;
     int h = bottom_blob.h;
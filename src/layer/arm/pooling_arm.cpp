@@ -26,6 +26,12 @@ int Pooling_arm::forward(const Mat& bottom_blob, Mat& top_blob, const Option& op
     // max value in NxN window
     // avg value in NxN window
 
+    // int8 max pooling keeps the blob scale, the neon kernels are float only
+    if (bottom_blob.elemsize == 1u)
+    {
+        return Pooling::forward(bottom_blob, top_blob, opt);
+    }
+
     if (kernel_w != kernel_h || stride_w != stride_h)
     {
         return Pooling::forward(bottom_blob, top_blob, opt);
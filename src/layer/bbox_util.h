@@ -0,0 +1,318 @@
+// Tencent is pleased to support the open source community by making ncnn available.
+//
+// Copyright (C) 2019 THL A29 Limited, a Tencent company. All rights reserved.
+//
+// Licensed under the BSD 3-Clause License (the "License"); you may not use this file except
+// in compliance with the License. You may obtain a copy of the License at
+//
+// https://opensource.org/licenses/BSD-3-Clause
+//
+// Unless required by applicable law or agreed to in writing, software distributed
+// under the License is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR
+// CONDITIONS OF ANY KIND, either express or implied. See the License for the
+// specific language governing permissions and limitations under the License.
+
+#ifndef LAYER_BBOX_UTIL_H
+#define LAYER_BBOX_UTIL_H
+
+// detection postprocessing shared by DetectionOutput, Proposal,
+// YoloDetectionOutput and Yolov3DetectionOutput
+
+#include <float.h>
+#include <math.h>
+#include <algorithm>
+#include <vector>
+
+#if __SSE2__
+#include <emmintrin.h>
+#endif // __SSE2__
+#if __ARM_NEON
+#include <arm_neon.h>
+#endif // __ARM_NEON
+
+namespace ncnn {
+
+struct BBoxRect
+{
+    float xmin;
+    float ymin;
+    float xmax;
+    float ymax;
+    int label;
+};
+
+// picked boxes in SoA layout, so that IoU against them runs four lanes at a time
+class BBoxSoA
+{
+public:
+    void reserve(int n)
+    {
+        xmin.reserve(n);
+        ymin.reserve(n);
+        xmax.reserve(n);
+        ymax.reserve(n);
+        area.reserve(n);
+    }
+
+    void push_back(const BBoxRect& r)
+    {
+        xmin.push_back(r.xmin);
+        ymin.push_back(r.ymin);
+        xmax.push_back(r.xmax);
+        ymax.push_back(r.ymax);
+        area.push_back((r.xmax - r.xmin) * (r.ymax - r.ymin));
+    }
+
+    int size() const { return (int)area.size(); }
+
+public:
+    std::vector<float> xmin;
+    std::vector<float> ymin;
+    std::vector<float> xmax;
+    std::vector<float> ymax;
+    std::vector<float> area;
+};
+
+// return true if IoU of box a against any of boxes [0, n) exceeds nms_threshold
+// inter / union > t is evaluated as inter > union * t to stay division free
+static inline bool bbox_overlap_any(const BBoxRect& a, float area_a, const BBoxSoA& boxes, int n, float nms_threshold)
+{
+    const float* x1 = boxes.xmin.empty() ? 0 : &boxes.xmin[0];
+    const float* y1 = boxes.ymin.empty() ? 0 : &boxes.ymin[0];
+    const float* x2 = boxes.xmax.empty() ? 0 : &boxes.xmax[0];
+    const float* y2 = boxes.ymax.empty() ? 0 : &boxes.ymax[0];
+    const float* area = boxes.area.empty() ? 0 : &boxes.area[0];
+
+    int j = 0;
+#if __SSE2__
+    __m128 _ax1 = _mm_set1_ps(a.xmin);
+    __m128 _ay1 = _mm_set1_ps(a.ymin);
+    __m128 _ax2 = _mm_set1_ps(a.xmax);
+    __m128 _ay2 = _mm_set1_ps(a.ymax);
+    __m128 _aarea = _mm_set1_ps(area_a);
+    __m128 _thresh = _mm_set1_ps(nms_threshold);
+    __m128 _zero = _mm_setzero_ps();
+    for (; j+3<n; j+=4)
+    {
+        __m128 _iw = _mm_sub_ps(_mm_min_ps(_ax2, _mm_loadu_ps(x2 + j)), _mm_max_ps(_ax1, _mm_loadu_ps(x1 + j)));
+        __m128 _ih = _mm_sub_ps(_mm_min_ps(_ay2, _mm_loadu_ps(y2 + j)), _mm_max_ps(_ay1, _mm_loadu_ps(y1 + j)));
+        __m128 _inter = _mm_mul_ps(_mm_max_ps(_iw, _zero), _mm_max_ps(_ih, _zero));
+        __m128 _union = _mm_sub_ps(_mm_add_ps(_aarea, _mm_loadu_ps(area + j)), _inter);
+        __m128 _mask = _mm_cmpgt_ps(_inter, _mm_mul_ps(_union, _thresh));
+        if (_mm_movemask_ps(_mask))
+            return true;
+    }
+#elif __ARM_NEON
+    float32x4_t _ax1 = vdupq_n_f32(a.xmin);
+    float32x4_t _ay1 = vdupq_n_f32(a.ymin);
+    float32x4_t _ax2 = vdupq_n_f32(a.xmax);
+    float32x4_t _ay2 = vdupq_n_f32(a.ymax);
+    float32x4_t _aarea = vdupq_n_f32(area_a);
+    float32x4_t _thresh = vdupq_n_f32(nms_threshold);
+    float32x4_t _zero = vdupq_n_f32(0.f);
+    for (; j+3<n; j+=4)
+    {
+        float32x4_t _iw = vsubq_f32(vminq_f32(_ax2, vld1q_f32(x2 + j)), vmaxq_f32(_ax1, vld1q_f32(x1 + j)));
+        float32x4_t _ih = vsubq_f32(vminq_f32(_ay2, vld1q_f32(y2 + j)), vmaxq_f32(_ay1, vld1q_f32(y1 + j)));
+        float32x4_t _inter = vmulq_f32(vmaxq_f32(_iw, _zero), vmaxq_f32(_ih, _zero));
+        float32x4_t _union = vsubq_f32(vaddq_f32(_aarea, vld1q_f32(area + j)), _inter);
+        uint32x4_t _mask = vcgtq_f32(_inter, vmulq_f32(_union, _thresh));
+        uint32x2_t _mask2 = vorr_u32(vget_low_u32(_mask), vget_high_u32(_mask));
+        if (vget_lane_u32(vpmax_u32(_mask2, _mask2), 0))
+            return true;
+    }
+#endif // __SSE2__
+    for (; j<n; j++)
+    {
+        float inter_width = std::max(std::min(a.xmax, x2[j]) - std::max(a.xmin, x1[j]), 0.f);
+        float inter_height = std::max(std::min(a.ymax, y2[j]) - std::max(a.ymin, y1[j]), 0.f);
+        float inter_area = inter_width * inter_height;
+        float union_area = area_a + area[j] - inter_area;
+        if (inter_area > union_area * nms_threshold)
+            return true;
+    }
+
+    return false;
+}
+
+// IoU of box a against each of boxes [0, n)
+static inline void bbox_iou_row(const BBoxRect& a, const BBoxSoA& boxes, int n, float* ious)
+{
+    const float area_a = (a.xmax - a.xmin) * (a.ymax - a.ymin);
+
+    const float* x1 = boxes.xmin.empty() ? 0 : &boxes.xmin[0];
+    const float* y1 = boxes.ymin.empty() ? 0 : &boxes.ymin[0];
+    const float* x2 = boxes.xmax.empty() ? 0 : &boxes.xmax[0];
+    const float* y2 = boxes.ymax.empty() ? 0 : &boxes.ymax[0];
+    const float* area = boxes.area.empty() ? 0 : &boxes.area[0];
+
+    int j = 0;
+#if __SSE2__
+    __m128 _ax1 = _mm_set1_ps(a.xmin);
+    __m128 _ay1 = _mm_set1_ps(a.ymin);
+    __m128 _ax2 = _mm_set1_ps(a.xmax);
+    __m128 _ay2 = _mm_set1_ps(a.ymax);
+    __m128 _aarea = _mm_set1_ps(area_a);
+    __m128 _zero = _mm_setzero_ps();
+    __m128 _eps = _mm_set1_ps(FLT_MIN);
+    for (; j+3<n; j+=4)
+    {
+        __m128 _iw = _mm_sub_ps(_mm_min_ps(_ax2, _mm_loadu_ps(x2 + j)), _mm_max_ps(_ax1, _mm_loadu_ps(x1 + j)));
+        __m128 _ih = _mm_sub_ps(_mm_min_ps(_ay2, _mm_loadu_ps(y2 + j)), _mm_max_ps(_ay1, _mm_loadu_ps(y1 + j)));
+        __m128 _inter = _mm_mul_ps(_mm_max_ps(_iw, _zero), _mm_max_ps(_ih, _zero));
+        __m128 _union = _mm_sub_ps(_mm_add_ps(_aarea, _mm_loadu_ps(area + j)), _inter);
+        // clamp union so that degenerate boxes give 0 instead of 0 / 0
+        _mm_storeu_ps(ious + j, _mm_div_ps(_inter, _mm_max_ps(_union, _eps)));
+    }
+#endif // __SSE2__
+    for (; j<n; j++)
+    {
+        float inter_width = std::max(std::min(a.xmax, x2[j]) - std::max(a.xmin, x1[j]), 0.f);
+        float inter_height = std::max(std::min(a.ymax, y2[j]) - std::max(a.ymin, y1[j]), 0.f);
+        float inter_area = inter_width * inter_height;
+        float union_area = area_a + area[j] - inter_area;
+        ious[j] = inter_area / std::max(union_area, FLT_MIN);
+    }
+}
+
+struct bbox_score_greater
+{
+    bbox_score_greater(const std::vector<float>& _scores) : scores(_scores) {}
+
+    // break ties by index so that the order is deterministic
+    bool operator()(int a, int b) const
+    {
+        return scores[a] > scores[b] || (scores[a] == scores[b] && a < b);
+    }
+
+    const std::vector<float>& scores;
+};
+
+// sort datas by descending scores and keep the top k, k <= 0 keeps all
+// nth_element + sort of the head is O(n + k log k) instead of a full sort
+template <typename T>
+static void topk_descent_inplace(std::vector<T>& datas, std::vector<float>& scores, int k)
+{
+    const int n = scores.size();
+    if (n == 0)
+        return;
+
+    if (k <= 0 || k > n)
+        k = n;
+
+    std::vector<int> indices(n);
+    for (int i = 0; i < n; i++)
+    {
+        indices[i] = i;
+    }
+
+    bbox_score_greater comp(scores);
+    if (k < n)
+    {
+        std::nth_element(indices.begin(), indices.begin() + k - 1, indices.end(), comp);
+    }
+    std::sort(indices.begin(), indices.begin() + k, comp);
+
+    std::vector<T> sorted_datas(k);
+    std::vector<float> sorted_scores(k);
+    for (int i = 0; i < k; i++)
+    {
+        sorted_datas[i] = datas[indices[i]];
+        sorted_scores[i] = scores[indices[i]];
+    }
+
+    datas.swap(sorted_datas);
+    scores.swap(sorted_scores);
+}
+
+// greedy nms over bboxes sorted by descending score
+// stop as soon as max_picked boxes are kept, max_picked <= 0 means no limit
+static void nms_sorted_bboxes(const std::vector<BBoxRect>& bboxes, std::vector<int>& picked, float nms_threshold, int max_picked = 0)
+{
+    picked.clear();
+
+    const int n = bboxes.size();
+    const int max_count = max_picked > 0 ? std::min(n, max_picked) : n;
+
+    BBoxSoA picked_bboxes;
+    picked_bboxes.reserve(max_count);
+    picked.reserve(max_count);
+
+    for (int i = 0; i < n; i++)
+    {
+        if ((int)picked.size() >= max_count)
+            break;
+
+        const BBoxRect& a = bboxes[i];
+        const float area_a = (a.xmax - a.xmin) * (a.ymax - a.ymin);
+
+        if (bbox_overlap_any(a, area_a, picked_bboxes, picked_bboxes.size(), nms_threshold))
+            continue;
+
+        picked.push_back(i);
+        picked_bboxes.push_back(a);
+    }
+}
+
+// matrix nms from SOLOv2, decays scores of bboxes sorted by descending score in parallel
+// instead of suppressing them one after another
+// kernel 0 = linear  decay = (1 - iou) / (1 - max_iou)
+// kernel 1 = gaussian  decay = exp(-sigma * (iou^2 - max_iou^2))
+static void matrix_nms_sorted_bboxes(const std::vector<BBoxRect>& bboxes, std::vector<float>& scores, int kernel, float sigma)
+{
+    const int n = bboxes.size();
+    if (n < 2)
+        return;
+
+    BBoxSoA soa;
+    soa.reserve(n);
+    for (int i = 0; i < n; i++)
+    {
+        soa.push_back(bboxes[i]);
+    }
+
+    // the largest IoU of each box against any higher scored box
+    std::vector<float> max_ious(n, 0.f);
+    std::vector<float> ious(n);
+    for (int i = 1; i < n; i++)
+    {
+        bbox_iou_row(bboxes[i], soa, i, &ious[0]);
+
+        float max_iou = 0.f;
+        for (int j = 0; j < i; j++)
+        {
+            max_iou = std::max(max_iou, ious[j]);
+        }
+        max_ious[i] = max_iou;
+    }
+
+    for (int i = 1; i < n; i++)
+    {
+        bbox_iou_row(bboxes[i], soa, i, &ious[0]);
+
+        float decay = 1.f;
+        for (int j = 0; j < i; j++)
+        {
+            float iou = ious[j];
+            float compensate_iou = max_ious[j];
+
+            float d;
+            if (kernel == 1)
+            {
+                d = exp(-sigma * (iou * iou - compensate_iou * compensate_iou));
+            }
+            else
+            {
+                d = (1.f - iou) / std::max(1.f - compensate_iou, FLT_EPSILON);
+            }
+
+            decay = std::min(decay, d);
+        }
+
+        scores[i] *= decay;
+    }
+}
+
+} // namespace ncnn
+
+#endif // LAYER_BBOX_UTIL_H
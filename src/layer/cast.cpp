@@ -156,6 +156,41 @@ static float float16_to_float32(unsigned short value)
     return tmp.f;
 }
 
+// convert float to bfloat16, round to nearest even
+static unsigned short float32_to_bfloat16(float value)
+{
+    union
+    {
+        unsigned int u;
+        float f;
+    } tmp;
+
+    tmp.f = value;
+
+    if ((tmp.u & 0x7fffffff) > 0x7f800000)
+    {
+        // NaN, keep it quiet
+        return (tmp.u >> 16) | 0x40;
+    }
+
+    unsigned int lsb = (tmp.u >> 16) & 1;
+    return (tmp.u + 0x7fff + lsb) >> 16;
+}
+
+// convert bfloat16 to float
+static float bfloat16_to_float32(unsigned short value)
+{
+    union
+    {
+        unsigned int u;
+        float f;
+    } tmp;
+
+    tmp.u = (unsigned int)value << 16;
+
+    return tmp.f;
+}
+
 // round to nearest
 static signed char float32_to_int8(float value)
 {
@@ -202,6 +237,11 @@ int Cast::forward(const Mat& bottom_blob, Mat& top_blob, const Option& opt) cons
         // int8
         out_elemsize = packing;
     }
+    else if (type_to == 4)
+    {
+        // bfloat16
+        out_elemsize = 2 * packing;
+    }
 
     if (dims == 1)
     {
@@ -250,6 +290,36 @@ int Cast::forward(const Mat& bottom_blob, Mat& top_blob, const Option& opt) cons
         }
     }
 
+    if (type_from == 1 && type_to == 4)
+    {
+        #pragma omp parallel for num_threads(opt.num_threads)
+        for (int q=0; q<channels; q++)
+        {
+            const float* ptr = bottom_blob.channel(q);
+            unsigned short* outptr = top_blob.channel(q);
+
+            for (int i=0; i<size; i++)
+            {
+                outptr[i] = float32_to_bfloat16(ptr[i]);
+            }
+        }
+    }
+
+    if (type_from == 4 && type_to == 1)
+    {
+        #pragma omp parallel for num_threads(opt.num_threads)
+        for (int q=0; q<channels; q++)
+        {
+            const unsigned short* ptr = bottom_blob.channel(q);
+            float* outptr = top_blob.channel(q);
+
+            for (int i=0; i<size; i++)
+            {
+                outptr[i] = bfloat16_to_float32(ptr[i]);
+            }
+        }
+    }
+
     // TODO more cast type
 
     return 0;
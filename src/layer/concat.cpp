@@ -13,6 +13,7 @@
 // specific language governing permissions and limitations under the License.
 
 #include "concat.h"
+#include <stdio.h>
 #include <algorithm>
 
 namespace ncnn {
@@ -24,6 +25,7 @@ Concat::Concat()
     one_blob_only = false;
     support_inplace = false;
     support_vulkan = true;
+    support_fp16_storage = true;
 
 #if NCNN_VULKAN
     pipeline_concat[0] = 0;
@@ -47,6 +49,15 @@ int Concat::forward(const std::vector<Mat>& bottom_blobs, std::vector<Mat>& top_
     int dims = bottom_blobs[0].dims;
     size_t elemsize = bottom_blobs[0].elemsize;
 
+    for (size_t b=1; b<bottom_blobs.size(); b++)
+    {
+        if (bottom_blobs[b].elemsize != elemsize)
+        {
+            fprintf(stderr, "Concat bottom blobs elemsize mismatch %d vs %d\n", (int)bottom_blobs[b].elemsize, (int)elemsize);
+            return -1;
+        }
+    }
+
     if (dims == 1) // axis == 0
     {
         // concat vector
@@ -63,17 +74,17 @@ int Concat::forward(const std::vector<Mat>& bottom_blobs, std::vector<Mat>& top_
         if (top_blob.empty())
             return -100;
 
-        float* outptr = top_blob;
+        unsigned char* outptr = top_blob;
         for (size_t b=0; b<bottom_blobs.size(); b++)
         {
             const Mat& bottom_blob = bottom_blobs[b];
 
             int w = bottom_blob.w;
 
-            const float* ptr = bottom_blob;
+            const unsigned char* ptr = bottom_blob;
             memcpy(outptr, ptr, w * elemsize);
 
-            outptr += w;
+            outptr += w * elemsize;
         }
 
         return 0;
@@ -97,17 +108,17 @@ int Concat::forward(const std::vector<Mat>& bottom_blobs, std::vector<Mat>& top_
         if (top_blob.empty())
             return -100;
 
-        float* outptr = top_blob;
+        unsigned char* outptr = top_blob;
         for (size_t b=0; b<bottom_blobs.size(); b++)
         {
             const Mat& bottom_blob = bottom_blobs[b];
 
             int size = w * bottom_blob.h;
 
-            const float* ptr = bottom_blob;
+            const unsigned char* ptr = bottom_blob;
             memcpy(outptr, ptr, size * elemsize);
 
-            outptr += size;
+            outptr += size * elemsize;
         }
 
         return 0;
@@ -134,15 +145,15 @@ int Concat::forward(const std::vector<Mat>& bottom_blobs, std::vector<Mat>& top_
         #pragma omp parallel for num_threads(opt.num_threads)
         for (int i=0; i<h; i++)
         {
-            float* outptr = top_blob.row(i);
+            unsigned char* outptr = (unsigned char*)top_blob.data + top_w * i * elemsize;
             for (size_t b=0; b<bottom_blobs.size(); b++)
             {
                 const Mat& bottom_blob = bottom_blobs[b];
 
-                const float* ptr = bottom_blob.row(i);
+                const unsigned char* ptr = (const unsigned char*)bottom_blob.data + bottom_blob.w * i * elemsize;
                 memcpy(outptr, ptr, bottom_blob.w * elemsize);
 
-                outptr += bottom_blob.w;
+                outptr += bottom_blob.w * elemsize;
             }
         }
 
@@ -176,8 +187,8 @@ int Concat::forward(const std::vector<Mat>& bottom_blobs, std::vector<Mat>& top_
             int channels = bottom_blob.c;
             int size = bottom_blob.cstep * channels;
 
-            const float* ptr = bottom_blob;
-            float* outptr = top_blob.channel(q);
+            const unsigned char* ptr = bottom_blob;
+            unsigned char* outptr = top_blob.channel(q);
             memcpy(outptr, ptr, size * elemsize);
 
             q += channels;
@@ -208,7 +219,7 @@ int Concat::forward(const std::vector<Mat>& bottom_blobs, std::vector<Mat>& top_
         #pragma omp parallel for num_threads(opt.num_threads)
         for (int q=0; q<channels; q++)
         {
-            float* outptr = top_blob.channel(q);
+            unsigned char* outptr = top_blob.channel(q);
 
             for (size_t b=0; b<bottom_blobs.size(); b++)
             {
@@ -216,10 +227,10 @@ int Concat::forward(const std::vector<Mat>& bottom_blobs, std::vector<Mat>& top_
 
                 int size = bottom_blob.w * bottom_blob.h;
 
-                const float* ptr = bottom_blob.channel(q);
+                const unsigned char* ptr = bottom_blob.channel(q);
                 memcpy(outptr, ptr, size * elemsize);
 
-                outptr += size;
+                outptr += size * elemsize;
             }
         }
 
@@ -248,7 +259,7 @@ int Concat::forward(const std::vector<Mat>& bottom_blobs, std::vector<Mat>& top_
         #pragma omp parallel for num_threads(opt.num_threads)
         for (int q=0; q<channels; q++)
         {
-            float* outptr = top_blob.channel(q);
+            unsigned char* outptr = top_blob.channel(q);
 
             for (int i=0; i<h; i++)
             {
@@ -256,10 +267,10 @@ int Concat::forward(const std::vector<Mat>& bottom_blobs, std::vector<Mat>& top_
                 {
                     const Mat& bottom_blob = bottom_blobs[b];
 
-                    const float* ptr = bottom_blob.channel(q).row(i);
+                    const unsigned char* ptr = (const unsigned char*)bottom_blob.channel(q).data + bottom_blob.w * i * elemsize;
                     memcpy(outptr, ptr, bottom_blob.w * elemsize);
 
-                    outptr += bottom_blob.w;
+                    outptr += bottom_blob.w * elemsize;
                 }
             }
         }
@@ -14,10 +14,13 @@
 
 #include "convolution.h"
 #include <algorithm>
+#include <math.h>
 #include "layer_type.h"
 
 namespace ncnn {
 
+#include "fused_activation.h"
+
 DEFINE_LAYER_CREATOR(Convolution)
 
 Convolution::Convolution()
@@ -26,6 +29,7 @@ Convolution::Convolution()
     support_inplace = false;
     support_vulkan = true;
     use_int8_requantize = false;
+    bottom_blob_int8_zero_point = 0;
 
 #if NCNN_VULKAN
     padding = 0;
@@ -129,6 +133,13 @@ int Convolution::load_model(const ModelBin& mb)
         bottom_blob_int8_scale = mb.load(1, 1)[0];
     }
 
+    // asymmetric bottom, the zero point is stored as float after the bottom scale
+    bottom_blob_int8_zero_point = 0;
+    if (int8_scale_term == 3)
+    {
+        bottom_blob_int8_zero_point = (int)round(mb.load(1, 1)[0]);
+    }
+
     for (int i=0; i<(int)dequantize_ops.size(); i++)
         delete dequantize_ops[i];
     dequantize_ops.clear();
@@ -181,6 +192,36 @@ int Convolution::load_model(const ModelBin& mb)
         weight_data = int8_weight_data;
     }
 
+    // fold the zero point into bias, sum((q - zp) * w) = sum(q * w) - zp * sum(w)
+    bias_data_int8 = bias_data;
+    if (use_int8_inference && bottom_blob_int8_zero_point != 0)
+    {
+        bias_data_int8.create(num_output);
+        if (bias_data_int8.empty())
+            return -100;
+
+        const int weight_data_size_output = weight_data_size / num_output;
+
+        for (int n=0; n<num_output; n++)
+        {
+            const signed char* kptr = (const signed char*)weight_data + weight_data_size_output * n;
+
+            int wsum = 0;
+            for (int i=0; i<weight_data_size_output; i++)
+            {
+                wsum += kptr[i];
+            }
+
+            float top_rescale = 0.f;
+            if (weight_data_int8_scales[n] != 0)
+                top_rescale = 1.f / (bottom_blob_int8_scale * weight_data_int8_scales[n]);
+
+            float bias = bias_term ? bias_data[n] : 0.f;
+
+            bias_data_int8[n] = bias - bottom_blob_int8_zero_point * wsum * top_rescale;
+        }
+    }
+
     // initial the quantize,dequantize op layer
     if (use_int8_inference)
     {
@@ -188,6 +229,7 @@ int Convolution::load_model(const ModelBin& mb)
         {
             ncnn::ParamDict pd;
             pd.set(0, bottom_blob_int8_scale);// scale
+            pd.set(1, bottom_blob_int8_zero_point);// zero_point
 
             quantize->load_param(pd);
         }
@@ -206,13 +248,14 @@ int Convolution::load_model(const ModelBin& mb)
 
             ncnn::ParamDict pd;
             pd.set(0, top_rescale);// scale
-            pd.set(1, bias_term);  // bias_term
+            pd.set(1, bias_data_int8.empty() ? 0 : 1);// bias_term
             pd.set(2, 1);          // bias_data_size
 
             dequantize_ops[n]->load_param(pd);
 
             ncnn::Mat weights[1];
-            weights[0] = bias_data.range(n, 1);
+            if (!bias_data_int8.empty())
+                weights[0] = bias_data_int8.range(n, 1);
 
             dequantize_ops[n]->load_model(ModelBinFromMatArray(weights));
 
@@ -253,13 +296,15 @@ int Convolution::create_requantize_op(void)
         ncnn::ParamDict pd;
         pd.set(0, scale_in);   // scale in
         pd.set(1, scale_out);  // scale_out
-        pd.set(2, bias_term);  // bias_term
+        pd.set(2, bias_data_int8.empty() ? 0 : 1);// bias_term
         pd.set(3, 1);          // bias_data_size
+        pd.set(4, activation_type == 1 ? 1 : 0);// fusion_relu
 
         requantize_ops[n]->load_param(pd);
 
         ncnn::Mat weights[1];
-        weights[0] = bias_data.range(n, 1);
+        if (!bias_data_int8.empty())
+            weights[0] = bias_data_int8.range(n, 1);
 
         requantize_ops[n]->load_model(ModelBinFromMatArray(weights));
 
@@ -270,6 +315,21 @@ int Convolution::create_requantize_op(void)
     return 0;
 }
 
+int Convolution::get_cost(const std::vector<Mat>& bottom_blobs, const std::vector<Mat>& top_blobs, LayerCost& cost) const
+{
+    Layer::get_cost(bottom_blobs, top_blobs, cost);
+
+    const Mat& top_blob = top_blobs[0];
+    // the 1x1 convolution of a 1 dim blob gives a 1 dim blob too
+    const unsigned long long outsize = (unsigned long long)top_blob.w * top_blob.h * top_blob.c / num_output;
+
+    cost.macs = outsize * weight_data_size;
+    cost.flops = outsize * num_output * (bias_term + (activation_type != 0));
+    cost.weight_bytes = weight_data.total() * weight_data.elemsize + bias_data.total() * bias_data.elemsize;
+
+    return 0;
+}
+
 int Convolution::forward(const Mat& bottom_blob, Mat& top_blob, const Option& opt) const
 {
     // convolv with NxN kernel
@@ -296,15 +356,20 @@ int Convolution::forward(const Mat& bottom_blob, Mat& top_blob, const Option& op
             op->load_param(pd);
 
             // set weights
-            ncnn::Mat weights[4];
+            ncnn::Mat weights[5];
             weights[0] = weight_data;
             weights[1] = bias_data;
 
+            float bottom_blob_int8_zero_point_f = bottom_blob_int8_zero_point;
             if (int8_scale_term)
             {
                 weights[2] = weight_data_int8_scales;
                 weights[3] = Mat(1, (size_t)4u, (void*)&bottom_blob_int8_scale);
             }
+            if (int8_scale_term == 3)
+            {
+                weights[4] = Mat(1, (size_t)4u, (void*)&bottom_blob_int8_zero_point_f);
+            }
 
             op->load_model(ModelBinFromMatArray(weights));
 
@@ -346,10 +411,13 @@ int Convolution::forward(const Mat& bottom_blob, Mat& top_blob, const Option& op
         bottom_blob_unbordered = bottom_blob_int8;
     }
 
+    // the int8 border is the zero point, which dequantizes to zero
+    const float border_value = use_int8_inference ? bottom_blob_int8_zero_point : 0.f;
+
     Mat bottom_blob_bordered = bottom_blob_unbordered;
     if (pad_w > 0 || pad_h > 0)
     {
-        copy_make_border(bottom_blob_unbordered, bottom_blob_bordered, pad_h, pad_h, pad_w, pad_w, BORDER_CONSTANT, 0.f, opt.workspace_allocator, opt.num_threads);
+        copy_make_border(bottom_blob_unbordered, bottom_blob_bordered, pad_h, pad_h, pad_w, pad_w, BORDER_CONSTANT, border_value, opt.workspace_allocator, opt.num_threads);
         if (bottom_blob_bordered.empty())
             return -100;
 
@@ -362,7 +430,7 @@ int Convolution::forward(const Mat& bottom_blob, Mat& top_blob, const Option& op
         int hpad = kernel_extent_h + (h - 1) / stride_h * stride_h - h;
         if (wpad > 0 || hpad > 0)
         {
-            copy_make_border(bottom_blob_unbordered, bottom_blob_bordered, hpad / 2, hpad - hpad / 2, wpad / 2, wpad - wpad / 2, BORDER_CONSTANT, 0.f, opt.workspace_allocator, opt.num_threads);
+            copy_make_border(bottom_blob_unbordered, bottom_blob_bordered, hpad / 2, hpad - hpad / 2, wpad / 2, wpad - wpad / 2, BORDER_CONSTANT, border_value, opt.workspace_allocator, opt.num_threads);
             if (bottom_blob_bordered.empty())
                 return -100;
         }
@@ -507,9 +575,12 @@ int Convolution::forward(const Mat& bottom_blob, Mat& top_blob, const Option& op
 
                     Mat top_blob_g = top_blob.channel_range(p, 1);
                     dequantize_ops[p]->forward_inplace(top_blob_g, opt_g);
-                }          
-            }   
-        }        
+                }
+            }
+
+            // fused activation on the dequantized output
+            activation_inplace(top_blob, activation_type, activation_params, opt);
+        }
 
         return 0;
     }
@@ -29,6 +29,8 @@ public:
 
     virtual int load_model(const ModelBin& mb);
 
+    virtual int get_cost(const std::vector<Mat>& bottom_blobs, const std::vector<Mat>& top_blobs, LayerCost& cost) const;
+
     virtual int create_requantize_op(void);
 
     virtual int forward(const Mat& bottom_blob, Mat& top_blob, const Option& opt) const;
@@ -101,6 +103,10 @@ public:
     float bottom_blob_int8_scale;
     float top_blob_int8_scale;
 
+    // asymmetric bottom when int8_scale_term is 3, bias_data_int8 absorbs the zero point
+    int bottom_blob_int8_zero_point;
+    Mat bias_data_int8;
+
     bool use_int8_inference;
     bool use_int8_requantize;
 
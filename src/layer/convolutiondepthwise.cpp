@@ -18,6 +18,8 @@
 
 namespace ncnn {
 
+#include "fused_activation.h"
+
 DEFINE_LAYER_CREATOR(ConvolutionDepthWise)
 
 ConvolutionDepthWise::ConvolutionDepthWise()
@@ -310,6 +312,7 @@ int ConvolutionDepthWise::create_requantize_op(void)
         pd.set(1, scale_out);  // scale_out
         pd.set(2, bias_term);  // bias_term
         pd.set(3, 1);          // bias_data_size
+        pd.set(4, activation_type == 1 ? 1 : 0);// fusion_relu
 
         requantize_ops[g]->load_param(pd);
 
@@ -325,6 +328,22 @@ int ConvolutionDepthWise::create_requantize_op(void)
     return 0;
 }
 
+int ConvolutionDepthWise::get_cost(const std::vector<Mat>& bottom_blobs, const std::vector<Mat>& top_blobs, LayerCost& cost) const
+{
+    Layer::get_cost(bottom_blobs, top_blobs, cost);
+
+    // every output channel reads channels / group inputs, the same as convolution
+    const Mat& top_blob = top_blobs[0];
+    // the 1x1 convolution of a 1 dim blob gives a 1 dim blob too
+    const unsigned long long outsize = (unsigned long long)top_blob.w * top_blob.h * top_blob.c / num_output;
+
+    cost.macs = outsize * weight_data_size;
+    cost.flops = outsize * num_output * (bias_term + (activation_type != 0));
+    cost.weight_bytes = weight_data.total() * weight_data.elemsize + bias_data.total() * bias_data.elemsize;
+
+    return 0;
+}
+
 int ConvolutionDepthWise::forward(const Mat& bottom_blob, Mat& top_blob, const Option& opt) const
 {
     // convolv with NxN kernel
@@ -441,7 +460,7 @@ int ConvolutionDepthWise::forward(const Mat& bottom_blob, Mat& top_blob, const O
                 #pragma omp parallel for num_threads(opt.num_threads)
                 for (int g=0; g<group; g++)
                 {
-                    int* outptr = top_blob.channel(g);
+                    int* outptr = top_blob_tm.channel(g);
                     const signed char* kptr = (const signed char*)weight_data + maxk * g;
                     const Mat m = bottom_blob_bordered.channel(g);
 
@@ -492,7 +511,7 @@ int ConvolutionDepthWise::forward(const Mat& bottom_blob, Mat& top_blob, const O
                 {
                     for (int p=0; p<num_output_g; p++)
                     {
-                        int* outptr = top_blob.channel(g * num_output_g + p);
+                        int* outptr = top_blob_tm.channel(g * num_output_g + p);
                         const signed char* weight_data_ptr = (const signed char*)weight_data + maxk * channels_g * num_output_g * g;
 
                         for (int i = 0; i < outh; i++)
@@ -650,6 +669,9 @@ int ConvolutionDepthWise::forward(const Mat& bottom_blob, Mat& top_blob, const O
                     dequantize_ops[g]->forward_inplace(top_blob_g, opt_g);
                 }
             }
+
+            // fused activation on the dequantized output
+            activation_inplace(top_blob, activation_type, activation_params, opt);
         }
 
         return 0;
@@ -29,6 +29,8 @@ public:
 
     virtual int load_model(const ModelBin& mb);
 
+    virtual int get_cost(const std::vector<Mat>& bottom_blobs, const std::vector<Mat>& top_blobs, LayerCost& cost) const;
+
     virtual int create_requantize_op(void);
 
     virtual int forward(const Mat& bottom_blob, Mat& top_blob, const Option& opt) const;
@@ -127,6 +127,23 @@ int DeconvolutionDepthWise::load_model(const ModelBin& mb)
     return 0;
 }
 
+int DeconvolutionDepthWise::get_cost(const std::vector<Mat>& bottom_blobs, const std::vector<Mat>& top_blobs, LayerCost& cost) const
+{
+    Layer::get_cost(bottom_blobs, top_blobs, cost);
+
+    // every input pixel scatters the whole kernel
+    const Mat& bottom_blob = bottom_blobs[0];
+    const Mat& top_blob = top_blobs[0];
+    const unsigned long long insize = (unsigned long long)bottom_blob.w * bottom_blob.h;
+    const unsigned long long outsize = (unsigned long long)top_blob.w * top_blob.h;
+
+    cost.macs = insize * weight_data_size;
+    cost.flops = outsize * num_output * (bias_term + (activation_type != 0));
+    cost.weight_bytes = weight_data.total() * weight_data.elemsize + bias_data.total() * bias_data.elemsize;
+
+    return 0;
+}
+
 int DeconvolutionDepthWise::forward(const Mat& bottom_blob, Mat& top_blob, const Option& opt) const
 {
     // deconvolv with NxN kernel
@@ -29,6 +29,7 @@ int Dequantize::load_param(const ParamDict& pd)
     scale = pd.get(0, 1.f);
     bias_term = pd.get(1, 0);
     bias_data_size = pd.get(2, 0);
+    scales = pd.get(3, Mat());
 
     return 0;
 }
@@ -63,7 +64,8 @@ int Dequantize::forward_inplace(Mat& bottom_top_blob, const Option& opt) const
                 #pragma omp parallel for num_threads(opt.num_threads)
                 for (int i=0; i<w; i++)
                 {
-                    ptr[i] = intptr[i] * scale + bias_data[i];
+                    float s = scales.empty() ? scale : scales[i];
+                    ptr[i] = intptr[i] * s + bias_data[i];
                 }
             }
             else
@@ -73,7 +75,8 @@ int Dequantize::forward_inplace(Mat& bottom_top_blob, const Option& opt) const
                 #pragma omp parallel for num_threads(opt.num_threads)
                 for (int i=0; i<w; i++)
                 {
-                    ptr[i] = intptr[i] * scale + bias;
+                    float s = scales.empty() ? scale : scales[i];
+                    ptr[i] = intptr[i] * s + bias;
                 }
             }
         }
@@ -82,7 +85,8 @@ int Dequantize::forward_inplace(Mat& bottom_top_blob, const Option& opt) const
             #pragma omp parallel for num_threads(opt.num_threads)
             for (int i=0; i<w; i++)
             {
-                ptr[i] = intptr[i] * scale;
+                float s = scales.empty() ? scale : scales[i];
+                ptr[i] = intptr[i] * s;
             }
         }
     }
@@ -100,11 +104,12 @@ int Dequantize::forward_inplace(Mat& bottom_top_blob, const Option& opt) const
                 const int* intptr = bottom_top_blob.row<const int>(i);
                 float* ptr = bottom_top_blob.row(i);
 
+                float s = scales.empty() ? scale : scales[i];
                 float bias = bias_data_size > 1 ? bias_data[i] : bias_data[0];
 
                 for (int j=0; j<w; j++)
                 {
-                    ptr[j] = intptr[j] * scale + bias;
+                    ptr[j] = intptr[j] * s + bias;
                 }
             }
         }
@@ -116,9 +121,11 @@ int Dequantize::forward_inplace(Mat& bottom_top_blob, const Option& opt) const
                 const int* intptr = bottom_top_blob.row<const int>(i);
                 float* ptr = bottom_top_blob.row(i);
 
+                float s = scales.empty() ? scale : scales[i];
+
                 for (int j=0; j<w; j++)
                 {
-                    ptr[j] = intptr[j] * scale;
+                    ptr[j] = intptr[j] * s;
                 }
             }
         }
@@ -139,11 +146,12 @@ int Dequantize::forward_inplace(Mat& bottom_top_blob, const Option& opt) const
                 const int* intptr = bottom_top_blob.channel(q);
                 float* ptr = bottom_top_blob.channel(q);
 
+                float s = scales.empty() ? scale : scales[q];
                 float bias = bias_data_size > 1 ? bias_data[q] : bias_data[0];
 
                 for (int i=0; i<size; i++)
                 {
-                    ptr[i] = intptr[i] * scale + bias;
+                    ptr[i] = intptr[i] * s + bias;
                 }
             }
         }
@@ -155,9 +163,11 @@ int Dequantize::forward_inplace(Mat& bottom_top_blob, const Option& opt) const
                 const int* intptr = bottom_top_blob.channel(q);
                 float* ptr = bottom_top_blob.channel(q);
 
+                float s = scales.empty() ? scale : scales[q];
+
                 for (int i=0; i<size; i++)
                 {
-                    ptr[i] = intptr[i] * scale;
+                    ptr[i] = intptr[i] * s;
                 }
             }
         }
@@ -35,6 +35,9 @@ public:
     int bias_term;
     int bias_data_size;
 
+    // one scale per channel, row or element, overrides scale when set
+    Mat scales;
+
     Mat bias_data;
 };
 
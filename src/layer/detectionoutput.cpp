@@ -15,6 +15,7 @@
 #include "detectionoutput.h"
 #include <algorithm>
 #include <math.h>
+#include "bbox_util.h"
 
 namespace ncnn {
 
@@ -37,114 +38,12 @@ int DetectionOutput::load_param(const ParamDict& pd)
     variances[1] = pd.get(6, 0.1f);
     variances[2] = pd.get(7, 0.2f);
     variances[3] = pd.get(8, 0.2f);
+    nms_method = pd.get(9, 0);
+    matrix_nms_sigma = pd.get(10, 2.f);
 
     return 0;
 }
 
-struct BBoxRect
-{
-    float xmin;
-    float ymin;
-    float xmax;
-    float ymax;
-    int label;
-};
-
-static inline float intersection_area(const BBoxRect& a, const BBoxRect& b)
-{
-    if (a.xmin > b.xmax || a.xmax < b.xmin || a.ymin > b.ymax || a.ymax < b.ymin)
-    {
-        // no intersection
-        return 0.f;
-    }
-
-    float inter_width = std::min(a.xmax, b.xmax) - std::max(a.xmin, b.xmin);
-    float inter_height = std::min(a.ymax, b.ymax) - std::max(a.ymin, b.ymin);
-
-    return inter_width * inter_height;
-}
-
-template <typename T>
-static void qsort_descent_inplace(std::vector<T>& datas, std::vector<float>& scores, int left, int right)
-{
-    int i = left;
-    int j = right;
-    float p = scores[(left + right) / 2];
-
-    while (i <= j)
-    {
-        while (scores[i] > p)
-            i++;
-
-        while (scores[j] < p)
-            j--;
-
-        if (i <= j)
-        {
-            // swap
-            std::swap(datas[i], datas[j]);
-            std::swap(scores[i], scores[j]);
-
-            i++;
-            j--;
-        }
-    }
-
-    if (left < j)
-        qsort_descent_inplace(datas, scores, left, j);
-
-    if (i < right)
-        qsort_descent_inplace(datas, scores, i, right);
-}
-
-template <typename T>
-static void qsort_descent_inplace(std::vector<T>& datas, std::vector<float>& scores)
-{
-    if (datas.empty() || scores.empty())
-        return;
-
-    qsort_descent_inplace(datas, scores, 0, scores.size() - 1);
-}
-
-static void nms_sorted_bboxes(const std::vector<BBoxRect>& bboxes, std::vector<int>& picked, float nms_threshold)
-{
-    picked.clear();
-
-    const int n = bboxes.size();
-
-    std::vector<float> areas(n);
-    for (int i = 0; i < n; i++)
-    {
-        const BBoxRect& r = bboxes[i];
-
-        float width = r.xmax - r.xmin;
-        float height = r.ymax - r.ymin;
-
-        areas[i] = width * height;
-    }
-
-    for (int i = 0; i < n; i++)
-    {
-        const BBoxRect& a = bboxes[i];
-
-        int keep = 1;
-        for (int j = 0; j < (int)picked.size(); j++)
-        {
-            const BBoxRect& b = bboxes[picked[j]];
-
-            // intersection over union
-            float inter_area = intersection_area(a, b);
-            float union_area = areas[i] + areas[picked[j]] - inter_area;
-//             float IoU = inter_area / union_area
-            if (inter_area / union_area > nms_threshold)
-                keep = 0;
-        }
-
-        if (keep)
-            picked.push_back(i);
-    }
-}
-
 int DetectionOutput::forward(const std::vector<Mat>& bottom_blobs, std::vector<Mat>& top_blobs, const Option& opt) const
 {
     const Mat& location = bottom_blobs[0];
@@ -224,26 +123,37 @@ int DetectionOutput::forward(const std::vector<Mat>& bottom_blobs, std::vector<M
             }
         }
 
-        // sort inplace
-        qsort_descent_inplace(class_bbox_rects, class_bbox_scores);
+        // sort inplace and keep nms_top_k
+        topk_descent_inplace(class_bbox_rects, class_bbox_scores, nms_top_k);
 
-        // keep nms_top_k
-        if (nms_top_k < (int)class_bbox_rects.size())
+        if (nms_method == 0)
         {
-            class_bbox_rects.resize(nms_top_k);
-            class_bbox_scores.resize(nms_top_k);
-        }
-
-        // apply nms
-        std::vector<int> picked;
-        nms_sorted_bboxes(class_bbox_rects, picked, nms_threshold);
+            // apply nms
+            // no class can contribute more than keep_top_k boxes to the final result
+            std::vector<int> picked;
+            nms_sorted_bboxes(class_bbox_rects, picked, nms_threshold, keep_top_k);
 
-        // select
-        for (int j = 0; j < (int)picked.size(); j++)
+            // select
+            for (int j = 0; j < (int)picked.size(); j++)
+            {
+                int z = picked[j];
+                all_class_bbox_rects[i].push_back(class_bbox_rects[z]);
+                all_class_bbox_scores[i].push_back(class_bbox_scores[z]);
+            }
+        }
+        else
         {
-            int z = picked[j];
-            all_class_bbox_rects[i].push_back(class_bbox_rects[z]);
-            all_class_bbox_scores[i].push_back(class_bbox_scores[z]);
+            // apply matrix nms, decayed scores are filtered by confidence_threshold again
+            matrix_nms_sorted_bboxes(class_bbox_rects, class_bbox_scores, nms_method - 1, matrix_nms_sigma);
+
+            for (int j = 0; j < (int)class_bbox_rects.size(); j++)
+            {
+                if (class_bbox_scores[j] > confidence_threshold)
+                {
+                    all_class_bbox_rects[i].push_back(class_bbox_rects[j]);
+                    all_class_bbox_scores[i].push_back(class_bbox_scores[j]);
+                }
+            }
         }
     }
 
@@ -260,15 +170,8 @@ int DetectionOutput::forward(const std::vector<Mat>& bottom_blobs, std::vector<M
         bbox_scores.insert(bbox_scores.end(), class_bbox_scores.begin(), class_bbox_scores.end());
     }
 
-    // global sort inplace
-    qsort_descent_inplace(bbox_rects, bbox_scores);
-
-    // keep_top_k
-    if (keep_top_k < (int)bbox_rects.size())
-    {
-        bbox_rects.resize(keep_top_k);
-        bbox_scores.resize(keep_top_k);
-    }
+    // global sort inplace and keep_top_k
+    topk_descent_inplace(bbox_rects, bbox_scores, keep_top_k);
 
     // fill result
     int num_detected = bbox_rects.size();
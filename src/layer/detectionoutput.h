@@ -35,6 +35,10 @@ public:
     int keep_top_k;
     float confidence_threshold;
     float variances[4];
+
+    // 0 = greedy nms, 1 = matrix nms linear, 2 = matrix nms gaussian
+    int nms_method;
+    float matrix_nms_sigma;
 };
 
 } // namespace ncnn
@@ -13,6 +13,7 @@
 // specific language governing permissions and limitations under the License.
 
 #include "eltwise.h"
+#include <math.h>
 #include <algorithm>
 
 namespace ncnn {
@@ -25,6 +26,9 @@ Eltwise::Eltwise()
     support_inplace = false;// TODO inplace reduction
     support_vulkan = true;
 
+    top_blob_int8_scale = 0.f;
+    use_int8_inference = false;
+
 #if NCNN_VULKAN
     pipeline_eltwise[0] = 0;
     pipeline_eltwise[1] = 0;
@@ -37,12 +41,55 @@ int Eltwise::load_param(const ParamDict& pd)
 {
     op_type = pd.get(0, 0);
     coeffs = pd.get(1, Mat());
+    bottom_blob_int8_scales = pd.get(2, Mat());
+
+    use_int8_inference = pd.use_int8_inference;
+
+    if (op_type != Operation_SUM || bottom_blob_int8_scales.w == 0)
+        use_int8_inference = false;
+
+    return 0;
+}
+
+static inline signed char float2int8(float v)
+{
+    int int32 = round(v);
+    if (int32 > 127) return 127;
+    if (int32 < -128) return -128;
+    return (signed char)int32;
+}
+
+int Eltwise::get_cost(const std::vector<Mat>& bottom_blobs, const std::vector<Mat>& top_blobs, LayerCost& cost) const
+{
+    Layer::get_cost(bottom_blobs, top_blobs, cost);
+
+    const Mat& top_blob = top_blobs[0];
+    const unsigned long long size = (unsigned long long)top_blob.w * top_blob.h * top_blob.c;
+
+    cost.flops = size * (bottom_blobs.size() - 1);
+
+    // weighted sum multiplies every bottom
+    if (op_type == Operation_SUM && !coeffs.empty())
+        cost.flops += size * bottom_blobs.size();
 
     return 0;
 }
 
 int Eltwise::forward(const std::vector<Mat>& bottom_blobs, std::vector<Mat>& top_blobs, const Option& opt) const
 {
+    if (use_int8_inference)
+    {
+        bool has_int8 = top_blob_int8_scale != 0.f;
+        for (size_t b=0; b<bottom_blobs.size(); b++)
+        {
+            if (bottom_blobs[b].elemsize == 1u)
+                has_int8 = true;
+        }
+
+        if (has_int8)
+            return forward_int8(bottom_blobs, top_blobs, opt);
+    }
+
     const Mat& bottom_blob = bottom_blobs[0];
     int w = bottom_blob.w;
     int h = bottom_blob.h;
@@ -197,6 +244,67 @@ int Eltwise::forward(const std::vector<Mat>& bottom_blobs, std::vector<Mat>& top
     return 0;
 }
 
+int Eltwise::forward_int8(const std::vector<Mat>& bottom_blobs, std::vector<Mat>& top_blobs, const Option& opt) const
+{
+    // every bottom is either int8 with its own scale or float32
+    // the weighted sum is accumulated in float32 and requantized when top_blob_int8_scale is set
+    const Mat& bottom_blob = bottom_blobs[0];
+    int w = bottom_blob.w;
+    int h = bottom_blob.h;
+    int channels = bottom_blob.c;
+    int size = w * h;
+
+    const int bottom_count = (int)bottom_blobs.size();
+
+    std::vector<float> bottom_coeffs(bottom_count);
+    for (int b=0; b<bottom_count; b++)
+    {
+        float coeff = coeffs.w == 0 ? 1.f : coeffs[b];
+        float scale = b < bottom_blob_int8_scales.w ? bottom_blob_int8_scales[b] : 0.f;
+
+        if (bottom_blobs[b].elemsize == 1u)
+            bottom_coeffs[b] = scale == 0.f ? 0.f : coeff / scale;
+        else
+            bottom_coeffs[b] = coeff;
+    }
+
+    Mat& top_blob = top_blobs[0];
+    top_blob.create(w, h, channels, top_blob_int8_scale != 0.f ? (size_t)1u : (size_t)4u, opt.blob_allocator);
+    if (top_blob.empty())
+        return -100;
+
+    #pragma omp parallel for num_threads(opt.num_threads)
+    for (int q=0; q<channels; q++)
+    {
+        for (int i=0; i<size; i++)
+        {
+            float sum = 0.f;
+            for (int b=0; b<bottom_count; b++)
+            {
+                const Mat m = bottom_blobs[b].channel(q);
+
+                if (m.elemsize == 1u)
+                    sum += ((const signed char*)m.data)[i] * bottom_coeffs[b];
+                else
+                    sum += ((const float*)m.data)[i] * bottom_coeffs[b];
+            }
+
+            if (top_blob_int8_scale != 0.f)
+            {
+                signed char* outptr = top_blob.channel(q);
+                outptr[i] = float2int8(sum * top_blob_int8_scale);
+            }
+            else
+            {
+                float* outptr = top_blob.channel(q);
+                outptr[i] = sum;
+            }
+        }
+    }
+
+    return 0;
+}
+
 #if NCNN_VULKAN
 int Eltwise::create_pipeline()
 {
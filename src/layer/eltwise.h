@@ -26,7 +26,10 @@ public:
 
     virtual int load_param(const ParamDict& pd);
 
+    virtual int get_cost(const std::vector<Mat>& bottom_blobs, const std::vector<Mat>& top_blobs, LayerCost& cost) const;
+
     virtual int forward(const std::vector<Mat>& bottom_blobs, std::vector<Mat>& top_blobs, const Option& opt) const;
+    virtual int forward_int8(const std::vector<Mat>& bottom_blobs, std::vector<Mat>& top_blobs, const Option& opt) const;
 
 #if NCNN_VULKAN
     virtual int create_pipeline();
@@ -42,6 +45,14 @@ public:
     int op_type;
     Mat coeffs;
 
+    // int8 scale of every bottom blob, sum only
+    Mat bottom_blob_int8_scales;
+
+    // requantize the sum to int8 with this scale, 0 = float32 output
+    float top_blob_int8_scale;
+
+    bool use_int8_inference;
+
 #if NCNN_VULKAN
     Pipeline* pipeline_eltwise[2];
     Pipeline* pipeline_eltwise_pack4[2];
@@ -0,0 +1,61 @@
+// Tencent is pleased to support the open source community by making ncnn available.
+//
+// Copyright (C) 2019 THL A29 Limited, a Tencent company. All rights reserved.
+//
+// Licensed under the BSD 3-Clause License (the "License"); you may not use this file except
+// in compliance with the License. You may obtain a copy of the License at
+//
+// https://opensource.org/licenses/BSD-3-Clause
+//
+// Unless required by applicable law or agreed to in writing, software distributed
+// under the License is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR
+// CONDITIONS OF ANY KIND, either express or implied. See the License for the
+// specific language governing permissions and limitations under the License.
+
+// the activation fused into convolution, convolutiondepthwise and innerproduct
+// 0=none 1=relu 2=leakyrelu 3=clip
+
+static inline float activation_ss(float v, int activation_type, const Mat& activation_params)
+{
+    if (activation_type == 1)
+    {
+        v = std::max(v, 0.f);
+    }
+    else if (activation_type == 2)
+    {
+        float slope = activation_params[0];
+        v = v > 0.f ? v : v * slope;
+    }
+    else if (activation_type == 3)
+    {
+        float min = activation_params[0];
+        float max = activation_params[1];
+        if (v < min)
+            v = min;
+        if (v > max)
+            v = max;
+    }
+
+    return v;
+}
+
+// every channel of a float32 blob in place
+static inline void activation_inplace(Mat& blob, int activation_type, const Mat& activation_params, const Option& opt)
+{
+    if (activation_type == 0)
+        return;
+
+    int channels = blob.c;
+    int size = blob.w * blob.h;
+
+    #pragma omp parallel for num_threads(opt.num_threads)
+    for (int q=0; q<channels; q++)
+    {
+        float* ptr = blob.channel(q);
+
+        for (int i=0; i<size; i++)
+        {
+            ptr[i] = activation_ss(ptr[i], activation_type, activation_params);
+        }
+    }
+}
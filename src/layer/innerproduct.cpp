@@ -14,10 +14,13 @@
 
 #include "innerproduct.h"
 #include <algorithm>
+#include <math.h>
 #include "layer_type.h"
 
 namespace ncnn {
 
+#include "fused_activation.h"
+
 DEFINE_LAYER_CREATOR(InnerProduct)
 
 InnerProduct::InnerProduct()
@@ -36,6 +39,7 @@ InnerProduct::InnerProduct()
 #endif // NCNN_VULKAN
 
     quantize = 0;
+    bottom_blob_int8_zero_point = 0;
 }
 
 InnerProduct::~InnerProduct()
@@ -101,6 +105,13 @@ int InnerProduct::load_model(const ModelBin& mb)
         bottom_blob_int8_scale = mb.load(1, 1)[0];
     }
 
+    // asymmetric bottom, the zero point is stored as float after the bottom scale
+    bottom_blob_int8_zero_point = 0;
+    if (int8_scale_term == 3)
+    {
+        bottom_blob_int8_zero_point = (int)round(mb.load(1, 1)[0]);
+    }
+
     bool weight_data_is_int8 = (weight_data.elemsize == (size_t)1u);
     bool weight_data_is_float32 = (weight_data.elemsize == (size_t)4u);
 
@@ -117,6 +128,7 @@ int InnerProduct::load_model(const ModelBin& mb)
         {
             ncnn::ParamDict pd;
             pd.set(0, bottom_blob_int8_scale);// scale
+            pd.set(1, bottom_blob_int8_zero_point);// zero_point
 
             quantize->load_param(pd);
         }
@@ -182,6 +194,17 @@ int InnerProduct::load_model(const ModelBin& mb)
     return 0;
 }
 
+int InnerProduct::get_cost(const std::vector<Mat>& bottom_blobs, const std::vector<Mat>& top_blobs, LayerCost& cost) const
+{
+    Layer::get_cost(bottom_blobs, top_blobs, cost);
+
+    cost.macs = weight_data_size;
+    cost.flops = (unsigned long long)num_output * (bias_term + (activation_type != 0));
+    cost.weight_bytes = weight_data.total() * weight_data.elemsize + bias_data.total() * bias_data.elemsize;
+
+    return 0;
+}
+
 int InnerProduct::forward(const Mat& bottom_blob, Mat& top_blob, const Option& opt) const
 {
     int w = bottom_blob.w;
@@ -190,25 +213,29 @@ int InnerProduct::forward(const Mat& bottom_blob, Mat& top_blob, const Option& o
     size_t elemsize = bottom_blob.elemsize;
     int size = w * h;
 
-    top_blob.create(num_output, elemsize, opt.blob_allocator);
+    top_blob.create(num_output, use_int8_inference ? (size_t)4u : elemsize, opt.blob_allocator);
     if (top_blob.empty())
         return -100;
 
     if (use_int8_inference)
     {
-        Mat bottom_blob_int8;
-        bottom_blob_int8.create(w, h, channels, (size_t)1u, opt.workspace_allocator);
-        if (bottom_blob_int8.empty())
-            return -100;
-
-        // quantize, scale and round to nearest
+        // an int8 bottom was quantized by the producer with bottom_blob_int8_scale
+        Mat bottom_blob_int8 = bottom_blob;
+        if (elemsize != 1)
         {
+            bottom_blob_int8.create(w, h, channels, (size_t)1u, opt.workspace_allocator);
+            if (bottom_blob_int8.empty())
+                return -100;
+
+            // quantize, scale and round to nearest
             ncnn::Option opt_g = opt;
             opt_g.blob_allocator = bottom_blob_int8.allocator;
 
             quantize->forward(bottom_blob, bottom_blob_int8, opt_g);
         }
 
+        const int zero_point = bottom_blob_int8_zero_point;
+
         // num_output
         #pragma omp parallel for num_threads(opt.num_threads)
         for (int p=0; p<num_output; p++)
@@ -224,7 +251,7 @@ int InnerProduct::forward(const Mat& bottom_blob, Mat& top_blob, const Option& o
 
                 for (int i = 0; i < size; i++)
                 {
-                    sum += m[i] * w[i];
+                    sum += (m[i] - zero_point) * w[i];
                 }
             }
 
@@ -242,10 +269,12 @@ int InnerProduct::forward(const Mat& bottom_blob, Mat& top_blob, const Option& o
             else
                 top_rescale = 1.f / (bottom_blob_int8_scale * weight_data_int8_scales[p]);
 
+            float sum = out_s32[p] * top_rescale;
+
             if (bias_term)
-                out_f32[p] = out_s32[p] * top_rescale + bias_data[p];
-            else
-                out_f32[p] = out_s32[p] * top_rescale;
+                sum += bias_data[p];
+
+            out_f32[p] = activation_ss(sum, activation_type, activation_params);
         }
 
         return 0;
@@ -29,6 +29,8 @@ public:
 
     virtual int load_model(const ModelBin& mb);
 
+    virtual int get_cost(const std::vector<Mat>& bottom_blobs, const std::vector<Mat>& top_blobs, LayerCost& cost) const;
+
     virtual int forward(const Mat& bottom_blob, Mat& top_blob, const Option& opt) const;
 
 #if NCNN_VULKAN
@@ -83,6 +85,9 @@ public:
     Mat weight_data_int8_scales;
     float bottom_blob_int8_scale;
 
+    // asymmetric bottom when int8_scale_term is 3
+    int bottom_blob_int8_zero_point;
+
     bool use_int8_inference;
 
     ncnn::Layer* quantize;
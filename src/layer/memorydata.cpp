@@ -22,6 +22,7 @@ MemoryData::MemoryData()
 {
     one_blob_only = false;
     support_inplace = false;
+    shape_only = true;
 }
 
 int MemoryData::load_param(const ParamDict& pd)
@@ -47,152 +47,6 @@ int Padding::load_param(const ParamDict& pd)
     return 0;
 }
 
-template<typename T>
-static void copy_make_border_image(const Mat& src, Mat& dst, int top, int left, int type, T v)
-{
-    int w = dst.w;
-    int h = dst.h;
-
-    const T* ptr = src;
-    T* outptr = dst;
-
-    if (type == 0)
-    {
-        int y = 0;
-        // fill top
-        for (; y < top; y++)
-        {
-            int x = 0;
-            for (; x < w; x++)
-            {
-                outptr[x] = v;
-            }
-            outptr += w;
-        }
-        // fill center
-        for (; y < (top + src.h); y++)
-        {
-            int x = 0;
-            for (; x < left; x++)
-            {
-                outptr[x] = v;
-            }
-            if (src.w < 12)
-            {
-                for (; x < (left + src.w); x++)
-                {
-                    outptr[x] = ptr[x - left];
-                }
-            }
-            else
-            {
-                memcpy(outptr + left, ptr, src.w * sizeof(T));
-                x += src.w;
-            }
-            for (; x < w; x++)
-            {
-                outptr[x] = v;
-            }
-            ptr += src.w;
-            outptr += w;
-        }
-        // fill bottom
-        for (; y < h; y++)
-        {
-            int x = 0;
-            for (; x < w; x++)
-            {
-                outptr[x] = v;
-            }
-            outptr += w;
-        }
-    }
-    else if (type == 1)
-    {
-        int y = 0;
-        // fill top
-        for (; y < top; y++)
-        {
-            int x = 0;
-            for (; x < left; x++)
-            {
-                outptr[x] = ptr[0];
-            }
-            if(src.w < 12)
-            {
-                for (; x < (left + src.w); x++)
-                {
-                    outptr[x] = ptr[x - left];
-                }
-            }
-            else
-            {
-                memcpy(outptr + left, ptr, src.w * sizeof(T));
-                x += src.w;
-            }
-            for (; x < w; x++)
-            {
-                outptr[x] = ptr[src.w - 1];
-            }
-            outptr += w;
-        }
-        // fill center
-        for (; y < (top + src.h); y++)
-        {
-            int x = 0;
-            for (; x < left; x++)
-            {
-                outptr[x] = ptr[0];
-            }
-            if(src.w < 12)
-            {
-                for (; x < (left + src.w); x++)
-                {
-                    outptr[x] = ptr[x - left];
-                }
-            }
-            else
-            {
-                memcpy(outptr + left, ptr, src.w * sizeof(T));
-                x += src.w;
-            }
-            for (; x < w; x++)
-            {
-                outptr[x] = ptr[src.w - 1];
-            }
-            ptr += src.w;
-            outptr += w;
-        }
-        // fill bottom
-        ptr -= src.w;
-        for (; y < h; y++)
-        {
-            int x = 0;
-            for (; x < left; x++)
-            {
-                outptr[x] = ptr[0];
-            }
-            if(src.w < 12)
-            {
-                for (; x < (left + src.w); x++)
-                {
-                    outptr[x] = ptr[x - left];
-                }
-            }
-            else
-            {
-                memcpy(outptr + left, ptr, src.w * sizeof(T));
-                x += src.w;
-            }
-            for (; x < w; x++)
-            {
-                outptr[x] = ptr[src.w - 1];
-            }
-            outptr += w;
-        }
-    }
-}
-
 int Padding::forward(const Mat& bottom_blob, Mat& top_blob, const Option& opt) const
 {
     if (top == 0 && bottom == 0 && left == 0 && right == 0)
@@ -201,64 +55,9 @@ int Padding::forward(const Mat& bottom_blob, Mat& top_blob, const Option& opt) c
         return 0;
     }
 
-    int w = bottom_blob.w;
-    int h = bottom_blob.h;
-    int channels = bottom_blob.c;
-    int dims = bottom_blob.dims;
-    size_t elemsize = bottom_blob.elemsize;
-
-    int outw = w + left + right;
-
-    if (dims == 1)
-    {
-        top_blob.create(outw, elemsize, opt.blob_allocator);
-        if (top_blob.empty())
-            return -100;
-
-        if (elemsize == 1)
-            copy_make_border_image<signed char>(bottom_blob, top_blob, 0, left, type, value);
-        else if (elemsize == 4)
-            copy_make_border_image<float>(bottom_blob, top_blob, 0, left, type, value);
-
-        return 0;
-    }
-
-    int outh = h + top + bottom;
-
-    if (dims == 2)
-    {
-        top_blob.create(outw, outh, elemsize, opt.blob_allocator);
-        if (top_blob.empty())
-            return -100;
-
-        if (elemsize == 1)
-            copy_make_border_image<signed char>(bottom_blob, top_blob, top, left, type, value);
-        else if (elemsize == 4)
-            copy_make_border_image<float>(bottom_blob, top_blob, top, left, type, value);
-
-        return 0;
-    }
-
-    if (dims == 3)
-    {
-        top_blob.create(outw, outh, channels, elemsize, opt.blob_allocator);
-        if (top_blob.empty())
-            return -100;
-
-        #pragma omp parallel for num_threads(opt.num_threads)
-        for (int q=0; q<channels; q++)
-        {
-            const Mat m = bottom_blob.channel(q);
-            Mat borderm = top_blob.channel(q);
-
-            if (elemsize == 1)
-                copy_make_border_image<signed char>(m, borderm, top, left, type, value);
-            else if (elemsize == 4)
-                copy_make_border_image<float>(m, borderm, top, left, type, value);
-        }
-
-        return 0;
-    }
+    copy_make_border(bottom_blob, top_blob, top, bottom, left, right, type, value, opt.blob_allocator, opt.num_threads);
+    if (top_blob.empty())
+        return -100;
 
     return 0;
 }
@@ -289,64 +88,9 @@ int Padding::forward(const std::vector<Mat>& bottom_blobs, std::vector<Mat>& top
         return 0;
     }
 
-    int w = bottom_blob.w;
-    int h = bottom_blob.h;
-    int channels = bottom_blob.c;
-    int dims = bottom_blob.dims;
-    size_t elemsize = bottom_blob.elemsize;
-
-    int outw = w + _left + _right;
-
-    if (dims == 1)
-    {
-        top_blob.create(outw, elemsize, opt.blob_allocator);
-        if (top_blob.empty())
-            return -100;
-
-        if (elemsize == 1)
-            copy_make_border_image<signed char>(bottom_blob, top_blob, 0, _left, type, value);
-        else if (elemsize == 4)
-            copy_make_border_image<float>(bottom_blob, top_blob, 0, _left, type, value);
-
-        return 0;
-    }
-
-    int outh = h + _top + _bottom;
-
-    if (dims == 2)
-    {
-        top_blob.create(outw, outh, elemsize, opt.blob_allocator);
-        if (top_blob.empty())
-            return -100;
-
-        if (elemsize == 1)
-            copy_make_border_image<signed char>(bottom_blob, top_blob, _top, _left, type, value);
-        else if (elemsize == 4)
-            copy_make_border_image<float>(bottom_blob, top_blob, _top, _left, type, value);
-
-        return 0;
-    }
-
-    if (dims == 3)
-    {
-        top_blob.create(outw, outh, channels, elemsize, opt.blob_allocator);
-        if (top_blob.empty())
-            return -100;
-
-        #pragma omp parallel for num_threads(opt.num_threads)
-        for (int q=0; q<channels; q++)
-        {
-            const Mat m = bottom_blob.channel(q);
-            Mat borderm = top_blob.channel(q);
-
-            if (elemsize == 1)
-                copy_make_border_image<signed char>(m, borderm, _top, _left, type, value);
-            else if (elemsize == 4)
-                copy_make_border_image<float>(m, borderm, _top, _left, type, value);
-        }
-
-        return 0;
-    }
+    copy_make_border(bottom_blob, top_blob, _top, _bottom, _left, _right, type, value, opt.blob_allocator, opt.num_threads);
+    if (top_blob.empty())
+        return -100;
 
     return 0;
 }
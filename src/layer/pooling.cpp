@@ -14,13 +14,302 @@
 
 #include "pooling.h"
 #include <float.h>
+#include <stdio.h>
 #include <algorithm>
 #include "layer_type.h"
+#include "threadpool.h"
 
 namespace ncnn {
 
 DEFINE_LAYER_CREATOR(Pooling)
 
+// max or average of every channel, int8 blobs take max only
+class GlobalPoolingTask : public ParallelTask
+{
+public:
+    GlobalPoolingTask(const Mat& _bottom_blob, Mat& _top_blob, int _pooling_type) : bottom_blob(_bottom_blob), top_blob(_top_blob), pooling_type(_pooling_type) {}
+
+    virtual void execute(int begin, int end, int /*thread_id*/) const
+    {
+        int size = bottom_blob.w * bottom_blob.h;
+
+        if (bottom_blob.elemsize == 1u)
+        {
+            // int8 max pooling keeps the blob scale
+            signed char* outptr = top_blob;
+
+            for (int q=begin; q<end; q++)
+            {
+                const signed char* ptr = bottom_blob.channel(q);
+
+                signed char max = ptr[0];
+                for (int i=0; i<size; i++)
+                {
+                    max = std::max(max, ptr[i]);
+                }
+
+                outptr[q] = max;
+            }
+
+            return;
+        }
+
+        for (int q=begin; q<end; q++)
+        {
+            const float* ptr = bottom_blob.channel(q);
+
+            if (pooling_type == Pooling::PoolMethod_MAX)
+            {
+                float max = ptr[0];
+                for (int i=0; i<size; i++)
+                {
+                    max = std::max(max, ptr[i]);
+                }
+
+                top_blob[q] = max;
+            }
+            else
+            {
+                float sum = 0.f;
+                for (int i=0; i<size; i++)
+                {
+                    sum += ptr[i];
+                }
+
+                top_blob[q] = sum / size;
+            }
+        }
+    }
+
+private:
+    const Mat& bottom_blob;
+    Mat& top_blob;
+    int pooling_type;
+};
+
+// windowed max or average of every channel
+class PoolingWindowTask : public ParallelTask
+{
+public:
+    PoolingWindowTask(const Pooling* _layer, const Mat& _bottom_blob, Mat& _top_blob, const int* _space_ofs, int _border_top, int _border_left, int _htailpad, int _wtailpad)
+        : layer(_layer), bottom_blob(_bottom_blob), top_blob(_top_blob), space_ofs(_space_ofs), border_top(_border_top), border_left(_border_left), htailpad(_htailpad), wtailpad(_wtailpad) {}
+
+    virtual void execute(int begin, int end, int /*thread_id*/) const
+    {
+        const int w = bottom_blob.w;
+        const int h = bottom_blob.h;
+        const int outw = top_blob.w;
+        const int outh = top_blob.h;
+
+        const int pooling_type = layer->pooling_type;
+        const int kernel_w = layer->kernel_w;
+        const int kernel_h = layer->kernel_h;
+        const int stride_w = layer->stride_w;
+        const int stride_h = layer->stride_h;
+        const int pad_left = layer->pad_left;
+        const int pad_right = layer->pad_right;
+        const int pad_top = layer->pad_top;
+        const int pad_bottom = layer->pad_bottom;
+        const int maxk = kernel_w * kernel_h;
+
+        if (bottom_blob.elemsize == 1u)
+        {
+            for (int q=begin; q<end; q++)
+            {
+                const Mat m = bottom_blob.channel(q);
+                signed char* outptr = top_blob.channel(q);
+
+                for (int i = 0; i < outh; i++)
+                {
+                    const int sy0 = i*stride_h - border_top;
+                    const int ky0 = std::max(0, -sy0);
+                    const int ky1 = std::min(kernel_h, h - sy0);
+
+                    for (int j = 0; j < outw; j++)
+                    {
+                        const int sx0 = j*stride_w - border_left;
+                        const int kx0 = std::max(0, -sx0);
+                        const int kx1 = std::min(kernel_w, w - sx0);
+
+                        signed char max = -128;
+
+                        for (int ky = ky0; ky < ky1; ky++)
+                        {
+                            const signed char* sptr = m.row<signed char>(sy0 + ky) + sx0;
+
+                            for (int kx = kx0; kx < kx1; kx++)
+                            {
+                                max = std::max(max, sptr[kx]);
+                            }
+                        }
+
+                        outptr[j] = max;
+                    }
+
+                    outptr += outw;
+                }
+            }
+        }
+        else if (pooling_type == Pooling::PoolMethod_MAX)
+        {
+            for (int q=begin; q<end; q++)
+            {
+                const Mat m = bottom_blob.channel(q);
+                float* outptr = top_blob.channel(q);
+
+                for (int i = 0; i < outh; i++)
+                {
+                    const int sy0 = i*stride_h - border_top;
+                    const int ky0 = std::max(0, -sy0);
+                    const int ky1 = std::min(kernel_h, h - sy0);
+
+                    for (int j = 0; j < outw; j++)
+                    {
+                        const int sx0 = j*stride_w - border_left;
+                        const int kx0 = std::max(0, -sx0);
+                        const int kx1 = std::min(kernel_w, w - sx0);
+
+                        float max = -FLT_MAX;
+
+                        if (ky0 == 0 && ky1 == kernel_h && kx0 == 0 && kx1 == kernel_w)
+                        {
+                            const float* sptr = m.row(sy0) + sx0;
+
+                            for (int k = 0; k < maxk; k++)
+                            {
+                                float val = sptr[ space_ofs[k] ];
+                                max = std::max(max, val);
+                            }
+                        }
+                        else
+                        {
+                            for (int ky = ky0; ky < ky1; ky++)
+                            {
+                                const float* sptr = m.row(sy0 + ky) + sx0;
+
+                                for (int kx = kx0; kx < kx1; kx++)
+                                {
+                                    max = std::max(max, sptr[kx]);
+                                }
+                            }
+                        }
+
+                        outptr[j] = max;
+                    }
+
+                    outptr += outw;
+                }
+            }
+        }
+        else if (pooling_type == Pooling::PoolMethod_AVE)
+        {
+            for (int q=begin; q<end; q++)
+            {
+                const Mat m = bottom_blob.channel(q);
+                float* outptr = top_blob.channel(q);
+
+                for (int i = 0; i < outh; i++)
+                {
+                    const int sy0 = i*stride_h - border_top;
+                    const int ky0 = std::max(0, -sy0);
+                    const int ky1 = std::min(kernel_h, h - sy0);
+
+                    for (int j = 0; j < outw; j++)
+                    {
+                        const int sx0 = j*stride_w - border_left;
+                        const int kx0 = std::max(0, -sx0);
+                        const int kx1 = std::min(kernel_w, w - sx0);
+
+                        float sum = 0;
+
+                        if (ky0 == 0 && ky1 == kernel_h && kx0 == 0 && kx1 == kernel_w)
+                        {
+                            const float* sptr = m.row(sy0) + sx0;
+
+                            for (int k = 0; k < maxk; k++)
+                            {
+                                float val = sptr[ space_ofs[k] ];
+                                sum += val;
+                            }
+                        }
+                        else
+                        {
+                            for (int ky = ky0; ky < ky1; ky++)
+                            {
+                                const float* sptr = m.row(sy0 + ky) + sx0;
+
+                                for (int kx = kx0; kx < kx1; kx++)
+                                {
+                                    sum += sptr[kx];
+                                }
+                            }
+                        }
+
+                        outptr[j] = sum / maxk;
+                    }
+
+                    outptr += outw;
+                }
+
+                // fix pad
+                if (pad_top != 0)
+                {
+                    const float scale = (float)kernel_h / (kernel_h - pad_top);
+
+                    outptr = top_blob.channel(q).row(0);
+                    for (int i = 0; i < outw; i++)
+                    {
+                        outptr[i] *= scale;
+                    }
+                }
+                if (pad_bottom + htailpad != 0)
+                {
+                    const float scale = (float)kernel_h / (kernel_h - pad_bottom - htailpad);
+
+                    outptr = top_blob.channel(q).row(outh - 1);
+                    for (int i = 0; i < outw; i++)
+                    {
+                        outptr[i] *= scale;
+                    }
+                }
+                if (pad_left != 0)
+                {
+                    const float scale = (float)kernel_w / (kernel_w - pad_left);
+
+                    outptr = top_blob.channel(q);
+                    for (int i = 0; i < outh; i++)
+                    {
+                        *outptr *= scale;
+                        outptr += outw;
+                    }
+                }
+                if (pad_right + wtailpad != 0)
+                {
+                    const float scale = (float)kernel_w / (kernel_w - pad_right - wtailpad);
+
+                    outptr = top_blob.channel(q);
+                    outptr += outw - 1;
+                    for (int i = 0; i < outh; i++)
+                    {
+                        *outptr *= scale;
+                        outptr += outw;
+                    }
+                }
+            }
+        }
+    }
+
+private:
+    const Pooling* layer;
+    const Mat& bottom_blob;
+    Mat& top_blob;
+    const int* space_ofs;
+    int border_top;
+    int border_left;
+    int htailpad;
+    int wtailpad;
+};
+
 Pooling::Pooling()
 {
     one_blob_only = true;
@@ -88,6 +377,22 @@ int Pooling::load_param(const ParamDict& pd)
     return 0;
 }
 
+int Pooling::get_cost(const std::vector<Mat>& bottom_blobs, const std::vector<Mat>& top_blobs, LayerCost& cost) const
+{
+    Layer::get_cost(bottom_blobs, top_blobs, cost);
+
+    // one max or add per kernel element
+    const Mat& bottom_blob = bottom_blobs[0];
+    const Mat& top_blob = top_blobs[0];
+
+    if (global_pooling)
+        cost.flops = (unsigned long long)bottom_blob.w * bottom_blob.h * bottom_blob.c;
+    else
+        cost.flops = (unsigned long long)top_blob.w * top_blob.h * top_blob.c * kernel_w * kernel_h;
+
+    return 0;
+}
+
 int Pooling::forward(const Mat& bottom_blob, Mat& top_blob, const Option& opt) const
 {
     // max value in NxN window
@@ -99,65 +404,36 @@ int Pooling::forward(const Mat& bottom_blob, Mat& top_blob, const Option& opt) c
     size_t elemsize = bottom_blob.elemsize;
 
 //     fprintf(stderr, "Pooling     input %d x %d  pad = %d %d %d %d  ksize=%d %d  stride=%d %d\n", w, h, pad_left, pad_right, pad_top, pad_bottom, kernel_w, kernel_h, stride_w, stride_h);
+    if (elemsize == 1u && pooling_type != PoolMethod_MAX)
+    {
+        fprintf(stderr, "Pooling int8 supports max pooling only\n");
+        return -1;
+    }
+
     if (global_pooling)
     {
         top_blob.create(channels, elemsize, opt.blob_allocator);
         if (top_blob.empty())
             return -100;
 
-        int size = w * h;
-
-        if (pooling_type == PoolMethod_MAX)
+        if (elemsize == 1u || pooling_type == PoolMethod_MAX || pooling_type == PoolMethod_AVE)
         {
-            #pragma omp parallel for num_threads(opt.num_threads)
-            for (int q=0; q<channels; q++)
-            {
-                const float* ptr = bottom_blob.channel(q);
-
-                float max = ptr[0];
-                for (int i=0; i<size; i++)
-                {
-                    max = std::max(max, ptr[i]);
-                }
-
-                top_blob[q] = max;
-            }
-        }
-        else if (pooling_type == PoolMethod_AVE)
-        {
-            #pragma omp parallel for num_threads(opt.num_threads)
-            for (int q=0; q<channels; q++)
-            {
-                const float* ptr = bottom_blob.channel(q);
-
-                float sum = 0.f;
-                for (int i=0; i<size; i++)
-                {
-                    sum += ptr[i];
-                }
-
-                top_blob[q] = sum / size;
-            }
+            parallel_for(channels, GlobalPoolingTask(bottom_blob, top_blob, pooling_type), opt);
         }
 
         return 0;
     }
 
-    Mat bottom_blob_bordered = bottom_blob;
-
-    float pad_value = 0.f;
-    if (pooling_type == PoolMethod_MAX)
-    {
-        pad_value = -FLT_MAX;
-    }
-    else if (pooling_type == PoolMethod_AVE)
-    {
-        pad_value = 0.f;
-    }
-
     int wtailpad = 0;
     int htailpad = 0;
 
+    // the border is never materialized, windows are clipped against the image instead
+    // max pooling skips the -FLT_MAX border and avg pooling skips the zero border
+    int border_top = 0;
+    int border_bottom = 0;
+    int border_left = 0;
+    int border_right = 0;
+
     if (pad_mode == 0) // full padding
     {
         int wtail = (w + pad_left + pad_right - kernel_w) % stride_w;
@@ -168,21 +444,17 @@ int Pooling::forward(const Mat& bottom_blob, Mat& top_blob, const Option& opt) c
         if (htail != 0)
             htailpad = stride_h - htail;
 
-        copy_make_border(bottom_blob, bottom_blob_bordered, pad_top, pad_bottom + htailpad, pad_left, pad_right + wtailpad, BORDER_CONSTANT, pad_value, opt.workspace_allocator, opt.num_threads);
-        if (bottom_blob_bordered.empty())
-            return -100;
-
-        w = bottom_blob_bordered.w;
-        h = bottom_blob_bordered.h;
+        border_top = pad_top;
+        border_bottom = pad_bottom + htailpad;
+        border_left = pad_left;
+        border_right = pad_right + wtailpad;
     }
     else if (pad_mode == 1) // valid padding
     {
-        copy_make_border(bottom_blob, bottom_blob_bordered, pad_top, pad_bottom, pad_left, pad_right, BORDER_CONSTANT, pad_value, opt.workspace_allocator, opt.num_threads);
-        if (bottom_blob_bordered.empty())
-            return -100;
-
-        w = bottom_blob_bordered.w;
-        h = bottom_blob_bordered.h;
+        border_top = pad_top;
+        border_bottom = pad_bottom;
+        border_left = pad_left;
+        border_right = pad_right;
     }
     else if (pad_mode == 2) // tensorflow padding=SAME
     {
@@ -190,17 +462,15 @@ int Pooling::forward(const Mat& bottom_blob, Mat& top_blob, const Option& opt) c
         int hpad = kernel_h + (h - 1) / stride_h * stride_h - h;
         if (wpad > 0 || hpad > 0)
         {
-            copy_make_border(bottom_blob, bottom_blob_bordered, hpad / 2, hpad - hpad / 2, wpad / 2, wpad - wpad / 2, BORDER_CONSTANT, pad_value, opt.workspace_allocator, opt.num_threads);
-            if (bottom_blob_bordered.empty())
-                return -100;
+            border_top = hpad / 2;
+            border_bottom = hpad - hpad / 2;
+            border_left = wpad / 2;
+            border_right = wpad - wpad / 2;
         }
-
-        w = bottom_blob_bordered.w;
-        h = bottom_blob_bordered.h;
     }
 
-    int outw = (w - kernel_w) / stride_w + 1;
-    int outh = (h - kernel_h) / stride_h + 1;
+    int outw = (w + border_left + border_right - kernel_w) / stride_w + 1;
+    int outh = (h + border_top + border_bottom - kernel_h) / stride_h + 1;
 
     top_blob.create(outw, outh, channels, elemsize, opt.blob_allocator);
     if (top_blob.empty())
@@ -227,108 +497,9 @@ int Pooling::forward(const Mat& bottom_blob, Mat& top_blob, const Option& opt) c
         }
     }
 
-    if (pooling_type == PoolMethod_MAX)
-    {
-        #pragma omp parallel for num_threads(opt.num_threads)
-        for (int q=0; q<channels; q++)
-        {
-            const Mat m = bottom_blob_bordered.channel(q);
-            float* outptr = top_blob.channel(q);
-
-            for (int i = 0; i < outh; i++)
-            {
-                for (int j = 0; j < outw; j++)
-                {
-                    const float* sptr = m.row(i*stride_h) + j*stride_w;
-
-                    float max = sptr[0];
-
-                    for (int k = 0; k < maxk; k++)
-                    {
-                        float val = sptr[ space_ofs[k] ];
-                        max = std::max(max, val);
-                    }
-
-                    outptr[j] = max;
-                }
-
-                outptr += outw;
-            }
-        }
-    }
-    else if (pooling_type == PoolMethod_AVE)
+    if (elemsize == 1u || pooling_type == PoolMethod_MAX || pooling_type == PoolMethod_AVE)
     {
-        #pragma omp parallel for num_threads(opt.num_threads)
-        for (int q=0; q<channels; q++)
-        {
-            const Mat m = bottom_blob_bordered.channel(q);
-            float* outptr = top_blob.channel(q);
-
-            for (int i = 0; i < outh; i++)
-            {
-                for (int j = 0; j < outw; j++)
-                {
-                    const float* sptr = m.row(i*stride_h) + j*stride_w;
-
-                    float sum = 0;
-
-                    for (int k = 0; k < maxk; k++)
-                    {
-                        float val = sptr[ space_ofs[k] ];
-                        sum += val;
-                    }
-
-                    outptr[j] = sum / maxk;
-                }
-
-                outptr += outw;
-            }
-
-            // fix pad
-            if (pad_top != 0)
-            {
-                const float scale = (float)kernel_h / (kernel_h - pad_top);
-
-                outptr = top_blob.channel(q).row(0);
-                for (int i = 0; i < outw; i++)
-                {
-                    outptr[i] *= scale;
-                }
-            }
-            if (pad_bottom + htailpad != 0)
-            {
-                const float scale = (float)kernel_h / (kernel_h - pad_bottom - htailpad);
-
-                outptr = top_blob.channel(q).row(outh - 1);
-                for (int i = 0; i < outw; i++)
-                {
-                    outptr[i] *= scale;
-                }
-            }
-            if (pad_left != 0)
-            {
-                const float scale = (float)kernel_w / (kernel_w - pad_left);
-
-                outptr = top_blob.channel(q);
-                for (int i = 0; i < outh; i++)
-                {
-                    *outptr *= scale;
-                    outptr += outw;
-                }
-            }
-            if (pad_right + wtailpad != 0)
-            {
-                const float scale = (float)kernel_w / (kernel_w - pad_right - wtailpad);
-
-                outptr = top_blob.channel(q);
-                outptr += outw - 1;
-                for (int i = 0; i < outh; i++)
-                {
-                    *outptr *= scale;
-                    outptr += outw;
-                }
-            }
-        }
+        parallel_for(channels, PoolingWindowTask(this, bottom_blob, top_blob, space_ofs, border_top, border_left, htailpad, wtailpad), opt);
     }
 
     return 0;
@@ -25,6 +25,7 @@ PriorBox::PriorBox()
     one_blob_only = false;
     support_inplace = false;
     support_vulkan = true;
+    shape_only = true;
 
 #if NCNN_VULKAN
     pipeline_priorbox = 0;
@@ -29,6 +29,8 @@ Quantize::Quantize()
 int Quantize::load_param(const ParamDict& pd)
 {
     scale = pd.get(0, 1.f);
+    zero_point = pd.get(1, 0);
+    scales = pd.get(2, Mat());
 
     return 0;
 }
@@ -59,7 +61,9 @@ int Quantize::forward(const Mat& bottom_blob, Mat& top_blob, const Option& opt)
         #pragma omp parallel for num_threads(opt.num_threads)
         for (int i=0; i<w; i++)
         {
-            outptr[i] = float2int8(ptr[i] * scale);
+            float s = scales.empty() ? scale : scales[i];
+
+            outptr[i] = float2int8(ptr[i] * s + zero_point);
         }
     }
 
@@ -67,19 +71,23 @@ int Quantize::forward(const Mat& bottom_blob, Mat& top_blob, const Option& opt)
     {
         int w = bottom_blob.w;
         int h = bottom_blob.h;
-        int size = w * h;
 
         top_blob.create(w, h, (size_t)1u, opt.blob_allocator);
         if (top_blob.empty())
             return -100;
 
-        const float* ptr = bottom_blob;
-        signed char* outptr = top_blob;
-
         #pragma omp parallel for num_threads(opt.num_threads)
-        for (int i=0; i<size; i++)
+        for (int i=0; i<h; i++)
         {
-            outptr[i] = float2int8(ptr[i] * scale);
+            const float* ptr = bottom_blob.row(i);
+            signed char* outptr = top_blob.row<signed char>(i);
+
+            float s = scales.empty() ? scale : scales[i];
+
+            for (int j=0; j<w; j++)
+            {
+                outptr[j] = float2int8(ptr[j] * s + zero_point);
+            }
         }
     }
 
@@ -100,9 +108,11 @@ int Quantize::forward(const Mat& bottom_blob, Mat& top_blob, const Option& opt)
             const float* ptr = bottom_blob.channel(q);
             signed char* outptr = top_blob.channel(q);
 
+            float s = scales.empty() ? scale : scales[q];
+
             for (int i=0; i<size; i++)
             {
-                outptr[i] = float2int8(ptr[i] * scale);
+                outptr[i] = float2int8(ptr[i] * s + zero_point);
             }
         }
     }
@@ -30,6 +30,12 @@ public:
 
 public:
     float scale;
+
+    // asymmetric quantization, q = round(x * scale) + zero_point
+    int zero_point;
+
+    // one scale per channel, row or element, overrides scale when set
+    Mat scales;
 };
 
 } // namespace ncnn
@@ -162,7 +162,7 @@ static int reduction_op(const Mat& a, Mat& b, float v0, int dim, float coeff, co
             {
                 for (int j=0; j<w; j++)
                 {
-                    mins_ptr[j] = op(mins_ptr[j], ptr[i]);
+                    mins_ptr[j] = op(mins_ptr[j], ptr[j]);
                 }
 
                 ptr += w;
@@ -265,7 +265,7 @@ int Reduction::forward(const Mat& bottom_blob, Mat& top_blob, const Option& opt)
         {
             for (int q=0; q<channels; q++)
             {
-                float* outptr = top_blob.channel(q);
+                float* outptr = top_blob.row(q);
 
                 for (int i=0; i<h; i++)
                 {
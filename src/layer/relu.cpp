@@ -14,11 +14,74 @@
 
 #include "relu.h"
 #include <algorithm>
+#include "threadpool.h"
 
 namespace ncnn {
 
 DEFINE_LAYER_CREATOR(ReLU)
 
+class ReLUTask : public ParallelTask
+{
+public:
+    ReLUTask(Mat& _bottom_top_blob, float _slope) : bottom_top_blob(_bottom_top_blob), slope(_slope) {}
+
+    virtual void execute(int begin, int end, int /*thread_id*/) const
+    {
+        int size = bottom_top_blob.w * bottom_top_blob.h;
+
+        for (int q=begin; q<end; q++)
+        {
+            float* ptr = bottom_top_blob.channel(q);
+
+            if (slope == 0.f)
+            {
+                for (int i=0; i<size; i++)
+                {
+                    if (ptr[i] < 0)
+                        ptr[i] = 0;
+                }
+            }
+            else
+            {
+                for (int i=0; i<size; i++)
+                {
+                    if (ptr[i] < 0)
+                        ptr[i] *= slope;
+                }
+            }
+        }
+    }
+
+private:
+    Mat& bottom_top_blob;
+    float slope;
+};
+
+class ReLUInt8Task : public ParallelTask
+{
+public:
+    ReLUInt8Task(Mat& _bottom_top_blob) : bottom_top_blob(_bottom_top_blob) {}
+
+    virtual void execute(int begin, int end, int /*thread_id*/) const
+    {
+        int size = bottom_top_blob.w * bottom_top_blob.h;
+
+        for (int q=begin; q<end; q++)
+        {
+            signed char* ptr = bottom_top_blob.channel(q);
+
+            for (int i=0; i<size; i++)
+            {
+                if (ptr[i] < 0)
+                    ptr[i] = 0;
+            }
+        }
+    }
+
+private:
+    Mat& bottom_top_blob;
+};
+
 ReLU::ReLU()
 {
     one_blob_only = true;
@@ -40,24 +103,9 @@ int ReLU::load_param(const ParamDict& pd)
 
 int ReLU::forward_inplace_int8(Mat& bottom_top_blob, const Option& opt) const
 {
-    int w = bottom_top_blob.w;
-    int h = bottom_top_blob.h;
-    int channels = bottom_top_blob.c;
-    int size = w * h;
-
     if (slope == 0.f)
     {
-        #pragma omp parallel for num_threads(opt.num_threads)
-        for (int q=0; q<channels; q++)
-        {
-            signed char* ptr = bottom_top_blob.channel(q);
-
-            for (int i=0; i<size; i++)
-            {
-                if (ptr[i] < 0)
-                    ptr[i] = 0;
-            }
-        }
+        parallel_for(bottom_top_blob.c, ReLUInt8Task(bottom_top_blob), opt);
     }
     else
     {
@@ -83,39 +131,7 @@ int ReLU::forward_inplace(Mat& bottom_top_blob, const Option& opt) const
     if (bottom_top_blob.elemsize == 1u)
         return ReLU::forward_inplace_int8(bottom_top_blob, opt);
 
-    int w = bottom_top_blob.w;
-    int h = bottom_top_blob.h;
-    int channels = bottom_top_blob.c;
-    int size = w * h;
-
-    if (slope == 0.f)
-    {
-        #pragma omp parallel for num_threads(opt.num_threads)
-        for (int q=0; q<channels; q++)
-        {
-            float* ptr = bottom_top_blob.channel(q);
-
-            for (int i=0; i<size; i++)
-            {
-                if (ptr[i] < 0)
-                    ptr[i] = 0;
-            }
-        }
-    }
-    else
-    {
-        #pragma omp parallel for num_threads(opt.num_threads)
-        for (int q=0; q<channels; q++)
-        {
-            float* ptr = bottom_top_blob.channel(q);
-
-            for (int i=0; i<size; i++)
-            {
-                if (ptr[i] < 0)
-                    ptr[i] *= slope;
-            }
-        }
-    }
+    parallel_for(bottom_top_blob.c, ReLUTask(bottom_top_blob, slope), opt);
 
     return 0;
 }
@@ -42,6 +42,8 @@ int Requantize::load_param(const ParamDict& pd)
     bias_term = pd.get(2, 0);
     bias_data_size = pd.get(3, 0);
     fusion_relu = pd.get(4, 0);
+    zero_point = pd.get(5, 0);
+    scales_in = pd.get(6, Mat());
 
     return 0;
 }
@@ -58,6 +60,17 @@ int Requantize::load_model(const ModelBin& mb)
     return 0;
 }
 
+// requantize n values with one scale_in and bias
+static void requantize(const int* intptr, signed char* ptr, float scale_in, float bias, float scale_out, int zero_point, bool fusion_relu, int n)
+{
+    for (int i=0; i<n; i++)
+    {
+        ptr[i] = float2int8(((intptr[i] * scale_in) + bias) * scale_out + zero_point);
+        if (fusion_relu && ptr[i] < zero_point)
+            ptr[i] = zero_point;
+    }
+}
+
 int Requantize::forward(const Mat& bottom_blob, Mat& top_blob, const Option& opt) const
 { 
     int dims = bottom_blob.dims;
@@ -66,42 +79,20 @@ int Requantize::forward(const Mat& bottom_blob, Mat& top_blob, const Option& opt
     {
         int w = bottom_blob.w;
 
+        top_blob.create(w, (size_t)1u, opt.blob_allocator);
+        if (top_blob.empty())
+            return -100;
+
         const int* intptr = bottom_blob;
         signed char * ptr = top_blob;
 
-        if (bias_term)
-        {
-            if (bias_data_size > 1)
-            {
-                #pragma omp parallel for num_threads(opt.num_threads)
-                for (int i=0; i<w; i++)
-                {
-                    ptr[i] = float2int8(((intptr[i] * scale_in) + bias_data[i]) * scale_out);
-                    if (fusion_relu && ptr[i] < 0)
-                        ptr[i] = 0;
-                }
-            }
-            else
-            {
-                float bias = bias_data[0];
-                #pragma omp parallel for num_threads(opt.num_threads)
-                for (int i=0; i<w; i++)
-                {
-                    ptr[i] = float2int8(((intptr[i] * scale_in) + bias) * scale_out);
-                    if (fusion_relu && ptr[i] < 0)
-                        ptr[i] = 0;
-                }
-            }
-        }
-        else
+        #pragma omp parallel for num_threads(opt.num_threads)
+        for (int i=0; i<w; i++)
         {
-            #pragma omp parallel for num_threads(opt.num_threads)
-            for (int i=0; i<w; i++)
-            {
-                ptr[i] = float2int8(intptr[i] * scale_in * scale_out);
-                if (fusion_relu && ptr[i] < 0)
-                    ptr[i] = 0;
-            }
+            float scale = scales_in.empty() ? scale_in : scales_in[i];
+            float bias = bias_term ? bias_data_size > 1 ? bias_data[i] : bias_data[0] : 0.f;
+
+            requantize(intptr + i, ptr + i, scale, bias, scale_out, zero_point, fusion_relu, 1);
         }
     }
 
@@ -110,39 +101,20 @@ int Requantize::forward(const Mat& bottom_blob, Mat& top_blob, const Option& opt
         int w = bottom_blob.w;
         int h = bottom_blob.h;
 
-        if (bias_term)
-        {
-            #pragma omp parallel for num_threads(opt.num_threads)
-            for (int i=0; i<h; i++)
-            {
-                const int* intptr = bottom_blob.row<const int>(i);
-                signed char* ptr = top_blob.row<signed char>(i);
-
-                float bias = bias_data_size > 1 ? bias_data[i] : bias_data[0];
-
-                for (int j=0; j<w; j++)
-                {
-                    ptr[j] = float2int8(((intptr[j] * scale_in) + bias) * scale_out);
-                    if (fusion_relu && ptr[j] < 0)
-                        ptr[j] = 0;
-                }
-            }
-        }
-        else
+        top_blob.create(w, h, (size_t)1u, opt.blob_allocator);
+        if (top_blob.empty())
+            return -100;
+
+        #pragma omp parallel for num_threads(opt.num_threads)
+        for (int i=0; i<h; i++)
         {
-            #pragma omp parallel for num_threads(opt.num_threads)
-            for (int i=0; i<h; i++)
-            {
-                const int* intptr = bottom_blob.row<const int>(i);
-                signed char* ptr = top_blob.row<signed char>(i);
-
-                for (int j=0; j<w; j++)
-                {
-                    ptr[j] = float2int8(intptr[j] * scale_in * scale_out);
-                    if (fusion_relu && ptr[j] < 0)
-                        ptr[j] = 0;
-                }
-            }
+            const int* intptr = bottom_blob.row<const int>(i);
+            signed char* ptr = top_blob.row<signed char>(i);
+
+            float scale = scales_in.empty() ? scale_in : scales_in[i];
+            float bias = bias_term ? bias_data_size > 1 ? bias_data[i] : bias_data[0] : 0.f;
+
+            requantize(intptr, ptr, scale, bias, scale_out, zero_point, fusion_relu, w);
         }
     }
 
@@ -151,45 +123,26 @@ int Requantize::forward(const Mat& bottom_blob, Mat& top_blob, const Option& opt
         int w = bottom_blob.w;
         int h = bottom_blob.h;
         int channels = bottom_blob.c;
-        int size = w * h;      
+        int size = w * h;
 
-        if (bias_term)
+        top_blob.create(w, h, channels, (size_t)1u, opt.blob_allocator);
+        if (top_blob.empty())
+            return -100;
+
+        #pragma omp parallel for num_threads(opt.num_threads)
+        for (int q=0; q<channels; q++)
         {
-            #pragma omp parallel for num_threads(opt.num_threads)
-            for (int q=0; q<channels; q++)
-            {
-                const int* intptr = bottom_blob.channel(q);
-                signed char* ptr = top_blob.channel(q);
-
-                float bias = bias_data_size > 1 ? bias_data[q] : bias_data[0];
-
-                for (int i=0; i<size; i++)
-                {
-                    ptr[i] = float2int8(((intptr[i] * scale_in) + bias) * scale_out);
-                    if (fusion_relu && ptr[i] < 0)
-                        ptr[i] = 0;
-                }
-            }
+            const int* intptr = bottom_blob.channel(q);
+            signed char* ptr = top_blob.channel(q);
+
+            float scale = scales_in.empty() ? scale_in : scales_in[q];
+            float bias = bias_term ? bias_data_size > 1 ? bias_data[q] : bias_data[0] : 0.f;
+
+            requantize(intptr, ptr, scale, bias, scale_out, zero_point, fusion_relu, size);
         }
-        else
-        {
-            #pragma omp parallel for num_threads(opt.num_threads)
-            for (int q=0; q<channels; q++)
-            {
-                const int* intptr = bottom_blob.channel(q);
-                signed char* ptr = top_blob.channel(q);
-
-                for (int i=0; i<size; i++)
-                {
-                    ptr[i] = float2int8(intptr[i] * scale_in * scale_out);
-                    if (fusion_relu && ptr[i] < 0)
-                        ptr[i] = 0;
-                }
-            }
-        }    
     }
 
     return 0;
 }
 
-} // namespace ncnn
\ No newline at end of file
+} // namespace ncnn
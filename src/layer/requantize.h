@@ -38,6 +38,12 @@ public:
 
     bool fusion_relu;
 
+    // asymmetric output, q = round(x * scale_out) + zero_point
+    int zero_point;
+
+    // one scale_in per channel, row or element, overrides scale_in when set
+    Mat scales_in;
+
     Mat bias_data;
 };
 
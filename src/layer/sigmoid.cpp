@@ -14,6 +14,7 @@
 
 #include "sigmoid.h"
 #include <math.h>
+#include "threadpool.h"
 
 namespace ncnn {
 
@@ -31,24 +32,34 @@ Sigmoid::Sigmoid()
 #endif // NCNN_VULKAN
 }
 
-int Sigmoid::forward_inplace(Mat& bottom_top_blob, const Option& opt) const
+class SigmoidTask : public ParallelTask
 {
-    int w = bottom_top_blob.w;
-    int h = bottom_top_blob.h;
-    int channels = bottom_top_blob.c;
-    int size = w * h;
+public:
+    SigmoidTask(Mat& _bottom_top_blob) : bottom_top_blob(_bottom_top_blob) {}
 
-    #pragma omp parallel for num_threads(opt.num_threads)
-    for (int q=0; q<channels; q++)
+    virtual void execute(int begin, int end, int /*thread_id*/) const
     {
-        float* ptr = bottom_top_blob.channel(q);
+        int size = bottom_top_blob.w * bottom_top_blob.h;
 
-        for (int i=0; i<size; i++)
+        for (int q=begin; q<end; q++)
         {
-            ptr[i] = 1.f / (1.f + exp(-ptr[i]));
+            float* ptr = bottom_top_blob.channel(q);
+
+            for (int i=0; i<size; i++)
+            {
+                ptr[i] = 1.f / (1.f + exp(-ptr[i]));
+            }
         }
     }
 
+private:
+    Mat& bottom_top_blob;
+};
+
+int Sigmoid::forward_inplace(Mat& bottom_top_blob, const Option& opt) const
+{
+    parallel_for(bottom_top_blob.c, SigmoidTask(bottom_top_blob), opt);
+
     return 0;
 }
 
@@ -0,0 +1,116 @@
+// Tencent is pleased to support the open source community by making ncnn available.
+//
+// Copyright (C) 2019 THL A29 Limited, a Tencent company. All rights reserved.
+//
+// Licensed under the BSD 3-Clause License (the "License"); you may not use this file except
+// in compliance with the License. You may obtain a copy of the License at
+//
+// https://opensource.org/licenses/BSD-3-Clause
+//
+// Unless required by applicable law or agreed to in writing, software distributed
+// under the License is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR
+// CONDITIONS OF ANY KIND, either express or implied. See the License for the
+// specific language governing permissions and limitations under the License.
+
+// bfloat16 loads and stores for the float32 kernels
+// bfloat16 is the upper half of float32, widening is a shift
+
+// distinct element type so that bfloat16 weight does not read as half-precision
+struct bfloat16
+{
+    unsigned short value;
+};
+
+static inline float bfloat16_to_float32(unsigned short value)
+{
+    union
+    {
+        unsigned int u;
+        float f;
+    } tmp;
+
+    tmp.u = (unsigned int)value << 16;
+
+    return tmp.f;
+}
+
+static inline unsigned short float32_to_bfloat16(float value)
+{
+    // round to nearest even
+    union
+    {
+        unsigned int u;
+        float f;
+    } tmp;
+
+    tmp.f = value;
+
+    if ((tmp.u & 0x7fffffff) > 0x7f800000)
+    {
+        // NaN, keep it quiet
+        return (tmp.u >> 16) | 0x40;
+    }
+
+    unsigned int lsb = (tmp.u >> 16) & 1;
+    return (tmp.u + 0x7fff + lsb) >> 16;
+}
+
+#if __SSE2__
+// 4 bfloat16 values to float32
+static inline __m128 bfloat16_to_float32_sse(const unsigned short* ptr)
+{
+    return _mm_castsi128_ps(_mm_unpacklo_epi16(_mm_setzero_si128(), _mm_loadl_epi64((const __m128i*)ptr)));
+}
+
+// float32 to 4 bfloat16 values
+static inline void float32_to_bfloat16_sse(unsigned short* ptr, __m128 _v)
+{
+    __m128i _u = _mm_castps_si128(_v);
+
+    __m128i _lsb = _mm_and_si128(_mm_srli_epi32(_u, 16), _mm_set1_epi32(1));
+    __m128i _r = _mm_srli_epi32(_mm_add_epi32(_mm_add_epi32(_u, _mm_set1_epi32(0x7fff)), _lsb), 16);
+
+    // NaN, keep it quiet
+    __m128i _abs = _mm_and_si128(_u, _mm_set1_epi32(0x7fffffff));
+    __m128i _nan = _mm_cmpgt_epi32(_abs, _mm_set1_epi32(0x7f800000));
+    __m128i _q = _mm_or_si128(_mm_srli_epi32(_u, 16), _mm_set1_epi32(0x40));
+    _r = _mm_or_si128(_mm_and_si128(_nan, _q), _mm_andnot_si128(_nan, _r));
+
+    // pack the low halves with signed saturation out of the way
+    _r = _mm_sub_epi32(_r, _mm_set1_epi32(0x8000));
+    _r = _mm_packs_epi32(_r, _r);
+    _r = _mm_xor_si128(_r, _mm_set1_epi16((short)0x8000));
+
+    _mm_storel_epi64((__m128i*)ptr, _r);
+}
+#endif // __SSE2__
+
+static inline void bfloat16_to_float32_row(const unsigned short* ptr, float* outptr, int size)
+{
+    int i = 0;
+#if __SSE2__
+    for (; i+3<size; i+=4)
+    {
+        _mm_storeu_ps(outptr + i, bfloat16_to_float32_sse(ptr + i));
+    }
+#endif // __SSE2__
+    for (; i<size; i++)
+    {
+        outptr[i] = bfloat16_to_float32(ptr[i]);
+    }
+}
+
+static inline void float32_to_bfloat16_row(const float* ptr, unsigned short* outptr, int size)
+{
+    int i = 0;
+#if __SSE2__
+    for (; i+3<size; i+=4)
+    {
+        float32_to_bfloat16_sse(outptr + i, _mm_loadu_ps(ptr + i));
+    }
+#endif // __SSE2__
+    for (; i<size; i++)
+    {
+        outptr[i] = float32_to_bfloat16(ptr[i]);
+    }
+}
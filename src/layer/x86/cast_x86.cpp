@@ -0,0 +1,117 @@
+// Tencent is pleased to support the open source community by making ncnn available.
+//
+// Copyright (C) 2019 THL A29 Limited, a Tencent company. All rights reserved.
+//
+// Licensed under the BSD 3-Clause License (the "License"); you may not use this file except
+// in compliance with the License. You may obtain a copy of the License at
+//
+// https://opensource.org/licenses/BSD-3-Clause
+//
+// Unless required by applicable law or agreed to in writing, software distributed
+// under the License is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR
+// CONDITIONS OF ANY KIND, either express or implied. See the License for the
+// specific language governing permissions and limitations under the License.
+
+#include "cast_x86.h"
+
+#if __SSE2__
+#include <emmintrin.h>
+#if __F16C__
+#include <immintrin.h>
+#endif // __F16C__
+#endif // __SSE2__
+
+namespace ncnn {
+
+#include "float16_sse.h"
+#include "bfloat16_sse.h"
+
+DEFINE_LAYER_CREATOR(Cast_x86)
+
+int Cast_x86::forward(const Mat& bottom_blob, Mat& top_blob, const Option& opt) const
+{
+    bool fp32_to_fp16 = type_from == 1 && type_to == 2;
+    bool fp16_to_fp32 = type_from == 2 && type_to == 1;
+    bool fp32_to_bf16 = type_from == 1 && type_to == 4;
+    bool bf16_to_fp32 = type_from == 4 && type_to == 1;
+
+    if (!fp32_to_fp16 && !fp16_to_fp32 && !fp32_to_bf16 && !bf16_to_fp32)
+        return Cast::forward(bottom_blob, top_blob, opt);
+
+    int w = bottom_blob.w;
+    int h = bottom_blob.h;
+    int channels = bottom_blob.c;
+    int dims = bottom_blob.dims;
+    int packing = bottom_blob.packing;
+
+    size_t out_elemsize = (fp32_to_fp16 || fp32_to_bf16 ? 2 : 4) * packing;
+
+    if (dims == 1)
+    {
+        top_blob.create(w, out_elemsize, packing, opt.blob_allocator);
+    }
+    else if (dims == 2)
+    {
+        top_blob.create(w, h, out_elemsize, packing, opt.blob_allocator);
+    }
+    else if (dims == 3)
+    {
+        top_blob.create(w, h, channels, out_elemsize, packing, opt.blob_allocator);
+    }
+    if (top_blob.empty())
+        return -100;
+
+    int size = w * h * packing;
+
+    if (fp32_to_fp16)
+    {
+        #pragma omp parallel for num_threads(opt.num_threads)
+        for (int q=0; q<channels; q++)
+        {
+            const float* ptr = bottom_blob.channel(q);
+            unsigned short* outptr = top_blob.channel(q);
+
+            float32_to_float16_row(ptr, outptr, size);
+        }
+    }
+
+    if (fp16_to_fp32)
+    {
+        #pragma omp parallel for num_threads(opt.num_threads)
+        for (int q=0; q<channels; q++)
+        {
+            const unsigned short* ptr = bottom_blob.channel(q);
+            float* outptr = top_blob.channel(q);
+
+            float16_to_float32_row(ptr, outptr, size);
+        }
+    }
+
+    if (fp32_to_bf16)
+    {
+        #pragma omp parallel for num_threads(opt.num_threads)
+        for (int q=0; q<channels; q++)
+        {
+            const float* ptr = bottom_blob.channel(q);
+            unsigned short* outptr = top_blob.channel(q);
+
+            float32_to_bfloat16_row(ptr, outptr, size);
+        }
+    }
+
+    if (bf16_to_fp32)
+    {
+        #pragma omp parallel for num_threads(opt.num_threads)
+        for (int q=0; q<channels; q++)
+        {
+            const unsigned short* ptr = bottom_blob.channel(q);
+            float* outptr = top_blob.channel(q);
+
+            bfloat16_to_float32_row(ptr, outptr, size);
+        }
+    }
+
+    return 0;
+}
+
+} // namespace ncnn
@@ -0,0 +1,97 @@
+// Tencent is pleased to support the open source community by making ncnn available.
+//
+// Copyright (C) 2019 THL A29 Limited, a Tencent company. All rights reserved.
+//
+// Licensed under the BSD 3-Clause License (the "License"); you may not use this file except
+// in compliance with the License. You may obtain a copy of the License at
+//
+// https://opensource.org/licenses/BSD-3-Clause
+//
+// Unless required by applicable law or agreed to in writing, software distributed
+// under the License is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR
+// CONDITIONS OF ANY KIND, either express or implied. See the License for the
+// specific language governing permissions and limitations under the License.
+
+#if __SSE2__
+#include <emmintrin.h>
+#endif // __SSE2__
+
+// top(outch x size) = sparse kernel(outch x inch) * bottom(inch x size)
+// every nonzero weight is broadcast over a block of 16 pixels of its input channel
+static void conv1x1s1_sparse_sse(const Mat& bottom_blob, Mat& top_blob, const Mat& sparse_data, const Mat& sparse_rowptr, const Mat& sparse_colidx, const Mat& _bias, const Option& opt)
+{
+    const int size = top_blob.w * top_blob.h;
+    const int outch = top_blob.c;
+
+    const float* bottom = bottom_blob;
+    const size_t cstep = bottom_blob.cstep;
+
+    const float* values = sparse_data;
+    const int* rowptr = (const int*)sparse_rowptr.data;
+    const int* colidx = (const int*)sparse_colidx.data;
+
+    const float* bias = _bias;
+
+    #pragma omp parallel for num_threads(opt.num_threads)
+    for (int p=0; p<outch; p++)
+    {
+        float* outptr = top_blob.channel(p);
+
+        const float bias0 = bias ? bias[p] : 0.f;
+
+        const int n0 = rowptr[p];
+        const int n1 = rowptr[p+1];
+
+        int j = 0;
+#if __SSE2__
+        for (; j+15<size; j+=16)
+        {
+            __m128 _sum0 = _mm_set1_ps(bias0);
+            __m128 _sum1 = _mm_set1_ps(bias0);
+            __m128 _sum2 = _mm_set1_ps(bias0);
+            __m128 _sum3 = _mm_set1_ps(bias0);
+
+            for (int n=n0; n<n1; n++)
+            {
+                const float* r0 = bottom + cstep * colidx[n] + j;
+
+                __m128 _k = _mm_set1_ps(values[n]);
+
+                _sum0 = _mm_add_ps(_sum0, _mm_mul_ps(_k, _mm_loadu_ps(r0)));
+                _sum1 = _mm_add_ps(_sum1, _mm_mul_ps(_k, _mm_loadu_ps(r0 + 4)));
+                _sum2 = _mm_add_ps(_sum2, _mm_mul_ps(_k, _mm_loadu_ps(r0 + 8)));
+                _sum3 = _mm_add_ps(_sum3, _mm_mul_ps(_k, _mm_loadu_ps(r0 + 12)));
+            }
+
+            _mm_storeu_ps(outptr + j, _sum0);
+            _mm_storeu_ps(outptr + j + 4, _sum1);
+            _mm_storeu_ps(outptr + j + 8, _sum2);
+            _mm_storeu_ps(outptr + j + 12, _sum3);
+        }
+        for (; j+3<size; j+=4)
+        {
+            __m128 _sum0 = _mm_set1_ps(bias0);
+
+            for (int n=n0; n<n1; n++)
+            {
+                const float* r0 = bottom + cstep * colidx[n] + j;
+
+                _sum0 = _mm_add_ps(_sum0, _mm_mul_ps(_mm_set1_ps(values[n]), _mm_loadu_ps(r0)));
+            }
+
+            _mm_storeu_ps(outptr + j, _sum0);
+        }
+#endif // __SSE2__
+        for (; j<size; j++)
+        {
+            float sum0 = bias0;
+
+            for (int n=n0; n<n1; n++)
+            {
+                sum0 += values[n] * bottom[cstep * colidx[n] + j];
+            }
+
+            outptr[j] = sum0;
+        }
+    }
+}
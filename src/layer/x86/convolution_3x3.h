@@ -188,7 +188,7 @@ static void conv3x3s1_winograd23_transform_kernel_sse(const Mat& kernel, Mat& ke
     }
 }
 
-static void conv3x3s1_winograd23_sse(const Mat& bottom_blob, Mat& top_blob, const Mat& kernel_tm, const Mat& _bias, const Option& opt)
+static void conv3x3s1_winograd23_sse(const Mat& bottom_blob, Mat& top_blob, const Mat& kernel_tm, const Mat& _bias, int pad_top, int pad_left, const Option& opt)
 {
     int w = bottom_blob.w;
     int h = bottom_blob.h;
@@ -199,6 +199,7 @@ static void conv3x3s1_winograd23_sse(const Mat& bottom_blob, Mat& top_blob, cons
     int outch = top_blob.c;
 
     // pad to 2n+2, winograd F(2,3)
+    // together with the convolution padding in a single copy
     Mat bottom_blob_bordered = bottom_blob;
 
     outw = (outw + 1) / 2 * 2;
@@ -206,7 +207,7 @@ static void conv3x3s1_winograd23_sse(const Mat& bottom_blob, Mat& top_blob, cons
 
     w = outw + 2;
     h = outh + 2;
-    copy_make_border(bottom_blob, bottom_blob_bordered, 0, h - bottom_blob.h, 0, w - bottom_blob.w, 0, 0.f, opt.workspace_allocator, opt.num_threads);
+    copy_make_border(bottom_blob, bottom_blob_bordered, pad_top, h - bottom_blob.h - pad_top, pad_left, w - bottom_blob.w - pad_left, 0, 0.f, opt.workspace_allocator, opt.num_threads);
 
     const float* bias = _bias;
 
@@ -611,7 +612,7 @@ static void conv3x3s1_winograd43_transform_kernel_sse(const Mat& kernel, Mat& ke
     }
 }
 
-static void conv3x3s1_winograd43_sse(const Mat& bottom_blob, Mat& top_blob, const Mat& kernel_tm, const Mat& _bias, const Option& opt)
+static void conv3x3s1_winograd43_sse(const Mat& bottom_blob, Mat& top_blob, const Mat& kernel_tm, const Mat& _bias, int pad_top, int pad_left, const Option& opt)
 {
     int w = bottom_blob.w;
     int h = bottom_blob.h;
@@ -622,6 +623,7 @@ static void conv3x3s1_winograd43_sse(const Mat& bottom_blob, Mat& top_blob, cons
     int outch = top_blob.c;
 
     // pad to 4n+2, winograd F(4,3)
+    // together with the convolution padding in a single copy
     Mat bottom_blob_bordered = bottom_blob;
 
     outw = (outw + 3) / 4 * 4;
@@ -629,7 +631,7 @@ static void conv3x3s1_winograd43_sse(const Mat& bottom_blob, Mat& top_blob, cons
 
     w = outw + 2;
     h = outh + 2;
-    copy_make_border(bottom_blob, bottom_blob_bordered, 0, h - bottom_blob.h, 0, w - bottom_blob.w, 0, 0.f, opt.workspace_allocator, opt.num_threads);
+    copy_make_border(bottom_blob, bottom_blob_bordered, pad_top, h - bottom_blob.h - pad_top, pad_left, w - bottom_blob.w - pad_left, 0, 0.f, opt.workspace_allocator, opt.num_threads);
 
     const float* bias = _bias;    
 
@@ -126,7 +126,7 @@ static void conv3x3s1_winograd23_transform_kernel_int8_sse(const Mat& kernel, Ma
     }
 }
 
-static void conv3x3s1_winograd23_int8_sse(const Mat& bottom_blob, Mat& top_blob, const Mat& kernel_tm, const Option& opt)
+static void conv3x3s1_winograd23_int8_sse(const Mat& bottom_blob, Mat& top_blob, const Mat& kernel_tm, int pad_top, int pad_left, const Option& opt)
 {
     int w = bottom_blob.w;
     int h = bottom_blob.h;
@@ -137,6 +137,7 @@ static void conv3x3s1_winograd23_int8_sse(const Mat& bottom_blob, Mat& top_blob,
     int outch = top_blob.c;
 
     // pad to 2n+2, winograd F(2,3)
+    // together with the convolution padding in a single copy
     Mat bottom_blob_bordered = bottom_blob;
 
     outw = (outw + 1) / 2 * 2;
@@ -144,7 +145,7 @@ static void conv3x3s1_winograd23_int8_sse(const Mat& bottom_blob, Mat& top_blob,
 
     w = outw + 2;
     h = outh + 2;
-    copy_make_border(bottom_blob, bottom_blob_bordered, 0, h - bottom_blob.h, 0, w - bottom_blob.w, 0, 0.f, opt.workspace_allocator, opt.num_threads);  
+    copy_make_border(bottom_blob, bottom_blob_bordered, pad_top, h - bottom_blob.h - pad_top, pad_left, w - bottom_blob.w - pad_left, 0, 0.f, opt.workspace_allocator, opt.num_threads);  
 
     // BEGIN transform input
     Mat bottom_blob_tm;
@@ -509,14 +510,16 @@ static void conv3x3s1_winograd43_transform_kernel_int8_sse(const Mat& kernel, Ma
     //     { 1.0f/24, -1.0f/12,  1.0f/6},
     //     {    0.0f,     0.0f,    1.0f}
     // };
+    // the last row is scaled by 6 instead of 24 so that U fits in short,
+    // the output transform multiplies it back by 4
     const short ktm[6][3] = {
         {  6,    0,    0},
         { -4,   -4,   -4},
         { -4,    4,   -4},
         {  1,    2,    4},
         {  1,   -2,    4},
-        {  0,    0,   24}
-    };    
+        {  0,    0,    6}
+    };
 
     #pragma omp parallel for
     for (int p = 0; p<outch; p++)
@@ -554,7 +557,7 @@ static void conv3x3s1_winograd43_transform_kernel_int8_sse(const Mat& kernel, Ma
     }
 }
 
-static void conv3x3s1_winograd43_int8_sse(const Mat& bottom_blob, Mat& top_blob, const Mat& kernel_tm, const Option& opt)
+static void conv3x3s1_winograd43_int8_sse(const Mat& bottom_blob, Mat& top_blob, const Mat& kernel_tm, int pad_top, int pad_left, const Option& opt)
 {
     int w = bottom_blob.w;
     int h = bottom_blob.h;
@@ -565,6 +568,7 @@ static void conv3x3s1_winograd43_int8_sse(const Mat& bottom_blob, Mat& top_blob,
     int outch = top_blob.c;
 
     // pad to 4n+2, winograd F(4,3)
+    // together with the convolution padding in a single copy
     Mat bottom_blob_bordered = bottom_blob;
 
     outw = (outw + 3) / 4 * 4;
@@ -572,7 +576,7 @@ static void conv3x3s1_winograd43_int8_sse(const Mat& bottom_blob, Mat& top_blob,
 
     w = outw + 2;
     h = outh + 2;
-    copy_make_border(bottom_blob, bottom_blob_bordered, 0, h - bottom_blob.h, 0, w - bottom_blob.w, 0, 0.f, opt.workspace_allocator, opt.num_threads);
+    copy_make_border(bottom_blob, bottom_blob_bordered, pad_top, h - bottom_blob.h - pad_top, pad_left, w - bottom_blob.w - pad_left, 0, 0.f, opt.workspace_allocator, opt.num_threads);
 
     // BEGIN transform input
     Mat bottom_blob_tm;
@@ -744,13 +748,13 @@ static void conv3x3s1_winograd43_int8_sse(const Mat& bottom_blob, Mat& top_blob,
         //     {1.0f, 1.0f,  1.0f, 1.0f,  1.0f, 0.0f},
         //     {0.0f, 1.0f, -1.0f, 2.0f, -2.0f, 0.0f},
         //     {0.0f, 1.0f,  1.0f, 4.0f,  4.0f, 0.0f},
-        //     {0.0f, 1.0f, -1.0f, 8.0f, -8.0f, 1.0f}
+        //     {0.0f, 1.0f, -1.0f, 8.0f, -8.0f, 4.0f}
         // };
 
         // 0 =	r00 + r01 + r02 + r03 +	r04
         // 1 =		  r01 - r02 + 2 * (r03 - r04)
         // 2 =		  r01 + r02 + 4 * (r03 + r04)
-        // 3 =		  r01 - r02 + 8 * (r03 - r04)  + r05
+        // 3 =		  r01 - r02 + 8 * (r03 - r04)  + 4 * r05
         
 
         int w_tm = outw / 4 * 6;
@@ -796,7 +800,7 @@ static void conv3x3s1_winograd43_int8_sse(const Mat& bottom_blob, Mat& top_blob,
                         w0[n] = s0[n] + s1[n] + s2[n] +   s3[n] +   s4[n];
                         w1[n] =         s1[n] - s2[n] + 2*s3[n] - 2*s4[n];
                         w2[n] =         s1[n] + s2[n] + 4*s3[n] + 4*s4[n];
-                        w3[n] =         s1[n] - s2[n] + 8*s3[n] - 8*s4[n] + s5[n];
+                        w3[n] =         s1[n] - s2[n] + 8*s3[n] - 8*s4[n] + 4*s5[n];
                     }
                     // transpose w to w_t
                     {
@@ -813,7 +817,7 @@ static void conv3x3s1_winograd43_int8_sse(const Mat& bottom_blob, Mat& top_blob,
                         o0[n] = d0[n] + d1[n] + d2[n] +   d3[n] +   d4[n];
                         o1[n] =         d1[n] - d2[n] + 2*d3[n] - 2*d4[n];
                         o2[n] =         d1[n] + d2[n] + 4*d3[n] + 4*d4[n];
-                        o3[n] =         d1[n] - d2[n] + 8*d3[n] - 8*d4[n] + d5[n];
+                        o3[n] =         d1[n] - d2[n] + 8*d3[n] - 8*d4[n] + 4*d5[n];
                     }
                     // save to top blob tm
                     for (int n = 0; n < 4; n++)
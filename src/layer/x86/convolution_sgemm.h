@@ -0,0 +1,315 @@
+// Tencent is pleased to support the open source community by making ncnn available.
+//
+// Copyright (C) 2019 THL A29 Limited, a Tencent company. All rights reserved.
+//
+// Licensed under the BSD 3-Clause License (the "License"); you may not use this file except
+// in compliance with the License. You may obtain a copy of the License at
+//
+// https://opensource.org/licenses/BSD-3-Clause
+//
+// Unless required by applicable law or agreed to in writing, software distributed
+// under the License is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR
+// CONDITIONS OF ANY KIND, either express or implied. See the License for the
+// specific language governing permissions and limitations under the License.
+
+#if __SSE2__
+#include <emmintrin.h>
+#endif // __SSE2__
+
+static void conv_im2col_sgemm_transform_kernel_sse(const Mat& _kernel, Mat& kernel_tm, int inch, int outch, int maxk)
+{
+    // src = maxk-inch-outch
+    // dst = 4a-inch*maxk-outch/4a, remaining output channels keep one row each
+    const int size = inch * maxk;
+
+    kernel_tm.create(4 * size, outch / 4 + outch % 4);
+
+    int p = 0;
+    for (; p+3<outch; p+=4)
+    {
+        const float* k0 = (const float*)_kernel + size * p;
+        const float* k1 = k0 + size;
+        const float* k2 = k1 + size;
+        const float* k3 = k2 + size;
+
+        float* ktmp = kernel_tm.row(p / 4);
+
+        for (int k=0; k<size; k++)
+        {
+            ktmp[0] = k0[k];
+            ktmp[1] = k1[k];
+            ktmp[2] = k2[k];
+            ktmp[3] = k3[k];
+
+            ktmp += 4;
+        }
+    }
+    for (; p<outch; p++)
+    {
+        const float* k0 = (const float*)_kernel + size * p;
+
+        float* ktmp = kernel_tm.row(p / 4 + p % 4);
+
+        for (int k=0; k<size; k++)
+        {
+            ktmp[k] = k0[k];
+        }
+    }
+}
+
+// the weight row of every output channel group is converted to float32 inside the loop
+template<typename T>
+static void conv_sgemm_sse(const float* colptr, size_t colstep, int K, Mat& top_blob, const T* kernel_tm, int kernel_tm_w, const float* bias, const Option& opt)
+{
+    int outch = top_blob.c;
+    const int size = top_blob.w * top_blob.h;
+
+    const int nn_outch = outch / 4;
+    const int remain_outch_start = nn_outch * 4;
+
+    #pragma omp parallel for num_threads(opt.num_threads)
+    for (int pp=0; pp<nn_outch; pp++)
+    {
+        const int p = pp * 4;
+
+        float* outptr0 = top_blob.channel(p);
+        float* outptr1 = top_blob.channel(p+1);
+        float* outptr2 = top_blob.channel(p+2);
+        float* outptr3 = top_blob.channel(p+3);
+
+        const float bias0 = bias ? bias[p] : 0.f;
+        const float bias1 = bias ? bias[p+1] : 0.f;
+        const float bias2 = bias ? bias[p+2] : 0.f;
+        const float bias3 = bias ? bias[p+3] : 0.f;
+
+        const T* ktmp0 = kernel_tm + kernel_tm_w * pp;
+
+        int j = 0;
+#if __SSE2__
+        for (; j+7<size; j+=8)
+        {
+            __m128 _sum00 = _mm_set1_ps(bias0);
+            __m128 _sum01 = _mm_set1_ps(bias0);
+            __m128 _sum10 = _mm_set1_ps(bias1);
+            __m128 _sum11 = _mm_set1_ps(bias1);
+            __m128 _sum20 = _mm_set1_ps(bias2);
+            __m128 _sum21 = _mm_set1_ps(bias2);
+            __m128 _sum30 = _mm_set1_ps(bias3);
+            __m128 _sum31 = _mm_set1_ps(bias3);
+
+            const T* ktmp = ktmp0;
+            const float* r0 = colptr + j;
+
+            for (int k=0; k<K; k++)
+            {
+                __m128 _r00 = _mm_loadu_ps(r0);
+                __m128 _r01 = _mm_loadu_ps(r0 + 4);
+
+                __m128 _k = load_weight_sse(ktmp);
+                __m128 _k0 = _mm_shuffle_ps(_k, _k, _MM_SHUFFLE(0, 0, 0, 0));
+                __m128 _k1 = _mm_shuffle_ps(_k, _k, _MM_SHUFFLE(1, 1, 1, 1));
+                __m128 _k2 = _mm_shuffle_ps(_k, _k, _MM_SHUFFLE(2, 2, 2, 2));
+                __m128 _k3 = _mm_shuffle_ps(_k, _k, _MM_SHUFFLE(3, 3, 3, 3));
+
+                _sum00 = _mm_add_ps(_sum00, _mm_mul_ps(_k0, _r00));
+                _sum01 = _mm_add_ps(_sum01, _mm_mul_ps(_k0, _r01));
+                _sum10 = _mm_add_ps(_sum10, _mm_mul_ps(_k1, _r00));
+                _sum11 = _mm_add_ps(_sum11, _mm_mul_ps(_k1, _r01));
+                _sum20 = _mm_add_ps(_sum20, _mm_mul_ps(_k2, _r00));
+                _sum21 = _mm_add_ps(_sum21, _mm_mul_ps(_k2, _r01));
+                _sum30 = _mm_add_ps(_sum30, _mm_mul_ps(_k3, _r00));
+                _sum31 = _mm_add_ps(_sum31, _mm_mul_ps(_k3, _r01));
+
+                ktmp += 4;
+                r0 += colstep;
+            }
+
+            _mm_storeu_ps(outptr0 + j, _sum00);
+            _mm_storeu_ps(outptr0 + j + 4, _sum01);
+            _mm_storeu_ps(outptr1 + j, _sum10);
+            _mm_storeu_ps(outptr1 + j + 4, _sum11);
+            _mm_storeu_ps(outptr2 + j, _sum20);
+            _mm_storeu_ps(outptr2 + j + 4, _sum21);
+            _mm_storeu_ps(outptr3 + j, _sum30);
+            _mm_storeu_ps(outptr3 + j + 4, _sum31);
+        }
+#endif // __SSE2__
+        for (; j<size; j++)
+        {
+            float sum0 = bias0;
+            float sum1 = bias1;
+            float sum2 = bias2;
+            float sum3 = bias3;
+
+            const T* ktmp = ktmp0;
+            const float* r0 = colptr + j;
+
+            for (int k=0; k<K; k++)
+            {
+                sum0 += load_weight(ktmp) * r0[0];
+                sum1 += load_weight(ktmp + 1) * r0[0];
+                sum2 += load_weight(ktmp + 2) * r0[0];
+                sum3 += load_weight(ktmp + 3) * r0[0];
+
+                ktmp += 4;
+                r0 += colstep;
+            }
+
+            outptr0[j] = sum0;
+            outptr1[j] = sum1;
+            outptr2[j] = sum2;
+            outptr3[j] = sum3;
+        }
+    }
+
+    #pragma omp parallel for num_threads(opt.num_threads)
+    for (int p=remain_outch_start; p<outch; p++)
+    {
+        float* outptr0 = top_blob.channel(p);
+
+        const float bias0 = bias ? bias[p] : 0.f;
+
+        const T* ktmp0 = kernel_tm + kernel_tm_w * (p / 4 + p % 4);
+
+        int j = 0;
+#if __SSE2__
+        for (; j+7<size; j+=8)
+        {
+            __m128 _sum0 = _mm_set1_ps(bias0);
+            __m128 _sum1 = _mm_set1_ps(bias0);
+
+            const float* r0 = colptr + j;
+
+            for (int k=0; k<K; k++)
+            {
+                __m128 _k0 = _mm_set1_ps(load_weight(ktmp0 + k));
+
+                _sum0 = _mm_add_ps(_sum0, _mm_mul_ps(_k0, _mm_loadu_ps(r0)));
+                _sum1 = _mm_add_ps(_sum1, _mm_mul_ps(_k0, _mm_loadu_ps(r0 + 4)));
+
+                r0 += colstep;
+            }
+
+            _mm_storeu_ps(outptr0 + j, _sum0);
+            _mm_storeu_ps(outptr0 + j + 4, _sum1);
+        }
+#endif // __SSE2__
+        for (; j<size; j++)
+        {
+            float sum0 = bias0;
+
+            const float* r0 = colptr + j;
+
+            for (int k=0; k<K; k++)
+            {
+                sum0 += load_weight(ktmp0 + k) * r0[0];
+
+                r0 += colstep;
+            }
+
+            outptr0[j] = sum0;
+        }
+    }
+}
+
+// top = kernel_tm(outch x inch*maxk) * col(inch*maxk x outw*outh)
+// im2col reads the pad_top / pad_left zero border in place, the bottom blob is never bordered
+// 1x1 stride 1 convolution without padding multiplies the bottom blob directly
+// kernel_tm element is float, half-precision or bfloat16
+template<typename T>
+static void conv_im2col_sgemm_sse(const Mat& bottom_blob, Mat& top_blob, const T* kernel_tm, int kernel_tm_w, const Mat& _bias, int kernel_w, int kernel_h, int stride_w, int stride_h, int pad_top, int pad_left, const Option& opt)
+{
+    int w = bottom_blob.w;
+    int h = bottom_blob.h;
+    int inch = bottom_blob.c;
+
+    int outw = top_blob.w;
+    int outh = top_blob.h;
+
+    const int size = outw * outh;
+    const int maxk = kernel_w * kernel_h;
+    const int K = inch * maxk;
+
+    const float* bias = _bias;
+
+    Mat col;
+    const float* colptr;
+    size_t colstep;
+
+    if (maxk == 1 && stride_w == 1 && stride_h == 1 && pad_top == 0 && pad_left == 0 && outw == w && outh == h)
+    {
+        colptr = bottom_blob;
+        colstep = bottom_blob.cstep;
+    }
+    else
+    {
+        col.create(size, K, 4u, opt.workspace_allocator);
+        if (col.empty())
+            return;
+
+        // im2col
+        #pragma omp parallel for num_threads(opt.num_threads)
+        for (int q=0; q<inch; q++)
+        {
+            const float* img = bottom_blob.channel(q);
+
+            for (int u=0; u<kernel_h; u++)
+            {
+                for (int v=0; v<kernel_w; v++)
+                {
+                    float* ptr = col.row(q * maxk + u * kernel_w + v);
+
+                    // output columns [j0, j1) read inside the image
+                    int j0 = 0;
+                    while (j0 < outw && j0 * stride_w + v - pad_left < 0)
+                        j0++;
+                    int j1 = outw;
+                    while (j1 > j0 && (j1 - 1) * stride_w + v - pad_left >= w)
+                        j1--;
+
+                    for (int i=0; i<outh; i++)
+                    {
+                        const int sy = i * stride_h + u - pad_top;
+                        if (sy < 0 || sy >= h)
+                        {
+                            memset(ptr, 0, outw * sizeof(float));
+                            ptr += outw;
+                            continue;
+                        }
+
+                        const float* sptr = img + sy * w + v - pad_left;
+
+                        int j = 0;
+                        for (; j<j0; j++)
+                        {
+                            ptr[j] = 0.f;
+                        }
+                        if (stride_w == 1)
+                        {
+                            memcpy(ptr + j0, sptr + j0, (j1 - j0) * sizeof(float));
+                            j = j1;
+                        }
+                        else
+                        {
+                            for (; j<j1; j++)
+                            {
+                                ptr[j] = sptr[j * stride_w];
+                            }
+                        }
+                        for (; j<outw; j++)
+                        {
+                            ptr[j] = 0.f;
+                        }
+
+                        ptr += outw;
+                    }
+                }
+            }
+        }
+
+        colptr = col;
+        colstep = size;
+    }
+
+    conv_sgemm_sse(colptr, colstep, K, top_blob, kernel_tm, kernel_tm_w, bias, opt);
+}
@@ -14,14 +14,30 @@
 
 #include "convolution_x86.h"
 
+#include <algorithm>
+
+#if __SSE2__
+#include <emmintrin.h>
+#if __F16C__ || __AVX512BF16__
+#include <immintrin.h>
+#endif // __F16C__ || __AVX512BF16__
+#endif // __SSE2__
+
 #include "layer_type.h"
 #include "benchmark.h"
 
 namespace ncnn {
 
+#include "float16_sse.h"
+#include "bfloat16_sse.h"
+#include "weight_sse.h"
+#include "weight_sparse.h"
+
 #include "convolution_1x1.h"
 #include "convolution_3x3.h"
 #include "convolution_5x5.h"
+#include "convolution_sgemm.h"
+#include "convolution_1x1_sparse.h"
 
 #include "convolution_sgemm_int8.h"
 #include "convolution_1x1_int8.h"
@@ -31,9 +47,60 @@ namespace ncnn {
 
 DEFINE_LAYER_CREATOR(Convolution_x86)
 
+// kernel_size x stride
+static const conv_func conv_func_table[7][4] =
+{
+    {
+        conv1x1s1_sse,
+        conv1x1s2_sse,
+        0,
+        0
+    }, // kernel_size = 1
+    {
+        0,
+        0,
+        0,
+        0
+    }, // kernel_size = 2
+    {
+        conv3x3s1_sse,
+        conv3x3s2_sse,
+        0,
+        0
+    }, // kernel_size = 3
+    {
+        0,
+        0,
+        0,
+        0
+    }, // kernel_size = 4
+    {
+        conv5x5s1_sse,
+        0,
+        0,
+        0
+    }, // kernel_size = 5
+    {
+        0,
+        0,
+        0,
+        0
+    }, // kernel_size = 6
+    {
+        0,          
+        0,          
+        0,
+        0
+    }  // kernel_size = 7        
+};
+
 Convolution_x86::Convolution_x86()
 {
     activation = 0;
+    impl = Impl_heuristic;
+    use_sparse_weight = false;
+    use_fp16_storage = false;
+    use_bf16_storage = false;
 }
 
 Convolution_x86::~Convolution_x86()
@@ -82,6 +149,11 @@ int Convolution_x86::load_param(const ParamDict& pd)
             use_winograd3x3 = true;
     }           
 
+    use_bf16_storage = pd.use_bf16_storage && !pd.use_vulkan_compute;
+    use_fp16_storage = pd.use_fp16_storage && !pd.use_vulkan_compute && !use_bf16_storage;
+
+    use_sparse_weight = pd.use_sparse_weight && !pd.use_vulkan_compute;
+
     return 0;
 }
 
@@ -91,6 +163,10 @@ int Convolution_x86::load_model(const ModelBin& mb)
     if (ret != 0)
         return ret;
 
+    // the int8 winograd kernel pads with zero, not with the zero point
+    if (use_int8_inference && bottom_blob_int8_zero_point != 0)
+        use_winograd3x3 = false;
+
     if (use_winograd3x3)
     {
         int num_input = weight_data_size / 9 / num_output;
@@ -100,12 +176,151 @@ int Convolution_x86::load_model(const ModelBin& mb)
             conv3x3s1_winograd43_transform_kernel_int8_sse(weight_data, weight_3x3_winograd23_data, num_input, num_output);
         else
             // conv3x3s1_winograd23_transform_kernel_sse(weight_data, weight_3x3_winograd23_data, num_input, num_output);
-            conv3x3s1_winograd43_transform_kernel_sse(weight_data, weight_3x3_winograd23_data, num_input, num_output);
+            conv3x3s1_winograd43_transform_kernel_sse(weight_data, weight_3x3_winograd43_data, num_input, num_output);
+    }
+
+    if (use_sparse_weight && !use_int8_inference && kernel_w == 1 && kernel_h == 1 && stride_w == 1 && stride_h == 1 && dilation_w == 1 && dilation_h == 1)
+    {
+        // pruned weight goes to the sparse kernel, it takes precedence over fp16 / bf16 storage
+        // the blocked spmm beats the dense 1x1 kernel from about half zero weight
+        if (weight_data.elemsize == 4u && weight_sparsity(weight_data) >= 0.5f)
+        {
+            use_fp16_storage = false;
+            use_bf16_storage = false;
+
+            ret = set_impl(Impl_sparse);
+            if (ret != 0)
+                return ret;
+        }
+    }
+
+    if (use_fp16_storage || use_bf16_storage)
+    {
+        // only the sgemm kernel reads half-precision or bfloat16 weight
+        const bool fp16 = use_fp16_storage;
+        const bool bf16 = use_bf16_storage;
+        use_fp16_storage = false;
+        use_bf16_storage = false;
+
+        std::vector<int> impls;
+        get_impls(impls);
+        if (std::find(impls.begin(), impls.end(), (int)Impl_sgemm) != impls.end())
+        {
+            ret = set_impl(Impl_sgemm);
+            if (ret != 0)
+                return ret;
+
+            Mat weight_sgemm_data_16;
+            if (bf16)
+                cast_float32_to_bfloat16(weight_sgemm_data, weight_sgemm_data_16);
+            else
+                cast_float32_to_float16(weight_sgemm_data, weight_sgemm_data_16);
+            if (weight_sgemm_data_16.empty())
+                return -100;
+
+            weight_sgemm_data = weight_sgemm_data_16;
+            weight_data.release();
+
+            use_fp16_storage = fp16;
+            use_bf16_storage = bf16;
+        }
     }
 
     return 0;
 }
 
+int Convolution_x86::get_impls(std::vector<int>& impls) const
+{
+    impls.clear();
+
+    // only the float32 kernels are interchangeable
+    // half-precision and bfloat16 weight is kept for the sgemm kernel alone
+    if (use_int8_inference || use_fp16_storage || use_bf16_storage)
+        return 0;
+
+    if (kernel_w != kernel_h || stride_w != stride_h || dilation_w != 1 || dilation_h != 1)
+        return 0;
+
+    if (kernel_w > 7 || stride_w > 7)
+        return 0;
+
+    // the generic implementation when there is no specialized direct kernel
+    impls.push_back(Impl_direct);
+
+    if (kernel_w == 3 && stride_w == 1)
+    {
+        impls.push_back(Impl_winograd23);
+        impls.push_back(Impl_winograd43);
+    }
+
+    impls.push_back(Impl_sgemm);
+
+    if (use_sparse_weight && kernel_w == 1 && stride_w == 1)
+        impls.push_back(Impl_sparse);
+
+    return 0;
+}
+
+int Convolution_x86::set_impl(int _impl)
+{
+    if (use_fp16_storage || use_bf16_storage)
+        return _impl == Impl_heuristic ? 0 : -1;
+
+    if (_impl != Impl_heuristic)
+    {
+        std::vector<int> impls;
+        get_impls(impls);
+        if (std::find(impls.begin(), impls.end(), _impl) == impls.end())
+            return -1;
+    }
+
+    if (use_int8_inference)
+        return 0;
+
+    const int maxk = kernel_w * kernel_h;
+    int num_input = weight_data_size / maxk / num_output;
+
+    // keep only the transformed weight that the chosen kernel reads
+    const bool need_winograd23 = _impl == Impl_winograd23;
+    const bool need_winograd43 = _impl == Impl_winograd43 || (_impl == Impl_heuristic && use_winograd3x3);
+    const bool need_sgemm = _impl == Impl_sgemm;
+    const bool need_sparse = _impl == Impl_sparse;
+
+    if (!need_winograd23)
+        weight_3x3_winograd23_data.release();
+    else if (weight_3x3_winograd23_data.empty())
+        conv3x3s1_winograd23_transform_kernel_sse(weight_data, weight_3x3_winograd23_data, num_input, num_output);
+
+    if (!need_winograd43)
+        weight_3x3_winograd43_data.release();
+    else if (weight_3x3_winograd43_data.empty())
+        conv3x3s1_winograd43_transform_kernel_sse(weight_data, weight_3x3_winograd43_data, num_input, num_output);
+
+    if (!need_sgemm)
+        weight_sgemm_data.release();
+    else if (weight_sgemm_data.empty())
+        conv_im2col_sgemm_transform_kernel_sse(weight_data, weight_sgemm_data, num_input, num_output, maxk);
+
+    if (!need_sparse)
+    {
+        weight_sparse_data.release();
+        weight_sparse_rowptr.release();
+        weight_sparse_colidx.release();
+    }
+    else if (weight_sparse_data.empty())
+        weight_sparse_transform(weight_data, num_input, num_output, weight_sparse_data, weight_sparse_rowptr, weight_sparse_colidx);
+
+    if ((need_winograd23 && weight_3x3_winograd23_data.empty())
+        || (need_winograd43 && weight_3x3_winograd43_data.empty())
+        || (need_sgemm && weight_sgemm_data.empty())
+        || (need_sparse && (weight_sparse_data.empty() || weight_sparse_rowptr.empty() || weight_sparse_colidx.empty())))
+        return -100;
+
+    impl = _impl;
+
+    return 0;
+}
+
 int Convolution_x86::forwardDilation(const Mat& bottom_blob, Mat& top_blob, conv_func conv, const Option& opt) const
 {
     int w = bottom_blob.w;
@@ -210,6 +425,34 @@ int Convolution_x86::forwardDilation(const Mat& bottom_blob, Mat& top_blob, conv
     return 0;
 }
 
+static size_t mat_bytes(const Mat& m)
+{
+    return m.total() * m.elemsize;
+}
+
+int Convolution_x86::get_cost(const std::vector<Mat>& bottom_blobs, const std::vector<Mat>& top_blobs, LayerCost& cost) const
+{
+    Convolution::get_cost(bottom_blobs, top_blobs, cost);
+
+    const Mat& top_blob = top_blobs[0];
+    const unsigned long long outsize = (unsigned long long)top_blob.w * top_blob.h * top_blob.c / num_output;
+
+    // the sparse kernel skips the zero weight
+    if (impl == Impl_sparse && !weight_sparse_rowptr.empty())
+    {
+        const int nnz = ((const int*)weight_sparse_rowptr.data)[num_output];
+
+        cost.macs = outsize * nnz;
+        cost.weight_bytes = mat_bytes(weight_sparse_data) + mat_bytes(weight_sparse_rowptr) + mat_bytes(weight_sparse_colidx) + mat_bytes(bias_data);
+    }
+    else if (use_fp16_storage || use_bf16_storage)
+    {
+        cost.weight_bytes = mat_bytes(weight_sgemm_data) + mat_bytes(bias_data);
+    }
+
+    return 0;
+}
+
 int Convolution_x86::forward(const Mat& bottom_blob, Mat& top_blob, const Option& opt) const
 {
     // convolv with NxN kernel
@@ -217,6 +460,12 @@ int Convolution_x86::forward(const Mat& bottom_blob, Mat& top_blob, const Option
 
     if (bottom_blob.dims != 3)
     {
+        if (weight_data.empty())
+        {
+            fprintf(stderr, "convolution with fp16 or bf16 weight storage expects 3-dim blob\n");
+            return -1;
+        }
+
         return Convolution::forward(bottom_blob, top_blob, opt);
     }
 
@@ -233,55 +482,6 @@ int Convolution_x86::forward(const Mat& bottom_blob, Mat& top_blob, const Option
         return Convolution::forward(bottom_blob, top_blob, opt);
     }
 
-    typedef void (*conv_func)(const Mat&, Mat&, const Mat&, const Mat&, const Option&);
-
-    // kernel_size x stride
-    conv_func conv_func_table[7][4] =
-    {
-        {
-            conv1x1s1_sse,
-            conv1x1s2_sse,
-            0,
-            0
-        }, // kernel_size = 1
-        {
-            0,
-            0,
-            0,
-            0
-        }, // kernel_size = 2
-        {
-            conv3x3s1_sse,
-            conv3x3s2_sse,
-            0,
-            0
-        }, // kernel_size = 3
-        {
-            0,
-            0,
-            0,
-            0
-        }, // kernel_size = 4
-        {
-            conv5x5s1_sse,
-            0,
-            0,
-            0
-        }, // kernel_size = 5
-        {
-            0,
-            0,
-            0,
-            0
-        }, // kernel_size = 6
-        {
-            0,          
-            0,          
-            0,
-            0
-        }  // kernel_size = 7        
-    };
-
     typedef void (*conv_int8_dequant_func)(const Mat&, Mat&, const Mat&, const Mat&, std::vector<float>, const Option&);
     typedef void (*conv_int8_requant_func)(const Mat&, Mat&, const Mat&, const Mat&, std::vector<float>, const Option&);
 
@@ -396,7 +596,7 @@ int Convolution_x86::forward(const Mat& bottom_blob, Mat& top_blob, const Option
     else
     {
         conv = conv_func_table[kernel_size-1][stride-1];
-        if (!conv)
+        if (!conv && impl != Impl_sgemm)
         {
             return Convolution::forward(bottom_blob, top_blob, opt);
         }
@@ -434,15 +634,16 @@ int Convolution_x86::forward(const Mat& bottom_blob, Mat& top_blob, const Option
         bottom_blob_unbordered = bottom_blob_int8;
     }
 
-    Mat bottom_blob_bordered = bottom_blob_unbordered;
+    int pad_top = 0;
+    int pad_bottom = 0;
+    int pad_left = 0;
+    int pad_right = 0;
     if (pad_w > 0 || pad_h > 0)
     {
-        copy_make_border(bottom_blob_unbordered, bottom_blob_bordered, pad_h, pad_h, pad_w, pad_w, BORDER_CONSTANT, 0.f, opt.workspace_allocator, opt.num_threads);
-        if (bottom_blob_bordered.empty())
-            return -100;
-
-        w = bottom_blob_bordered.w;
-        h = bottom_blob_bordered.h;
+        pad_top = pad_h;
+        pad_bottom = pad_h;
+        pad_left = pad_w;
+        pad_right = pad_w;
     }
     else if (pad_w == -233 && pad_h == -233)
     {
@@ -450,17 +651,29 @@ int Convolution_x86::forward(const Mat& bottom_blob, Mat& top_blob, const Option
         int hpad = kernel_size + (h - 1) / stride * stride - h;
         if (wpad > 0 || hpad > 0)
         {
-            copy_make_border(bottom_blob_unbordered, bottom_blob_bordered, hpad / 2, hpad - hpad / 2, wpad / 2, wpad - wpad / 2, BORDER_CONSTANT, 0.f, opt.workspace_allocator, opt.num_threads);
-            if (bottom_blob_bordered.empty())
-                return -100;
+            pad_top = hpad / 2;
+            pad_bottom = hpad - hpad / 2;
+            pad_left = wpad / 2;
+            pad_right = wpad - wpad / 2;
         }
-
-        w = bottom_blob_bordered.w;
-        h = bottom_blob_bordered.h;
     }
 
-    int outw = (w - kernel_size) / stride + 1;
-    int outh = (h - kernel_size) / stride + 1;
+    int outw = (w + pad_left + pad_right - kernel_size) / stride + 1;
+    int outh = (h + pad_top + pad_bottom - kernel_size) / stride + 1;
+
+    const bool use_winograd = impl == Impl_winograd23 || impl == Impl_winograd43 || (impl == Impl_heuristic && use_winograd3x3);
+
+    // winograd and sgemm kernels read the zero border themselves
+    Mat bottom_blob_bordered = bottom_blob_unbordered;
+    if (!use_winograd && impl != Impl_sgemm && (pad_top != 0 || pad_bottom != 0 || pad_left != 0 || pad_right != 0))
+    {
+        // the int8 border is the zero point, which dequantizes to zero
+        const float border_value = use_int8_inference ? bottom_blob_int8_zero_point : 0.f;
+
+        copy_make_border(bottom_blob_unbordered, bottom_blob_bordered, pad_top, pad_bottom, pad_left, pad_right, BORDER_CONSTANT, border_value, opt.workspace_allocator, opt.num_threads);
+        if (bottom_blob_bordered.empty())
+            return -100;
+    }
 
     // int8
     if (use_int8_inference)
@@ -479,7 +692,7 @@ int Convolution_x86::forward(const Mat& bottom_blob, Mat& top_blob, const Option
             if (use_winograd3x3)
             {
                 // conv3x3s1_winograd23_int8_sse(bottom_blob_bordered, top_blob_tm, weight_3x3_winograd23_data, opt);
-                conv3x3s1_winograd43_int8_sse(bottom_blob_bordered, top_blob_tm, weight_3x3_winograd23_data, opt);
+                conv3x3s1_winograd43_int8_sse(bottom_blob_bordered, top_blob_tm, weight_3x3_winograd23_data, pad_top, pad_left, opt);
 
                 // requantize, reverse scale inplace
                 #pragma omp parallel for num_threads(opt.num_threads)
@@ -495,7 +708,13 @@ int Convolution_x86::forward(const Mat& bottom_blob, Mat& top_blob, const Option
                 }
             }
             else
-                conv_int8_requant(bottom_blob_bordered, top_blob, weight_data, bias_data, requantize_scales, opt);                                                    
+                conv_int8_requant(bottom_blob_bordered, top_blob, weight_data, bias_data_int8, requantize_scales, opt);
+
+            // fused relu on the requantized output
+            if (activation)
+            {
+                activation->forward_inplace(top_blob, opt);
+            }
         }
         else
         {
@@ -506,7 +725,7 @@ int Convolution_x86::forward(const Mat& bottom_blob, Mat& top_blob, const Option
             if (use_winograd3x3)
             {
                 // conv3x3s1_winograd23_int8_sse(bottom_blob_bordered, top_blob, weight_3x3_winograd23_data, opt);
-                conv3x3s1_winograd43_int8_sse(bottom_blob_bordered, top_blob, weight_3x3_winograd23_data, opt);
+                conv3x3s1_winograd43_int8_sse(bottom_blob_bordered, top_blob, weight_3x3_winograd23_data, pad_top, pad_left, opt);
 
                 // dequantize, reverse scale inplace
                 #pragma omp parallel for num_threads(opt.num_threads)
@@ -521,7 +740,13 @@ int Convolution_x86::forward(const Mat& bottom_blob, Mat& top_blob, const Option
                 }
             }
             else
-                conv_int8_dequant(bottom_blob_bordered, top_blob, weight_data, bias_data, dequantize_scales, opt);     
+                conv_int8_dequant(bottom_blob_bordered, top_blob, weight_data, bias_data_int8, dequantize_scales, opt);
+
+            // fused activation on the dequantized output
+            if (activation)
+            {
+                activation->forward_inplace(top_blob, opt);
+            }
         }
     
         return 0;
@@ -532,11 +757,29 @@ int Convolution_x86::forward(const Mat& bottom_blob, Mat& top_blob, const Option
     if (top_blob.empty())
         return -100;    
 
-    if (use_winograd3x3)
+    if (impl == Impl_winograd23)
+    {
+        conv3x3s1_winograd23_sse(bottom_blob_bordered, top_blob, weight_3x3_winograd23_data, bias_data, pad_top, pad_left, opt);
+    }
+    else if (use_winograd)
+    {
+        conv3x3s1_winograd43_sse(bottom_blob_bordered, top_blob, weight_3x3_winograd43_data, bias_data, pad_top, pad_left, opt);
+    }
+    else if (impl == Impl_sgemm)
     {
-        //conv3x3s1_winograd23_sse(bottom_blob_bordered, top_blob, weight_3x3_winograd23_data, bias_data, opt);
-        conv3x3s1_winograd43_sse(bottom_blob_bordered, top_blob, weight_3x3_winograd23_data, bias_data, opt);
-    }    
+        const int kernel_tm_w = weight_sgemm_data.w;
+
+        if (use_bf16_storage)
+            conv_im2col_sgemm_sse(bottom_blob_bordered, top_blob, (const bfloat16*)weight_sgemm_data.data, kernel_tm_w, bias_data, kernel_w, kernel_h, stride_w, stride_h, pad_top, pad_left, opt);
+        else if (use_fp16_storage)
+            conv_im2col_sgemm_sse(bottom_blob_bordered, top_blob, (const unsigned short*)weight_sgemm_data.data, kernel_tm_w, bias_data, kernel_w, kernel_h, stride_w, stride_h, pad_top, pad_left, opt);
+        else
+            conv_im2col_sgemm_sse(bottom_blob_bordered, top_blob, (const float*)weight_sgemm_data.data, kernel_tm_w, bias_data, kernel_w, kernel_h, stride_w, stride_h, pad_top, pad_left, opt);
+    }
+    else if (impl == Impl_sparse)
+    {
+        conv1x1s1_sparse_sse(bottom_blob_bordered, top_blob, weight_sparse_data, weight_sparse_rowptr, weight_sparse_colidx, bias_data, opt);
+    }
     else
         conv(bottom_blob_bordered, top_blob, weight_data, bias_data, opt);
 
@@ -31,13 +31,45 @@ public:
 
     virtual int load_model(const ModelBin& mb);
 
+    virtual int get_impls(std::vector<int>& impls) const;
+    virtual int set_impl(int impl);
+
+    virtual int get_cost(const std::vector<Mat>& bottom_blobs, const std::vector<Mat>& top_blobs, LayerCost& cost) const;
+
     virtual int forward(const Mat& bottom_blob, Mat& top_blob, const Option& opt) const;
     virtual int forwardDilation(const Mat& bottom_blob, Mat &top_blob, conv_func conv, const Option& opt) const;
 
+    enum
+    {
+        Impl_heuristic = 0,
+        Impl_direct = 1,
+        Impl_winograd23 = 2,
+        Impl_winograd43 = 3,
+        Impl_sgemm = 4,// im2col + gemm, plain gemm for 1x1s1
+        Impl_sparse = 5// sparse 1x1s1 kernel for pruned weight
+    };
+
 public:
     Layer* activation;
     bool use_winograd3x3;
     Mat weight_3x3_winograd23_data;
+    Mat weight_3x3_winograd43_data;
+    Mat weight_sgemm_data;
+
+    // compressed sparse row weight of the sparse kernel
+    Mat weight_sparse_data;
+    Mat weight_sparse_rowptr;
+    Mat weight_sparse_colidx;
+
+    // forced kernel implementation
+    int impl;
+
+    // pruned weight may go to the sparse kernel, from Net::use_sparse_weight
+    bool use_sparse_weight;
+
+    // half-precision or bfloat16 weight_sgemm_data, weight_data is released
+    bool use_fp16_storage;
+    bool use_bf16_storage;
 };
 
 } // namespace ncnn
@@ -12,190 +12,218 @@
 // CONDITIONS OF ANY KIND, either express or implied. See the License for the
 // specific language governing permissions and limitations under the License.
 
-static void convdw3x3s1_sse(const Mat& bottom_blob, Mat& top_blob, const Mat& _kernel, const Mat& _bias, const Option& opt)
+class ConvolutionDepthWise3x3s1Task : public ParallelTask
 {
-    int w = bottom_blob.w;
-
-    int outw = top_blob.w;
-    int outh = top_blob.h;
-
-    const int group = bottom_blob.c;
+public:
+    ConvolutionDepthWise3x3s1Task(const Mat& _bottom_blob, Mat& _top_blob, const Mat& _kernel, const Mat& _bias) : bottom_blob(_bottom_blob), top_blob(_top_blob), kernel_data(_kernel), bias_data(_bias) {}
 
-    const float* kernel = _kernel;
-    const float* bias = _bias;
-
-    #pragma omp parallel for num_threads(opt.num_threads)
-    for (int g=0; g<group; g++)
+    virtual void execute(int begin, int end, int /*thread_id*/) const
     {
-        Mat out = top_blob.channel(g);
-
-        const float bias0 = bias ? bias[g] : 0.f;
+        int w = bottom_blob.w;
 
-        const float* kernel0 = kernel + g*9;
+        int outw = top_blob.w;
+        int outh = top_blob.h;
 
-        float* outptr = out;
-        float* outptr2 = outptr + outw;
+        const float* kernel = kernel_data;
+        const float* bias = bias_data;
 
-        const float* img0 = bottom_blob.channel(g);
+        for (int g=begin; g<end; g++)
+        {
+            Mat out = top_blob.channel(g);
 
-        const float* r0 = img0;
-        const float* r1 = img0 + w;
-        const float* r2 = img0 + w*2;
-        const float* r3 = img0 + w*3;
+            const float bias0 = bias ? bias[g] : 0.f;
 
-        const float* k0 = kernel0;
-        const float* k1 = kernel0 + 3;
-        const float* k2 = kernel0 + 6;
+            const float* kernel0 = kernel + g*9;
 
-        int i = 0;
+            float* outptr = out;
+            float* outptr2 = outptr + outw;
 
-        for (; i+1 < outh; i+=2)
-        {
+            const float* img0 = bottom_blob.channel(g);
 
-            int remain = outw;
+            const float* r0 = img0;
+            const float* r1 = img0 + w;
+            const float* r2 = img0 + w*2;
+            const float* r3 = img0 + w*3;
 
-            for (; remain>0; remain--)
-            {
-                float sum = bias0;
-                sum += r0[0] * k0[0];
-                sum += r0[1] * k0[1];
-                sum += r0[2] * k0[2];
-                sum += r1[0] * k1[0];
-                sum += r1[1] * k1[1];
-                sum += r1[2] * k1[2];
-                sum += r2[0] * k2[0];
-                sum += r2[1] * k2[1];
-                sum += r2[2] * k2[2];
-
-                float sum2 = bias0;
-                sum2 += r1[0] * k0[0];
-                sum2 += r1[1] * k0[1];
-                sum2 += r1[2] * k0[2];
-                sum2 += r2[0] * k1[0];
-                sum2 += r2[1] * k1[1];
-                sum2 += r2[2] * k1[2];
-                sum2 += r3[0] * k2[0];
-                sum2 += r3[1] * k2[1];
-                sum2 += r3[2] * k2[2];
-
-                *outptr = sum;
-                *outptr2 = sum2;
-
-                r0++;
-                r1++;
-                r2++;
-                r3++;
-                outptr++;
-                outptr2++;
-            }
+            const float* k0 = kernel0;
+            const float* k1 = kernel0 + 3;
+            const float* k2 = kernel0 + 6;
 
-            r0 += 2 + w;
-            r1 += 2 + w;
-            r2 += 2 + w;
-            r3 += 2 + w;
+            int i = 0;
 
-            outptr += outw;
-            outptr2 += outw;
-        }
+            for (; i+1 < outh; i+=2)
+            {
 
-        for (; i < outh; i++)
-        {
-            int remain = outw;
+                int remain = outw;
+
+                for (; remain>0; remain--)
+                {
+                    float sum = bias0;
+                    sum += r0[0] * k0[0];
+                    sum += r0[1] * k0[1];
+                    sum += r0[2] * k0[2];
+                    sum += r1[0] * k1[0];
+                    sum += r1[1] * k1[1];
+                    sum += r1[2] * k1[2];
+                    sum += r2[0] * k2[0];
+                    sum += r2[1] * k2[1];
+                    sum += r2[2] * k2[2];
+
+                    float sum2 = bias0;
+                    sum2 += r1[0] * k0[0];
+                    sum2 += r1[1] * k0[1];
+                    sum2 += r1[2] * k0[2];
+                    sum2 += r2[0] * k1[0];
+                    sum2 += r2[1] * k1[1];
+                    sum2 += r2[2] * k1[2];
+                    sum2 += r3[0] * k2[0];
+                    sum2 += r3[1] * k2[1];
+                    sum2 += r3[2] * k2[2];
+
+                    *outptr = sum;
+                    *outptr2 = sum2;
+
+                    r0++;
+                    r1++;
+                    r2++;
+                    r3++;
+                    outptr++;
+                    outptr2++;
+                }
+
+                r0 += 2 + w;
+                r1 += 2 + w;
+                r2 += 2 + w;
+                r3 += 2 + w;
+
+                outptr += outw;
+                outptr2 += outw;
+            }
 
-            for (; remain>0; remain--)
+            for (; i < outh; i++)
             {
-                float sum = bias0;
-                sum += r0[0] * k0[0];
-                sum += r0[1] * k0[1];
-                sum += r0[2] * k0[2];
-                sum += r1[0] * k1[0];
-                sum += r1[1] * k1[1];
-                sum += r1[2] * k1[2];
-                sum += r2[0] * k2[0];
-                sum += r2[1] * k2[1];
-                sum += r2[2] * k2[2];
-
-                *outptr = sum;
-
-                r0++;
-                r1++;
-                r2++;
-                outptr++;
-            }
+                int remain = outw;
+
+                for (; remain>0; remain--)
+                {
+                    float sum = bias0;
+                    sum += r0[0] * k0[0];
+                    sum += r0[1] * k0[1];
+                    sum += r0[2] * k0[2];
+                    sum += r1[0] * k1[0];
+                    sum += r1[1] * k1[1];
+                    sum += r1[2] * k1[2];
+                    sum += r2[0] * k2[0];
+                    sum += r2[1] * k2[1];
+                    sum += r2[2] * k2[2];
+
+                    *outptr = sum;
+
+                    r0++;
+                    r1++;
+                    r2++;
+                    outptr++;
+                }
 
-            r0 += 2;
-            r1 += 2;
-            r2 += 2;
+                r0 += 2;
+                r1 += 2;
+                r2 += 2;
+            }
         }
     }
-}
 
-static void convdw3x3s2_sse(const Mat& bottom_blob, Mat& top_blob, const Mat& _kernel, const Mat& _bias, const Option& opt)
+private:
+    const Mat& bottom_blob;
+    Mat& top_blob;
+    const Mat& kernel_data;
+    const Mat& bias_data;
+};
+
+static void convdw3x3s1_sse(const Mat& bottom_blob, Mat& top_blob, const Mat& _kernel, const Mat& _bias, const Option& opt)
 {
-    int w = bottom_blob.w;
+    parallel_for(bottom_blob.c, ConvolutionDepthWise3x3s1Task(bottom_blob, top_blob, _kernel, _bias), opt);
+}
 
-    int outw = top_blob.w;
-    int outh = top_blob.h;
+class ConvolutionDepthWise3x3s2Task : public ParallelTask
+{
+public:
+    ConvolutionDepthWise3x3s2Task(const Mat& _bottom_blob, Mat& _top_blob, const Mat& _kernel, const Mat& _bias) : bottom_blob(_bottom_blob), top_blob(_top_blob), kernel_data(_kernel), bias_data(_bias) {}
 
-    const int group = bottom_blob.c;
+    virtual void execute(int begin, int end, int /*thread_id*/) const
+    {
+        int w = bottom_blob.w;
 
-    const int tailstep = w - 2*outw + w;
+        int outw = top_blob.w;
+        int outh = top_blob.h;
 
-    const float* kernel = _kernel;
-    const float* bias = _bias;
+        const int tailstep = w - 2*outw + w;
 
-    #pragma omp parallel for num_threads(opt.num_threads)
-    for (int g=0; g<group; g++)
-    {
-        Mat out = top_blob.channel(g);
+        const float* kernel = kernel_data;
+        const float* bias = bias_data;
 
-        const float bias0 = bias ? bias[g] : 0.f;
+        for (int g=begin; g<end; g++)
+        {
+            Mat out = top_blob.channel(g);
 
-        const float* kernel0 = kernel + g*9;
+            const float bias0 = bias ? bias[g] : 0.f;
 
-        float* outptr = out;
+            const float* kernel0 = kernel + g*9;
 
-        const float* img0 = bottom_blob.channel(g);
+            float* outptr = out;
 
-        const float* r0 = img0;
-        const float* r1 = img0 + w;
-        const float* r2 = img0 + w*2;
+            const float* img0 = bottom_blob.channel(g);
 
-        const float* k0 = kernel0;
-        const float* k1 = kernel0 + 3;
-        const float* k2 = kernel0 + 6;
+            const float* r0 = img0;
+            const float* r1 = img0 + w;
+            const float* r2 = img0 + w*2;
 
-        int i = 0;
+            const float* k0 = kernel0;
+            const float* k1 = kernel0 + 3;
+            const float* k2 = kernel0 + 6;
 
-        for (; i < outh; i++)
-        {
-            int remain = outw;
+            int i = 0;
 
-            for (; remain>0; remain--)
+            for (; i < outh; i++)
             {
-                float sum = bias0;
-                sum += r0[0] * k0[0];
-                sum += r0[1] * k0[1];
-                sum += r0[2] * k0[2];
-                sum += r1[0] * k1[0];
-                sum += r1[1] * k1[1];
-                sum += r1[2] * k1[2];
-                sum += r2[0] * k2[0];
-                sum += r2[1] * k2[1];
-                sum += r2[2] * k2[2];
-
-                *outptr = sum;
-
-                r0 += 2;
-                r1 += 2;
-                r2 += 2;
-                outptr++;
+                int remain = outw;
+
+                for (; remain>0; remain--)
+                {
+                    float sum = bias0;
+                    sum += r0[0] * k0[0];
+                    sum += r0[1] * k0[1];
+                    sum += r0[2] * k0[2];
+                    sum += r1[0] * k1[0];
+                    sum += r1[1] * k1[1];
+                    sum += r1[2] * k1[2];
+                    sum += r2[0] * k2[0];
+                    sum += r2[1] * k2[1];
+                    sum += r2[2] * k2[2];
+
+                    *outptr = sum;
+
+                    r0 += 2;
+                    r1 += 2;
+                    r2 += 2;
+                    outptr++;
+                }
+
+                r0 += tailstep;
+                r1 += tailstep;
+                r2 += tailstep;
             }
 
-            r0 += tailstep;
-            r1 += tailstep;
-            r2 += tailstep;
         }
-
     }
+
+private:
+    const Mat& bottom_blob;
+    Mat& top_blob;
+    const Mat& kernel_data;
+    const Mat& bias_data;
+};
+
+static void convdw3x3s2_sse(const Mat& bottom_blob, Mat& top_blob, const Mat& _kernel, const Mat& _bias, const Option& opt)
+{
+    parallel_for(bottom_blob.c, ConvolutionDepthWise3x3s2Task(bottom_blob, top_blob, _kernel, _bias), opt);
 }
@@ -18,10 +18,20 @@
 #include <omp.h>
 #endif
 
+#if __SSE2__
+#include <emmintrin.h>
+#if __F16C__
+#include <immintrin.h>
+#endif // __F16C__
+#endif // __SSE2__
+
 #include "layer_type.h"
+#include "threadpool.h"
 
 namespace ncnn {
 
+#include "float16_sse.h"
+
 #include "convolutiondepthwise_3x3.h"
 
 #include "convolutiondepthwise_3x3_int8.h"
@@ -83,6 +93,9 @@ int ConvolutionDepthWise_x86::load_model(const ModelBin& mb)
     if (ret != 0)
         return ret;
 
+    // the quantize ops take float32 blobs
+    support_fp16_storage = !use_int8_inference;
+
     // create Convolution op for each group
     const int maxk = kernel_w * kernel_h;
     int channels = (weight_data_size / group) / maxk / (num_output / group) * group;
@@ -186,6 +199,19 @@ int ConvolutionDepthWise_x86::forward(const Mat& bottom_blob, Mat& top_blob, con
         return -100;
     }
 
+    if (elemsize == 2u)
+        return forward_fp16(bottom_blob, top_blob, opt);
+
+    // only depth-wise 3x3 s1 / s2 has a requantize kernel
+    if (use_int8_requantize)
+    {
+        bool dw3x3 = channels == group && group == num_output && kernel_w == 3 && kernel_h == 3 && dilation_w == 1 && dilation_h == 1;
+        bool s1s2 = (stride_w == 1 && stride_h == 1) || (stride_w == 2 && stride_h == 2);
+
+        if (!dw3x3 || !s1s2)
+            return ConvolutionDepthWise::forward(bottom_blob, top_blob, opt);
+    }
+
     const int kernel_extent_w = dilation_w * (kernel_w - 1) + 1;
     const int kernel_extent_h = dilation_h * (kernel_h - 1) + 1;
 
@@ -248,71 +274,26 @@ int ConvolutionDepthWise_x86::forward(const Mat& bottom_blob, Mat& top_blob, con
     {
         if (use_int8_requantize)
         {
-            Mat top_blob_tm;
-            top_blob_tm.create(outw, outh, num_output, (size_t)4u, opt.workspace_allocator);
-            if (top_blob_tm.empty())
-                return -100;
-            
             top_blob.create(outw, outh, num_output, (size_t)1u, opt.blob_allocator);
             if (top_blob.empty())
                 return -100;
 
-            // depth-wise
-            if (channels == group && group == num_output)
-            {                
-                if (kernel_w == 3 && kernel_h == 3 && dilation_w == 1 && dilation_h == 1)
-                {
-                    if ((stride_w == 1 && stride_h == 1) || (stride_w == 2 && stride_h == 2))
-                    {
-                        if (stride_w == 1 && stride_h == 1)
-                        {
-                            convdw3x3s1_int8_requant_sse(bottom_blob_bordered, top_blob, weight_data, bias_data, requantize_scales, opt);                          
-                        }
-                        else if (stride_w == 2 && stride_h == 2)
-                        {
-                            convdw3x3s2_int8_requant_sse(bottom_blob_bordered, top_blob, weight_data, bias_data, requantize_scales, opt);                           
-                        }
-
-                        return 0;
-                    }
-                }
-
-                #pragma omp parallel for num_threads(opt.num_threads)
-                for (int g=0; g<group; g++)
-                {
-                    const Mat bottom_blob_bordered_g = bottom_blob_bordered.channel_range(g, 1);
-                    Mat top_blob_tm_g = top_blob_tm.channel_range(g, 1);
-
-                    const ncnn::Layer* op = group_ops[g];
-
-                    ncnn::Option opt_g = opt;
-                    opt_g.num_threads = 1;
-                    opt_g.blob_allocator = top_blob.allocator;
-
-                    // forward
-                    op->forward(bottom_blob_bordered_g, top_blob_tm_g, opt_g);
-                }
-
-                return 0;
+            if (stride_w == 1 && stride_h == 1)
+            {
+                convdw3x3s1_int8_requant_sse(bottom_blob_bordered, top_blob, weight_data, bias_data, requantize_scales, opt);
             }
-
-            const int channels_g = channels / group;
-            const int num_output_g = num_output / group;
-
-            #pragma omp parallel for num_threads(opt.num_threads)
-            for (int g=0; g<group; g++)
+            else
             {
-                const Mat bottom_blob_bordered_g = bottom_blob_bordered.channel_range(channels_g * g, channels_g);
-                Mat top_blob_tm_g = top_blob_tm.channel_range(num_output_g * g, num_output_g);
-
-                const ncnn::Layer* op = group_ops[g];
+                convdw3x3s2_int8_requant_sse(bottom_blob_bordered, top_blob, weight_data, bias_data, requantize_scales, opt);
+            }
 
-                ncnn::Option opt_g = opt;
-                opt_g.blob_allocator = top_blob.allocator;
+            // fused relu on the requantized output
+            if (activation)
+            {
+                activation->forward_inplace(top_blob, opt);
+            }
 
-                // forward
-                op->forward(bottom_blob_bordered_g, top_blob_tm_g, opt_g);
-            }       
+            return 0;
         }
         else
         {
@@ -336,6 +317,12 @@ int ConvolutionDepthWise_x86::forward(const Mat& bottom_blob, Mat& top_blob, con
                             convdw3x3s2_int8_dequant_sse(bottom_blob_bordered, top_blob, weight_data, bias_data, dequantize_scales, opt);                          
                         }
 
+                        // fused activation on the dequantized output
+                        if (activation)
+                        {
+                            activation->forward_inplace(top_blob, opt);
+                        }
+
                         return 0;
                     }
                 }
@@ -355,7 +342,13 @@ int ConvolutionDepthWise_x86::forward(const Mat& bottom_blob, Mat& top_blob, con
                     // forward
                     op->forward(bottom_blob_bordered_g, top_blob_g, opt_g);
                 }
-              
+
+                // fused activation on the dequantized output
+                if (activation)
+                {
+                    activation->forward_inplace(top_blob, opt);
+                }
+
                 return 0;
             }
 
@@ -375,7 +368,13 @@ int ConvolutionDepthWise_x86::forward(const Mat& bottom_blob, Mat& top_blob, con
 
                 // forward
                 op->forward(bottom_blob_bordered_g, top_blob_g, opt_g);
-            }                      
+            }
+
+            // fused activation on the dequantized output
+            if (activation)
+            {
+                activation->forward_inplace(top_blob, opt);
+            }
         }
 
         return 0;
@@ -457,4 +456,147 @@ int ConvolutionDepthWise_x86::forward(const Mat& bottom_blob, Mat& top_blob, con
     return 0;
 }
 
+int ConvolutionDepthWise_x86::forward_fp16(const Mat& bottom_blob, Mat& top_blob, const Option& opt) const
+{
+    int w = bottom_blob.w;
+    int h = bottom_blob.h;
+    int channels = bottom_blob.c;
+
+    if (channels != group || group != num_output)
+    {
+        // grouped convolution is computed in float32 as a whole
+        Option opt_fp32 = opt;
+        opt_fp32.blob_allocator = opt.workspace_allocator;
+
+        Mat bottom_blob_fp32(w, h, channels, (size_t)4u, opt.workspace_allocator);
+        if (bottom_blob_fp32.empty())
+            return -100;
+
+        #pragma omp parallel for num_threads(opt.num_threads)
+        for (int q=0; q<channels; q++)
+        {
+            float16_to_float32_row(bottom_blob.channel(q), bottom_blob_fp32.channel(q), w * h);
+        }
+
+        Mat top_blob_fp32;
+        int ret = forward(bottom_blob_fp32, top_blob_fp32, opt_fp32);
+        if (ret != 0)
+            return ret;
+
+        int outw = top_blob_fp32.w;
+        int outh = top_blob_fp32.h;
+
+        top_blob.create(outw, outh, num_output, (size_t)2u, opt.blob_allocator);
+        if (top_blob.empty())
+            return -100;
+
+        #pragma omp parallel for num_threads(opt.num_threads)
+        for (int p=0; p<num_output; p++)
+        {
+            float32_to_float16_row(top_blob_fp32.channel(p), top_blob.channel(p), outw * outh);
+        }
+
+        return 0;
+    }
+
+    const int kernel_extent_w = dilation_w * (kernel_w - 1) + 1;
+    const int kernel_extent_h = dilation_h * (kernel_h - 1) + 1;
+
+    int pad_top = 0;
+    int pad_bottom = 0;
+    int pad_left = 0;
+    int pad_right = 0;
+    if (pad_w > 0 || pad_h > 0)
+    {
+        pad_top = pad_h;
+        pad_bottom = pad_h;
+        pad_left = pad_w;
+        pad_right = pad_w;
+    }
+    else if (pad_w == -233 && pad_h == -233)
+    {
+        int wpad = kernel_extent_w + (w - 1) / stride_w * stride_w - w;
+        int hpad = kernel_extent_h + (h - 1) / stride_h * stride_h - h;
+        if (wpad > 0 || hpad > 0)
+        {
+            pad_top = hpad / 2;
+            pad_bottom = hpad - hpad / 2;
+            pad_left = wpad / 2;
+            pad_right = wpad - wpad / 2;
+        }
+    }
+
+    const int wb = w + pad_left + pad_right;
+    const int hb = h + pad_top + pad_bottom;
+
+    int outw = (wb - kernel_extent_w) / stride_w + 1;
+    int outh = (hb - kernel_extent_h) / stride_h + 1;
+
+    top_blob.create(outw, outh, num_output, (size_t)2u, opt.blob_allocator);
+    if (top_blob.empty())
+        return -100;
+
+    const bool use_3x3 = kernel_w == 3 && kernel_h == 3 && dilation_w == 1 && dilation_h == 1 && ((stride_w == 1 && stride_h == 1) || (stride_w == 2 && stride_h == 2));
+
+    // every channel is widened to float32 with its border in cache, convolved and narrowed back
+    int ret = 0;
+    #pragma omp parallel for num_threads(opt.num_threads)
+    for (int g=0; g<group; g++)
+    {
+        ncnn::Option opt_g = opt;
+        opt_g.num_threads = 1;
+        opt_g.blob_allocator = opt.workspace_allocator;
+
+        Mat bottom_blob_bordered_g(wb, hb, 1, (size_t)4u, opt.workspace_allocator);
+        Mat top_blob_g(outw, outh, 1, (size_t)4u, opt.workspace_allocator);
+        if (bottom_blob_bordered_g.empty() || top_blob_g.empty())
+        {
+            ret = -100;
+            continue;
+        }
+
+        const unsigned short* ptr = bottom_blob.channel(g);
+        float* outptr = bottom_blob_bordered_g;
+
+        memset(outptr, 0, wb * pad_top * sizeof(float));
+        outptr += wb * pad_top;
+        for (int i=0; i<h; i++)
+        {
+            memset(outptr, 0, pad_left * sizeof(float));
+            float16_to_float32_row(ptr, outptr + pad_left, w);
+            memset(outptr + pad_left + w, 0, pad_right * sizeof(float));
+
+            ptr += w;
+            outptr += wb;
+        }
+        memset(outptr, 0, wb * pad_bottom * sizeof(float));
+
+        if (use_3x3)
+        {
+            const Mat weight_data_g = weight_data.range(9 * g, 9);
+            Mat bias_data_g;
+            if (bias_term)
+                bias_data_g = bias_data.range(g, 1);
+
+            if (stride_w == 1)
+                convdw3x3s1_sse(bottom_blob_bordered_g, top_blob_g, weight_data_g, bias_data_g, opt_g);
+            else
+                convdw3x3s2_sse(bottom_blob_bordered_g, top_blob_g, weight_data_g, bias_data_g, opt_g);
+        }
+        else
+        {
+            group_ops[g]->forward(bottom_blob_bordered_g, top_blob_g, opt_g);
+        }
+
+        if (activation)
+        {
+            activation->forward_inplace(top_blob_g, opt_g);
+        }
+
+        float32_to_float16_row(top_blob_g, top_blob.channel(g), outw * outh);
+    }
+
+    return ret;
+}
+
 } // namespace ncnn
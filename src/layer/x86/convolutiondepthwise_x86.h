@@ -31,6 +31,9 @@ public:
 
     virtual int forward(const Mat& bottom_blob, Mat& top_blob, const Option& opt) const;
 
+protected:
+    int forward_fp16(const Mat& bottom_blob, Mat& top_blob, const Option& opt) const;
+
 public:
     Layer* activation;
     std::vector<ncnn::Layer*> group_ops;
@@ -0,0 +1,257 @@
+// Tencent is pleased to support the open source community by making ncnn available.
+//
+// Copyright (C) 2019 THL A29 Limited, a Tencent company. All rights reserved.
+//
+// Licensed under the BSD 3-Clause License (the "License"); you may not use this file except
+// in compliance with the License. You may obtain a copy of the License at
+//
+// https://opensource.org/licenses/BSD-3-Clause
+//
+// Unless required by applicable law or agreed to in writing, software distributed
+// under the License is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR
+// CONDITIONS OF ANY KIND, either express or implied. See the License for the
+// specific language governing permissions and limitations under the License.
+
+#if __SSE2__
+#include <emmintrin.h>
+#endif // __SSE2__
+
+static void deconv_activation_sse(float* ptr, int size, int activation_type, const Mat& activation_params)
+{
+    if (activation_type == 1)
+    {
+        for (int i = 0; i < size; i++)
+        {
+            ptr[i] = std::max(ptr[i], 0.f);
+        }
+    }
+    else if (activation_type == 2)
+    {
+        float slope = activation_params[0];
+
+        for (int i = 0; i < size; i++)
+        {
+            ptr[i] = ptr[i] > 0.f ? ptr[i] : ptr[i] * slope;
+        }
+    }
+    else if (activation_type == 3)
+    {
+        float min = activation_params[0];
+        float max = activation_params[1];
+
+        for (int i = 0; i < size; i++)
+        {
+            ptr[i] = std::min(std::max(ptr[i], min), max);
+        }
+    }
+}
+
+static void deconv_sgemm_transform_kernel_sse(const Mat& _kernel, Mat& kernel_tm, int inch, int outch, int maxk)
+{
+    // src = maxk-inch-outch
+    // dst = 4k-inch-maxk/4-outch, trailing taps padded with zero
+    const int maxk4 = (maxk + 3) / 4 * 4;
+
+    kernel_tm.create(maxk4 * inch, outch);
+
+    for (int p=0; p<outch; p++)
+    {
+        const float* kernel = (const float*)_kernel + maxk * inch * p;
+        float* ktmp = kernel_tm.row(p);
+
+        for (int k=0; k<maxk4; k+=4)
+        {
+            for (int q=0; q<inch; q++)
+            {
+                for (int i=0; i<4; i++)
+                {
+                    ktmp[i] = k + i < maxk ? kernel[maxk * q + k + i] : 0.f;
+                }
+
+                ktmp += 4;
+            }
+        }
+    }
+}
+
+// deconvolution as gemm + col2im
+// col = kernel_tm(maxk x inch) * bottom(inch x w*h) per output channel,
+// then every col row is scattered into the output at its kernel tap offset
+static void deconv_sgemm_sse(const Mat& bottom_blob, Mat& top_blob, const Mat& kernel_tm, const Mat& _bias, int kernel_w, int kernel_h, int dilation_w, int dilation_h, int stride_w, int stride_h, int activation_type, const Mat& activation_params, const Option& opt)
+{
+    int w = bottom_blob.w;
+    int h = bottom_blob.h;
+    int inch = bottom_blob.c;
+
+    int outw = top_blob.w;
+    int outh = top_blob.h;
+    int outch = top_blob.c;
+
+    const int size = w * h;
+    const int maxk = kernel_w * kernel_h;
+    const int maxk4 = (maxk + 3) / 4 * 4;
+
+    const float* bias = _bias;
+
+    const float* bottom_ptr = bottom_blob;
+    const size_t bottom_cstep = bottom_blob.cstep;
+
+    #pragma omp parallel for num_threads(opt.num_threads)
+    for (int p=0; p<outch; p++)
+    {
+        Mat col(size, maxk4, 4u, opt.workspace_allocator);
+
+        const float* kptr = kernel_tm.row(p);
+
+        for (int k=0; k<maxk4; k+=4)
+        {
+            float* col0 = col.row(k);
+            float* col1 = col.row(k+1);
+            float* col2 = col.row(k+2);
+            float* col3 = col.row(k+3);
+
+            const float* ktmp0 = kptr + k * inch;
+
+            int j = 0;
+#if __SSE2__
+            for (; j+7<size; j+=8)
+            {
+                __m128 _sum00 = _mm_setzero_ps();
+                __m128 _sum01 = _mm_setzero_ps();
+                __m128 _sum10 = _mm_setzero_ps();
+                __m128 _sum11 = _mm_setzero_ps();
+                __m128 _sum20 = _mm_setzero_ps();
+                __m128 _sum21 = _mm_setzero_ps();
+                __m128 _sum30 = _mm_setzero_ps();
+                __m128 _sum31 = _mm_setzero_ps();
+
+                const float* ktmp = ktmp0;
+                const float* r0 = bottom_ptr + j;
+
+                for (int q=0; q<inch; q++)
+                {
+                    __m128 _r00 = _mm_loadu_ps(r0);
+                    __m128 _r01 = _mm_loadu_ps(r0 + 4);
+
+                    __m128 _k0 = _mm_set1_ps(ktmp[0]);
+                    __m128 _k1 = _mm_set1_ps(ktmp[1]);
+                    __m128 _k2 = _mm_set1_ps(ktmp[2]);
+                    __m128 _k3 = _mm_set1_ps(ktmp[3]);
+
+                    _sum00 = _mm_add_ps(_sum00, _mm_mul_ps(_k0, _r00));
+                    _sum01 = _mm_add_ps(_sum01, _mm_mul_ps(_k0, _r01));
+                    _sum10 = _mm_add_ps(_sum10, _mm_mul_ps(_k1, _r00));
+                    _sum11 = _mm_add_ps(_sum11, _mm_mul_ps(_k1, _r01));
+                    _sum20 = _mm_add_ps(_sum20, _mm_mul_ps(_k2, _r00));
+                    _sum21 = _mm_add_ps(_sum21, _mm_mul_ps(_k2, _r01));
+                    _sum30 = _mm_add_ps(_sum30, _mm_mul_ps(_k3, _r00));
+                    _sum31 = _mm_add_ps(_sum31, _mm_mul_ps(_k3, _r01));
+
+                    ktmp += 4;
+                    r0 += bottom_cstep;
+                }
+
+                _mm_storeu_ps(col0 + j, _sum00);
+                _mm_storeu_ps(col0 + j + 4, _sum01);
+                _mm_storeu_ps(col1 + j, _sum10);
+                _mm_storeu_ps(col1 + j + 4, _sum11);
+                _mm_storeu_ps(col2 + j, _sum20);
+                _mm_storeu_ps(col2 + j + 4, _sum21);
+                _mm_storeu_ps(col3 + j, _sum30);
+                _mm_storeu_ps(col3 + j + 4, _sum31);
+            }
+            for (; j+3<size; j+=4)
+            {
+                __m128 _sum0 = _mm_setzero_ps();
+                __m128 _sum1 = _mm_setzero_ps();
+                __m128 _sum2 = _mm_setzero_ps();
+                __m128 _sum3 = _mm_setzero_ps();
+
+                const float* ktmp = ktmp0;
+                const float* r0 = bottom_ptr + j;
+
+                for (int q=0; q<inch; q++)
+                {
+                    __m128 _r0 = _mm_loadu_ps(r0);
+
+                    _sum0 = _mm_add_ps(_sum0, _mm_mul_ps(_mm_set1_ps(ktmp[0]), _r0));
+                    _sum1 = _mm_add_ps(_sum1, _mm_mul_ps(_mm_set1_ps(ktmp[1]), _r0));
+                    _sum2 = _mm_add_ps(_sum2, _mm_mul_ps(_mm_set1_ps(ktmp[2]), _r0));
+                    _sum3 = _mm_add_ps(_sum3, _mm_mul_ps(_mm_set1_ps(ktmp[3]), _r0));
+
+                    ktmp += 4;
+                    r0 += bottom_cstep;
+                }
+
+                _mm_storeu_ps(col0 + j, _sum0);
+                _mm_storeu_ps(col1 + j, _sum1);
+                _mm_storeu_ps(col2 + j, _sum2);
+                _mm_storeu_ps(col3 + j, _sum3);
+            }
+#endif // __SSE2__
+            for (; j<size; j++)
+            {
+                float sum0 = 0.f;
+                float sum1 = 0.f;
+                float sum2 = 0.f;
+                float sum3 = 0.f;
+
+                const float* ktmp = ktmp0;
+                const float* r0 = bottom_ptr + j;
+
+                for (int q=0; q<inch; q++)
+                {
+                    sum0 += ktmp[0] * r0[0];
+                    sum1 += ktmp[1] * r0[0];
+                    sum2 += ktmp[2] * r0[0];
+                    sum3 += ktmp[3] * r0[0];
+
+                    ktmp += 4;
+                    r0 += bottom_cstep;
+                }
+
+                col0[j] = sum0;
+                col1[j] = sum1;
+                col2[j] = sum2;
+                col3[j] = sum3;
+            }
+        }
+
+        // col2im
+        Mat out = top_blob.channel(p);
+
+        out.fill(bias ? bias[p] : 0.f);
+
+        for (int k=0; k<maxk; k++)
+        {
+            const int ky = k / kernel_w;
+            const int kx = k % kernel_w;
+
+            const float* cptr = col.row(k);
+
+            for (int i=0; i<h; i++)
+            {
+                float* outptr = out.row(i * stride_h + ky * dilation_h) + kx * dilation_w;
+
+                if (stride_w == 1)
+                {
+                    for (int j=0; j<w; j++)
+                    {
+                        outptr[j] += cptr[j];
+                    }
+                }
+                else
+                {
+                    for (int j=0; j<w; j++)
+                    {
+                        outptr[j * stride_w] += cptr[j];
+                    }
+                }
+
+                cptr += w;
+            }
+        }
+
+        deconv_activation_sse(out, outw * outh, activation_type, activation_params);
+    }
+}
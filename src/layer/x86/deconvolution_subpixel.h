@@ -0,0 +1,120 @@
+// Tencent is pleased to support the open source community by making ncnn available.
+//
+// Copyright (C) 2019 THL A29 Limited, a Tencent company. All rights reserved.
+//
+// Licensed under the BSD 3-Clause License (the "License"); you may not use this file except
+// in compliance with the License. You may obtain a copy of the License at
+//
+// https://opensource.org/licenses/BSD-3-Clause
+//
+// Unless required by applicable law or agreed to in writing, software distributed
+// under the License is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR
+// CONDITIONS OF ANY KIND, either express or implied. See the License for the
+// specific language governing permissions and limitations under the License.
+
+#if __SSE2__
+#include <emmintrin.h>
+#endif // __SSE2__
+
+// strided deconvolution split into stride_h x stride_w small convolutions
+// phase (ry, rx) produces out(Y * stride_h + ry, X * stride_w + rx) from the taps
+// ky = ry + ty * stride_h, kx = rx + tx * stride_w reading in(Y - ty, X - tx)
+// every output pixel is written exactly once, no scatter accumulation
+static void deconv_subpixel_sse(const Mat& bottom_blob, Mat& top_blob, const Mat& _kernel, const Mat& _bias, int kernel_w, int kernel_h, int stride_w, int stride_h, int activation_type, const Mat& activation_params, const Option& opt)
+{
+    int w = bottom_blob.w;
+    int h = bottom_blob.h;
+    int inch = bottom_blob.c;
+
+    int outw = top_blob.w;
+    int outh = top_blob.h;
+    int outch = top_blob.c;
+
+    const int maxk = kernel_w * kernel_h;
+
+    const float* kernel = _kernel;
+    const float* bias = _bias;
+
+    // phase 0 is the largest one
+    const int phase_w = (outw + stride_w - 1) / stride_w;
+    const int phase_h = (outh + stride_h - 1) / stride_h;
+
+    #pragma omp parallel for num_threads(opt.num_threads)
+    for (int p=0; p<outch; p++)
+    {
+        Mat phase(phase_w * phase_h, 4u, opt.workspace_allocator);
+
+        Mat out = top_blob.channel(p);
+
+        const float bias0 = bias ? bias[p] : 0.f;
+
+        for (int ry=0; ry<stride_h; ry++)
+        {
+            for (int rx=0; rx<stride_w; rx++)
+            {
+                const int pw = (outw - rx + stride_w - 1) / stride_w;
+                const int ph = (outh - ry + stride_h - 1) / stride_h;
+
+                float* sum = phase;
+
+                for (int i=0; i<pw*ph; i++)
+                {
+                    sum[i] = bias0;
+                }
+
+                for (int q=0; q<inch; q++)
+                {
+                    const float* img0 = bottom_blob.channel(q);
+                    const float* kptr = kernel + maxk * (inch * p + q);
+
+                    for (int ky = ry, ty = 0; ky < kernel_h; ky += stride_h, ty++)
+                    {
+                        for (int kx = rx, tx = 0; kx < kernel_w; kx += stride_w, tx++)
+                        {
+                            const float k0 = kptr[ky * kernel_w + kx];
+
+                            // in(Y - ty, X - tx) is valid for Y in [ty, ty + h) and X in [tx, tx + w)
+                            const int y1 = std::min(ph, ty + h);
+                            const int x1 = std::min(pw, tx + w);
+
+                            for (int Y = ty; Y < y1; Y++)
+                            {
+                                float* sptr = sum + Y * pw;
+                                const float* r0 = img0 + (Y - ty) * w - tx;
+
+                                int X = tx;
+#if __SSE2__
+                                __m128 _k0 = _mm_set1_ps(k0);
+                                for (; X+3<x1; X+=4)
+                                {
+                                    __m128 _s = _mm_loadu_ps(sptr + X);
+                                    __m128 _r = _mm_loadu_ps(r0 + X);
+                                    _mm_storeu_ps(sptr + X, _mm_add_ps(_s, _mm_mul_ps(_r, _k0)));
+                                }
+#endif // __SSE2__
+                                for (; X<x1; X++)
+                                {
+                                    sptr[X] += r0[X] * k0;
+                                }
+                            }
+                        }
+                    }
+                }
+
+                // interleave phase into output
+                for (int Y=0; Y<ph; Y++)
+                {
+                    float* outptr = out.row(Y * stride_h + ry) + rx;
+                    const float* sptr = sum + Y * pw;
+
+                    for (int X=0; X<pw; X++)
+                    {
+                        outptr[X * stride_w] = sptr[X];
+                    }
+                }
+            }
+        }
+
+        deconv_activation_sse(out, outw * outh, activation_type, activation_params);
+    }
+}
@@ -0,0 +1,106 @@
+// Tencent is pleased to support the open source community by making ncnn available.
+//
+// Copyright (C) 2019 THL A29 Limited, a Tencent company. All rights reserved.
+//
+// Licensed under the BSD 3-Clause License (the "License"); you may not use this file except
+// in compliance with the License. You may obtain a copy of the License at
+//
+// https://opensource.org/licenses/BSD-3-Clause
+//
+// Unless required by applicable law or agreed to in writing, software distributed
+// under the License is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR
+// CONDITIONS OF ANY KIND, either express or implied. See the License for the
+// specific language governing permissions and limitations under the License.
+
+#include "deconvolution_x86.h"
+
+#include <algorithm>
+
+namespace ncnn {
+
+#include "deconvolution_sgemm.h"
+#include "deconvolution_subpixel.h"
+
+DEFINE_LAYER_CREATOR(Deconvolution_x86)
+
+int Deconvolution_x86::load_model(const ModelBin& mb)
+{
+    int ret = Deconvolution::load_model(mb);
+    if (ret != 0)
+        return ret;
+
+    use_subpixel = dilation_w == 1 && dilation_h == 1 && (stride_w > 1 || stride_h > 1);
+
+    if (!use_subpixel)
+    {
+        const int maxk = kernel_w * kernel_h;
+        int num_input = weight_data_size / maxk / num_output;
+
+        deconv_sgemm_transform_kernel_sse(weight_data, weight_sgemm_data, num_input, num_output, maxk);
+    }
+
+    return 0;
+}
+
+int Deconvolution_x86::forward(const Mat& bottom_blob, Mat& top_blob, const Option& opt) const
+{
+    // deconvolv with NxN kernel
+    // value = value + bias
+
+    if (bottom_blob.dims != 3 || bottom_blob.elemsize != 4)
+    {
+        return Deconvolution::forward(bottom_blob, top_blob, opt);
+    }
+
+    int w = bottom_blob.w;
+    int h = bottom_blob.h;
+    size_t elemsize = bottom_blob.elemsize;
+
+    const int kernel_extent_w = dilation_w * (kernel_w - 1) + 1;
+    const int kernel_extent_h = dilation_h * (kernel_h - 1) + 1;
+
+    int outw = (w - 1) * stride_w + kernel_extent_w;
+    int outh = (h - 1) * stride_h + kernel_extent_h;
+
+    Mat top_blob_bordered;
+    if (pad_w > 0 || pad_h > 0)
+    {
+        top_blob_bordered.create(outw, outh, num_output, elemsize, opt.workspace_allocator);
+        if (top_blob_bordered.empty())
+            return -100;
+    }
+    else
+    {
+        top_blob_bordered = top_blob;
+        top_blob_bordered.create(outw, outh, num_output, elemsize, opt.blob_allocator);
+        if (top_blob_bordered.empty())
+            return -100;
+    }
+
+    if (use_subpixel)
+    {
+        deconv_subpixel_sse(bottom_blob, top_blob_bordered, weight_data, bias_data, kernel_w, kernel_h, stride_w, stride_h, activation_type, activation_params, opt);
+    }
+    else
+    {
+        deconv_sgemm_sse(bottom_blob, top_blob_bordered, weight_sgemm_data, bias_data, kernel_w, kernel_h, dilation_w, dilation_h, stride_w, stride_h, activation_type, activation_params, opt);
+    }
+
+    if (pad_w > 0 || pad_h > 0)
+    {
+        copy_cut_border(top_blob_bordered, top_blob, pad_h, pad_h, pad_w, pad_w, opt.blob_allocator, opt.num_threads);
+        if (top_blob.empty())
+            return -100;
+
+        outw = top_blob.w;
+        outh = top_blob.h;
+    }
+    else
+    {
+        top_blob = top_blob_bordered;
+    }
+
+    return 0;
+}
+
+} // namespace ncnn
@@ -0,0 +1,140 @@
+// Tencent is pleased to support the open source community by making ncnn available.
+//
+// Copyright (C) 2019 THL A29 Limited, a Tencent company. All rights reserved.
+//
+// Licensed under the BSD 3-Clause License (the "License"); you may not use this file except
+// in compliance with the License. You may obtain a copy of the License at
+//
+// https://opensource.org/licenses/BSD-3-Clause
+//
+// Unless required by applicable law or agreed to in writing, software distributed
+// under the License is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR
+// CONDITIONS OF ANY KIND, either express or implied. See the License for the
+// specific language governing permissions and limitations under the License.
+
+#include "deconvolutiondepthwise_x86.h"
+
+#include <algorithm>
+
+namespace ncnn {
+
+#include "deconvolution_sgemm.h"
+#include "deconvolution_subpixel.h"
+
+DEFINE_LAYER_CREATOR(DeconvolutionDepthWise_x86)
+
+int DeconvolutionDepthWise_x86::load_model(const ModelBin& mb)
+{
+    int ret = DeconvolutionDepthWise::load_model(mb);
+    if (ret != 0)
+        return ret;
+
+    use_subpixel = dilation_w == 1 && dilation_h == 1 && (stride_w > 1 || stride_h > 1);
+
+    if (!use_subpixel)
+    {
+        // weight layout per group is maxk-inch_g-outch_g, which chains into maxk-inch_g-outch
+        const int maxk = kernel_w * kernel_h;
+        int channels_g = weight_data_size / maxk / num_output;
+
+        deconv_sgemm_transform_kernel_sse(weight_data, weight_sgemm_data, channels_g, num_output, maxk);
+    }
+
+    return 0;
+}
+
+int DeconvolutionDepthWise_x86::forward(const Mat& bottom_blob, Mat& top_blob, const Option& opt) const
+{
+    // deconvolv with NxN kernel
+    // value = value + bias
+
+    if (bottom_blob.dims != 3 || bottom_blob.elemsize != 4)
+    {
+        return DeconvolutionDepthWise::forward(bottom_blob, top_blob, opt);
+    }
+
+    int w = bottom_blob.w;
+    int h = bottom_blob.h;
+    int channels = bottom_blob.c;
+    size_t elemsize = bottom_blob.elemsize;
+
+    if (channels % group != 0 || num_output % group != 0)
+    {
+        // reject invalid group
+        return -100;
+    }
+
+    const int kernel_extent_w = dilation_w * (kernel_w - 1) + 1;
+    const int kernel_extent_h = dilation_h * (kernel_h - 1) + 1;
+
+    int outw = (w - 1) * stride_w + kernel_extent_w;
+    int outh = (h - 1) * stride_h + kernel_extent_h;
+
+    Mat top_blob_bordered;
+    if (pad_w > 0 || pad_h > 0)
+    {
+        top_blob_bordered.create(outw, outh, num_output, elemsize, opt.workspace_allocator);
+        if (top_blob_bordered.empty())
+            return -100;
+    }
+    else
+    {
+        top_blob_bordered = top_blob;
+        top_blob_bordered.create(outw, outh, num_output, elemsize, opt.blob_allocator);
+        if (top_blob_bordered.empty())
+            return -100;
+    }
+
+    const int maxk = kernel_w * kernel_h;
+    const int channels_g = channels / group;
+    const int num_output_g = num_output / group;
+
+    // depth-wise runs one group per thread, grouped runs the groups one after another
+    const bool depthwise = channels == group && group == num_output;
+
+    ncnn::Option opt_g = opt;
+    if (depthwise)
+        opt_g.num_threads = 1;
+
+    #pragma omp parallel for num_threads(opt.num_threads) if(depthwise)
+    for (int g=0; g<group; g++)
+    {
+        const Mat bottom_blob_g = bottom_blob.channel_range(channels_g * g, channels_g);
+        Mat top_blob_bordered_g = top_blob_bordered.channel_range(num_output_g * g, num_output_g);
+
+        Mat bias_data_g;
+        if (bias_term)
+            bias_data_g = bias_data.range(num_output_g * g, num_output_g);
+
+        if (use_subpixel)
+        {
+            const Mat weight_data_g = weight_data.range(maxk * channels_g * num_output_g * g, maxk * channels_g * num_output_g);
+
+            deconv_subpixel_sse(bottom_blob_g, top_blob_bordered_g, weight_data_g, bias_data_g, kernel_w, kernel_h, stride_w, stride_h, activation_type, activation_params, opt_g);
+        }
+        else
+        {
+            const Mat weight_sgemm_data_g = weight_sgemm_data.row_range(num_output_g * g, num_output_g);
+
+            deconv_sgemm_sse(bottom_blob_g, top_blob_bordered_g, weight_sgemm_data_g, bias_data_g, kernel_w, kernel_h, dilation_w, dilation_h, stride_w, stride_h, activation_type, activation_params, opt_g);
+        }
+    }
+
+    if (pad_w > 0 || pad_h > 0)
+    {
+        copy_cut_border(top_blob_bordered, top_blob, pad_h, pad_h, pad_w, pad_w, opt.blob_allocator, opt.num_threads);
+        if (top_blob.empty())
+            return -100;
+
+        outw = top_blob.w;
+        outh = top_blob.h;
+    }
+    else
+    {
+        top_blob = top_blob_bordered;
+    }
+
+    return 0;
+}
+
+} // namespace ncnn
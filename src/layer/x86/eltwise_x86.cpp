@@ -0,0 +1,291 @@
+// Tencent is pleased to support the open source community by making ncnn available.
+//
+// Copyright (C) 2019 THL A29 Limited, a Tencent company. All rights reserved.
+//
+// Licensed under the BSD 3-Clause License (the "License"); you may not use this file except
+// in compliance with the License. You may obtain a copy of the License at
+//
+// https://opensource.org/licenses/BSD-3-Clause
+//
+// Unless required by applicable law or agreed to in writing, software distributed
+// under the License is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR
+// CONDITIONS OF ANY KIND, either express or implied. See the License for the
+// specific language governing permissions and limitations under the License.
+
+#include "eltwise_x86.h"
+#include <float.h>
+#include <math.h>
+#include <algorithm>
+
+#if __SSE2__
+#include <emmintrin.h>
+#if __F16C__
+#include <immintrin.h>
+#endif // __F16C__
+#endif // __SSE2__
+
+namespace ncnn {
+
+#include "float16_sse.h"
+#include "quantize_sse.h"
+
+DEFINE_LAYER_CREATOR(Eltwise_x86)
+
+static void eltwise_scale(float* sum, float coeff, int size)
+{
+    for (int i=0; i<size; i++)
+    {
+        sum[i] *= coeff;
+    }
+}
+
+static void eltwise_prod_fp16(float* sum, const unsigned short* ptr, int size)
+{
+    int i = 0;
+#if __SSE2__
+    for (; i+3<size; i+=4)
+    {
+        _mm_storeu_ps(sum + i, _mm_mul_ps(_mm_loadu_ps(sum + i), float16_to_float32_sse(ptr + i)));
+    }
+#endif // __SSE2__
+    for (; i<size; i++)
+    {
+        sum[i] *= float16_to_float32(ptr[i]);
+    }
+}
+
+static void eltwise_sum_fp16(float* sum, const unsigned short* ptr, float coeff, int size)
+{
+    int i = 0;
+#if __SSE2__
+    __m128 _coeff = _mm_set1_ps(coeff);
+    for (; i+3<size; i+=4)
+    {
+        _mm_storeu_ps(sum + i, _mm_add_ps(_mm_loadu_ps(sum + i), _mm_mul_ps(float16_to_float32_sse(ptr + i), _coeff)));
+    }
+#endif // __SSE2__
+    for (; i<size; i++)
+    {
+        sum[i] += float16_to_float32(ptr[i]) * coeff;
+    }
+}
+
+static void eltwise_max_fp16(float* sum, const unsigned short* ptr, int size)
+{
+    int i = 0;
+#if __SSE2__
+    for (; i+3<size; i+=4)
+    {
+        _mm_storeu_ps(sum + i, _mm_max_ps(_mm_loadu_ps(sum + i), float16_to_float32_sse(ptr + i)));
+    }
+#endif // __SSE2__
+    for (; i<size; i++)
+    {
+        sum[i] = std::max(sum[i], float16_to_float32(ptr[i]));
+    }
+}
+
+static void eltwise_sum_int8(float* sum, const signed char* ptr, float coeff, int size)
+{
+    int i = 0;
+#if __SSE2__
+    __m128 _coeff = _mm_set1_ps(coeff);
+    for (; i+15<size; i+=16)
+    {
+        // sign extend 16 int8 to int32
+        __m128i _p = _mm_loadu_si128((const __m128i*)(ptr + i));
+        __m128i _pl = _mm_srai_epi16(_mm_unpacklo_epi8(_p, _p), 8);
+        __m128i _ph = _mm_srai_epi16(_mm_unpackhi_epi8(_p, _p), 8);
+        __m128 _p0 = _mm_cvtepi32_ps(_mm_srai_epi32(_mm_unpacklo_epi16(_pl, _pl), 16));
+        __m128 _p1 = _mm_cvtepi32_ps(_mm_srai_epi32(_mm_unpackhi_epi16(_pl, _pl), 16));
+        __m128 _p2 = _mm_cvtepi32_ps(_mm_srai_epi32(_mm_unpacklo_epi16(_ph, _ph), 16));
+        __m128 _p3 = _mm_cvtepi32_ps(_mm_srai_epi32(_mm_unpackhi_epi16(_ph, _ph), 16));
+
+        _mm_storeu_ps(sum + i, _mm_add_ps(_mm_loadu_ps(sum + i), _mm_mul_ps(_p0, _coeff)));
+        _mm_storeu_ps(sum + i + 4, _mm_add_ps(_mm_loadu_ps(sum + i + 4), _mm_mul_ps(_p1, _coeff)));
+        _mm_storeu_ps(sum + i + 8, _mm_add_ps(_mm_loadu_ps(sum + i + 8), _mm_mul_ps(_p2, _coeff)));
+        _mm_storeu_ps(sum + i + 12, _mm_add_ps(_mm_loadu_ps(sum + i + 12), _mm_mul_ps(_p3, _coeff)));
+    }
+#endif // __SSE2__
+    for (; i<size; i++)
+    {
+        sum[i] += ptr[i] * coeff;
+    }
+}
+
+static void eltwise_sum_float32(float* sum, const float* ptr, float coeff, int size)
+{
+    int i = 0;
+#if __SSE2__
+    __m128 _coeff = _mm_set1_ps(coeff);
+    for (; i+3<size; i+=4)
+    {
+        _mm_storeu_ps(sum + i, _mm_add_ps(_mm_loadu_ps(sum + i), _mm_mul_ps(_mm_loadu_ps(ptr + i), _coeff)));
+    }
+#endif // __SSE2__
+    for (; i<size; i++)
+    {
+        sum[i] += ptr[i] * coeff;
+    }
+}
+
+Eltwise_x86::Eltwise_x86()
+{
+    support_fp16_storage = true;
+}
+
+int Eltwise_x86::forward(const std::vector<Mat>& bottom_blobs, std::vector<Mat>& top_blobs, const Option& opt) const
+{
+    int fp16_count = 0;
+    for (size_t b=0; b<bottom_blobs.size(); b++)
+    {
+        if (bottom_blobs[b].elemsize == 2u)
+            fp16_count++;
+    }
+
+    if (fp16_count == 0)
+        return Eltwise::forward(bottom_blobs, top_blobs, opt);
+
+    if (fp16_count == (int)bottom_blobs.size())
+        return forward_fp16(bottom_blobs, top_blobs, opt);
+
+    // fp16 mixed with int8 or float32 bottoms, sum in float32
+    std::vector<Mat> bottom_blobs_fp32 = bottom_blobs;
+    for (size_t b=0; b<bottom_blobs.size(); b++)
+    {
+        if (bottom_blobs[b].elemsize != 2u)
+            continue;
+
+        cast_float16_to_float32(bottom_blobs[b], bottom_blobs_fp32[b], opt.workspace_allocator, opt.num_threads);
+        if (bottom_blobs_fp32[b].empty())
+            return -100;
+    }
+
+    return Eltwise::forward(bottom_blobs_fp32, top_blobs, opt);
+}
+
+int Eltwise_x86::forward_int8(const std::vector<Mat>& bottom_blobs, std::vector<Mat>& top_blobs, const Option& opt) const
+{
+    const Mat& bottom_blob = bottom_blobs[0];
+    int w = bottom_blob.w;
+    int h = bottom_blob.h;
+    int channels = bottom_blob.c;
+    int size = w * h;
+
+    const int bottom_count = (int)bottom_blobs.size();
+
+    std::vector<float> bottom_coeffs(bottom_count);
+    for (int b=0; b<bottom_count; b++)
+    {
+        float coeff = coeffs.w == 0 ? 1.f : coeffs[b];
+        float scale = b < bottom_blob_int8_scales.w ? bottom_blob_int8_scales[b] : 0.f;
+
+        if (bottom_blobs[b].elemsize == 1u)
+            bottom_coeffs[b] = scale == 0.f ? 0.f : coeff / scale;
+        else
+            bottom_coeffs[b] = coeff;
+    }
+
+    Mat& top_blob = top_blobs[0];
+    top_blob.create(w, h, channels, top_blob_int8_scale != 0.f ? (size_t)1u : (size_t)4u, opt.blob_allocator);
+    if (top_blob.empty())
+        return -100;
+
+    // dequantize and reduce tile by tile in float32, the top is stored once
+    const int tile = 256;
+
+    #pragma omp parallel for num_threads(opt.num_threads)
+    for (int q=0; q<channels; q++)
+    {
+        float sum[tile];
+
+        for (int j=0; j<size; j+=tile)
+        {
+            const int n = std::min(tile, size - j);
+
+            memset(sum, 0, n * sizeof(float));
+
+            for (int b=0; b<bottom_count; b++)
+            {
+                const Mat m = bottom_blobs[b].channel(q);
+
+                if (m.elemsize == 1u)
+                    eltwise_sum_int8(sum, (const signed char*)m.data + j, bottom_coeffs[b], n);
+                else
+                    eltwise_sum_float32(sum, (const float*)m.data + j, bottom_coeffs[b], n);
+            }
+
+            if (top_blob_int8_scale != 0.f)
+            {
+                signed char* outptr = top_blob.channel(q);
+                quantize_row_sse(sum, outptr + j, top_blob_int8_scale, 0, n);
+            }
+            else
+            {
+                float* outptr = top_blob.channel(q);
+                memcpy(outptr + j, sum, n * sizeof(float));
+            }
+        }
+    }
+
+    return 0;
+}
+
+int Eltwise_x86::forward_fp16(const std::vector<Mat>& bottom_blobs, std::vector<Mat>& top_blobs, const Option& opt) const
+{
+    const Mat& bottom_blob = bottom_blobs[0];
+    int w = bottom_blob.w;
+    int h = bottom_blob.h;
+    int channels = bottom_blob.c;
+    size_t elemsize = bottom_blob.elemsize;
+    int size = w * h;
+
+    Mat& top_blob = top_blobs[0];
+    top_blob.create(w, h, channels, elemsize, opt.blob_allocator);
+    if (top_blob.empty())
+        return -100;
+
+    const int bottom_count = (int)bottom_blobs.size();
+
+    // reduce tile by tile in float32, every blob is read and the top is stored once
+    const int tile = 256;
+
+    #pragma omp parallel for num_threads(opt.num_threads)
+    for (int q=0; q<channels; q++)
+    {
+        float sum[tile];
+
+        unsigned short* outptr = top_blob.channel(q);
+
+        for (int j=0; j<size; j+=tile)
+        {
+            const int n = std::min(tile, size - j);
+
+            const unsigned short* ptr = (const unsigned short*)bottom_blob.channel(q) + j;
+            float16_to_float32_row(ptr, sum, n);
+
+            if (op_type == Operation_SUM && coeffs.w != 0)
+            {
+                eltwise_scale(sum, coeffs[0], n);
+            }
+
+            for (int b=1; b<bottom_count; b++)
+            {
+                const unsigned short* ptr1 = (const unsigned short*)bottom_blobs[b].channel(q) + j;
+
+                if (op_type == Operation_PROD)
+                    eltwise_prod_fp16(sum, ptr1, n);
+                else if (op_type == Operation_SUM)
+                    eltwise_sum_fp16(sum, ptr1, coeffs.w == 0 ? 1.f : coeffs[b], n);
+                else if (op_type == Operation_MAX)
+                    eltwise_max_fp16(sum, ptr1, n);
+            }
+
+            float32_to_float16_row(sum, outptr + j, n);
+        }
+    }
+
+    return 0;
+}
+
+} // namespace ncnn
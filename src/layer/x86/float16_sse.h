@@ -0,0 +1,188 @@
+// Tencent is pleased to support the open source community by making ncnn available.
+//
+// Copyright (C) 2019 THL A29 Limited, a Tencent company. All rights reserved.
+//
+// Licensed under the BSD 3-Clause License (the "License"); you may not use this file except
+// in compliance with the License. You may obtain a copy of the License at
+//
+// https://opensource.org/licenses/BSD-3-Clause
+//
+// Unless required by applicable law or agreed to in writing, software distributed
+// under the License is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR
+// CONDITIONS OF ANY KIND, either express or implied. See the License for the
+// specific language governing permissions and limitations under the License.
+
+// half-precision loads and stores for the float32 kernels
+// F16C instructions are used when the compiler targets them
+
+static inline float float16_to_float32(unsigned short value)
+{
+    // rebias the exponent, zero and denormal go through a float subtraction
+    union
+    {
+        unsigned int u;
+        float f;
+    } tmp, magic;
+
+    magic.u = 113 << 23;
+
+    unsigned int em = (value & 0x7fff) << 13;
+    unsigned int exponent = em & 0x0f800000;
+
+    tmp.u = em + ((127 - 15) << 23);
+
+    if (exponent == 0x0f800000)
+    {
+        // infinity or NaN
+        tmp.u += (128 - 16) << 23;
+    }
+    else if (exponent == 0)
+    {
+        // zero or denormal
+        tmp.u += 1 << 23;
+        tmp.f -= magic.f;
+    }
+
+    tmp.u |= (value & 0x8000) << 16;
+
+    return tmp.f;
+}
+
+static inline unsigned short float32_to_float16(float value)
+{
+    // round to nearest even, denormal goes through a float addition
+    union
+    {
+        unsigned int u;
+        float f;
+    } tmp, magic;
+
+    magic.u = ((127 - 15) + (23 - 10) + 1) << 23;
+
+    tmp.f = value;
+
+    unsigned int sign = tmp.u & 0x80000000;
+    tmp.u ^= sign;
+
+    unsigned short fp16;
+    if (tmp.u >= (127 + 16) << 23)
+    {
+        // overflow to infinity, NaN stays quiet NaN
+        fp16 = tmp.u > 0x7f800000 ? 0x7e00 : 0x7c00;
+    }
+    else if (tmp.u < 113 << 23)
+    {
+        // zero or denormal
+        tmp.f += magic.f;
+        fp16 = tmp.u - magic.u;
+    }
+    else
+    {
+        unsigned int mant_odd = (tmp.u >> 13) & 1;
+        tmp.u += 0xfff + mant_odd;
+        tmp.u -= (127 - 15) << 23;
+        fp16 = tmp.u >> 13;
+    }
+
+    return fp16 | (sign >> 16);
+}
+
+#if __SSE2__
+// 4 half-precision values to float32
+static inline __m128 float16_to_float32_sse(const unsigned short* ptr)
+{
+#if __F16C__
+    return _mm_cvtph_ps(_mm_loadl_epi64((const __m128i*)ptr));
+#else
+    __m128i _h = _mm_unpacklo_epi16(_mm_loadl_epi64((const __m128i*)ptr), _mm_setzero_si128());
+
+    __m128i _sign = _mm_slli_epi32(_mm_and_si128(_h, _mm_set1_epi32(0x8000)), 16);
+    __m128i _em = _mm_slli_epi32(_mm_and_si128(_h, _mm_set1_epi32(0x7fff)), 13);
+    __m128i _exponent = _mm_and_si128(_em, _mm_set1_epi32(0x0f800000));
+
+    __m128i _u = _mm_add_epi32(_em, _mm_set1_epi32((127 - 15) << 23));
+
+    // infinity or NaN
+    __m128i _infnan = _mm_cmpeq_epi32(_exponent, _mm_set1_epi32(0x0f800000));
+    _u = _mm_add_epi32(_u, _mm_and_si128(_infnan, _mm_set1_epi32((128 - 16) << 23)));
+
+    // zero or denormal
+    __m128i _zero = _mm_cmpeq_epi32(_exponent, _mm_setzero_si128());
+    _u = _mm_add_epi32(_u, _mm_and_si128(_zero, _mm_set1_epi32(1 << 23)));
+
+    __m128 _f = _mm_sub_ps(_mm_castsi128_ps(_u), _mm_and_ps(_mm_castsi128_ps(_zero), _mm_castsi128_ps(_mm_set1_epi32(113 << 23))));
+
+    return _mm_or_ps(_f, _mm_castsi128_ps(_sign));
+#endif // __F16C__
+}
+
+// float32 to 4 half-precision values
+static inline void float32_to_float16_sse(unsigned short* ptr, __m128 _v)
+{
+#if __F16C__
+    _mm_storel_epi64((__m128i*)ptr, _mm_cvtps_ph(_v, 0));
+#else
+    __m128i _u = _mm_castps_si128(_v);
+
+    __m128i _sign = _mm_and_si128(_u, _mm_set1_epi32(0x80000000));
+    _u = _mm_xor_si128(_u, _sign);
+
+    // normal
+    __m128i _mant_odd = _mm_and_si128(_mm_srli_epi32(_u, 13), _mm_set1_epi32(1));
+    __m128i _n = _mm_add_epi32(_u, _mm_set1_epi32(0xfff - ((127 - 15) << 23)));
+    _n = _mm_srli_epi32(_mm_add_epi32(_n, _mant_odd), 13);
+
+    // zero or denormal
+    __m128 _magic = _mm_castsi128_ps(_mm_set1_epi32(((127 - 15) + (23 - 10) + 1) << 23));
+    __m128i _d = _mm_sub_epi32(_mm_castps_si128(_mm_add_ps(_mm_castsi128_ps(_u), _magic)), _mm_castps_si128(_magic));
+
+    // overflow to infinity, NaN stays quiet NaN
+    __m128i _nan = _mm_cmpgt_epi32(_u, _mm_set1_epi32(0x7f800000));
+    __m128i _inf = _mm_or_si128(_mm_set1_epi32(0x7c00), _mm_and_si128(_nan, _mm_set1_epi32(0x0200)));
+
+    __m128i _is_denormal = _mm_cmplt_epi32(_u, _mm_set1_epi32(113 << 23));
+    __m128i _is_overflow = _mm_cmpgt_epi32(_u, _mm_set1_epi32(((127 + 16) << 23) - 1));
+
+    __m128i _h = _mm_or_si128(_mm_and_si128(_is_denormal, _d), _mm_andnot_si128(_is_denormal, _n));
+    _h = _mm_or_si128(_mm_and_si128(_is_overflow, _inf), _mm_andnot_si128(_is_overflow, _h));
+    _h = _mm_or_si128(_h, _mm_srli_epi32(_sign, 16));
+
+    // pack the low halves with signed saturation out of the way
+    _h = _mm_sub_epi32(_h, _mm_set1_epi32(0x8000));
+    _h = _mm_packs_epi32(_h, _h);
+    _h = _mm_xor_si128(_h, _mm_set1_epi16((short)0x8000));
+
+    _mm_storel_epi64((__m128i*)ptr, _h);
+#endif // __F16C__
+}
+#endif // __SSE2__
+
+static inline void float16_to_float32_row(const unsigned short* ptr, float* outptr, int size)
+{
+    int i = 0;
+#if __SSE2__
+    for (; i+3<size; i+=4)
+    {
+        _mm_storeu_ps(outptr + i, float16_to_float32_sse(ptr + i));
+    }
+#endif // __SSE2__
+    for (; i<size; i++)
+    {
+        outptr[i] = float16_to_float32(ptr[i]);
+    }
+}
+
+static inline void float32_to_float16_row(const float* ptr, unsigned short* outptr, int size)
+{
+    int i = 0;
+#if __SSE2__
+    for (; i+3<size; i+=4)
+    {
+        float32_to_float16_sse(outptr + i, _mm_loadu_ps(ptr + i));
+    }
+#endif // __SSE2__
+    for (; i<size; i++)
+    {
+        outptr[i] = float32_to_float16(ptr[i]);
+    }
+}
@@ -0,0 +1,369 @@
+// Tencent is pleased to support the open source community by making ncnn available.
+//
+// Copyright (C) 2019 THL A29 Limited, a Tencent company. All rights reserved.
+//
+// Licensed under the BSD 3-Clause License (the "License"); you may not use this file except
+// in compliance with the License. You may obtain a copy of the License at
+//
+// https://opensource.org/licenses/BSD-3-Clause
+//
+// Unless required by applicable law or agreed to in writing, software distributed
+// under the License is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR
+// CONDITIONS OF ANY KIND, either express or implied. See the License for the
+// specific language governing permissions and limitations under the License.
+
+#include "innerproduct_x86.h"
+
+#include <algorithm>
+#include <math.h>
+#include <string.h>
+
+#if __SSE2__
+#include <emmintrin.h>
+#if __F16C__ || __AVX512BF16__
+#include <immintrin.h>
+#endif // __F16C__ || __AVX512BF16__
+#endif // __SSE2__
+
+#include "threadpool.h"
+
+namespace ncnn {
+
+#include "float16_sse.h"
+#include "bfloat16_sse.h"
+#include "weight_sse.h"
+#include "weight_sparse.h"
+#include "weight_quantize_sse.h"
+#include "fused_activation.h"
+
+DEFINE_LAYER_CREATOR(InnerProduct_x86)
+
+InnerProduct_x86::InnerProduct_x86()
+{
+    use_fp16_storage = false;
+    use_bf16_storage = false;
+    weight_bits = 0;
+    use_sparse_weight = false;
+}
+
+int InnerProduct_x86::load_param(const ParamDict& pd)
+{
+    int ret = InnerProduct::load_param(pd);
+    if (ret != 0)
+        return ret;
+
+    use_bf16_storage = pd.use_bf16_storage && !pd.use_vulkan_compute;
+    use_fp16_storage = pd.use_fp16_storage && !pd.use_vulkan_compute && !use_bf16_storage;
+
+    weight_bits = 0;
+    if (!pd.use_vulkan_compute)
+        weight_bits = pd.use_int4_weight_storage ? 4 : pd.use_int8_weight_storage ? 8 : 0;
+
+    use_sparse_weight = pd.use_sparse_weight && !pd.use_vulkan_compute;
+
+    if (weight_bits)
+    {
+        use_fp16_storage = false;
+        use_bf16_storage = false;
+    }
+
+    return 0;
+}
+
+int InnerProduct_x86::load_model(const ModelBin& mb)
+{
+    int ret = InnerProduct::load_model(mb);
+    if (ret != 0)
+        return ret;
+
+    if (use_int8_inference)
+    {
+        use_fp16_storage = false;
+        use_bf16_storage = false;
+        weight_bits = 0;
+    }
+
+    // pruned weight goes to the sparse kernel, it takes precedence over the other weight storage
+    // the gathered dot product beats the dense one from about 80% zero weight
+    if (use_sparse_weight && !use_int8_inference && weight_data.elemsize == 4u && weight_sparsity(weight_data) >= 0.8f)
+    {
+        use_fp16_storage = false;
+        use_bf16_storage = false;
+        weight_bits = 0;
+
+        const int num_input = weight_data_size / num_output;
+        weight_sparse_transform(weight_data, num_input, num_output, weight_sparse_data, weight_sparse_rowptr, weight_sparse_colidx);
+        if (weight_sparse_data.empty() || weight_sparse_rowptr.empty() || weight_sparse_colidx.empty())
+            return -100;
+
+        weight_data.release();
+    }
+
+    if (weight_bits)
+    {
+        const int num_input = weight_data_size / num_output;
+        weight_quantize_transform(weight_data, num_input, num_output, weight_bits, weight_data_quantized, weight_data_quantize_scales);
+        if (weight_data_quantized.empty() || weight_data_quantize_scales.empty())
+            return -100;
+
+        weight_data.release();
+    }
+
+    if (use_fp16_storage)
+    {
+        cast_float32_to_float16(weight_data, weight_data_fp16);
+        if (weight_data_fp16.empty())
+            return -100;
+
+        weight_data.release();
+    }
+
+    if (use_bf16_storage)
+    {
+        cast_float32_to_bfloat16(weight_data, weight_data_bf16);
+        if (weight_data_bf16.empty())
+            return -100;
+
+        weight_data.release();
+    }
+
+    return 0;
+}
+
+template<typename T>
+class InnerProductTask : public ParallelTask
+{
+public:
+    InnerProductTask(const Mat& _bottom_blob, Mat& _top_blob, const T* _weight, const Mat& _bias_data, int _activation_type, const Mat& _activation_params)
+        : bottom_blob(_bottom_blob), top_blob(_top_blob), weight(_weight), bias_data(_bias_data), activation_type(_activation_type), activation_params(_activation_params) {}
+
+    virtual void execute(int begin, int end, int /*thread_id*/) const
+    {
+        int channels = bottom_blob.c;
+        int size = bottom_blob.w * bottom_blob.h;
+
+        const float* bias = bias_data;
+
+        // one long dot product when the channels are packed without gap
+        const bool contiguous = channels == 1 || bottom_blob.cstep == (size_t)size;
+
+        for (int p=begin; p<end; p++)
+        {
+            float sum = bias ? bias[p] : 0.f;
+
+            const T* wptr = weight + size * channels * p;
+
+            if (contiguous)
+            {
+                sum += dot_weight_sse((const float*)bottom_blob, wptr, size * channels);
+            }
+            else
+            {
+                for (int q=0; q<channels; q++)
+                {
+                    sum += dot_weight_sse((const float*)bottom_blob.channel(q), wptr + size * q, size);
+                }
+            }
+
+            top_blob[p] = activation_ss(sum, activation_type, activation_params);
+        }
+    }
+
+private:
+    const Mat& bottom_blob;
+    Mat& top_blob;
+    const T* weight;
+    const Mat& bias_data;
+    int activation_type;
+    const Mat& activation_params;
+};
+
+template<typename T>
+static void innerproduct_sse(const Mat& bottom_blob, Mat& top_blob, const T* weight, const Mat& bias_data, int activation_type, const Mat& activation_params, const Option& opt)
+{
+    parallel_for(top_blob.w, InnerProductTask<T>(bottom_blob, top_blob, weight, bias_data, activation_type, activation_params), opt);
+}
+
+// dot product over the nonzero weight of each output, bottom is flattened
+class InnerProductSparseTask : public ParallelTask
+{
+public:
+    InnerProductSparseTask(const float* _bottom, Mat& _top_blob, const Mat& _sparse_data, const Mat& _sparse_rowptr, const Mat& _sparse_colidx, const Mat& _bias_data, int _activation_type, const Mat& _activation_params)
+        : bottom(_bottom), top_blob(_top_blob), sparse_data(_sparse_data), sparse_rowptr(_sparse_rowptr), sparse_colidx(_sparse_colidx), bias_data(_bias_data), activation_type(_activation_type), activation_params(_activation_params) {}
+
+    virtual void execute(int begin, int end, int /*thread_id*/) const
+    {
+        const float* values = sparse_data;
+        const int* rowptr = (const int*)sparse_rowptr.data;
+        const int* colidx = (const int*)sparse_colidx.data;
+
+        const float* bias = bias_data;
+
+        for (int p=begin; p<end; p++)
+        {
+            const int n0 = rowptr[p];
+            const int n1 = rowptr[p+1];
+
+            float sum0 = 0.f;
+            float sum1 = 0.f;
+            float sum2 = 0.f;
+            float sum3 = 0.f;
+
+            int n = n0;
+            for (; n+3<n1; n+=4)
+            {
+                sum0 += values[n] * bottom[colidx[n]];
+                sum1 += values[n+1] * bottom[colidx[n+1]];
+                sum2 += values[n+2] * bottom[colidx[n+2]];
+                sum3 += values[n+3] * bottom[colidx[n+3]];
+            }
+            for (; n<n1; n++)
+            {
+                sum0 += values[n] * bottom[colidx[n]];
+            }
+
+            float sum = (bias ? bias[p] : 0.f) + (sum0 + sum1) + (sum2 + sum3);
+
+            top_blob[p] = activation_ss(sum, activation_type, activation_params);
+        }
+    }
+
+private:
+    const float* bottom;
+    Mat& top_blob;
+    const Mat& sparse_data;
+    const Mat& sparse_rowptr;
+    const Mat& sparse_colidx;
+    const Mat& bias_data;
+    int activation_type;
+    const Mat& activation_params;
+};
+
+static void innerproduct_sparse_sse(const float* bottom, Mat& top_blob, const Mat& sparse_data, const Mat& sparse_rowptr, const Mat& sparse_colidx, const Mat& bias_data, int activation_type, const Mat& activation_params, const Option& opt)
+{
+    // the rows differ in nonzero count
+    parallel_for(top_blob.w, InnerProductSparseTask(bottom, top_blob, sparse_data, sparse_rowptr, sparse_colidx, bias_data, activation_type, activation_params), opt, ParallelSchedule_GUIDED);
+}
+
+// int8 or int4 weight rows with one scale per output, bottom is flattened
+class InnerProductQuantizedTask : public ParallelTask
+{
+public:
+    InnerProductQuantizedTask(const float* _bottom, int _K, Mat& _top_blob, const Mat& _weight_quantized, const Mat& _weight_scales, int _bits, const Mat& _bias_data, int _activation_type, const Mat& _activation_params)
+        : bottom(_bottom), K(_K), top_blob(_top_blob), weight_quantized(_weight_quantized), weight_scales(_weight_scales), bits(_bits), bias_data(_bias_data), activation_type(_activation_type), activation_params(_activation_params) {}
+
+    virtual void execute(int begin, int end, int /*thread_id*/) const
+    {
+        const int row_bytes = weight_quantize_row_bytes(K, bits);
+
+        const float* bias = bias_data;
+
+        for (int p=begin; p<end; p++)
+        {
+            const unsigned char* wptr = (const unsigned char*)weight_quantized.data + (size_t)row_bytes * p;
+
+            float sum = (bias ? bias[p] : 0.f) + weight_scales[p] * dot_weight_quantized_sse(bottom, wptr, K, bits);
+
+            top_blob[p] = activation_ss(sum, activation_type, activation_params);
+        }
+    }
+
+private:
+    const float* bottom;
+    int K;
+    Mat& top_blob;
+    const Mat& weight_quantized;
+    const Mat& weight_scales;
+    int bits;
+    const Mat& bias_data;
+    int activation_type;
+    const Mat& activation_params;
+};
+
+static void innerproduct_quantized_sse(const float* bottom, int K, Mat& top_blob, const Mat& weight_quantized, const Mat& weight_scales, int bits, const Mat& bias_data, int activation_type, const Mat& activation_params, const Option& opt)
+{
+    parallel_for(top_blob.w, InnerProductQuantizedTask(bottom, K, top_blob, weight_quantized, weight_scales, bits, bias_data, activation_type, activation_params), opt);
+}
+
+static size_t mat_bytes(const Mat& m)
+{
+    return m.total() * m.elemsize;
+}
+
+int InnerProduct_x86::get_cost(const std::vector<Mat>& bottom_blobs, const std::vector<Mat>& top_blobs, LayerCost& cost) const
+{
+    InnerProduct::get_cost(bottom_blobs, top_blobs, cost);
+
+    // weight_data is released for the other storage, count what the kernel reads
+    if (!weight_sparse_rowptr.empty())
+    {
+        cost.macs = ((const int*)weight_sparse_rowptr.data)[num_output];
+        cost.weight_bytes = mat_bytes(weight_sparse_data) + mat_bytes(weight_sparse_rowptr) + mat_bytes(weight_sparse_colidx);
+    }
+    else if (weight_bits)
+    {
+        cost.weight_bytes = mat_bytes(weight_data_quantized) + mat_bytes(weight_data_quantize_scales);
+    }
+    else if (use_fp16_storage)
+    {
+        cost.weight_bytes = mat_bytes(weight_data_fp16);
+    }
+    else if (use_bf16_storage)
+    {
+        cost.weight_bytes = mat_bytes(weight_data_bf16);
+    }
+    else
+    {
+        cost.weight_bytes = mat_bytes(weight_data);
+    }
+
+    cost.weight_bytes += mat_bytes(bias_data);
+
+    return 0;
+}
+
+int InnerProduct_x86::forward(const Mat& bottom_blob, Mat& top_blob, const Option& opt) const
+{
+    if (use_int8_inference || bottom_blob.elemsize != 4)
+    {
+        return InnerProduct::forward(bottom_blob, top_blob, opt);
+    }
+
+    top_blob.create(num_output, bottom_blob.elemsize, opt.blob_allocator);
+    if (top_blob.empty())
+        return -100;
+
+    const Mat bias = bias_term ? bias_data : Mat();
+
+    if (!weight_sparse_data.empty() || weight_bits)
+    {
+        int size = bottom_blob.w * bottom_blob.h;
+
+        // the weight row runs over the flattened bottom blob
+        Mat bottom_blob_flattened = bottom_blob;
+        if (bottom_blob.dims == 3 && bottom_blob.cstep != (size_t)size)
+        {
+            bottom_blob_flattened = bottom_blob.reshape(size * bottom_blob.c, opt.workspace_allocator);
+            if (bottom_blob_flattened.empty())
+                return -100;
+        }
+
+        if (weight_bits)
+            innerproduct_quantized_sse(bottom_blob_flattened, size * bottom_blob.c, top_blob, weight_data_quantized, weight_data_quantize_scales, weight_bits, bias, activation_type, activation_params, opt);
+        else
+            innerproduct_sparse_sse(bottom_blob_flattened, top_blob, weight_sparse_data, weight_sparse_rowptr, weight_sparse_colidx, bias, activation_type, activation_params, opt);
+
+        return 0;
+    }
+
+    if (use_bf16_storage)
+        innerproduct_sse(bottom_blob, top_blob, (const bfloat16*)weight_data_bf16.data, bias, activation_type, activation_params, opt);
+    else if (use_fp16_storage)
+        innerproduct_sse(bottom_blob, top_blob, (const unsigned short*)weight_data_fp16.data, bias, activation_type, activation_params, opt);
+    else
+        innerproduct_sse(bottom_blob, top_blob, (const float*)weight_data, bias, activation_type, activation_params, opt);
+
+    return 0;
+}
+
+} // namespace ncnn
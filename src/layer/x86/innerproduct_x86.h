@@ -0,0 +1,59 @@
+// Tencent is pleased to support the open source community by making ncnn available.
+//
+// Copyright (C) 2019 THL A29 Limited, a Tencent company. All rights reserved.
+//
+// Licensed under the BSD 3-Clause License (the "License"); you may not use this file except
+// in compliance with the License. You may obtain a copy of the License at
+//
+// https://opensource.org/licenses/BSD-3-Clause
+//
+// Unless required by applicable law or agreed to in writing, software distributed
+// under the License is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR
+// CONDITIONS OF ANY KIND, either express or implied. See the License for the
+// specific language governing permissions and limitations under the License.
+
+#ifndef LAYER_INNERPRODUCT_X86_H
+#define LAYER_INNERPRODUCT_X86_H
+
+#include "innerproduct.h"
+
+namespace ncnn {
+
+class InnerProduct_x86 : public InnerProduct
+{
+public:
+    InnerProduct_x86();
+
+    virtual int load_param(const ParamDict& pd);
+
+    virtual int load_model(const ModelBin& mb);
+
+    virtual int get_cost(const std::vector<Mat>& bottom_blobs, const std::vector<Mat>& top_blobs, LayerCost& cost) const;
+
+    virtual int forward(const Mat& bottom_blob, Mat& top_blob, const Option& opt) const;
+
+public:
+    bool use_fp16_storage;
+    bool use_bf16_storage;
+
+    // half-precision or bfloat16 weight, weight_data is released when used
+    Mat weight_data_fp16;
+    Mat weight_data_bf16;
+
+    // weight-only quantization, 8 or 4 bits with one scale per output, 0 = off
+    // weight_data is released when used
+    int weight_bits;
+    Mat weight_data_quantized;
+    Mat weight_data_quantize_scales;
+
+    // compressed sparse row weight of a pruned model, from Net::use_sparse_weight
+    // weight_data is released when used
+    bool use_sparse_weight;
+    Mat weight_sparse_data;
+    Mat weight_sparse_rowptr;
+    Mat weight_sparse_colidx;
+};
+
+} // namespace ncnn
+
+#endif // LAYER_INNERPRODUCT_X86_H
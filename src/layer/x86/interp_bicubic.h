@@ -0,0 +1,179 @@
+// Tencent is pleased to support the open source community by making ncnn available.
+//
+// Copyright (C) 2019 THL A29 Limited, a Tencent company. All rights reserved.
+//
+// Licensed under the BSD 3-Clause License (the "License"); you may not use this file except
+// in compliance with the License. You may obtain a copy of the License at
+//
+// https://opensource.org/licenses/BSD-3-Clause
+//
+// Unless required by applicable law or agreed to in writing, software distributed
+// under the License is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR
+// CONDITIONS OF ANY KIND, either express or implied. See the License for the
+// specific language governing permissions and limitations under the License.
+
+#if __SSE2__
+#include <emmintrin.h>
+#endif // __SSE2__
+
+static inline void interpolate_cubic(float fx, float* coeffs)
+{
+    const float A = -0.75f;
+
+    float fx0 = fx + 1;
+    float fx1 = fx;
+    float fx2 = 1 - fx;
+    // float fx3 = 2 - fx;
+
+    coeffs[0] = A * fx0*fx0*fx0 - 5*A * fx0*fx0 + 8*A * fx0 - 4*A;
+    coeffs[1] = (A+2) * fx1*fx1*fx1 - (A+3) * fx1*fx1 + 1;
+    coeffs[2] = (A+2) * fx2*fx2*fx2 - (A+3) * fx2*fx2 + 1;
+    coeffs[3] = 1.f - coeffs[0] - coeffs[1] - coeffs[2];
+}
+
+static void cubic_coeffs(int w, int outw, int* xofs, float* alpha)
+{
+    double scale = (double)w / outw;
+
+    for (int dx = 0; dx < outw; dx++)
+    {
+        float fx = (float)((dx + 0.5) * scale - 0.5);
+        int sx = floor(fx);
+        fx -= sx;
+
+        interpolate_cubic(fx, alpha + dx*4);
+
+        if (sx <= -1)
+        {
+            sx = 1;
+            alpha[dx*4 +0] = 1.f - alpha[dx*4 +3];
+            alpha[dx*4 +1] = alpha[dx*4 +3];
+            alpha[dx*4 +2] = 0.f;
+            alpha[dx*4 +3] = 0.f;
+        }
+        if (sx == 0)
+        {
+            sx = 1;
+            alpha[dx*4 +0] = alpha[dx*4 +0] + alpha[dx*4 +1];
+            alpha[dx*4 +1] = alpha[dx*4 +2];
+            alpha[dx*4 +2] = alpha[dx*4 +3];
+            alpha[dx*4 +3] = 0.f;
+        }
+        if (sx == w - 2)
+        {
+            sx = w - 3;
+            alpha[dx*4 +3] = alpha[dx*4 +2] + alpha[dx*4 +3];
+            alpha[dx*4 +2] = alpha[dx*4 +1];
+            alpha[dx*4 +1] = alpha[dx*4 +0];
+            alpha[dx*4 +0] = 0.f;
+        }
+        if (sx >= w - 1)
+        {
+            sx = w - 3;
+            alpha[dx*4 +3] = 1.f - alpha[dx*4 +0];
+            alpha[dx*4 +2] = alpha[dx*4 +0];
+            alpha[dx*4 +1] = 0.f;
+            alpha[dx*4 +0] = 0.f;
+        }
+
+        xofs[dx] = sx;
+    }
+}
+
+static void cubic_hresize(const float* S, float* rows, int w, const float* alpha, const int* xofs)
+{
+    int dx = 0;
+#if __SSE2__
+    for (; dx+3 < w; dx += 4)
+    {
+        // the four taps of one output are contiguous in the source row
+        __m128 _m0 = _mm_mul_ps(_mm_loadu_ps(S + xofs[dx] - 1), _mm_loadu_ps(alpha + dx*4));
+        __m128 _m1 = _mm_mul_ps(_mm_loadu_ps(S + xofs[dx+1] - 1), _mm_loadu_ps(alpha + dx*4 + 4));
+        __m128 _m2 = _mm_mul_ps(_mm_loadu_ps(S + xofs[dx+2] - 1), _mm_loadu_ps(alpha + dx*4 + 8));
+        __m128 _m3 = _mm_mul_ps(_mm_loadu_ps(S + xofs[dx+3] - 1), _mm_loadu_ps(alpha + dx*4 + 12));
+
+        _MM_TRANSPOSE4_PS(_m0, _m1, _m2, _m3);
+
+        _mm_storeu_ps(rows + dx, _mm_add_ps(_mm_add_ps(_mm_add_ps(_m0, _m1), _m2), _m3));
+    }
+#endif // __SSE2__
+    for (; dx < w; dx++)
+    {
+        const float* Sp = S + xofs[dx];
+        const float* alphap = alpha + dx*4;
+
+        rows[dx] = Sp[-1]*alphap[0] + Sp[0]*alphap[1] + Sp[1]*alphap[2] + Sp[2]*alphap[3];
+    }
+}
+
+// separable two-pass bicubic, output rows [dy0, dy1) of one channel
+// the horizontal pass keeps a ring of four resized source rows
+static void resize_bicubic_image(const Mat& src, Mat& dst, const float* alpha, const int* xofs, const float* beta, const int* yofs, int dy0, int dy1)
+{
+    int w = dst.w;
+
+    // loop body
+    Mat rowsbuf(w, 4);
+    float* rows[4] = { rowsbuf.row(0), rowsbuf.row(1), rowsbuf.row(2), rowsbuf.row(3) };
+
+    int prev_sy1 = -3;
+
+    for (int dy = dy0; dy < dy1; dy++)
+    {
+        int sy = yofs[dy];
+
+        // number of rows at the bottom of the ring that must be resized again
+        int nfresh = std::min(sy - prev_sy1, 4);
+        if (nfresh < 0)
+            nfresh = 4;
+
+        if (nfresh > 0 && nfresh < 4)
+        {
+            float* rows_old[4] = { rows[0], rows[1], rows[2], rows[3] };
+            for (int i = 0; i < 4; i++)
+            {
+                rows[i] = rows_old[(i + nfresh) % 4];
+            }
+        }
+
+        for (int i = 4 - nfresh; i < 4; i++)
+        {
+            cubic_hresize(src.row(sy - 1 + i), rows[i], w, alpha, xofs);
+        }
+
+        prev_sy1 = sy;
+
+        // vresize
+        float b0 = beta[dy*4];
+        float b1 = beta[dy*4 + 1];
+        float b2 = beta[dy*4 + 2];
+        float b3 = beta[dy*4 + 3];
+
+        const float* rows0p = rows[0];
+        const float* rows1p = rows[1];
+        const float* rows2p = rows[2];
+        const float* rows3p = rows[3];
+        float* Dp = dst.row(dy);
+
+        int dx = 0;
+#if __SSE2__
+        __m128 _b0 = _mm_set1_ps(b0);
+        __m128 _b1 = _mm_set1_ps(b1);
+        __m128 _b2 = _mm_set1_ps(b2);
+        __m128 _b3 = _mm_set1_ps(b3);
+        for (; dx+3 < w; dx += 4)
+        {
+            __m128 _D = _mm_mul_ps(_mm_loadu_ps(rows0p + dx), _b0);
+            _D = _mm_add_ps(_D, _mm_mul_ps(_mm_loadu_ps(rows1p + dx), _b1));
+            _D = _mm_add_ps(_D, _mm_mul_ps(_mm_loadu_ps(rows2p + dx), _b2));
+            _D = _mm_add_ps(_D, _mm_mul_ps(_mm_loadu_ps(rows3p + dx), _b3));
+
+            _mm_storeu_ps(Dp + dx, _D);
+        }
+#endif // __SSE2__
+        for (; dx < w; dx++)
+        {
+            Dp[dx] = rows0p[dx] * b0 + rows1p[dx] * b1 + rows2p[dx] * b2 + rows3p[dx] * b3;
+        }
+    }
+}
@@ -0,0 +1,140 @@
+// Tencent is pleased to support the open source community by making ncnn available.
+//
+// Copyright (C) 2019 THL A29 Limited, a Tencent company. All rights reserved.
+//
+// Licensed under the BSD 3-Clause License (the "License"); you may not use this file except
+// in compliance with the License. You may obtain a copy of the License at
+//
+// https://opensource.org/licenses/BSD-3-Clause
+//
+// Unless required by applicable law or agreed to in writing, software distributed
+// under the License is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR
+// CONDITIONS OF ANY KIND, either express or implied. See the License for the
+// specific language governing permissions and limitations under the License.
+
+#if __SSE2__
+#include <emmintrin.h>
+#endif // __SSE2__
+
+static void linear_coeffs(int w, int outw, int* xofs, float* alpha)
+{
+    double scale = (double)w / outw;
+
+    for (int dx = 0; dx < outw; dx++)
+    {
+        float fx = (float)((dx + 0.5) * scale - 0.5);
+        int sx = floor(fx);
+        fx -= sx;
+
+        if (sx < 0)
+        {
+            sx = 0;
+            fx = 0.f;
+        }
+        if (sx >= w - 1)
+        {
+            sx = w - 2;
+            fx = 1.f;
+        }
+
+        xofs[dx] = sx;
+
+        alpha[dx*2    ] = 1.f - fx;
+        alpha[dx*2 + 1] = fx;
+    }
+}
+
+static void linear_hresize(const float* S, float* rows, int w, const float* alpha, const int* xofs)
+{
+    int dx = 0;
+#if __SSE2__
+    for (; dx+3 < w; dx += 4)
+    {
+        // gather the four source pairs, then add the products pairwise
+        __m128 _S01 = _mm_loadl_pi(_mm_setzero_ps(), (const __m64*)(S + xofs[dx]));
+        _S01 = _mm_loadh_pi(_S01, (const __m64*)(S + xofs[dx+1]));
+        __m128 _S23 = _mm_loadl_pi(_mm_setzero_ps(), (const __m64*)(S + xofs[dx+2]));
+        _S23 = _mm_loadh_pi(_S23, (const __m64*)(S + xofs[dx+3]));
+
+        __m128 _m01 = _mm_mul_ps(_S01, _mm_loadu_ps(alpha + dx*2));
+        __m128 _m23 = _mm_mul_ps(_S23, _mm_loadu_ps(alpha + dx*2 + 4));
+
+        __m128 _a = _mm_shuffle_ps(_m01, _m23, _MM_SHUFFLE(2, 0, 2, 0));
+        __m128 _b = _mm_shuffle_ps(_m01, _m23, _MM_SHUFFLE(3, 1, 3, 1));
+
+        _mm_storeu_ps(rows + dx, _mm_add_ps(_a, _b));
+    }
+#endif // __SSE2__
+    for (; dx < w; dx++)
+    {
+        const float* Sp = S + xofs[dx];
+
+        rows[dx] = Sp[0]*alpha[dx*2] + Sp[1]*alpha[dx*2 + 1];
+    }
+}
+
+// output rows [dy0, dy1) of one channel
+static void resize_bilinear_image(const Mat& src, Mat& dst, const float* alpha, const int* xofs, const float* beta, const int* yofs, int dy0, int dy1)
+{
+    int w = dst.w;
+
+    // loop body
+    Mat rowsbuf0(w);
+    Mat rowsbuf1(w);
+    float* rows0 = rowsbuf0;
+    float* rows1 = rowsbuf1;
+
+    int prev_sy1 = -2;
+
+    for (int dy = dy0; dy < dy1; dy++)
+    {
+        int sy = yofs[dy];
+
+        if (sy == prev_sy1)
+        {
+            // reuse all rows
+        }
+        else if (sy == prev_sy1 + 1)
+        {
+            // hresize one row
+            float* rows0_old = rows0;
+            rows0 = rows1;
+            rows1 = rows0_old;
+
+            linear_hresize(src.row(sy+1), rows1, w, alpha, xofs);
+        }
+        else
+        {
+            // hresize two rows
+            linear_hresize(src.row(sy), rows0, w, alpha, xofs);
+            linear_hresize(src.row(sy+1), rows1, w, alpha, xofs);
+        }
+
+        prev_sy1 = sy;
+
+        // vresize
+        float b0 = beta[dy*2];
+        float b1 = beta[dy*2 + 1];
+
+        const float* rows0p = rows0;
+        const float* rows1p = rows1;
+        float* Dp = dst.row(dy);
+
+        int dx = 0;
+#if __SSE2__
+        __m128 _b0 = _mm_set1_ps(b0);
+        __m128 _b1 = _mm_set1_ps(b1);
+        for (; dx+3 < w; dx += 4)
+        {
+            __m128 _rows0 = _mm_loadu_ps(rows0p + dx);
+            __m128 _rows1 = _mm_loadu_ps(rows1p + dx);
+
+            _mm_storeu_ps(Dp + dx, _mm_add_ps(_mm_mul_ps(_rows0, _b0), _mm_mul_ps(_rows1, _b1)));
+        }
+#endif // __SSE2__
+        for (; dx < w; dx++)
+        {
+            Dp[dx] = rows0p[dx] * b0 + rows1p[dx] * b1;
+        }
+    }
+}
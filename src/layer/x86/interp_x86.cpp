@@ -0,0 +1,273 @@
+// Tencent is pleased to support the open source community by making ncnn available.
+//
+// Copyright (C) 2019 THL A29 Limited, a Tencent company. All rights reserved.
+//
+// Licensed under the BSD 3-Clause License (the "License"); you may not use this file except
+// in compliance with the License. You may obtain a copy of the License at
+//
+// https://opensource.org/licenses/BSD-3-Clause
+//
+// Unless required by applicable law or agreed to in writing, software distributed
+// under the License is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR
+// CONDITIONS OF ANY KIND, either express or implied. See the License for the
+// specific language governing permissions and limitations under the License.
+
+#include "interp_x86.h"
+
+#include <math.h>
+#include <algorithm>
+
+#if __SSE2__
+#include <emmintrin.h>
+#endif // __SSE2__
+
+namespace ncnn {
+
+#include "interp_bilinear.h"
+#include "interp_bicubic.h"
+
+DEFINE_LAYER_CREATOR(Interp_x86)
+
+static void nearest_coeffs(int w, int outw, float scale, int* xofs)
+{
+    for (int dx = 0; dx < outw; dx++)
+    {
+        // the rounded float quotient, even when fast-math turns the division into a reciprocal multiply
+        float fx = (float)((double)dx / scale);
+
+        xofs[dx] = std::min((int)fx, w - 1);
+    }
+}
+
+static void resize_nearest_image(const Mat& src, Mat& dst, const int* xofs, const int* yofs, int dy0, int dy1)
+{
+    int w = dst.w;
+
+    for (int dy = dy0; dy < dy1; dy++)
+    {
+        const float* S = src.row(yofs[dy]);
+        float* Dp = dst.row(dy);
+
+        for (int dx = 0; dx < w; dx++)
+        {
+            Dp[dx] = S[xofs[dx]];
+        }
+    }
+}
+
+// integer scale factors, every source pixel becomes a scale_w x scale_h block
+static void resize_nearest_integer_image(const Mat& src, Mat& dst, int scale_w, int scale_h, int dy0, int dy1)
+{
+    int w = src.w;
+    int outw = dst.w;
+
+    for (int dy = dy0; dy < dy1; dy++)
+    {
+        float* Dp = dst.row(dy);
+
+        if (dy != dy0 && dy % scale_h != 0)
+        {
+            // same source row as the previous one
+            memcpy(Dp, dst.row(dy - 1), outw * sizeof(float));
+            continue;
+        }
+
+        const float* S = src.row(dy / scale_h);
+
+        if (scale_w == 1)
+        {
+            memcpy(Dp, S, w * sizeof(float));
+        }
+        else if (scale_w == 2)
+        {
+            int sx = 0;
+#if __SSE2__
+            for (; sx+3 < w; sx += 4)
+            {
+                __m128 _S = _mm_loadu_ps(S + sx);
+                _mm_storeu_ps(Dp + sx*2, _mm_unpacklo_ps(_S, _S));
+                _mm_storeu_ps(Dp + sx*2 + 4, _mm_unpackhi_ps(_S, _S));
+            }
+#endif // __SSE2__
+            for (; sx < w; sx++)
+            {
+                Dp[sx*2] = S[sx];
+                Dp[sx*2 + 1] = S[sx];
+            }
+        }
+        else
+        {
+            for (int sx = 0; sx < w; sx++)
+            {
+                const float v = S[sx];
+                float* ptr = Dp + sx * scale_w;
+
+                for (int k = 0; k < scale_w; k++)
+                {
+                    ptr[k] = v;
+                }
+            }
+        }
+    }
+}
+
+Interp_x86::Interp_x86()
+{
+    coeffs_w = 0;
+    coeffs_h = 0;
+    coeffs_outw = 0;
+    coeffs_outh = 0;
+}
+
+Mat Interp_x86::get_coeffs(int w, int h, int outw, int outh) const
+{
+    {
+        MutexLockGuard guard(coeffs_lock);
+
+        if (!coeffs.empty() && coeffs_w == w && coeffs_h == h && coeffs_outw == outw && coeffs_outh == outh)
+            return coeffs;
+    }
+
+    // xofs yofs alpha beta
+    const int ntaps = resize_type == 3 ? 4 : resize_type == 2 ? 2 : 0;
+
+    Mat tables(outw + outh + outw * ntaps + outh * ntaps, (size_t)4u);
+    if (tables.empty())
+        return tables;
+
+    int* xofs = tables;
+    int* yofs = xofs + outw;
+    float* alpha = (float*)(yofs + outh);
+    float* beta = alpha + outw * ntaps;
+
+    if (resize_type == 1)
+    {
+        nearest_coeffs(w, outw, width_scale, xofs);
+        nearest_coeffs(h, outh, height_scale, yofs);
+    }
+    else if (resize_type == 2)
+    {
+        linear_coeffs(w, outw, xofs, alpha);
+        linear_coeffs(h, outh, yofs, beta);
+    }
+    else // if (resize_type == 3)
+    {
+        cubic_coeffs(w, outw, xofs, alpha);
+        cubic_coeffs(h, outh, yofs, beta);
+    }
+
+    {
+        MutexLockGuard guard(coeffs_lock);
+
+        coeffs_w = w;
+        coeffs_h = h;
+        coeffs_outw = outw;
+        coeffs_outh = outh;
+        coeffs = tables;
+    }
+
+    return tables;
+}
+
+int Interp_x86::forward(const Mat& bottom_blob, Mat& top_blob, const Option& opt) const
+{
+    if (bottom_blob.dims == 1 || bottom_blob.elemsize != 4 || resize_type < 1 || resize_type > 3)
+    {
+        return Interp::forward(bottom_blob, top_blob, opt);
+    }
+
+    int w = bottom_blob.w;
+    int h = bottom_blob.h;
+    int channels = bottom_blob.c;
+    size_t elemsize = bottom_blob.elemsize;
+
+    int outh = output_height;
+    int outw = output_width;
+    if (outh == 0 || outw == 0)
+    {
+        outh = h * height_scale;
+        outw = w * width_scale;
+    }
+    if (outh == h && outw == w)
+    {
+        top_blob = bottom_blob;
+        return 0;
+    }
+
+    top_blob.create(outw, outh, channels, elemsize, opt.blob_allocator);
+    if (top_blob.empty())
+        return -100;
+
+    // split rows too when there are fewer channels than threads
+    int nblocks = 1;
+    if (channels < opt.num_threads)
+    {
+        nblocks = std::min((opt.num_threads + channels - 1) / channels, outh);
+    }
+
+    const int ntasks = channels * nblocks;
+
+    if (resize_type == 1)// nearest
+    {
+        const int scale_w = (int)width_scale;
+        const int scale_h = (int)height_scale;
+
+        if (scale_w == width_scale && scale_h == height_scale && scale_w >= 1 && scale_h >= 1 && outw == w * scale_w && outh == h * scale_h)
+        {
+            #pragma omp parallel for num_threads(opt.num_threads)
+            for (int i = 0; i < ntasks; i++)
+            {
+                const int q = i / nblocks;
+                const int b = i % nblocks;
+
+                const Mat src = bottom_blob.channel(q);
+                Mat dst = top_blob.channel(q);
+
+                resize_nearest_integer_image(src, dst, scale_w, scale_h, outh * b / nblocks, outh * (b + 1) / nblocks);
+            }
+
+            return 0;
+        }
+    }
+
+    Mat tables = get_coeffs(w, h, outw, outh);
+    if (tables.empty())
+        return -100;
+
+    const int ntaps = resize_type == 3 ? 4 : resize_type == 2 ? 2 : 0;
+
+    const int* xofs = tables;
+    const int* yofs = xofs + outw;
+    const float* alpha = (const float*)(yofs + outh);
+    const float* beta = alpha + outw * ntaps;
+
+    #pragma omp parallel for num_threads(opt.num_threads)
+    for (int i = 0; i < ntasks; i++)
+    {
+        const int q = i / nblocks;
+        const int b = i % nblocks;
+
+        const int dy0 = outh * b / nblocks;
+        const int dy1 = outh * (b + 1) / nblocks;
+
+        const Mat src = bottom_blob.channel(q);
+        Mat dst = top_blob.channel(q);
+
+        if (resize_type == 1)
+        {
+            resize_nearest_image(src, dst, xofs, yofs, dy0, dy1);
+        }
+        else if (resize_type == 2)
+        {
+            resize_bilinear_image(src, dst, alpha, xofs, beta, yofs, dy0, dy1);
+        }
+        else // if (resize_type == 3)
+        {
+            resize_bicubic_image(src, dst, alpha, xofs, beta, yofs, dy0, dy1);
+        }
+    }
+
+    return 0;
+}
+
+} // namespace ncnn
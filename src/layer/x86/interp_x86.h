@@ -0,0 +1,45 @@
+// Tencent is pleased to support the open source community by making ncnn available.
+//
+// Copyright (C) 2019 THL A29 Limited, a Tencent company. All rights reserved.
+//
+// Licensed under the BSD 3-Clause License (the "License"); you may not use this file except
+// in compliance with the License. You may obtain a copy of the License at
+//
+// https://opensource.org/licenses/BSD-3-Clause
+//
+// Unless required by applicable law or agreed to in writing, software distributed
+// under the License is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR
+// CONDITIONS OF ANY KIND, either express or implied. See the License for the
+// specific language governing permissions and limitations under the License.
+
+#ifndef LAYER_INTERP_X86_H
+#define LAYER_INTERP_X86_H
+
+#include "interp.h"
+
+namespace ncnn {
+
+class Interp_x86 : public Interp
+{
+public:
+    Interp_x86();
+
+    virtual int forward(const Mat& bottom_blob, Mat& top_blob, const Option& opt) const;
+
+protected:
+    // xofs yofs alpha beta for the given shape, built on first use
+    Mat get_coeffs(int w, int h, int outw, int outh) const;
+
+public:
+    // coefficient tables of the last seen (in, out) shape
+    mutable Mutex coeffs_lock;
+    mutable int coeffs_w;
+    mutable int coeffs_h;
+    mutable int coeffs_outw;
+    mutable int coeffs_outh;
+    mutable Mat coeffs;
+};
+
+} // namespace ncnn
+
+#endif // LAYER_INTERP_X86_H
@@ -0,0 +1,244 @@
+// Tencent is pleased to support the open source community by making ncnn available.
+//
+// Copyright (C) 2019 THL A29 Limited, a Tencent company. All rights reserved.
+//
+// Licensed under the BSD 3-Clause License (the "License"); you may not use this file except
+// in compliance with the License. You may obtain a copy of the License at
+//
+// https://opensource.org/licenses/BSD-3-Clause
+//
+// Unless required by applicable law or agreed to in writing, software distributed
+// under the License is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR
+// CONDITIONS OF ANY KIND, either express or implied. See the License for the
+// specific language governing permissions and limitations under the License.
+
+#include "lstm_x86.h"
+
+#include <algorithm>
+#include <math.h>
+#include <string.h>
+
+#if __SSE2__
+#include <emmintrin.h>
+#if __F16C__ || __AVX512BF16__
+#include <immintrin.h>
+#endif // __F16C__ || __AVX512BF16__
+#endif // __SSE2__
+
+namespace ncnn {
+
+#include "float16_sse.h"
+#include "bfloat16_sse.h"
+#include "weight_sse.h"
+#include "weight_quantize_sse.h"
+
+DEFINE_LAYER_CREATOR(LSTM_x86)
+
+LSTM_x86::LSTM_x86()
+{
+    use_fp16_storage = false;
+    weight_bits = 0;
+}
+
+int LSTM_x86::load_param(const ParamDict& pd)
+{
+    int ret = LSTM::load_param(pd);
+    if (ret != 0)
+        return ret;
+
+    use_fp16_storage = pd.use_fp16_storage && !pd.use_vulkan_compute;
+
+    weight_bits = 0;
+    if (!pd.use_vulkan_compute)
+        weight_bits = pd.use_int4_weight_storage ? 4 : pd.use_int8_weight_storage ? 8 : 0;
+
+    if (weight_bits)
+        use_fp16_storage = false;
+
+    return 0;
+}
+
+int LSTM_x86::load_model(const ModelBin& mb)
+{
+    int ret = LSTM::load_model(mb);
+    if (ret != 0)
+        return ret;
+
+    if (weight_bits)
+    {
+        int size = weight_data_size / num_output / 4;
+
+        weight_quantize_transform(weight_xc_data, size, num_output * 4, weight_bits, weight_xc_data_quantized, weight_xc_data_quantize_scales);
+        if (weight_xc_data_quantized.empty() || weight_xc_data_quantize_scales.empty())
+            return -100;
+
+        weight_quantize_transform(weight_hc_data, num_output, num_output * 4, weight_bits, weight_hc_data_quantized, weight_hc_data_quantize_scales);
+        if (weight_hc_data_quantized.empty() || weight_hc_data_quantize_scales.empty())
+            return -100;
+
+        weight_xc_data.release();
+        weight_hc_data.release();
+    }
+
+    if (use_fp16_storage)
+    {
+        cast_float32_to_float16(weight_xc_data, weight_xc_data_fp16);
+        if (weight_xc_data_fp16.empty())
+            return -100;
+
+        cast_float32_to_float16(weight_hc_data, weight_hc_data_fp16);
+        if (weight_hc_data_fp16.empty())
+            return -100;
+
+        weight_xc_data.release();
+        weight_hc_data.release();
+    }
+
+    return 0;
+}
+
+// gate_input_t := W_hc * h_conted_{t-1} + W_xc * x_t + b_c
+// gates are laid out as I F O G for every output
+template<typename T>
+static void lstm_gates_sse(const float* x, const float* hidden, bool cont, const T* weight_xc, const T* weight_hc, const Mat& bias_c_data, Mat& gates, int size, int num_output, const Option& opt)
+{
+    #pragma omp parallel for num_threads(opt.num_threads)
+    for (int q=0; q<num_output; q++)
+    {
+        float* gates_data = (float*)gates + 4 * q;
+
+        for (int k=0; k<4; k++)
+        {
+            const T* weight_xc_ptr = weight_xc + (size_t)size * (num_output * k + q);
+
+            float sum = ((const float*)bias_c_data)[num_output * k + q];
+
+            sum += dot_weight_sse(x, weight_xc_ptr, size);
+
+            // h_cont_{t-1} is zero when not continued
+            if (cont)
+            {
+                const T* weight_hc_ptr = weight_hc + (size_t)num_output * (num_output * k + q);
+
+                sum += dot_weight_sse(hidden, weight_hc_ptr, num_output);
+            }
+
+            gates_data[k] = sum;
+        }
+    }
+}
+
+// same as lstm_gates_sse with int8 or int4 weight rows
+static void lstm_gates_quantized_sse(const float* x, const float* hidden, bool cont, const Mat& weight_xc, const Mat& weight_xc_scales, const Mat& weight_hc, const Mat& weight_hc_scales, int bits, const Mat& bias_c_data, Mat& gates, int size, int num_output, const Option& opt)
+{
+    const int xc_row_bytes = weight_quantize_row_bytes(size, bits);
+    const int hc_row_bytes = weight_quantize_row_bytes(num_output, bits);
+
+    #pragma omp parallel for num_threads(opt.num_threads)
+    for (int q=0; q<num_output; q++)
+    {
+        float* gates_data = (float*)gates + 4 * q;
+
+        for (int k=0; k<4; k++)
+        {
+            const int row = num_output * k + q;
+
+            const unsigned char* weight_xc_ptr = (const unsigned char*)weight_xc.data + (size_t)xc_row_bytes * row;
+
+            float sum = ((const float*)bias_c_data)[row];
+
+            sum += weight_xc_scales[row] * dot_weight_quantized_sse(x, weight_xc_ptr, size, bits);
+
+            // h_cont_{t-1} is zero when not continued
+            if (cont)
+            {
+                const unsigned char* weight_hc_ptr = (const unsigned char*)weight_hc.data + (size_t)hc_row_bytes * row;
+
+                sum += weight_hc_scales[row] * dot_weight_quantized_sse(hidden, weight_hc_ptr, num_output, bits);
+            }
+
+            gates_data[k] = sum;
+        }
+    }
+}
+
+int LSTM_x86::forward(const std::vector<Mat>& bottom_blobs, std::vector<Mat>& top_blobs, const Option& opt) const
+{
+    // size x T
+    const Mat& input_blob = bottom_blobs[0];
+
+    size_t elemsize = input_blob.elemsize;
+
+    // T, 0 or 1 each
+    const Mat& cont_blob = bottom_blobs[1];
+
+    int T = input_blob.h;
+    int size = input_blob.w;
+
+    // initial hidden state
+    Mat hidden(num_output, 4u, opt.workspace_allocator);
+    if (hidden.empty())
+        return -100;
+    hidden.fill(0.f);
+
+    // internal cell state
+    Mat cell(num_output, 4u, opt.workspace_allocator);
+    if (cell.empty())
+        return -100;
+    // 4 x num_output
+    Mat gates(4, num_output, 4u, opt.workspace_allocator);
+    if (gates.empty())
+        return -100;
+
+    Mat& top_blob = top_blobs[0];
+    top_blob.create(num_output, T, elemsize, opt.blob_allocator);
+    if (top_blob.empty())
+        return -100;
+
+    // unroll
+    for (int t=0; t<T; t++)
+    {
+        const int cont = ((const int*)cont_blob)[t];
+        const float* x = input_blob.row(t);
+
+        if (weight_bits)
+            lstm_gates_quantized_sse(x, hidden, cont != 0, weight_xc_data_quantized, weight_xc_data_quantize_scales, weight_hc_data_quantized, weight_hc_data_quantize_scales, weight_bits, bias_c_data, gates, size, num_output, opt);
+        else if (use_fp16_storage)
+            lstm_gates_sse(x, hidden, cont != 0, (const unsigned short*)weight_xc_data_fp16.data, (const unsigned short*)weight_hc_data_fp16.data, bias_c_data, gates, size, num_output, opt);
+        else
+            lstm_gates_sse(x, hidden, cont != 0, (const float*)weight_xc_data, (const float*)weight_hc_data, bias_c_data, gates, size, num_output, opt);
+
+        // lstm unit
+        // sigmoid(I)
+        // sigmoid(F)
+        // sigmoid(O)
+        // tanh(G)
+        // c_t := f_t .* c_{t-1} + i_t .* g_t
+        // h_t := o_t .* tanh[c_t]
+        float* output_data = top_blob.row(t);
+        for (int q=0; q<num_output; q++)
+        {
+            const float* gates_data = (const float*)gates + 4 * q;
+
+            float I = gates_data[0];
+            float F = gates_data[1];
+            float O = gates_data[2];
+            float G = gates_data[3];
+
+            I = 1.f / (1.f + exp(-I));
+            F = cont ? 1.f / (1.f + exp(-F)) : 0.f;
+            O = 1.f / (1.f + exp(-O));
+            G = tanh(G);
+
+            float cell2 = cont ? F * cell[q] + I * G : I * G;
+            float H = O * tanh(cell2);
+            cell[q] = cell2;
+            hidden[q] = H;
+            output_data[q] = H;
+        }
+    }
+
+    return 0;
+}
+
+} // namespace ncnn
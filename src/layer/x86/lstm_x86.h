@@ -0,0 +1,51 @@
+// Tencent is pleased to support the open source community by making ncnn available.
+//
+// Copyright (C) 2019 THL A29 Limited, a Tencent company. All rights reserved.
+//
+// Licensed under the BSD 3-Clause License (the "License"); you may not use this file except
+// in compliance with the License. You may obtain a copy of the License at
+//
+// https://opensource.org/licenses/BSD-3-Clause
+//
+// Unless required by applicable law or agreed to in writing, software distributed
+// under the License is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR
+// CONDITIONS OF ANY KIND, either express or implied. See the License for the
+// specific language governing permissions and limitations under the License.
+
+#ifndef LAYER_LSTM_X86_H
+#define LAYER_LSTM_X86_H
+
+#include "lstm.h"
+
+namespace ncnn {
+
+class LSTM_x86 : public LSTM
+{
+public:
+    LSTM_x86();
+
+    virtual int load_param(const ParamDict& pd);
+
+    virtual int load_model(const ModelBin& mb);
+
+    virtual int forward(const std::vector<Mat>& bottom_blobs, std::vector<Mat>& top_blobs, const Option& opt) const;
+
+public:
+    bool use_fp16_storage;
+
+    // half-precision weight, weight_xc_data and weight_hc_data are released when used
+    Mat weight_xc_data_fp16;
+    Mat weight_hc_data_fp16;
+
+    // weight-only quantization, 8 or 4 bits with one scale per gate row, 0 = off
+    // weight_xc_data and weight_hc_data are released when used
+    int weight_bits;
+    Mat weight_xc_data_quantized;
+    Mat weight_xc_data_quantize_scales;
+    Mat weight_hc_data_quantized;
+    Mat weight_hc_data_quantize_scales;
+};
+
+} // namespace ncnn
+
+#endif // LAYER_LSTM_X86_H
@@ -0,0 +1,167 @@
+// Tencent is pleased to support the open source community by making ncnn available.
+//
+// Copyright (C) 2019 THL A29 Limited, a Tencent company. All rights reserved.
+//
+// Licensed under the BSD 3-Clause License (the "License"); you may not use this file except
+// in compliance with the License. You may obtain a copy of the License at
+//
+// https://opensource.org/licenses/BSD-3-Clause
+//
+// Unless required by applicable law or agreed to in writing, software distributed
+// under the License is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR
+// CONDITIONS OF ANY KIND, either express or implied. See the License for the
+// specific language governing permissions and limitations under the License.
+
+#include "pooling_x86.h"
+#include <algorithm>
+
+#if __SSE2__
+#include <emmintrin.h>
+#if __F16C__
+#include <immintrin.h>
+#endif // __F16C__
+#endif // __SSE2__
+
+namespace ncnn {
+
+#include "float16_sse.h"
+
+DEFINE_LAYER_CREATOR(Pooling_x86)
+
+Pooling_x86::Pooling_x86()
+{
+    support_fp16_storage = true;
+}
+
+int Pooling_x86::forward(const Mat& bottom_blob, Mat& top_blob, const Option& opt) const
+{
+    if (bottom_blob.elemsize == 2u)
+        return forward_fp16(bottom_blob, top_blob, opt);
+
+    return Pooling::forward(bottom_blob, top_blob, opt);
+}
+
+// pool one channel staged in float32
+static int pooling_channel_fp16(const Pooling* op, const Mat& bottom_blob, int q, Mat& top_blob, const Option& opt)
+{
+    Option opt_q = opt;
+    opt_q.num_threads = 1;
+    opt_q.blob_allocator = opt.workspace_allocator;
+
+    Mat bottom_blob_q(bottom_blob.w, bottom_blob.h, 1, (size_t)4u, opt.workspace_allocator);
+    if (bottom_blob_q.empty())
+        return -100;
+
+    float16_to_float32_row(bottom_blob.channel(q), bottom_blob_q, bottom_blob.w * bottom_blob.h);
+
+    Mat top_blob_q;
+    int ret = op->Pooling::forward(bottom_blob_q, top_blob_q, opt_q);
+    if (ret != 0)
+        return ret;
+
+    if (top_blob.empty())
+    {
+        top_blob.create(top_blob_q.w, top_blob_q.h, bottom_blob.c, (size_t)2u, opt.blob_allocator);
+        if (top_blob.empty())
+            return -100;
+    }
+
+    float32_to_float16_row(top_blob_q, top_blob.channel(q), top_blob_q.w * top_blob_q.h);
+
+    return 0;
+}
+
+int Pooling_x86::forward_fp16(const Mat& bottom_blob, Mat& top_blob, const Option& opt) const
+{
+    int w = bottom_blob.w;
+    int h = bottom_blob.h;
+    int channels = bottom_blob.c;
+    size_t elemsize = bottom_blob.elemsize;
+    int size = w * h;
+
+    if (global_pooling)
+    {
+        top_blob.create(channels, elemsize, opt.blob_allocator);
+        if (top_blob.empty())
+            return -100;
+
+        unsigned short* outptr = top_blob;
+
+        #pragma omp parallel for num_threads(opt.num_threads)
+        for (int q=0; q<channels; q++)
+        {
+            const unsigned short* ptr = bottom_blob.channel(q);
+
+            float v = float16_to_float32(ptr[0]);
+
+            if (pooling_type == PoolMethod_MAX)
+            {
+                int i = 0;
+#if __SSE2__
+                __m128 _max = _mm_set1_ps(v);
+                for (; i+3<size; i+=4)
+                {
+                    _max = _mm_max_ps(_max, float16_to_float32_sse(ptr + i));
+                }
+
+                float maxs[4];
+                _mm_storeu_ps(maxs, _max);
+
+                v = std::max(std::max(maxs[0], maxs[1]), std::max(maxs[2], maxs[3]));
+#endif // __SSE2__
+                for (; i<size; i++)
+                {
+                    v = std::max(v, float16_to_float32(ptr[i]));
+                }
+            }
+            else if (pooling_type == PoolMethod_AVE)
+            {
+                float sum = 0.f;
+
+                int i = 0;
+#if __SSE2__
+                __m128 _sum = _mm_setzero_ps();
+                for (; i+3<size; i+=4)
+                {
+                    _sum = _mm_add_ps(_sum, float16_to_float32_sse(ptr + i));
+                }
+
+                float sums[4];
+                _mm_storeu_ps(sums, _sum);
+
+                sum = (sums[0] + sums[1]) + (sums[2] + sums[3]);
+#endif // __SSE2__
+                for (; i<size; i++)
+                {
+                    sum += float16_to_float32(ptr[i]);
+                }
+
+                v = sum / size;
+            }
+
+            outptr[q] = float32_to_float16(v);
+        }
+
+        return 0;
+    }
+
+    // every channel is widened to float32 in cache and pooled by the reference kernel
+    // the first channel decides the output shape
+    top_blob.release();
+
+    int ret = pooling_channel_fp16(this, bottom_blob, 0, top_blob, opt);
+    if (ret != 0)
+        return ret;
+
+    #pragma omp parallel for num_threads(opt.num_threads)
+    for (int q=1; q<channels; q++)
+    {
+        int ret_q = pooling_channel_fp16(this, bottom_blob, q, top_blob, opt);
+        if (ret_q != 0)
+            ret = ret_q;
+    }
+
+    return ret;
+}
+
+} // namespace ncnn
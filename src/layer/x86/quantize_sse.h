@@ -0,0 +1,115 @@
+// Tencent is pleased to support the open source community by making ncnn available.
+//
+// Copyright (C) 2019 THL A29 Limited, a Tencent company. All rights reserved.
+//
+// Licensed under the BSD 3-Clause License (the "License"); you may not use this file except
+// in compliance with the License. You may obtain a copy of the License at
+//
+// https://opensource.org/licenses/BSD-3-Clause
+//
+// Unless required by applicable law or agreed to in writing, software distributed
+// under the License is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR
+// CONDITIONS OF ANY KIND, either express or implied. See the License for the
+// specific language governing permissions and limitations under the License.
+
+// float32 <-> int8 activation rows shared by the quantize, dequantize, requantize and eltwise layers
+// rounding is half away from zero and saturates to [-128, 127], the same as the reference layers
+
+static inline signed char float2int8(float v)
+{
+    int int32 = round(v);
+    if (int32 > 127) return 127;
+    if (int32 < -128) return -128;
+    return (signed char)int32;
+}
+
+#if __SSE2__
+// 8 float32 to 8 int8 in the low half
+static inline __m128i float2int8_sse(__m128 _v0, __m128 _v1)
+{
+    const __m128 _min = _mm_set1_ps(-128.f);
+    const __m128 _max = _mm_set1_ps(127.f);
+    const __m128 _half = _mm_set1_ps(0.5f);
+    const __m128 _signmask = _mm_castsi128_ps(_mm_set1_epi32(0x80000000));
+
+    // clamp first so the truncation never overflows
+    _v0 = _mm_min_ps(_mm_max_ps(_v0, _min), _max);
+    _v1 = _mm_min_ps(_mm_max_ps(_v1, _min), _max);
+    _v0 = _mm_add_ps(_v0, _mm_or_ps(_mm_and_ps(_v0, _signmask), _half));
+    _v1 = _mm_add_ps(_v1, _mm_or_ps(_mm_and_ps(_v1, _signmask), _half));
+
+    __m128i _q16 = _mm_packs_epi32(_mm_cvttps_epi32(_v0), _mm_cvttps_epi32(_v1));
+    return _mm_packs_epi16(_q16, _q16);
+}
+#endif // __SSE2__
+
+// outptr = int8(ptr * scale + zero_point)
+static void quantize_row_sse(const float* ptr, signed char* outptr, float scale, int zero_point, int size)
+{
+    int i = 0;
+#if __SSE2__
+    __m128 _scale = _mm_set1_ps(scale);
+    __m128 _zero_point = _mm_set1_ps((float)zero_point);
+    for (; i+7<size; i+=8)
+    {
+        __m128 _v0 = _mm_add_ps(_mm_mul_ps(_mm_loadu_ps(ptr + i), _scale), _zero_point);
+        __m128 _v1 = _mm_add_ps(_mm_mul_ps(_mm_loadu_ps(ptr + i + 4), _scale), _zero_point);
+
+        _mm_storel_epi64((__m128i*)(outptr + i), float2int8_sse(_v0, _v1));
+    }
+#endif // __SSE2__
+    for (; i<size; i++)
+    {
+        outptr[i] = float2int8(ptr[i] * scale + zero_point);
+    }
+}
+
+// ptr = intptr * scale + bias, ptr may alias intptr
+static void dequantize_row_sse(const int* intptr, float* ptr, float scale, float bias, int size)
+{
+    int i = 0;
+#if __SSE2__
+    __m128 _scale = _mm_set1_ps(scale);
+    __m128 _bias = _mm_set1_ps(bias);
+    for (; i+3<size; i+=4)
+    {
+        __m128 _v = _mm_cvtepi32_ps(_mm_loadu_si128((const __m128i*)(intptr + i)));
+        _mm_storeu_ps(ptr + i, _mm_add_ps(_mm_mul_ps(_v, _scale), _bias));
+    }
+#endif // __SSE2__
+    for (; i<size; i++)
+    {
+        ptr[i] = intptr[i] * scale + bias;
+    }
+}
+
+// outptr = int8((intptr * scale_in + bias) * scale_out + zero_point)
+// relu clamps at the zero point, which is where the real value crosses zero
+static void requantize_row_sse(const int* intptr, signed char* outptr, float scale_in, float bias, float scale_out, int zero_point, bool relu, int size)
+{
+    int i = 0;
+#if __SSE2__
+    __m128 _scale_in = _mm_set1_ps(scale_in);
+    __m128 _bias = _mm_set1_ps(bias);
+    __m128 _scale_out = _mm_set1_ps(scale_out);
+    __m128 _zero_point = _mm_set1_ps((float)zero_point);
+    __m128 _low = _mm_set1_ps(relu ? (float)zero_point : -FLT_MAX);
+    for (; i+7<size; i+=8)
+    {
+        __m128 _v0 = _mm_cvtepi32_ps(_mm_loadu_si128((const __m128i*)(intptr + i)));
+        __m128 _v1 = _mm_cvtepi32_ps(_mm_loadu_si128((const __m128i*)(intptr + i + 4)));
+        _v0 = _mm_add_ps(_mm_mul_ps(_mm_add_ps(_mm_mul_ps(_v0, _scale_in), _bias), _scale_out), _zero_point);
+        _v1 = _mm_add_ps(_mm_mul_ps(_mm_add_ps(_mm_mul_ps(_v1, _scale_in), _bias), _scale_out), _zero_point);
+        _v0 = _mm_max_ps(_v0, _low);
+        _v1 = _mm_max_ps(_v1, _low);
+
+        _mm_storel_epi64((__m128i*)(outptr + i), float2int8_sse(_v0, _v1));
+    }
+#endif // __SSE2__
+    for (; i<size; i++)
+    {
+        outptr[i] = float2int8(((intptr[i] * scale_in) + bias) * scale_out + zero_point);
+        if (relu && outptr[i] < zero_point)
+            outptr[i] = zero_point;
+    }
+}
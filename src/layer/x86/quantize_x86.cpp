@@ -0,0 +1,104 @@
+// Tencent is pleased to support the open source community by making ncnn available.
+//
+// Copyright (C) 2019 THL A29 Limited, a Tencent company. All rights reserved.
+//
+// Licensed under the BSD 3-Clause License (the "License"); you may not use this file except
+// in compliance with the License. You may obtain a copy of the License at
+//
+// https://opensource.org/licenses/BSD-3-Clause
+//
+// Unless required by applicable law or agreed to in writing, software distributed
+// under the License is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR
+// CONDITIONS OF ANY KIND, either express or implied. See the License for the
+// specific language governing permissions and limitations under the License.
+
+#include "quantize_x86.h"
+
+#include <algorithm>
+#include <float.h>
+#include <math.h>
+
+#if __SSE2__
+#include <emmintrin.h>
+#endif // __SSE2__
+
+namespace ncnn {
+
+#include "quantize_sse.h"
+
+DEFINE_LAYER_CREATOR(Quantize_x86)
+
+int Quantize_x86::forward(const Mat& bottom_blob, Mat& top_blob, const Option& opt) const
+{
+    int dims = bottom_blob.dims;
+
+    // per-element scales are rare, leave them to the reference path
+    if (dims == 1 && !scales.empty())
+        return Quantize::forward(bottom_blob, top_blob, opt);
+
+    if (dims == 1)
+    {
+        int w = bottom_blob.w;
+
+        top_blob.create(w, (size_t)1u, opt.blob_allocator);
+        if (top_blob.empty())
+            return -100;
+
+        const float* ptr = bottom_blob;
+        signed char* outptr = top_blob;
+
+        // split into 64-element chunks so every thread gets whole sse blocks
+        int nn = (w + 63) / 64;
+
+        #pragma omp parallel for num_threads(opt.num_threads)
+        for (int ii=0; ii<nn; ii++)
+        {
+            int i = ii * 64;
+            int n = std::min(64, w - i);
+
+            quantize_row_sse(ptr + i, outptr + i, scale, zero_point, n);
+        }
+    }
+
+    if (dims == 2)
+    {
+        int w = bottom_blob.w;
+        int h = bottom_blob.h;
+
+        top_blob.create(w, h, (size_t)1u, opt.blob_allocator);
+        if (top_blob.empty())
+            return -100;
+
+        #pragma omp parallel for num_threads(opt.num_threads)
+        for (int i=0; i<h; i++)
+        {
+            float s = scales.empty() ? scale : scales[i];
+
+            quantize_row_sse(bottom_blob.row(i), top_blob.row<signed char>(i), s, zero_point, w);
+        }
+    }
+
+    if (dims == 3)
+    {
+        int w = bottom_blob.w;
+        int h = bottom_blob.h;
+        int channels = bottom_blob.c;
+        int size = w * h;
+
+        top_blob.create(w, h, channels, (size_t)1u, opt.blob_allocator);
+        if (top_blob.empty())
+            return -100;
+
+        #pragma omp parallel for num_threads(opt.num_threads)
+        for (int q=0; q<channels; q++)
+        {
+            float s = scales.empty() ? scale : scales[q];
+
+            quantize_row_sse(bottom_blob.channel(q), top_blob.channel(q), s, zero_point, size);
+        }
+    }
+
+    return 0;
+}
+
+} // namespace ncnn
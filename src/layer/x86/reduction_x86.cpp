@@ -0,0 +1,340 @@
+// Tencent is pleased to support the open source community by making ncnn available.
+//
+// Copyright (C) 2019 THL A29 Limited, a Tencent company. All rights reserved.
+//
+// Licensed under the BSD 3-Clause License (the "License"); you may not use this file except
+// in compliance with the License. You may obtain a copy of the License at
+//
+// https://opensource.org/licenses/BSD-3-Clause
+//
+// Unless required by applicable law or agreed to in writing, software distributed
+// under the License is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR
+// CONDITIONS OF ANY KIND, either express or implied. See the License for the
+// specific language governing permissions and limitations under the License.
+
+#include "reduction_x86.h"
+#include <float.h>
+#include <math.h>
+#include <algorithm>
+
+#if __SSE2__
+#include <emmintrin.h>
+#endif // __SSE2__
+
+namespace ncnn {
+
+DEFINE_LAYER_CREATOR(Reduction_x86)
+
+struct reduction_op_add
+{
+    float operator() (const float& x, const float& y) const { return x + y; }
+#if __SSE2__
+    __m128 operator() (const __m128& x, const __m128& y) const { return _mm_add_ps(x, y); }
+#endif // __SSE2__
+};
+
+struct reduction_op_asum
+{
+    float operator() (const float& x, const float& y) const { return x + fabs(y); }
+#if __SSE2__
+    __m128 operator() (const __m128& x, const __m128& y) const { return _mm_add_ps(x, _mm_and_ps(y, _mm_castsi128_ps(_mm_set1_epi32(0x7fffffff)))); }
+#endif // __SSE2__
+};
+
+struct reduction_op_sumsq
+{
+    float operator() (const float& x, const float& y) const { return x + y * y; }
+#if __SSE2__
+    __m128 operator() (const __m128& x, const __m128& y) const { return _mm_add_ps(x, _mm_mul_ps(y, y)); }
+#endif // __SSE2__
+};
+
+struct reduction_op_max
+{
+    float operator() (const float& x, const float& y) const { return std::max(x, y); }
+#if __SSE2__
+    __m128 operator() (const __m128& x, const __m128& y) const { return _mm_max_ps(x, y); }
+#endif // __SSE2__
+};
+
+struct reduction_op_min
+{
+    float operator() (const float& x, const float& y) const { return std::min(x, y); }
+#if __SSE2__
+    __m128 operator() (const __m128& x, const __m128& y) const { return _mm_min_ps(x, y); }
+#endif // __SSE2__
+};
+
+struct reduction_op_mul
+{
+    float operator() (const float& x, const float& y) const { return x * y; }
+#if __SSE2__
+    __m128 operator() (const __m128& x, const __m128& y) const { return _mm_mul_ps(x, y); }
+#endif // __SSE2__
+};
+
+// reduce a contiguous run into a single value
+// eight independent lanes, folded pairwise with op2 at the end
+template<typename Op, typename Op2>
+static float reduction_contiguous(const float* ptr, int size, float v0)
+{
+    Op op;
+    Op2 op2;
+
+    float sum = v0;
+
+    int i = 0;
+#if __SSE2__
+    if (size >= 4)
+    {
+        __m128 _sum0 = _mm_set1_ps(v0);
+        __m128 _sum1 = _mm_set1_ps(v0);
+        for (; i+7<size; i+=8)
+        {
+            _sum0 = op(_sum0, _mm_loadu_ps(ptr + i));
+            _sum1 = op(_sum1, _mm_loadu_ps(ptr + i + 4));
+        }
+        for (; i+3<size; i+=4)
+        {
+            _sum0 = op(_sum0, _mm_loadu_ps(ptr + i));
+        }
+
+        _sum0 = op2(_sum0, _sum1);
+
+        float sums[4];
+        _mm_storeu_ps(sums, _sum0);
+
+        sum = op2(op2(sums[0], sums[1]), op2(sums[2], sums[3]));
+    }
+#endif // __SSE2__
+    for (; i<size; i++)
+    {
+        sum = op(sum, ptr[i]);
+    }
+
+    return sum;
+}
+
+// outptr[i] = op(outptr[i], ptr[i])
+template<typename Op>
+static void reduction_elementwise(const float* ptr, float* outptr, int size)
+{
+    Op op;
+
+    int i = 0;
+#if __SSE2__
+    for (; i+3<size; i+=4)
+    {
+        _mm_storeu_ps(outptr + i, op(_mm_loadu_ps(outptr + i), _mm_loadu_ps(ptr + i)));
+    }
+#endif // __SSE2__
+    for (; i<size; i++)
+    {
+        outptr[i] = op(outptr[i], ptr[i]);
+    }
+}
+
+static void reduction_scale(float* ptr, int size, float coeff)
+{
+    for (int i=0; i<size; i++)
+    {
+        ptr[i] *= coeff;
+    }
+}
+
+template<typename Op, typename Op2>
+static int reduction_op(const Mat& a, Mat& b, float v0, int dim, float coeff, const Option& opt)
+{
+    Op2 op2;
+
+    int w = a.w;
+    int h = a.h;
+    int channels = a.c;
+    size_t elemsize = a.elemsize;
+    int size = w * h;
+
+    if (dim == 0)
+    {
+        // w h c -> X X X
+        b.create(1, elemsize, opt.blob_allocator);
+    }
+    else if (dim == 1)
+    {
+        // w h c -> X X c
+        b.create(channels, elemsize, opt.blob_allocator);
+    }
+    else if (dim == 2)
+    {
+        // w h c -> X h c
+        b.create(h, channels, elemsize, opt.blob_allocator);
+    }
+    else if (dim == -1)
+    {
+        // w h c -> w X X
+        b.create(w, elemsize, opt.blob_allocator);
+    }
+    else if (dim == -2)
+    {
+        // w h c -> w h X
+        b.create(w, h, elemsize, opt.blob_allocator);
+    }
+    if (b.empty())
+        return -100;
+
+    if (dim == 0)
+    {
+        Mat sums(channels, elemsize, opt.workspace_allocator);
+        if (sums.empty())
+            return -100;
+
+        #pragma omp parallel for num_threads(opt.num_threads)
+        for (int q=0; q<channels; q++)
+        {
+            const float* ptr = a.channel(q);
+
+            sums[q] = reduction_contiguous<Op, Op2>(ptr, size, v0);
+        }
+
+        float sum = v0;
+        for (int i=0; i<channels; i++)
+        {
+            sum = op2(sum, sums[i]);
+        }
+
+        b[0] = sum * coeff;
+    }
+    else if (dim == 1)
+    {
+        #pragma omp parallel for num_threads(opt.num_threads)
+        for (int q=0; q<channels; q++)
+        {
+            const float* ptr = a.channel(q);
+
+            b[q] = reduction_contiguous<Op, Op2>(ptr, size, v0) * coeff;
+        }
+    }
+    else if (dim == 2)
+    {
+        #pragma omp parallel for num_threads(opt.num_threads)
+        for (int q=0; q<channels; q++)
+        {
+            const float* ptr = a.channel(q);
+            float* outptr = b.row(q);
+
+            for (int i=0; i<h; i++)
+            {
+                outptr[i] = reduction_contiguous<Op, Op2>(ptr, w, v0) * coeff;
+
+                ptr += w;
+            }
+        }
+    }
+    else if (dim == -1)
+    {
+        Mat mins(w, 1, channels, elemsize, opt.workspace_allocator);
+        if (mins.empty())
+            return -100;
+
+        mins.fill(v0);
+
+        #pragma omp parallel for num_threads(opt.num_threads)
+        for (int q=0; q<channels; q++)
+        {
+            const float* ptr = a.channel(q);
+            float* mins_ptr = mins.channel(q);
+
+            for (int i=0; i<h; i++)
+            {
+                reduction_elementwise<Op>(ptr, mins_ptr, w);
+
+                ptr += w;
+            }
+        }
+
+        b.fill(v0);
+
+        for (int q=0; q<channels; q++)
+        {
+            reduction_elementwise<Op2>(mins.channel(q), b, w);
+        }
+
+        reduction_scale(b, w, coeff);
+    }
+    else if (dim == -2)
+    {
+        b.fill(v0);
+
+        // every thread owns a slice of the output plane
+        const int nn_size = ((size + opt.num_threads - 1) / opt.num_threads + 3) / 4 * 4;
+        const int nn = (size + nn_size - 1) / nn_size;
+
+        #pragma omp parallel for num_threads(opt.num_threads)
+        for (int ii=0; ii<nn; ii++)
+        {
+            const int i = ii * nn_size;
+            const int n = std::min(nn_size, size - i);
+
+            float* outptr = (float*)b + i;
+
+            for (int q=0; q<channels; q++)
+            {
+                reduction_elementwise<Op>((const float*)a.channel(q) + i, outptr, n);
+            }
+
+            reduction_scale(outptr, n, coeff);
+        }
+    }
+
+    return 0;
+}
+
+int Reduction_x86::forward(const Mat& bottom_blob, Mat& top_blob, const Option& opt) const
+{
+    if (bottom_blob.elemsize != 4)
+        return Reduction::forward(bottom_blob, top_blob, opt);
+
+    if (operation == ReductionOp_SUM)
+        return reduction_op<reduction_op_add, reduction_op_add>(bottom_blob, top_blob, 0.f, dim, coeff, opt);
+
+    if (operation == ReductionOp_ASUM)
+        return reduction_op<reduction_op_asum, reduction_op_add>(bottom_blob, top_blob, 0.f, dim, coeff, opt);
+
+    if (operation == ReductionOp_SUMSQ)
+        return reduction_op<reduction_op_sumsq, reduction_op_add>(bottom_blob, top_blob, 0.f, dim, coeff, opt);
+
+    if (operation == ReductionOp_MEAN)
+    {
+        int w = bottom_blob.w;
+        int h = bottom_blob.h;
+        int channels = bottom_blob.c;
+        int size = w * h;
+
+        // fold the element count into coeff
+        int count = 1;
+        if (dim == 0)
+            count = channels * size;
+        else if (dim == 1)
+            count = size;
+        else if (dim == 2)
+            count = w;
+        else if (dim == -1)
+            count = h * channels;
+        else if (dim == -2)
+            count = channels;
+
+        return reduction_op<reduction_op_add, reduction_op_add>(bottom_blob, top_blob, 0.f, dim, coeff / count, opt);
+    }
+
+    if (operation == ReductionOp_MAX)
+        return reduction_op<reduction_op_max, reduction_op_max>(bottom_blob, top_blob, -FLT_MAX, dim, coeff, opt);
+
+    if (operation == ReductionOp_MIN)
+        return reduction_op<reduction_op_min, reduction_op_min>(bottom_blob, top_blob, FLT_MAX, dim, coeff, opt);
+
+    if (operation == ReductionOp_PROD)
+        return reduction_op<reduction_op_mul, reduction_op_mul>(bottom_blob, top_blob, 1.f, dim, coeff, opt);
+
+    return 0;
+}
+
+} // namespace ncnn
@@ -0,0 +1,143 @@
+// Tencent is pleased to support the open source community by making ncnn available.
+//
+// Copyright (C) 2019 THL A29 Limited, a Tencent company. All rights reserved.
+//
+// Licensed under the BSD 3-Clause License (the "License"); you may not use this file except
+// in compliance with the License. You may obtain a copy of the License at
+//
+// https://opensource.org/licenses/BSD-3-Clause
+//
+// Unless required by applicable law or agreed to in writing, software distributed
+// under the License is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR
+// CONDITIONS OF ANY KIND, either express or implied. See the License for the
+// specific language governing permissions and limitations under the License.
+
+#include "relu_x86.h"
+
+#if __SSE2__
+#include <emmintrin.h>
+#if __F16C__
+#include <immintrin.h>
+#endif // __F16C__
+#endif // __SSE2__
+
+namespace ncnn {
+
+#include "float16_sse.h"
+
+DEFINE_LAYER_CREATOR(ReLU_x86)
+
+ReLU_x86::ReLU_x86()
+{
+    support_fp16_storage = true;
+}
+
+int ReLU_x86::forward_inplace(Mat& bottom_top_blob, const Option& opt) const
+{
+    if (bottom_top_blob.elemsize == 2u)
+        return forward_inplace_fp16(bottom_top_blob, opt);
+
+    if (bottom_top_blob.elemsize == 1u)
+        return forward_inplace_int8(bottom_top_blob, opt);
+
+    return ReLU::forward_inplace(bottom_top_blob, opt);
+}
+
+int ReLU_x86::forward_inplace_int8(Mat& bottom_top_blob, const Option& opt) const
+{
+    if (slope != 0.f)
+        return ReLU::forward_inplace_int8(bottom_top_blob, opt);
+
+    int w = bottom_top_blob.w;
+    int h = bottom_top_blob.h;
+    int channels = bottom_top_blob.c;
+    int size = w * h;
+
+    #pragma omp parallel for num_threads(opt.num_threads)
+    for (int q=0; q<channels; q++)
+    {
+        signed char* ptr = bottom_top_blob.channel(q);
+
+        int i = 0;
+#if __SSE2__
+        const __m128i _zero = _mm_setzero_si128();
+        for (; i+15<size; i+=16)
+        {
+            __m128i _p = _mm_loadu_si128((const __m128i*)(ptr + i));
+            _p = _mm_andnot_si128(_mm_cmplt_epi8(_p, _zero), _p);
+            _mm_storeu_si128((__m128i*)(ptr + i), _p);
+        }
+#endif // __SSE2__
+        for (; i<size; i++)
+        {
+            if (ptr[i] < 0)
+                ptr[i] = 0;
+        }
+    }
+
+    return 0;
+}
+
+int ReLU_x86::forward_inplace_fp16(Mat& bottom_top_blob, const Option& opt) const
+{
+    int w = bottom_top_blob.w;
+    int h = bottom_top_blob.h;
+    int channels = bottom_top_blob.c;
+    int size = w * h;
+
+    if (slope == 0.f)
+    {
+        // clear every value with the sign bit set, no conversion needed
+        #pragma omp parallel for num_threads(opt.num_threads)
+        for (int q=0; q<channels; q++)
+        {
+            unsigned short* ptr = bottom_top_blob.channel(q);
+
+            int i = 0;
+#if __SSE2__
+            for (; i+7<size; i+=8)
+            {
+                __m128i _p = _mm_loadu_si128((const __m128i*)(ptr + i));
+                _p = _mm_andnot_si128(_mm_srai_epi16(_p, 15), _p);
+                _mm_storeu_si128((__m128i*)(ptr + i), _p);
+            }
+#endif // __SSE2__
+            for (; i<size; i++)
+            {
+                if (ptr[i] & 0x8000)
+                    ptr[i] = 0;
+            }
+        }
+    }
+    else
+    {
+        #pragma omp parallel for num_threads(opt.num_threads)
+        for (int q=0; q<channels; q++)
+        {
+            unsigned short* ptr = bottom_top_blob.channel(q);
+
+            int i = 0;
+#if __SSE2__
+            __m128 _zero = _mm_setzero_ps();
+            __m128 _slope = _mm_set1_ps(slope);
+            for (; i+3<size; i+=4)
+            {
+                __m128 _p = float16_to_float32_sse(ptr + i);
+                __m128 _pos = _mm_max_ps(_p, _zero);
+                __m128 _neg = _mm_min_ps(_p, _zero);
+                float32_to_float16_sse(ptr + i, _mm_add_ps(_pos, _mm_mul_ps(_slope, _neg)));
+            }
+#endif // __SSE2__
+            for (; i<size; i++)
+            {
+                float v = float16_to_float32(ptr[i]);
+                if (v < 0)
+                    ptr[i] = float32_to_float16(v * slope);
+            }
+        }
+    }
+
+    return 0;
+}
+
+} // namespace ncnn
@@ -0,0 +1,392 @@
+// Tencent is pleased to support the open source community by making ncnn available.
+//
+// Copyright (C) 2019 THL A29 Limited, a Tencent company. All rights reserved.
+//
+// Licensed under the BSD 3-Clause License (the "License"); you may not use this file except
+// in compliance with the License. You may obtain a copy of the License at
+//
+// https://opensource.org/licenses/BSD-3-Clause
+//
+// Unless required by applicable law or agreed to in writing, software distributed
+// under the License is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR
+// CONDITIONS OF ANY KIND, either express or implied. See the License for the
+// specific language governing permissions and limitations under the License.
+
+#include "softmax_x86.h"
+#include <float.h>
+#include <math.h>
+#include <algorithm>
+
+#if __SSE2__
+#include <emmintrin.h>
+#define USE_SSE2
+#include "sse_mathfun.h"
+#endif // __SSE2__
+
+namespace ncnn {
+
+DEFINE_LAYER_CREATOR(Softmax_x86)
+
+static float softmax_max(const float* ptr, int size)
+{
+    float max = -FLT_MAX;
+
+    int i = 0;
+#if __SSE2__
+    if (size >= 4)
+    {
+        __m128 _max = _mm_set1_ps(-FLT_MAX);
+        for (; i+3<size; i+=4)
+        {
+            _max = _mm_max_ps(_max, _mm_loadu_ps(ptr + i));
+        }
+
+        float maxs[4];
+        _mm_storeu_ps(maxs, _max);
+
+        max = std::max(std::max(maxs[0], maxs[1]), std::max(maxs[2], maxs[3]));
+    }
+#endif // __SSE2__
+    for (; i<size; i++)
+    {
+        max = std::max(max, ptr[i]);
+    }
+
+    return max;
+}
+
+// value = exp(value - max), returns the sum
+static float softmax_exp_sum(float* ptr, int size, float max)
+{
+    float sum = 0.f;
+
+    int i = 0;
+#if __SSE2__
+    __m128 _max = _mm_set1_ps(max);
+    __m128 _sum = _mm_setzero_ps();
+    for (; i+3<size; i+=4)
+    {
+        __m128 _p = exp_ps(_mm_sub_ps(_mm_loadu_ps(ptr + i), _max));
+        _mm_storeu_ps(ptr + i, _p);
+        _sum = _mm_add_ps(_sum, _p);
+    }
+
+    float sums[4];
+    _mm_storeu_ps(sums, _sum);
+
+    sum = (sums[0] + sums[1]) + (sums[2] + sums[3]);
+#endif // __SSE2__
+    for (; i<size; i++)
+    {
+        ptr[i] = exp(ptr[i] - max);
+        sum += ptr[i];
+    }
+
+    return sum;
+}
+
+static void softmax_scale(float* ptr, int size, float scale)
+{
+    int i = 0;
+#if __SSE2__
+    __m128 _scale = _mm_set1_ps(scale);
+    for (; i+3<size; i+=4)
+    {
+        _mm_storeu_ps(ptr + i, _mm_mul_ps(_mm_loadu_ps(ptr + i), _scale));
+    }
+#endif // __SSE2__
+    for (; i<size; i++)
+    {
+        ptr[i] *= scale;
+    }
+}
+
+static void softmax_row(float* ptr, int size)
+{
+    float max = softmax_max(ptr, size);
+
+    float sum = softmax_exp_sum(ptr, size, max);
+
+    softmax_scale(ptr, size, 1.f / sum);
+}
+
+// the same three steps for many softmax at once, one per column
+static void softmax_max_columns(const float* ptr, float* maxptr, int size)
+{
+    int i = 0;
+#if __SSE2__
+    for (; i+3<size; i+=4)
+    {
+        _mm_storeu_ps(maxptr + i, _mm_max_ps(_mm_loadu_ps(maxptr + i), _mm_loadu_ps(ptr + i)));
+    }
+#endif // __SSE2__
+    for (; i<size; i++)
+    {
+        maxptr[i] = std::max(maxptr[i], ptr[i]);
+    }
+}
+
+static void softmax_exp_sum_columns(float* ptr, const float* maxptr, float* sumptr, int size)
+{
+    int i = 0;
+#if __SSE2__
+    for (; i+3<size; i+=4)
+    {
+        __m128 _p = exp_ps(_mm_sub_ps(_mm_loadu_ps(ptr + i), _mm_loadu_ps(maxptr + i)));
+        _mm_storeu_ps(ptr + i, _p);
+        _mm_storeu_ps(sumptr + i, _mm_add_ps(_mm_loadu_ps(sumptr + i), _p));
+    }
+#endif // __SSE2__
+    for (; i<size; i++)
+    {
+        ptr[i] = exp(ptr[i] - maxptr[i]);
+        sumptr[i] += ptr[i];
+    }
+}
+
+static void softmax_scale_columns(float* ptr, const float* scaleptr, int size)
+{
+    int i = 0;
+#if __SSE2__
+    for (; i+3<size; i+=4)
+    {
+        _mm_storeu_ps(ptr + i, _mm_mul_ps(_mm_loadu_ps(ptr + i), _mm_loadu_ps(scaleptr + i)));
+    }
+#endif // __SSE2__
+    for (; i<size; i++)
+    {
+        ptr[i] *= scaleptr[i];
+    }
+}
+
+static void softmax_reciprocal(float* ptr, int size)
+{
+    for (int i=0; i<size; i++)
+    {
+        ptr[i] = 1.f / ptr[i];
+    }
+}
+
+// softmax across rows, every column is normalized independently
+// columns are split into blocks so that the reductions run in parallel too
+static int softmax_columns(Mat& bottom_top_blob, int size, int rows, size_t rowstep, const Option& opt)
+{
+    Mat max;
+    max.create(size, (size_t)4u, opt.workspace_allocator);
+    if (max.empty())
+        return -100;
+    max.fill(-FLT_MAX);
+
+    Mat sum;
+    sum.create(size, (size_t)4u, opt.workspace_allocator);
+    if (sum.empty())
+        return -100;
+    sum.fill(0.f);
+
+    float* ptr = bottom_top_blob;
+    float* maxptr = max;
+    float* sumptr = sum;
+
+    const int nn_size = ((size + opt.num_threads - 1) / opt.num_threads + 3) / 4 * 4;
+    const int nn = (size + nn_size - 1) / nn_size;
+
+    #pragma omp parallel for num_threads(opt.num_threads)
+    for (int ii=0; ii<nn; ii++)
+    {
+        const int i = ii * nn_size;
+        const int n = std::min(nn_size, size - i);
+
+        for (int q=0; q<rows; q++)
+        {
+            softmax_max_columns(ptr + rowstep * q + i, maxptr + i, n);
+        }
+
+        for (int q=0; q<rows; q++)
+        {
+            softmax_exp_sum_columns(ptr + rowstep * q + i, maxptr + i, sumptr + i, n);
+        }
+
+        softmax_reciprocal(sumptr + i, n);
+    }
+
+    #pragma omp parallel for num_threads(opt.num_threads)
+    for (int q=0; q<rows; q++)
+    {
+        softmax_scale_columns(ptr + rowstep * q, sumptr, size);
+    }
+
+    return 0;
+}
+
+int Softmax_x86::forward_inplace(Mat& bottom_top_blob, const Option& opt) const
+{
+    // value = exp( value - global max value )
+    // sum all value
+    // value = value * (1 / sum)
+
+    int dims = bottom_top_blob.dims;
+    size_t elemsize = bottom_top_blob.elemsize;
+
+    if (elemsize != 4)
+        return Softmax::forward_inplace(bottom_top_blob, opt);
+
+    if (dims == 1) // axis == 0
+    {
+        int w = bottom_top_blob.w;
+
+        float* ptr = bottom_top_blob;
+
+        // long vectors are split into blocks, partial max and sum are merged
+        const int nn_size = std::max(((w + opt.num_threads - 1) / opt.num_threads + 3) / 4 * 4, 4096);
+        const int nn = (w + nn_size - 1) / nn_size;
+
+        if (nn == 1)
+        {
+            softmax_row(ptr, w);
+            return 0;
+        }
+
+        Mat partial;
+        partial.create(nn, (size_t)4u, opt.workspace_allocator);
+        if (partial.empty())
+            return -100;
+
+        #pragma omp parallel for num_threads(opt.num_threads)
+        for (int ii=0; ii<nn; ii++)
+        {
+            const int i = ii * nn_size;
+            partial[ii] = softmax_max(ptr + i, std::min(nn_size, w - i));
+        }
+
+        const float max = softmax_max(partial, nn);
+
+        #pragma omp parallel for num_threads(opt.num_threads)
+        for (int ii=0; ii<nn; ii++)
+        {
+            const int i = ii * nn_size;
+            partial[ii] = softmax_exp_sum(ptr + i, std::min(nn_size, w - i), max);
+        }
+
+        float sum = 0.f;
+        for (int ii=0; ii<nn; ii++)
+        {
+            sum += partial[ii];
+        }
+
+        const float scale = 1.f / sum;
+
+        #pragma omp parallel for num_threads(opt.num_threads)
+        for (int ii=0; ii<nn; ii++)
+        {
+            const int i = ii * nn_size;
+            softmax_scale(ptr + i, std::min(nn_size, w - i), scale);
+        }
+
+        return 0;
+    }
+
+    if (dims == 2 && axis == 0)
+    {
+        int w = bottom_top_blob.w;
+        int h = bottom_top_blob.h;
+
+        return softmax_columns(bottom_top_blob, w, h, w, opt);
+    }
+
+    if (dims == 2 && axis == 1)
+    {
+        int w = bottom_top_blob.w;
+        int h = bottom_top_blob.h;
+
+        #pragma omp parallel for num_threads(opt.num_threads)
+        for (int i=0; i<h; i++)
+        {
+            float* ptr = bottom_top_blob.row(i);
+
+            softmax_row(ptr, w);
+        }
+
+        return 0;
+    }
+
+    if (dims == 3 && axis == 0)
+    {
+        int w = bottom_top_blob.w;
+        int h = bottom_top_blob.h;
+        int channels = bottom_top_blob.c;
+
+        return softmax_columns(bottom_top_blob, w * h, channels, bottom_top_blob.cstep, opt);
+    }
+
+    if (dims == 3 && axis == 1)
+    {
+        int w = bottom_top_blob.w;
+        int h = bottom_top_blob.h;
+        int channels = bottom_top_blob.c;
+
+        Mat max;
+        max.create(w, channels, elemsize, opt.workspace_allocator);
+        if (max.empty())
+            return -100;
+        max.fill(-FLT_MAX);
+
+        Mat sum;
+        sum.create(w, channels, elemsize, opt.workspace_allocator);
+        if (sum.empty())
+            return -100;
+        sum.fill(0.f);
+
+        #pragma omp parallel for num_threads(opt.num_threads)
+        for (int q=0; q<channels; q++)
+        {
+            float* ptr = bottom_top_blob.channel(q);
+            float* maxptr = max.row(q);
+            float* sumptr = sum.row(q);
+
+            for (int i=0; i<h; i++)
+            {
+                softmax_max_columns(ptr + w * i, maxptr, w);
+            }
+
+            for (int i=0; i<h; i++)
+            {
+                softmax_exp_sum_columns(ptr + w * i, maxptr, sumptr, w);
+            }
+
+            softmax_reciprocal(sumptr, w);
+
+            for (int i=0; i<h; i++)
+            {
+                softmax_scale_columns(ptr + w * i, sumptr, w);
+            }
+        }
+
+        return 0;
+    }
+
+    if (dims == 3 && axis == 2)
+    {
+        int w = bottom_top_blob.w;
+        int h = bottom_top_blob.h;
+        int channels = bottom_top_blob.c;
+
+        #pragma omp parallel for num_threads(opt.num_threads)
+        for (int q=0; q<channels; q++)
+        {
+            float* ptr = bottom_top_blob.channel(q);
+
+            for (int i=0; i<h; i++)
+            {
+                softmax_row(ptr, w);
+
+                ptr += w;
+            }
+        }
+
+        return 0;
+    }
+
+    return 0;
+}
+
+} // namespace ncnn
@@ -0,0 +1,163 @@
+// Tencent is pleased to support the open source community by making ncnn available.
+//
+// Copyright (C) 2019 THL A29 Limited, a Tencent company. All rights reserved.
+//
+// Licensed under the BSD 3-Clause License (the "License"); you may not use this file except
+// in compliance with the License. You may obtain a copy of the License at
+//
+// https://opensource.org/licenses/BSD-3-Clause
+//
+// Unless required by applicable law or agreed to in writing, software distributed
+// under the License is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR
+// CONDITIONS OF ANY KIND, either express or implied. See the License for the
+// specific language governing permissions and limitations under the License.
+
+// weight-only quantization for the float32 gemv kernels
+// every row keeps one float scale and int8 or packed int4 weight
+// int4 rows hold two weights per byte, the even one in the low nibble
+// weight is dequantized in register, the row scale is applied to the dot product
+
+static inline int weight_quantize_row_bytes(int K, int bits)
+{
+    return bits == 4 ? (K + 1) / 2 : K;
+}
+
+// weight = M rows x K columns, symmetric round to nearest
+static void weight_quantize_transform(const Mat& weight, int K, int M, int bits, Mat& weight_quantized, Mat& weight_scales)
+{
+    const int row_bytes = weight_quantize_row_bytes(K, bits);
+    const int qmax = bits == 4 ? 7 : 127;
+
+    weight_quantized.create(row_bytes * M, (size_t)1u);
+    weight_scales.create(M);
+    if (weight_quantized.empty() || weight_scales.empty())
+        return;
+
+    const float* ptr = weight;
+
+    for (int p=0; p<M; p++)
+    {
+        const float* wptr = ptr + K * p;
+        unsigned char* qptr = (unsigned char*)weight_quantized.data + row_bytes * p;
+
+        float absmax = 0.f;
+        for (int k=0; k<K; k++)
+        {
+            absmax = std::max(absmax, (float)fabs(wptr[k]));
+        }
+
+        const float scale = absmax / qmax;
+        const float scale_inv = absmax == 0.f ? 0.f : qmax / absmax;
+
+        weight_scales[p] = scale;
+
+        memset(qptr, 0, row_bytes);
+        for (int k=0; k<K; k++)
+        {
+            int q = (int)round(wptr[k] * scale_inv);
+            q = std::min(std::max(q, -qmax), qmax);
+
+            if (bits == 4)
+                qptr[k / 2] |= (q & 15) << (k % 2 * 4);
+            else
+                qptr[k] = (unsigned char)(signed char)q;
+        }
+    }
+}
+
+#if __SSE2__
+// 16 unsigned bytes u to float32 u - offset
+static inline void uint8_to_float32_sse(__m128i _u, int offset, __m128& _w0, __m128& _w1, __m128& _w2, __m128& _w3)
+{
+    // 0x4b0000uu is the float 2^23 + u
+    const __m128i _zero = _mm_setzero_si128();
+    const __m128i _magic = _mm_set1_epi16(0x4b00);
+    const __m128 _bias = _mm_set1_ps(8388608.f + offset);
+
+    __m128i _ul = _mm_unpacklo_epi8(_u, _zero);
+    __m128i _uh = _mm_unpackhi_epi8(_u, _zero);
+
+    _w0 = _mm_sub_ps(_mm_castsi128_ps(_mm_unpacklo_epi16(_ul, _magic)), _bias);
+    _w1 = _mm_sub_ps(_mm_castsi128_ps(_mm_unpackhi_epi16(_ul, _magic)), _bias);
+    _w2 = _mm_sub_ps(_mm_castsi128_ps(_mm_unpacklo_epi16(_uh, _magic)), _bias);
+    _w3 = _mm_sub_ps(_mm_castsi128_ps(_mm_unpackhi_epi16(_uh, _magic)), _bias);
+}
+
+// 16 int8 values to float32
+static inline void int8_to_float32_sse(const unsigned char* ptr, __m128& _w0, __m128& _w1, __m128& _w2, __m128& _w3)
+{
+    // flip the sign bit, u = q + 128
+    __m128i _u = _mm_xor_si128(_mm_loadu_si128((const __m128i*)ptr), _mm_set1_epi8((char)0x80));
+
+    uint8_to_float32_sse(_u, 128, _w0, _w1, _w2, _w3);
+}
+
+// 16 packed int4 values in 8 bytes to float32
+static inline void int4_to_float32_sse(const unsigned char* ptr, __m128& _w0, __m128& _w1, __m128& _w2, __m128& _w3)
+{
+    __m128i _p = _mm_loadl_epi64((const __m128i*)ptr);
+
+    __m128i _lo = _mm_and_si128(_p, _mm_set1_epi8(0x0f));
+    __m128i _hi = _mm_and_si128(_mm_srli_epi16(_p, 4), _mm_set1_epi8(0x0f));
+
+    // flip the nibble sign bit, u = q + 8
+    __m128i _u = _mm_xor_si128(_mm_unpacklo_epi8(_lo, _hi), _mm_set1_epi8(8));
+
+    uint8_to_float32_sse(_u, 8, _w0, _w1, _w2, _w3);
+}
+#endif // __SSE2__
+
+static inline int int4_value(const unsigned char* ptr, int i)
+{
+    return (((ptr[i / 2] >> (i % 2 * 4)) & 15) ^ 8) - 8;
+}
+
+// sum of a[i] * w[i], unscaled
+static float dot_weight_quantized_sse(const float* a, const unsigned char* w, int size, int bits)
+{
+    float sum = 0.f;
+
+    int i = 0;
+#if __SSE2__
+    __m128 _sum0 = _mm_setzero_ps();
+    __m128 _sum1 = _mm_setzero_ps();
+    __m128 _sum2 = _mm_setzero_ps();
+    __m128 _sum3 = _mm_setzero_ps();
+    for (; i+15<size; i+=16)
+    {
+        __m128 _w0, _w1, _w2, _w3;
+        if (bits == 4)
+            int4_to_float32_sse(w + i / 2, _w0, _w1, _w2, _w3);
+        else
+            int8_to_float32_sse(w + i, _w0, _w1, _w2, _w3);
+
+        _sum0 = _mm_add_ps(_sum0, _mm_mul_ps(_mm_loadu_ps(a + i), _w0));
+        _sum1 = _mm_add_ps(_sum1, _mm_mul_ps(_mm_loadu_ps(a + i + 4), _w1));
+        _sum2 = _mm_add_ps(_sum2, _mm_mul_ps(_mm_loadu_ps(a + i + 8), _w2));
+        _sum3 = _mm_add_ps(_sum3, _mm_mul_ps(_mm_loadu_ps(a + i + 12), _w3));
+    }
+
+    _sum0 = _mm_add_ps(_mm_add_ps(_sum0, _sum1), _mm_add_ps(_sum2, _sum3));
+
+    float sums[4];
+    _mm_storeu_ps(sums, _sum0);
+
+    sum += (sums[0] + sums[1]) + (sums[2] + sums[3]);
+#endif // __SSE2__
+    if (bits == 4)
+    {
+        for (; i<size; i++)
+        {
+            sum += a[i] * int4_value(w, i);
+        }
+    }
+    else
+    {
+        for (; i<size; i++)
+        {
+            sum += a[i] * (signed char)w[i];
+        }
+    }
+
+    return sum;
+}
@@ -0,0 +1,77 @@
+// Tencent is pleased to support the open source community by making ncnn available.
+//
+// Copyright (C) 2019 THL A29 Limited, a Tencent company. All rights reserved.
+//
+// Licensed under the BSD 3-Clause License (the "License"); you may not use this file except
+// in compliance with the License. You may obtain a copy of the License at
+//
+// https://opensource.org/licenses/BSD-3-Clause
+//
+// Unless required by applicable law or agreed to in writing, software distributed
+// under the License is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR
+// CONDITIONS OF ANY KIND, either express or implied. See the License for the
+// specific language governing permissions and limitations under the License.
+
+// compressed sparse row weight for pruned models
+// row p keeps the column index and the value of its nonzero weight
+
+// fraction of zero weight
+static float weight_sparsity(const Mat& weight)
+{
+    const int size = weight.w * weight.h * weight.c;
+    if (size == 0)
+        return 0.f;
+
+    const float* ptr = weight;
+
+    int nz = 0;
+    for (int i=0; i<size; i++)
+    {
+        if (ptr[i] == 0.f)
+            nz++;
+    }
+
+    return (float)nz / size;
+}
+
+// weight = M rows x K columns
+static void weight_sparse_transform(const Mat& weight, int K, int M, Mat& sparse_data, Mat& sparse_rowptr, Mat& sparse_colidx)
+{
+    const float* ptr = weight;
+
+    int nnz = 0;
+    for (int i=0; i<K*M; i++)
+    {
+        if (ptr[i] != 0.f)
+            nnz++;
+    }
+
+    // keep one slot so that an all-zero weight is not an empty Mat
+    sparse_data.create(std::max(nnz, 1));
+    sparse_rowptr.create(M + 1, (size_t)4u);
+    sparse_colidx.create(std::max(nnz, 1), (size_t)4u);
+    if (sparse_data.empty() || sparse_rowptr.empty() || sparse_colidx.empty())
+        return;
+
+    float* values = sparse_data;
+    int* rowptr = (int*)sparse_rowptr.data;
+    int* colidx = (int*)sparse_colidx.data;
+
+    int n = 0;
+    for (int p=0; p<M; p++)
+    {
+        rowptr[p] = n;
+
+        const float* wptr = ptr + K * p;
+        for (int k=0; k<K; k++)
+        {
+            if (wptr[k] == 0.f)
+                continue;
+
+            values[n] = wptr[k];
+            colidx[n] = k;
+            n++;
+        }
+    }
+    rowptr[M] = n;
+}
@@ -0,0 +1,112 @@
+// Tencent is pleased to support the open source community by making ncnn available.
+//
+// Copyright (C) 2019 THL A29 Limited, a Tencent company. All rights reserved.
+//
+// Licensed under the BSD 3-Clause License (the "License"); you may not use this file except
+// in compliance with the License. You may obtain a copy of the License at
+//
+// https://opensource.org/licenses/BSD-3-Clause
+//
+// Unless required by applicable law or agreed to in writing, software distributed
+// under the License is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR
+// CONDITIONS OF ANY KIND, either express or implied. See the License for the
+// specific language governing permissions and limitations under the License.
+
+// weight loads for the float32 kernels
+// weight may be stored in float32, half-precision or bfloat16, computation is always float32
+// needs float16_sse.h and bfloat16_sse.h
+
+static inline float load_weight(const float* ptr)
+{
+    return *ptr;
+}
+
+static inline float load_weight(const unsigned short* ptr)
+{
+    return float16_to_float32(*ptr);
+}
+
+static inline float load_weight(const bfloat16* ptr)
+{
+    return bfloat16_to_float32(ptr->value);
+}
+
+#if __SSE2__
+static inline __m128 load_weight_sse(const float* ptr)
+{
+    return _mm_loadu_ps(ptr);
+}
+
+static inline __m128 load_weight_sse(const unsigned short* ptr)
+{
+    return float16_to_float32_sse(ptr);
+}
+
+static inline __m128 load_weight_sse(const bfloat16* ptr)
+{
+    return bfloat16_to_float32_sse((const unsigned short*)ptr);
+}
+#endif // __SSE2__
+
+// leading part of the dot product done with wider instructions
+// returns the count of elements consumed
+template<typename T>
+static inline int dot_weight_wide(const float* /*a*/, const T* /*w*/, int /*size*/, float& /*sum*/)
+{
+    return 0;
+}
+
+#if __AVX512BF16__
+static inline int dot_weight_wide(const float* a, const bfloat16* w, int size, float& sum)
+{
+    // a is rounded to bfloat16 and multiplied in pairs by vdpbf16ps
+    __m512 _sum = _mm512_setzero_ps();
+
+    int i = 0;
+    for (; i+31<size; i+=32)
+    {
+        __m512bh _a = _mm512_cvtne2ps_pbh(_mm512_loadu_ps(a + i + 16), _mm512_loadu_ps(a + i));
+        __m512bh _w = (__m512bh)_mm512_loadu_si512((const void*)(w + i));
+        _sum = _mm512_dpbf16_ps(_sum, _a, _w);
+    }
+
+    sum += _mm512_reduce_add_ps(_sum);
+
+    return i;
+}
+#endif // __AVX512BF16__
+
+// sum of a[i] * w[i]
+template<typename T>
+static float dot_weight_sse(const float* a, const T* w, int size)
+{
+    float sum = 0.f;
+
+    int i = dot_weight_wide(a, w, size, sum);
+#if __SSE2__
+    __m128 _sum0 = _mm_setzero_ps();
+    __m128 _sum1 = _mm_setzero_ps();
+    for (; i+7<size; i+=8)
+    {
+        _sum0 = _mm_add_ps(_sum0, _mm_mul_ps(_mm_loadu_ps(a + i), load_weight_sse(w + i)));
+        _sum1 = _mm_add_ps(_sum1, _mm_mul_ps(_mm_loadu_ps(a + i + 4), load_weight_sse(w + i + 4)));
+    }
+    for (; i+3<size; i+=4)
+    {
+        _sum0 = _mm_add_ps(_sum0, _mm_mul_ps(_mm_loadu_ps(a + i), load_weight_sse(w + i)));
+    }
+
+    _sum0 = _mm_add_ps(_sum0, _sum1);
+
+    float sums[4];
+    _mm_storeu_ps(sums, _sum0);
+
+    sum += (sums[0] + sums[1]) + (sums[2] + sums[3]);
+#endif // __SSE2__
+    for (; i<size; i++)
+    {
+        sum += a[i] * load_weight(w + i);
+    }
+
+    return sum;
+}
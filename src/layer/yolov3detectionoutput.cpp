@@ -16,6 +16,7 @@
 #include <algorithm>
 #include <math.h>
 #include "layer_type.h"
+#include "bbox_util.h"
 
 namespace ncnn {
 
@@ -52,110 +53,6 @@ int Yolov3DetectionOutput::load_param(const ParamDict& pd)
     return 0;
 }
 
-struct BBoxRect
-{
-    float xmin;
-    float ymin;
-    float xmax;
-    float ymax;
-    int label;
-};
-
-static inline float intersection_area(const BBoxRect& a, const BBoxRect& b)
-{
-    if (a.xmin > b.xmax || a.xmax < b.xmin || a.ymin > b.ymax || a.ymax < b.ymin)
-    {
-        // no intersection
-        return 0.f;
-    }
-
-    float inter_width = std::min(a.xmax, b.xmax) - std::max(a.xmin, b.xmin);
-    float inter_height = std::min(a.ymax, b.ymax) - std::max(a.ymin, b.ymin);
-
-    return inter_width * inter_height;
-}
-
-template <typename T>
-static void qsort_descent_inplace(std::vector<T>& datas, std::vector<float>& scores, int left, int right)
-{
-    int i = left;
-    int j = right;
-    float p = scores[(left + right) / 2];
-
-    while (i <= j)
-    {
-        while (scores[i] > p)
-            i++;
-
-        while (scores[j] < p)
-            j--;
-
-        if (i <= j)
-        {
-            // swap
-            std::swap(datas[i], datas[j]);
-            std::swap(scores[i], scores[j]);
-
-            i++;
-            j--;
-        }
-    }
-
-    if (left < j)
-        qsort_descent_inplace(datas, scores, left, j);
-
-    if (i < right)
-        qsort_descent_inplace(datas, scores, i, right);
-}
-
-template <typename T>
-static void qsort_descent_inplace(std::vector<T>& datas, std::vector<float>& scores)
-{
-    if (datas.empty() || scores.empty())
-        return;
-
-    qsort_descent_inplace(datas, scores, 0, scores.size() - 1);
-}
-
-static void nms_sorted_bboxes(const std::vector<BBoxRect>& bboxes, std::vector<int>& picked, float nms_threshold)
-{
-    picked.clear();
-
-    const int n = bboxes.size();
-
-    std::vector<float> areas(n);
-    for (int i = 0; i < n; i++)
-    {
-        const BBoxRect& r = bboxes[i];
-
-        float width = r.xmax - r.xmin;
-        float height = r.ymax - r.ymin;
-
-        areas[i] = width * height;
-    }
-
-    for (int i = 0; i < n; i++)
-    {
-        const BBoxRect& a = bboxes[i];
-
-        int keep = 1;
-        for (int j = 0; j < (int)picked.size(); j++)
-        {
-            const BBoxRect& b = bboxes[picked[j]];
-
-            // intersection over union
-            float inter_area = intersection_area(a, b);
-            float union_area = areas[i] + areas[picked[j]] - inter_area;
-//             float IoU = inter_area / union_area
-            if (inter_area / union_area > nms_threshold)
-                keep = 0;
-        }
-
-        if (keep)
-            picked.push_back(i);
-    }
-}
-
 static inline float sigmoid(float x)
 {
     return 1.f / (1.f + exp(-x));
@@ -219,38 +116,43 @@ int Yolov3DetectionOutput::forward(const std::vector<Mat>& bottom_blobs, std::ve
                     // box score
                     float box_score = sigmoid(box_score_ptr[0]);
 
-                    // find class index with max class score
-                    int class_index = 0;
-                    float class_score = 0.f;
-                    for (int q = 0; q < num_class; q++)
+                    // class score never exceeds 1, skip the class scan when box score alone fails
+                    if (box_score >= confidence_threshold)
                     {
-                        float score = sigmoid(scores.channel(q).row(i)[j]);
-                        if (score > class_score)
+                        // find class index with max class score
+                        // sigmoid is monotonic, so compare raw values and squash only the winner
+                        int class_index = 0;
+                        float class_score_raw = scores.channel(0).row(i)[j];
+                        for (int q = 1; q < num_class; q++)
                         {
-                            class_index = q;
-                            class_score = score;
+                            float score = scores.channel(q).row(i)[j];
+                            if (score > class_score_raw)
+                            {
+                                class_index = q;
+                                class_score_raw = score;
+                            }
                         }
-                    }
 
-                    //printf( "%d %f %f\n", class_index, box_score, class_score);
+                        float class_score = sigmoid(class_score_raw);
 
-                    float confidence = box_score * class_score;
-                    if (confidence >= confidence_threshold)
-                    {
-                                            // region box
-                        float bbox_cx = (j + sigmoid(xptr[0])) / w;
-                        float bbox_cy = (i + sigmoid(yptr[0])) / h;
-                        float bbox_w = exp(wptr[0]) * bias_w / net_w;
-                        float bbox_h = exp(hptr[0]) * bias_h / net_h;
-
-                        float bbox_xmin = bbox_cx - bbox_w * 0.5f;
-                        float bbox_ymin = bbox_cy - bbox_h * 0.5f;
-                        float bbox_xmax = bbox_cx + bbox_w * 0.5f;
-                        float bbox_ymax = bbox_cy + bbox_h * 0.5f;
-                        
-                        BBoxRect c = { bbox_xmin, bbox_ymin, bbox_xmax, bbox_ymax, class_index };
-                        all_box_bbox_rects[pp].push_back(c);
-                        all_box_bbox_scores[pp].push_back(confidence);
+                        float confidence = box_score * class_score;
+                        if (confidence >= confidence_threshold)
+                        {
+                            // region box
+                            float bbox_cx = (j + sigmoid(xptr[0])) / w;
+                            float bbox_cy = (i + sigmoid(yptr[0])) / h;
+                            float bbox_w = exp(wptr[0]) * bias_w / net_w;
+                            float bbox_h = exp(hptr[0]) * bias_h / net_h;
+
+                            float bbox_xmin = bbox_cx - bbox_w * 0.5f;
+                            float bbox_ymin = bbox_cy - bbox_h * 0.5f;
+                            float bbox_xmax = bbox_cx + bbox_w * 0.5f;
+                            float bbox_ymax = bbox_cy + bbox_h * 0.5f;
+
+                            BBoxRect c = { bbox_xmin, bbox_ymin, bbox_xmax, bbox_ymax, class_index };
+                            all_box_bbox_rects[pp].push_back(c);
+                            all_box_bbox_scores[pp].push_back(confidence);
+                        }
                     }
 
                     xptr++;
@@ -278,7 +180,7 @@ int Yolov3DetectionOutput::forward(const std::vector<Mat>& bottom_blobs, std::ve
     
 
     // global sort inplace
-    qsort_descent_inplace(all_bbox_rects, all_bbox_scores);
+    topk_descent_inplace(all_bbox_rects, all_bbox_scores, 0);
 
     // apply nms
     std::vector<int> picked;
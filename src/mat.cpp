@@ -17,7 +17,14 @@
 #if __ARM_NEON
 #include <arm_neon.h>
 #endif // __ARM_NEON
+#if __SSE2__
+#include <emmintrin.h>
+#if __F16C__
+#include <immintrin.h>
+#endif // __F16C__
+#endif // __SSE2__
 #include <math.h>
+#include <string.h>
 
 #include "cpu.h"
 
@@ -26,6 +33,10 @@
 
 namespace ncnn {
 
+// the row conversions of the x86 layers, plain c without sse2
+#include "layer/x86/float16_sse.h"
+#include "layer/x86/bfloat16_sse.h"
+
 void Mat::substract_mean_normalize(const float* mean_vals, const float* norm_vals)
 {
     ncnn::Layer* op;
@@ -220,50 +231,305 @@ Mat Mat::from_float16(const unsigned short* data, int size)
     return m;
 }
 
+Mat Mat::from_bfloat16(const unsigned short* data, int size)
+{
+    Mat m(size);
+    if (m.empty())
+        return m;
+
+    // bfloat16 is the upper half of float32
+    unsigned int* ptr = m;
+    for (int i=0; i<size; i++)
+    {
+        ptr[i] = (unsigned int)data[i] << 16;
+    }
+
+    return m;
+}
+
+template<typename T>
+static void copy_make_border_image(const Mat& src, Mat& dst, int top, int left, int type, T v)
+{
+    int w = dst.w;
+    int h = dst.h;
+
+    const T* ptr = src;
+    T* outptr = dst;
+
+    if (type == 0)
+    {
+        int y = 0;
+        // fill top
+        for (; y < top; y++)
+        {
+            int x = 0;
+            for (; x < w; x++)
+            {
+                outptr[x] = v;
+            }
+            outptr += w;
+        }
+        // fill center
+        for (; y < (top + src.h); y++)
+        {
+            int x = 0;
+            for (; x < left; x++)
+            {
+                outptr[x] = v;
+            }
+            if (src.w < 12)
+            {
+                for (; x < (left + src.w); x++)
+                {
+                    outptr[x] = ptr[x - left];
+                }
+            }
+            else
+            {
+                memcpy(outptr + left, ptr, src.w * sizeof(T));
+                x += src.w;
+            }
+            for (; x < w; x++)
+            {
+                outptr[x] = v;
+            }
+            ptr += src.w;
+            outptr += w;
+        }
+        // fill bottom
+        for (; y < h; y++)
+        {
+            int x = 0;
+            for (; x < w; x++)
+            {
+                outptr[x] = v;
+            }
+            outptr += w;
+        }
+    }
+    else if (type == 1)
+    {
+        int y = 0;
+        // fill top
+        for (; y < top; y++)
+        {
+            int x = 0;
+            for (; x < left; x++)
+            {
+                outptr[x] = ptr[0];
+            }
+            if(src.w < 12)
+            {
+                for (; x < (left + src.w); x++)
+                {
+                    outptr[x] = ptr[x - left];
+                }
+            }
+            else
+            {
+                memcpy(outptr + left, ptr, src.w * sizeof(T));
+                x += src.w;
+            }
+            for (; x < w; x++)
+            {
+                outptr[x] = ptr[src.w - 1];
+            }
+            outptr += w;
+        }
+        // fill center
+        for (; y < (top + src.h); y++)
+        {
+            int x = 0;
+            for (; x < left; x++)
+            {
+                outptr[x] = ptr[0];
+            }
+            if(src.w < 12)
+            {
+                for (; x < (left + src.w); x++)
+                {
+                    outptr[x] = ptr[x - left];
+                }
+            }
+            else
+            {
+                memcpy(outptr + left, ptr, src.w * sizeof(T));
+                x += src.w;
+            }
+            for (; x < w; x++)
+            {
+                outptr[x] = ptr[src.w - 1];
+            }
+            ptr += src.w;
+            outptr += w;
+        }
+        // fill bottom
+        ptr -= src.w;
+        for (; y < h; y++)
+        {
+            int x = 0;
+            for (; x < left; x++)
+            {
+                outptr[x] = ptr[0];
+            }
+            if(src.w < 12)
+            {
+                for (; x < (left + src.w); x++)
+                {
+                    outptr[x] = ptr[x - left];
+                }
+            }
+            else
+            {
+                memcpy(outptr + left, ptr, src.w * sizeof(T));
+                x += src.w;
+            }
+            for (; x < w; x++)
+            {
+                outptr[x] = ptr[src.w - 1];
+            }
+            outptr += w;
+        }
+    }
+}
+
 void copy_make_border(const Mat& src, Mat& dst, int top, int bottom, int left, int right, int type, float v, Allocator* allocator, int num_threads)
 {
-    ncnn::Layer* padding = ncnn::create_layer(ncnn::LayerType::Padding);
+    int w = src.w;
+    int h = src.h;
+    int channels = src.c;
+    int dims = src.dims;
+    size_t elemsize = src.elemsize;
 
-    ncnn::ParamDict pd;
-    pd.set(0, top);
-    pd.set(1, bottom);
-    pd.set(2, left);
-    pd.set(3, right);
-    pd.set(4, type);
-    pd.set(5, v);
+    int outw = w + left + right;
 
-    padding->load_param(pd);
+    if (dims == 1)
+    {
+        dst.create(outw, elemsize, allocator);
+        if (dst.empty())
+            return;
 
-    ncnn::Option opt = ncnn::get_default_option();
-    opt.num_threads = num_threads;
-    opt.blob_allocator = allocator;
+        if (elemsize == 1)
+            copy_make_border_image<signed char>(src, dst, 0, left, type, v);
+        else if (elemsize == 4)
+            copy_make_border_image<float>(src, dst, 0, left, type, v);
 
-    padding->forward(src, dst, opt);
+        return;
+    }
 
-    delete padding;
+    int outh = h + top + bottom;
+
+    if (dims == 2)
+    {
+        dst.create(outw, outh, elemsize, allocator);
+        if (dst.empty())
+            return;
+
+        if (elemsize == 1)
+            copy_make_border_image<signed char>(src, dst, top, left, type, v);
+        else if (elemsize == 4)
+            copy_make_border_image<float>(src, dst, top, left, type, v);
+
+        return;
+    }
+
+    if (dims == 3)
+    {
+        dst.create(outw, outh, channels, elemsize, allocator);
+        if (dst.empty())
+            return;
+
+        #pragma omp parallel for num_threads(num_threads)
+        for (int q=0; q<channels; q++)
+        {
+            const Mat m = src.channel(q);
+            Mat borderm = dst.channel(q);
+
+            if (elemsize == 1)
+                copy_make_border_image<signed char>(m, borderm, top, left, type, v);
+            else if (elemsize == 4)
+                copy_make_border_image<float>(m, borderm, top, left, type, v);
+        }
+
+        return;
+    }
+}
+
+static void copy_cut_border_image(const Mat& src, Mat& dst, int top, int left)
+{
+    int w = dst.w;
+    int h = dst.h;
+    size_t elemsize = src.elemsize;
+
+    const unsigned char* ptr = (const unsigned char*)src.data + (src.w * top + left) * elemsize;
+    unsigned char* outptr = dst;
+
+    for (int y = 0; y < h; y++)
+    {
+        memcpy(outptr, ptr, w * elemsize);
+
+        outptr += w * elemsize;
+        ptr += src.w * elemsize;
+    }
 }
 
 void copy_cut_border(const Mat& src, Mat& dst, int top, int bottom, int left, int right, Allocator* allocator, int num_threads)
 {
-    ncnn::Layer* crop = ncnn::create_layer(ncnn::LayerType::Crop);
+    int w = src.w;
+    int h = src.h;
+    int channels = src.c;
+    int dims = src.dims;
+    size_t elemsize = src.elemsize;
 
-    ncnn::ParamDict pd;
-    pd.set(0, left);
-    pd.set(1, top);
-    pd.set(2, 0);
-    pd.set(3, src.w - left - right);
-    pd.set(4, src.h - top - bottom);
-    pd.set(5, src.c);
+    if (top == 0 && bottom == 0 && left == 0 && right == 0)
+    {
+        dst = src;
+        return;
+    }
 
-    crop->load_param(pd);
+    int outw = w - left - right;
 
-    ncnn::Option opt = ncnn::get_default_option();
-    opt.num_threads = num_threads;
-    opt.blob_allocator = allocator;
+    if (dims == 1)
+    {
+        dst.create(outw, elemsize, allocator);
+        if (dst.empty())
+            return;
+
+        copy_cut_border_image(src, dst, 0, left);
 
-    crop->forward(src, dst, opt);
+        return;
+    }
+
+    int outh = h - top - bottom;
+
+    if (dims == 2)
+    {
+        dst.create(outw, outh, elemsize, allocator);
+        if (dst.empty())
+            return;
+
+        copy_cut_border_image(src, dst, top, left);
+
+        return;
+    }
 
-    delete crop;
+    if (dims == 3)
+    {
+        dst.create(outw, outh, channels, elemsize, allocator);
+        if (dst.empty())
+            return;
+
+        #pragma omp parallel for num_threads(num_threads)
+        for (int q=0; q<channels; q++)
+        {
+            const Mat m = src.channel(q);
+            Mat cutm = dst.channel(q);
+
+            copy_cut_border_image(m, cutm, top, left);
+        }
+
+        return;
+    }
 }
 
 void resize_bilinear(const Mat& src, Mat& dst, int w, int h, Allocator* allocator, int num_threads)
@@ -324,42 +590,75 @@ void convert_packing(const Mat& src, Mat& dst, int _packing, Allocator* allocato
     delete packing;
 }
 
+// dst of the shape of src with elemsize bytes per value
+static void create_cast_dst(const Mat& src, Mat& dst, size_t elemsize, Allocator* allocator)
+{
+    if (src.dims == 1)
+        dst.create(src.w, elemsize * src.packing, src.packing, allocator);
+    else if (src.dims == 2)
+        dst.create(src.w, src.h, elemsize * src.packing, src.packing, allocator);
+    else if (src.dims == 3)
+        dst.create(src.w, src.h, src.c, elemsize * src.packing, src.packing, allocator);
+}
+
 void cast_float32_to_float16(const Mat& src, Mat& dst, Allocator* allocator, int num_threads)
 {
-    ncnn::Layer* cast = ncnn::create_layer(ncnn::LayerType::Cast);
+    create_cast_dst(src, dst, 2u, allocator);
+    if (dst.empty())
+        return;
 
-    ncnn::ParamDict pd;
-    pd.set(0, 1);
-    pd.set(1, 2);
+    const int size = src.w * src.h * src.packing;
 
-    cast->load_param(pd);
+    #pragma omp parallel for num_threads(num_threads)
+    for (int q=0; q<src.c; q++)
+    {
+        float32_to_float16_row(src.channel(q), dst.channel(q), size);
+    }
+}
 
-    ncnn::Option opt = ncnn::get_default_option();
-    opt.num_threads = num_threads;
-    opt.blob_allocator = allocator;
+void cast_float16_to_float32(const Mat& src, Mat& dst, Allocator* allocator, int num_threads)
+{
+    create_cast_dst(src, dst, 4u, allocator);
+    if (dst.empty())
+        return;
 
-    cast->forward(src, dst, opt);
+    const int size = src.w * src.h * src.packing;
 
-    delete cast;
+    #pragma omp parallel for num_threads(num_threads)
+    for (int q=0; q<src.c; q++)
+    {
+        float16_to_float32_row(src.channel(q), dst.channel(q), size);
+    }
 }
 
-void cast_float16_to_float32(const Mat& src, Mat& dst, Allocator* allocator, int num_threads)
+void cast_float32_to_bfloat16(const Mat& src, Mat& dst, Allocator* allocator, int num_threads)
 {
-    ncnn::Layer* cast = ncnn::create_layer(ncnn::LayerType::Cast);
+    create_cast_dst(src, dst, 2u, allocator);
+    if (dst.empty())
+        return;
 
-    ncnn::ParamDict pd;
-    pd.set(0, 2);
-    pd.set(1, 1);
+    const int size = src.w * src.h * src.packing;
 
-    cast->load_param(pd);
+    #pragma omp parallel for num_threads(num_threads)
+    for (int q=0; q<src.c; q++)
+    {
+        float32_to_bfloat16_row(src.channel(q), dst.channel(q), size);
+    }
+}
 
-    ncnn::Option opt = ncnn::get_default_option();
-    opt.num_threads = num_threads;
-    opt.blob_allocator = allocator;
+void cast_bfloat16_to_float32(const Mat& src, Mat& dst, Allocator* allocator, int num_threads)
+{
+    create_cast_dst(src, dst, 4u, allocator);
+    if (dst.empty())
+        return;
 
-    cast->forward(src, dst, opt);
+    const int size = src.w * src.h * src.packing;
 
-    delete cast;
+    #pragma omp parallel for num_threads(num_threads)
+    for (int q=0; q<src.c; q++)
+    {
+        bfloat16_to_float32_row(src.channel(q), dst.channel(q), size);
+    }
 }
 
 } // namespace ncnn
@@ -175,6 +175,9 @@ public:
     // convenient construct from half precisoin floating point data
     static Mat from_float16(const unsigned short* data, int size);
 
+    // convenient construct from bfloat16 data
+    static Mat from_bfloat16(const unsigned short* data, int size);
+
     // pointer to the data
     void* data;
 
@@ -372,6 +375,8 @@ void resize_bicubic(const Mat& src, Mat& dst, int w, int h, Allocator* allocator
 void convert_packing(const Mat& src, Mat& dst, int packing, Allocator* allocator = 0, int num_threads = 1);
 void cast_float32_to_float16(const Mat& src, Mat& dst, Allocator* allocator = 0, int num_threads = 1);
 void cast_float16_to_float32(const Mat& src, Mat& dst, Allocator* allocator = 0, int num_threads = 1);
+void cast_float32_to_bfloat16(const Mat& src, Mat& dst, Allocator* allocator = 0, int num_threads = 1);
+void cast_bfloat16_to_float32(const Mat& src, Mat& dst, Allocator* allocator = 0, int num_threads = 1);
 
 inline Mat::Mat()
     : data(0), refcount(0), elemsize(0), packing(0), allocator(0), dims(0), w(0), h(0), c(0), cstep(0)
@@ -21,6 +21,39 @@
 
 namespace ncnn {
 
+// sparse data is a bitmask of the nonzero positions followed by the nonzero values
+static void sparse_expand(const unsigned char* mask, const float* values, int w, float* ptr)
+{
+    for (int i = 0; i < w; i++)
+    {
+        ptr[i] = (mask[i / 8] >> (i % 8)) & 1 ? *values++ : 0.f;
+    }
+}
+
+// per-row quantized data is the row count, one float scale per row and int8 or packed int4 weight
+// int4 rows hold two weights per byte, the even one in the low nibble
+static int quantized_data_size(int w, int rows, int bits)
+{
+    const int K = w / rows;
+    return alignSize((bits == 4 ? (K + 1) / 2 : K) * rows, 4);
+}
+
+static void quantized_expand(const float* scales, const unsigned char* data, int w, int rows, int bits, float* ptr)
+{
+    const int K = w / rows;
+    const int row_bytes = bits == 4 ? (K + 1) / 2 : K;
+
+    for (int p = 0; p < rows; p++)
+    {
+        const unsigned char* qptr = data + row_bytes * p;
+        for (int k = 0; k < K; k++)
+        {
+            int q = bits == 4 ? (((qptr[k / 2] >> (k % 2 * 4)) & 15) ^ 8) - 8 : (signed char)qptr[k];
+            ptr[K * p + k] = scales[p] * q;
+        }
+    }
+}
+
 Mat ModelBin::load(int w, int h, int type) const
 {
     Mat m = load(w * h, type);
@@ -89,6 +122,99 @@ Mat ModelBinFromStdio::load(int w, int type) const
 
             return Mat::from_float16(float16_weights.data(), w);
         }
+        else if (flag_struct.tag == 0x0002BF16)
+        {
+            // bfloat16 data
+            int align_data_size = alignSize(w * sizeof(unsigned short), 4);
+            std::vector<unsigned short> bfloat16_weights;
+            bfloat16_weights.resize(align_data_size);
+            nread = fread(bfloat16_weights.data(), align_data_size, 1, binfp);
+            if (nread != 1)
+            {
+                fprintf(stderr, "ModelBin read bfloat16_weights failed %d\n", nread);
+                return Mat();
+            }
+
+            return Mat::from_bfloat16(bfloat16_weights.data(), w);
+        }
+        else if (flag_struct.tag == 0x0005BA5E)
+        {
+            // sparse data
+            int nnz;
+            nread = fread(&nnz, sizeof(int), 1, binfp);
+            if (nread != 1 || nnz < 0 || nnz > w)
+            {
+                fprintf(stderr, "ModelBin read sparse nnz failed %d\n", nread);
+                return Mat();
+            }
+
+            int align_mask_size = alignSize((w + 7) / 8, 4);
+            std::vector<unsigned char> mask;
+            mask.resize(align_mask_size);
+            nread = fread(mask.data(), align_mask_size, 1, binfp);
+            if (nread != 1)
+            {
+                fprintf(stderr, "ModelBin read sparse mask failed %d\n", nread);
+                return Mat();
+            }
+
+            std::vector<float> values;
+            values.resize(nnz);
+            nread = fread(values.data(), nnz * sizeof(float), 1, binfp);
+            if (nnz != 0 && nread != 1)
+            {
+                fprintf(stderr, "ModelBin read sparse values failed %d\n", nread);
+                return Mat();
+            }
+
+            Mat m(w);
+            if (m.empty())
+                return m;
+
+            sparse_expand(mask.data(), values.data(), w, m);
+
+            return m;
+        }
+        else if (flag_struct.tag == 0x0051D008 || flag_struct.tag == 0x0051D004)
+        {
+            // per-row quantized int8 or int4 data
+            const int bits = flag_struct.tag == 0x0051D004 ? 4 : 8;
+
+            int rows;
+            nread = fread(&rows, sizeof(int), 1, binfp);
+            if (nread != 1 || rows <= 0 || w % rows != 0)
+            {
+                fprintf(stderr, "ModelBin read quantized rows failed %d\n", nread);
+                return Mat();
+            }
+
+            std::vector<float> scales;
+            scales.resize(rows);
+            nread = fread(scales.data(), rows * sizeof(float), 1, binfp);
+            if (nread != 1)
+            {
+                fprintf(stderr, "ModelBin read quantized scales failed %d\n", nread);
+                return Mat();
+            }
+
+            int align_data_size = quantized_data_size(w, rows, bits);
+            std::vector<unsigned char> quantized_weights;
+            quantized_weights.resize(align_data_size);
+            nread = fread(quantized_weights.data(), align_data_size, 1, binfp);
+            if (nread != 1)
+            {
+                fprintf(stderr, "ModelBin read quantized_weights failed %d\n", nread);
+                return Mat();
+            }
+
+            Mat m(w);
+            if (m.empty())
+                return m;
+
+            quantized_expand(scales.data(), quantized_weights.data(), w, rows, bits, m);
+
+            return m;
+        }
         else if (flag_struct.tag == 0x000D4B38)
         {
             // int8 data
@@ -232,6 +358,62 @@ Mat ModelBinFromMemory::load(int w, int type) const
             mem += alignSize(w * sizeof(unsigned short), 4);
             return m;
         }
+        else if (flag_struct.tag == 0x0002BF16)
+        {
+            // bfloat16 data
+            Mat m = Mat::from_bfloat16((unsigned short*)mem, w);
+            mem += alignSize(w * sizeof(unsigned short), 4);
+            return m;
+        }
+        else if (flag_struct.tag == 0x0005BA5E)
+        {
+            // sparse data
+            int nnz;
+            memcpy(&nnz, mem, sizeof(int));
+            mem += sizeof(int);
+
+            const unsigned char* mask = mem;
+            mem += alignSize((w + 7) / 8, 4);
+
+            const float* values = (const float*)mem;
+            mem += nnz * sizeof(float);
+
+            Mat m(w);
+            if (m.empty())
+                return m;
+
+            sparse_expand(mask, values, w, m);
+
+            return m;
+        }
+        else if (flag_struct.tag == 0x0051D008 || flag_struct.tag == 0x0051D004)
+        {
+            // per-row quantized int8 or int4 data
+            const int bits = flag_struct.tag == 0x0051D004 ? 4 : 8;
+
+            int rows;
+            memcpy(&rows, mem, sizeof(int));
+            mem += sizeof(int);
+            if (rows <= 0 || w % rows != 0)
+            {
+                fprintf(stderr, "ModelBin read quantized rows failed %d\n", rows);
+                return Mat();
+            }
+
+            const float* scales = (const float*)mem;
+            mem += rows * sizeof(float);
+
+            const unsigned char* quantized_weights = mem;
+            mem += quantized_data_size(w, rows, bits);
+
+            Mat m(w);
+            if (m.empty())
+                return m;
+
+            quantized_expand(scales, quantized_weights, w, rows, bits, m);
+
+            return m;
+        }
         else if (flag_struct.tag == 0x000D4B38)
         {
             // int8 data
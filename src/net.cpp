@@ -18,8 +18,16 @@
 #include "paramdict.h"
 #include "convolution.h"
 #include "convolutiondepthwise.h"
+#include "eltwise.h"
+#include "innerproduct.h"
+#include "pooling.h"
 #include "relu.h"
+#include "input.h"
+#include "benchmark.h"
+#include "profiler.h"
 
+#include <algorithm>
+#include <float.h>
 #include <stdarg.h>
 #include <stdio.h>
 #include <string.h>
@@ -28,10 +36,6 @@
 #include <omp.h>
 #endif // _OPENMP
 
-#if NCNN_BENCHMARK
-#include "benchmark.h"
-#endif // NCNN_BENCHMARK
-
 #if NCNN_VULKAN
 #include "command.h"
 #endif // NCNN_VULKAN
@@ -44,6 +48,13 @@ Net::Net()
     use_sgemm_convolution = 1;
     use_int8_inference = 1;
     use_vulkan_compute = 0;
+    use_fp16_storage = 0;
+    use_bf16_storage = 0;
+    use_int8_weight_storage = 0;
+    use_int4_weight_storage = 0;
+    use_sparse_weight = 0;
+
+    constant_serial = 0;
 
 #if NCNN_VULKAN
     vkdev = 0;
@@ -172,6 +183,11 @@ int Net::load_param(FILE* fp)
     pd.use_sgemm_convolution = use_sgemm_convolution;
     pd.use_int8_inference = use_int8_inference;
     pd.use_vulkan_compute = use_vulkan_compute;
+    pd.use_fp16_storage = use_fp16_storage;
+    pd.use_bf16_storage = use_bf16_storage;
+    pd.use_int8_weight_storage = use_int8_weight_storage;
+    pd.use_int4_weight_storage = use_int4_weight_storage;
+    pd.use_sparse_weight = use_sparse_weight;
 
     int blob_index = 0;
     for (int i=0; i<layer_count; i++)
@@ -343,6 +359,11 @@ int Net::load_param_mem(const char* _mem)
     pd.use_sgemm_convolution = use_sgemm_convolution;
     pd.use_int8_inference = use_int8_inference;
     pd.use_vulkan_compute = use_vulkan_compute;
+    pd.use_fp16_storage = use_fp16_storage;
+    pd.use_bf16_storage = use_bf16_storage;
+    pd.use_int8_weight_storage = use_int8_weight_storage;
+    pd.use_int4_weight_storage = use_int4_weight_storage;
+    pd.use_sparse_weight = use_sparse_weight;
 
     int blob_index = 0;
     for (int i=0; i<layer_count; i++)
@@ -517,6 +538,11 @@ int Net::load_param_bin(FILE* fp)
     pd.use_sgemm_convolution = use_sgemm_convolution;
     pd.use_int8_inference = use_int8_inference;
     pd.use_vulkan_compute = use_vulkan_compute;
+    pd.use_fp16_storage = use_fp16_storage;
+    pd.use_bf16_storage = use_bf16_storage;
+    pd.use_int8_weight_storage = use_int8_weight_storage;
+    pd.use_int4_weight_storage = use_int4_weight_storage;
+    pd.use_sparse_weight = use_sparse_weight;
 
     for (int i=0; i<layer_count; i++)
     {
@@ -665,6 +691,8 @@ int Net::load_model(FILE* fp)
 
     fuse_network();
 
+    find_constant_layers();
+
     return ret;
 }
 
@@ -729,6 +757,11 @@ int Net::load_param(const unsigned char* _mem)
     pd.use_sgemm_convolution = use_sgemm_convolution;
     pd.use_int8_inference = use_int8_inference;
     pd.use_vulkan_compute = use_vulkan_compute;
+    pd.use_fp16_storage = use_fp16_storage;
+    pd.use_bf16_storage = use_bf16_storage;
+    pd.use_int8_weight_storage = use_int8_weight_storage;
+    pd.use_int4_weight_storage = use_int4_weight_storage;
+    pd.use_sparse_weight = use_sparse_weight;
 
     for (int i=0; i<layer_count; i++)
     {
@@ -857,139 +890,743 @@ int Net::load_model(const unsigned char* _mem)
     }
 #endif // NCNN_VULKAN
 
+    fuse_network();
+
+    find_constant_layers();
+
     return mem - _mem;
 }
 
+#if NCNN_REQUANT
+// ReLU, max Pooling, Split and Concat forward int8 as is, the blob scale is unchanged
+static bool is_int8_passthrough(const Layer* layer)
+{
+    if (layer->typeindex == LayerType::ReLU)
+        return ((const ReLU*)layer)->slope == 0.f;
+
+    if (layer->typeindex == LayerType::Pooling)
+        return ((const Pooling*)layer)->pooling_type == Pooling::PoolMethod_MAX;
+
+    return layer->typeindex == LayerType::Split || layer->typeindex == LayerType::Concat;
+}
+
+// the layer can write an int8 top blob
+static bool is_int8_producer(const Layer* layer)
+{
+    if (layer->typeindex == LayerType::Convolution)
+    {
+        const Convolution* conv = (const Convolution*)layer;
+        return conv->use_int8_inference && (conv->activation_type == 0 || conv->activation_type == 1);
+    }
+
+    if (layer->typeindex == LayerType::ConvolutionDepthWise)
+    {
+        // the requantize ops carry one bias per group
+        const ConvolutionDepthWise* convdw = (const ConvolutionDepthWise*)layer;
+        return convdw->use_int8_inference && convdw->group == convdw->num_output && (convdw->activation_type == 0 || convdw->activation_type == 1);
+    }
+
+    if (layer->typeindex == LayerType::Eltwise)
+        return ((const Eltwise*)layer)->use_int8_inference;
+
+    return is_int8_passthrough(layer);
+}
+
+// the layer can read an int8 bottom blob
+static bool is_int8_consumer(const Layer* layer)
+{
+    // the producers requantize symmetric, an asymmetric reader quantizes float itself
+    if (layer->typeindex == LayerType::Convolution)
+    {
+        const Convolution* convolution = (const Convolution*)layer;
+        return convolution->use_int8_inference && convolution->bottom_blob_int8_zero_point == 0;
+    }
+
+    if (layer->typeindex == LayerType::ConvolutionDepthWise)
+        return ((const ConvolutionDepthWise*)layer)->use_int8_inference;
+
+    if (layer->typeindex == LayerType::InnerProduct)
+    {
+        const InnerProduct* innerproduct = (const InnerProduct*)layer;
+        return innerproduct->use_int8_inference && innerproduct->bottom_blob_int8_zero_point == 0;
+    }
+
+    if (layer->typeindex == LayerType::Eltwise)
+    {
+        const Eltwise* eltwise = (const Eltwise*)layer;
+        return eltwise->use_int8_inference && eltwise->bottom_blob_int8_scales.w == (int)layer->bottoms.size();
+    }
+
+    // only the shape is read
+    if (layer->typeindex == LayerType::PriorBox)
+        return true;
+
+    return is_int8_passthrough(layer);
+}
+
+static int find_blob_group(std::vector<int>& group, int i)
+{
+    while (group[i] != i)
+    {
+        group[i] = group[group[i]];
+        i = group[i];
+    }
+
+    return i;
+}
+#endif // NCNN_REQUANT
+
 void Net::fuse_network()
 {
-    // set the int8 op fusion:requantize
-#if NCNN_STRING && NCNN_REQUANT    
-    // fprintf(stderr, "Test op fusion to int8 implement:\n");
-    for (size_t i=0; i<layers.size(); i++)
+    // keep activations int8 between int8 layers
+    // an int8 convolution requantizes its top blob when every consumer takes int8 directly,
+    // blobs joined by passthrough layers share one scale taken from the int8 layers reading them
+    // the blobs nothing consumes stay float, extracting an intermediate blob gives the int8 data
+    // so NCNN_REQUANT is off by default
+#if NCNN_REQUANT
+    const int blob_count = (int)blobs.size();
+
+    std::vector<int> blob_int8(blob_count, 0);
+    for (int i=0; i<blob_count; i++)
     {
-        Layer* layer = layers[i];
+        const Blob& blob = blobs[i];
+        if (blob.producer < 0 || blob.consumers.empty())
+            continue;
 
-        if (layer->type == "Convolution" || layer->type == "ConvolutionDepthWise")
+        if (!is_int8_producer(layers[blob.producer]))
+            continue;
+
+        bool int8 = true;
+        for (size_t j=0; j<blob.consumers.size(); j++)
         {
-            if (((Convolution*)layer)->use_int8_inference == false)
+            if (!is_int8_consumer(layers[blob.consumers[j]]))
+                int8 = false;
+        }
+
+        blob_int8[i] = int8;
+    }
+
+    // a passthrough layer is int8 on all of its blobs or on none
+    bool changed = true;
+    while (changed)
+    {
+        changed = false;
+
+        for (size_t i=0; i<layers.size(); i++)
+        {
+            const Layer* layer = layers[i];
+            if (!is_int8_passthrough(layer))
+                continue;
+
+            bool int8 = true;
+            for (size_t j=0; j<layer->bottoms.size(); j++)
+                int8 = int8 && blob_int8[layer->bottoms[j]];
+            for (size_t j=0; j<layer->tops.size(); j++)
+                int8 = int8 && blob_int8[layer->tops[j]];
+
+            if (int8)
                 continue;
 
-            for (size_t n=0; n<blobs[layer->tops[0]].consumers.size(); n++)
+            for (size_t j=0; j<layer->bottoms.size(); j++)
             {
-                int layer_next_index = blobs[layer->tops[0]].consumers[n];
-                Layer* layer_next = layers[layer_next_index];
+                changed = changed || blob_int8[layer->bottoms[j]];
+                blob_int8[layer->bottoms[j]] = 0;
+            }
+            for (size_t j=0; j<layer->tops.size(); j++)
+            {
+                changed = changed || blob_int8[layer->tops[j]];
+                blob_int8[layer->tops[j]] = 0;
+            }
+        }
+    }
 
-                if (layer_next->type == "ReLU")
-                {
-                    int layer_next_2_index = blobs[layer_next->tops[0]].consumers[0];
-                    Layer* layer_next_2 = layers[layer_next_2_index];
+    // group the blobs joined by passthrough layers
+    std::vector<int> group(blob_count);
+    for (int i=0; i<blob_count; i++)
+    {
+        group[i] = i;
+    }
 
-                    if (layer_next_2->type == "Convolution" || layer_next_2->type == "ConvolutionDepthWise")
-                    {
-                        // fprintf(stderr, "%s, %s, %s\n", layer->name.c_str(), layer_next->name.c_str(), layer_next_2->name.c_str());
-                        if (layer->type == "Convolution" && layer_next_2->type == "Convolution")
-                        {
-                            ((Convolution*)layer)->use_int8_requantize = true;
-                            ((Convolution*)layer)->top_blob_int8_scale = ((Convolution*)layer_next_2)->bottom_blob_int8_scale;
-                            ((Convolution*)layer)->create_requantize_op();
-                        }
-                        else if (layer->type == "ConvolutionDepthWise" && layer_next_2->type == "Convolution")
-                        {
-                            ((ConvolutionDepthWise*)layer)->use_int8_requantize = true;
-                            ((ConvolutionDepthWise*)layer)->top_blob_int8_scale = ((Convolution*)layer_next_2)->bottom_blob_int8_scale;
-                            ((ConvolutionDepthWise*)layer)->create_requantize_op();
-                        }
-                        else if (layer->type == "Convolution" && layer_next_2->type == "ConvolutionDepthWise")
-                        {
-                            ((Convolution*)layer)->use_int8_requantize = true;
-                            ((Convolution*)layer)->top_blob_int8_scale = ((ConvolutionDepthWise*)layer_next_2)->bottom_blob_int8_scales[0];
-                            ((Convolution*)layer)->create_requantize_op();
-                        }
-                        else
-                        {
-                            ((ConvolutionDepthWise*)layer)->use_int8_requantize = true;
-                            ((ConvolutionDepthWise*)layer)->top_blob_int8_scale = ((ConvolutionDepthWise*)layer_next_2)->bottom_blob_int8_scales[0];
-                            ((ConvolutionDepthWise*)layer)->create_requantize_op();
-                        }
-                    }
-                    else if (layer_next_2->type == "Split")
-                    {
-                        bool all_conv = true;
-                        for (size_t i=0; i<layer_next_2->tops.size(); i++)
-                        {
-                            int layer_next_3_index = blobs[layer_next_2->tops[i]].consumers[0];
-                            if (layers[layer_next_3_index]->type != "Convolution" && layers[layer_next_3_index]->type != "ConvolutionDepthWise" && layers[layer_next_3_index]->type != "PriorBox" )
-                            {
-                                // fprintf(stderr, "%s, %s, %s, %s\n", layer->name.c_str(), layer_next->name.c_str(), layer_next_2->name.c_str(), layers[layer_next_3_index]->name.c_str());
-                                all_conv = false;
-                            }
-                        }
+    for (size_t i=0; i<layers.size(); i++)
+    {
+        const Layer* layer = layers[i];
+        if (!is_int8_passthrough(layer) || !blob_int8[layer->tops[0]])
+            continue;
 
-                        if (all_conv == true && layer_next_2->tops.size() >= size_t(2))
-                        {
-                            // fprintf(stderr, "%s, %s, %s, ", layer->name.c_str(), layer_next->name.c_str(), layer_next_2->name.c_str());
-                            for (size_t i=0; i<layer_next_2->tops.size(); i++)
-                            {
-                                int layer_next_3_index = blobs[layer_next_2->tops[i]].consumers[0];
-                                Layer* layer_next_3 = layers[layer_next_3_index];
-
-                                // fprintf(stderr, "%s, ", layer_next_3->name.c_str());
-                                if (layer_next_3->type == "Convolution")
-                                {
-                                    ((Convolution*)layer)->top_blob_int8_scale = ((Convolution*)layer_next_3)->bottom_blob_int8_scale; 
-                                }    
-                            }
+        int g0 = find_blob_group(group, layer->tops[0]);
+        for (size_t j=0; j<layer->bottoms.size(); j++)
+            group[find_blob_group(group, layer->bottoms[j])] = g0;
+        for (size_t j=1; j<layer->tops.size(); j++)
+            group[find_blob_group(group, layer->tops[j])] = g0;
+    }
 
-                            ((Convolution*)layer)->use_int8_requantize = true;
-                            ((Convolution*)layer)->create_requantize_op();    
-                            // fprintf(stderr, "\n");
-                        }
-                    }
-                    else
-                    {
-                        // fprintf(stderr, "%s, %s\n", layer->name.c_str(), layer_next->name.c_str());
-                    }
-                }
-                else if (layer_next->type == "Pooling")
+    // the scale of a group is the bottom scale of the convolution and innerproduct layers reading it
+    // eltwise bottom scales follow, or decide the scale when nothing else reads the group
+    std::vector<float> group_scale_min(blob_count, FLT_MAX);
+    std::vector<float> group_scale_max(blob_count, 0.f);
+    std::vector<float> group_eltwise_scale_min(blob_count, FLT_MAX);
+    for (int i=0; i<blob_count; i++)
+    {
+        if (!blob_int8[i])
+            continue;
+
+        const int g = find_blob_group(group, i);
+
+        for (size_t j=0; j<blobs[i].consumers.size(); j++)
+        {
+            const Layer* layer = layers[blobs[i].consumers[j]];
+
+            std::vector<float> scales;
+            if (layer->typeindex == LayerType::Convolution)
+            {
+                scales.push_back(((const Convolution*)layer)->bottom_blob_int8_scale);
+            }
+            else if (layer->typeindex == LayerType::ConvolutionDepthWise)
+            {
+                const Mat& bottom_blob_int8_scales = ((const ConvolutionDepthWise*)layer)->bottom_blob_int8_scales;
+                for (int k=0; k<bottom_blob_int8_scales.w; k++)
+                    scales.push_back(bottom_blob_int8_scales[k]);
+            }
+            else if (layer->typeindex == LayerType::InnerProduct)
+            {
+                scales.push_back(((const InnerProduct*)layer)->bottom_blob_int8_scale);
+            }
+            else if (layer->typeindex == LayerType::Eltwise)
+            {
+                const Eltwise* eltwise = (const Eltwise*)layer;
+                for (size_t k=0; k<layer->bottoms.size(); k++)
                 {
-                    // ToDo
+                    if (layer->bottoms[k] == i)
+                        group_eltwise_scale_min[g] = std::min(group_eltwise_scale_min[g], eltwise->bottom_blob_int8_scales[k]);
                 }
-                else
+            }
+
+            for (size_t k=0; k<scales.size(); k++)
+            {
+                group_scale_min[g] = std::min(group_scale_min[g], scales[k]);
+                group_scale_max[g] = std::max(group_scale_max[g], scales[k]);
+            }
+        }
+    }
+
+    // negative = no usable scale, the group stays float32
+    std::vector<float> group_scale(blob_count, -1.f);
+    for (int g=0; g<blob_count; g++)
+    {
+        if (group[g] != g)
+            continue;
+
+        if (group_scale_min[g] != FLT_MAX)
+        {
+            // readers calibrated on different scales would see a skewed value
+            if (group_scale_max[g] <= group_scale_min[g] * 1.01f)
+                group_scale[g] = group_scale_min[g];
+        }
+        else if (group_eltwise_scale_min[g] != FLT_MAX)
+        {
+            group_scale[g] = group_eltwise_scale_min[g];
+        }
+    }
+
+    for (int i=0; i<blob_count; i++)
+    {
+        if (blob_int8[i] && group_scale[find_blob_group(group, i)] < 0.f)
+            blob_int8[i] = 0;
+    }
+
+    // eltwise dequantizes its int8 bottoms with the group scale
+    for (size_t i=0; i<layers.size(); i++)
+    {
+        Layer* layer = layers[i];
+        if (layer->typeindex != LayerType::Eltwise)
+            continue;
+
+        Eltwise* eltwise = (Eltwise*)layer;
+        for (size_t j=0; j<layer->bottoms.size(); j++)
+        {
+            int bottom_blob_index = layer->bottoms[j];
+            if (!blob_int8[bottom_blob_index])
+                continue;
+
+            if (eltwise->bottom_blob_int8_scales.refcount && *eltwise->bottom_blob_int8_scales.refcount > 1)
+                eltwise->bottom_blob_int8_scales = eltwise->bottom_blob_int8_scales.clone();
+
+            eltwise->bottom_blob_int8_scales[j] = group_scale[find_blob_group(group, bottom_blob_index)];
+        }
+    }
+
+    // requantize to int8 at the producers
+    for (int i=0; i<blob_count; i++)
+    {
+        if (!blob_int8[i])
+            continue;
+
+        Layer* layer = layers[blobs[i].producer];
+        const float scale = group_scale[find_blob_group(group, i)];
+
+        if (layer->typeindex == LayerType::Convolution)
+        {
+            Convolution* conv = (Convolution*)layer;
+            conv->use_int8_requantize = true;
+            conv->top_blob_int8_scale = scale;
+            conv->create_requantize_op();
+        }
+        else if (layer->typeindex == LayerType::ConvolutionDepthWise)
+        {
+            ConvolutionDepthWise* convdw = (ConvolutionDepthWise*)layer;
+            convdw->use_int8_requantize = true;
+            convdw->top_blob_int8_scale = scale;
+            convdw->create_requantize_op();
+        }
+        else if (layer->typeindex == LayerType::Eltwise)
+        {
+            ((Eltwise*)layer)->top_blob_int8_scale = scale;
+        }
+    }
+#endif // NCNN_REQUANT
+}
+
+void Net::find_constant_layers()
+{
+    layer_constants.assign(layers.size(), 0);
+
+    for (size_t i=0; i<layers.size(); i++)
+    {
+        const Layer* layer = layers[i];
+
+        if (layer->shape_only)
+        {
+            layer_constants[i] = 1;
+            continue;
+        }
+
+        // custom layers may keep state, input layers are fed by the extractor
+        if (layer->bottoms.empty() || layer->typeindex == LayerType::Input || (layer->typeindex & LayerType::CustomBit))
+            continue;
+
+        bool constant = true;
+        for (size_t j=0; j<layer->bottoms.size(); j++)
+        {
+            int producer = blobs[layer->bottoms[j]].producer;
+            if (producer < 0 || producer >= (int)i || layer_constants[producer] == 0)
+                constant = false;
+        }
+
+        if (constant)
+            layer_constants[i] = 2;
+    }
+
+    // the work estimates of the previous weight are stale too
+    layer_adaptive_threads.assign(layers.size(), 0);
+
+    MutexLockGuard lock(constant_lock);
+
+    constant_entries.clear();
+    constant_entries.resize(layers.size());
+}
+
+void Net::clear()
+{
+#if NCNN_VULKAN
+    destroy_pipeline();
+#endif // NCNN_VULKAN
+
+    blobs.clear();
+    for (size_t i=0; i<layers.size(); i++)
+    {
+        delete layers[i];
+    }
+    layers.clear();
+    layer_impls.clear();
+    layer_threads.clear();
+    layer_adaptive_threads.clear();
+
+    layer_constants.clear();
+    constant_entries.clear();
+
+#if NCNN_VULKAN
+    if (weight_vkallocator)
+    {
+        delete weight_vkallocator;
+        weight_vkallocator = 0;
+    }
+    if (weight_staging_vkallocator)
+    {
+        delete weight_staging_vkallocator;
+        weight_staging_vkallocator = 0;
+    }
+#endif // NCNN_VULKAN
+}
+
+int Net::forward_tune_input(std::vector<Mat>& blob_mats, Option& opt) const
+{
+    blob_mats.clear();
+    blob_mats.resize(blobs.size());
+
+    // dummy input blobs of the declared shape
+    for (size_t i=0; i<layers.size(); i++)
+    {
+        const Layer* layer = layers[i];
+        if (layer->typeindex != LayerType::Input)
+            continue;
+
+        const Input* input = (const Input*)layer;
+
+        Mat m;
+        if (input->c > 0)
+            m.create(input->w, input->h, input->c);
+        else if (input->h > 0)
+            m.create(input->w, input->h);
+        else
+            m.create(input->w);
+
+        if (input->w <= 0 || m.empty())
+        {
+            fprintf(stderr, "autotune input shape of layer %d not declared\n", (int)i);
+            return -1;
+        }
+
+        m.fill(0.01f);
+
+        blob_mats[layer->tops[0]] = m;
+    }
+
+    // keep every intermediate blob as the bottom blob of the tunable layers
+    for (size_t i=0; i<layers.size(); i++)
+    {
+        const Layer* layer = layers[i];
+
+        bool ready = true;
+        for (size_t j=0; j<layer->tops.size(); j++)
+        {
+            if (blob_mats[layer->tops[j]].dims == 0)
+                ready = false;
+        }
+
+        if (ready)
+            continue;
+
+        int ret = forward_layer(i, blob_mats, opt);
+        if (ret != 0)
+            return ret;
+    }
+
+    return 0;
+}
+
+int Net::autotune()
+{
+    if (layers.empty())
+    {
+        fprintf(stderr, "network graph not ready\n");
+        return -1;
+    }
+
+    Option opt = get_default_option();
+    opt.lightmode = false;
+
+    std::vector<Mat> blob_mats;
+    int ret = forward_tune_input(blob_mats, opt);
+    if (ret != 0)
+        return ret;
+
+    layer_impls.resize(layers.size(), 0);
+
+    for (size_t i=0; i<layers.size(); i++)
+    {
+        Layer* layer = layers[i];
+        if (!layer->one_blob_only)
+            continue;
+
+        std::vector<int> impls;
+        layer->get_impls(impls);
+        if (impls.size() < 2)
+            continue;
+
+        const Mat& bottom_blob = blob_mats[layer->bottoms[0]];
+
+        int best_impl = 0;
+        double best_time = DBL_MAX;
+
+        for (size_t j=0; j<impls.size(); j++)
+        {
+            if (layer->set_impl(impls[j]) != 0)
+                continue;
+
+            // the first run warms up caches and allocators
+            double time = DBL_MAX;
+            for (int k=0; k<4; k++)
+            {
+                Mat top_blob;
+
+                double start = get_current_time();
+                int ret = layer->forward(bottom_blob, top_blob, opt);
+                double end = get_current_time();
+
+                if (ret != 0)
                 {
-                    // fprintf(stderr, "%s\n", layer->name.c_str());
-                }                  
+                    time = DBL_MAX;
+                    break;
+                }
+
+                if (k > 0 && end - start < time)
+                    time = end - start;
+            }
+
+            if (time < best_time)
+            {
+                best_impl = impls[j];
+                best_time = time;
             }
         }
+
+        ret = layer->set_impl(best_impl);
+        if (ret != 0)
+            return ret;
+
+        layer_impls[i] = best_impl;
     }
-#endif
+
+    return 0;
+}
+
+int Net::autotune_num_threads()
+{
+    if (layers.empty())
+    {
+        fprintf(stderr, "network graph not ready\n");
+        return -1;
+    }
+
+    Option opt = get_default_option();
+    opt.lightmode = false;
+    opt.use_adaptive_threads = false;
+
+    // time each layer alone, not with the counts of a previous tune
+    layer_threads.clear();
+
+    std::vector<Mat> blob_mats;
+    int ret = forward_tune_input(blob_mats, opt);
+    if (ret != 0)
+        return ret;
+
+    layer_threads.resize(layers.size(), 0);
+
+    for (size_t i=0; i<layers.size(); i++)
+    {
+        const Layer* layer = layers[i];
+        if (!layer->one_blob_only || layer->bottoms.empty())
+            continue;
+
+        const Mat& bottom_blob = blob_mats[layer->bottoms[0]];
+
+        int best_num_threads = 0;
+        double best_time = DBL_MAX;
+
+        for (int num_threads=1; ; num_threads *= 2)
+        {
+            // end the doubling at the option thread count
+            num_threads = std::min(num_threads, opt.num_threads);
+
+            Option opt_t = opt;
+            opt_t.num_threads = num_threads;
+
+            // the first run warms up caches and allocators
+            double time = DBL_MAX;
+            for (int k=0; k<4; k++)
+            {
+                Mat top_blob;
+
+                double start = get_current_time();
+                ret = layer->forward(bottom_blob, top_blob, opt_t);
+                double end = get_current_time();
+
+                if (ret != 0)
+                    return ret;
+
+                if (k > 0 && end - start < time)
+                    time = end - start;
+            }
+
+            if (time < best_time)
+            {
+                best_num_threads = num_threads;
+                best_time = time;
+            }
+
+            if (num_threads >= opt.num_threads)
+                break;
+        }
+
+        // the full count needs no entry
+        layer_threads[i] = best_num_threads == opt.num_threads ? 0 : best_num_threads;
+    }
+
+    return 0;
+}
+
+#if NCNN_STDIO
+int Net::save_tune(const char* tunepath) const
+{
+    FILE* fp = fopen(tunepath, "wb");
+    if (!fp)
+    {
+        fprintf(stderr, "fopen %s failed\n", tunepath);
+        return -1;
+    }
+
+    // layer_index impl [layer_name]
+    for (size_t i=0; i<layer_impls.size(); i++)
+    {
+        if (layer_impls[i] == 0)
+            continue;
+
+#if NCNN_STRING
+        fprintf(fp, "%d %d %s\n", (int)i, layer_impls[i], layers[i]->name.c_str());
+#else
+        fprintf(fp, "%d %d\n", (int)i, layer_impls[i]);
+#endif // NCNN_STRING
+    }
+
+    fclose(fp);
+
+    return 0;
+}
+
+int Net::load_tune(const char* tunepath)
+{
+    if (layers.empty())
+    {
+        fprintf(stderr, "network graph not ready\n");
+        return -1;
+    }
+
+    FILE* fp = fopen(tunepath, "rb");
+    if (!fp)
+    {
+        fprintf(stderr, "fopen %s failed\n", tunepath);
+        return -1;
+    }
+
+    layer_impls.resize(layers.size(), 0);
+
+    int ret = 0;
+
+    char line[1024];
+    while (fgets(line, 1024, fp))
+    {
+        int layer_index = -1;
+        int impl = 0;
+        char layer_name[257];
+        int nscan = sscanf(line, "%d %d %256s", &layer_index, &impl, layer_name);
+        if (nscan < 2)
+            continue;
+
+#if NCNN_STRING
+        // the layer name wins over the index
+        if (nscan == 3)
+            layer_index = find_layer_index_by_name(layer_name);
+#endif // NCNN_STRING
+
+        if (layer_index < 0 || layer_index >= (int)layers.size())
+        {
+            fprintf(stderr, "tune file %s refers to unknown layer\n", tunepath);
+            ret = -1;
+            continue;
+        }
+
+        if (layers[layer_index]->set_impl(impl) != 0)
+        {
+            fprintf(stderr, "layer %d set_impl %d failed\n", layer_index, impl);
+            ret = -1;
+            continue;
+        }
+
+        layer_impls[layer_index] = impl;
+    }
+
+    fclose(fp);
+
+    return ret;
+}
+
+int Net::save_num_threads(const char* path) const
+{
+    FILE* fp = fopen(path, "wb");
+    if (!fp)
+    {
+        fprintf(stderr, "fopen %s failed\n", path);
+        return -1;
+    }
+
+    // layer_index num_threads [layer_name]
+    for (size_t i=0; i<layer_threads.size(); i++)
+    {
+        if (layer_threads[i] == 0)
+            continue;
+
+#if NCNN_STRING
+        fprintf(fp, "%d %d %s\n", (int)i, layer_threads[i], layers[i]->name.c_str());
+#else
+        fprintf(fp, "%d %d\n", (int)i, layer_threads[i]);
+#endif // NCNN_STRING
+    }
+
+    fclose(fp);
+
+    return 0;
 }
 
-void Net::clear()
+int Net::load_num_threads(const char* path)
 {
-#if NCNN_VULKAN
-    destroy_pipeline();
-#endif // NCNN_VULKAN
-
-    blobs.clear();
-    for (size_t i=0; i<layers.size(); i++)
+    if (layers.empty())
     {
-        delete layers[i];
+        fprintf(stderr, "network graph not ready\n");
+        return -1;
     }
-    layers.clear();
 
-#if NCNN_VULKAN
-    if (weight_vkallocator)
+    FILE* fp = fopen(path, "rb");
+    if (!fp)
     {
-        delete weight_vkallocator;
-        weight_vkallocator = 0;
+        fprintf(stderr, "fopen %s failed\n", path);
+        return -1;
     }
-    if (weight_staging_vkallocator)
+
+    layer_threads.assign(layers.size(), 0);
+
+    int ret = 0;
+
+    char line[1024];
+    while (fgets(line, 1024, fp))
     {
-        delete weight_staging_vkallocator;
-        weight_staging_vkallocator = 0;
+        int layer_index = -1;
+        int num_threads = 0;
+        char layer_name[257];
+        int nscan = sscanf(line, "%d %d %256s", &layer_index, &num_threads, layer_name);
+        if (nscan < 2)
+            continue;
+
+#if NCNN_STRING
+        // the layer name wins over the index
+        if (nscan == 3)
+            layer_index = find_layer_index_by_name(layer_name);
+#endif // NCNN_STRING
+
+        if (layer_index < 0 || layer_index >= (int)layers.size() || num_threads < 0)
+        {
+            fprintf(stderr, "thread file %s refers to unknown layer\n", path);
+            ret = -1;
+            continue;
+        }
+
+        layer_threads[layer_index] = num_threads;
     }
-#endif // NCNN_VULKAN
+
+    fclose(fp);
+
+    return ret;
 }
+#endif // NCNN_STDIO
 
 Extractor Net::create_extractor() const
 {
@@ -1207,12 +1844,238 @@ Layer* Net::create_custom_layer(int index)
     return layer_creator();
 }
 
+int Net::find_constant_key(int layer_index, std::vector<Mat>& blob_mats, Option& opt, std::vector<int>& key) const
+{
+    const Layer* layer = layers[layer_index];
+
+    // half precision blob storage changes the top blobs
+    key.push_back(opt.use_fp16_storage ? 1 : 0);
+
+    for (size_t i=0; i<layer->bottoms.size(); i++)
+    {
+        int bottom_blob_index = layer->bottoms[i];
+
+        if (blob_mats[bottom_blob_index].dims == 0)
+        {
+            int ret = forward_layer(blobs[bottom_blob_index].producer, blob_mats, opt);
+            if (ret != 0)
+                return ret;
+        }
+
+        const Mat& m = blob_mats[bottom_blob_index];
+
+        if (layer_constants[layer_index] == 1)
+        {
+            key.push_back(m.dims);
+            key.push_back(m.w);
+            key.push_back(m.h);
+            key.push_back(m.c);
+            continue;
+        }
+
+        // the memo entry the bottom blob was taken from
+        int serial = -1;
+        {
+            MutexLockGuard lock(constant_lock);
+
+            const std::vector<ConstantEntry>& entries = constant_entries[blobs[bottom_blob_index].producer];
+            for (size_t j=0; j<entries.size(); j++)
+            {
+                for (size_t k=0; k<entries[j].tops.size(); k++)
+                {
+                    if (m.data && entries[j].tops[k].data == m.data)
+                        serial = entries[j].serial;
+                }
+            }
+        }
+
+        // fed by the user or evicted, forward without memo
+        if (serial == -1)
+        {
+            key.clear();
+            return 0;
+        }
+
+        key.push_back(serial);
+    }
+
+    return 0;
+}
+
+bool Net::load_constant(int layer_index, const std::vector<int>& key, std::vector<Mat>& blob_mats, const Option& opt) const
+{
+    const Layer* layer = layers[layer_index];
+
+    {
+        MutexLockGuard lock(constant_lock);
+
+        const std::vector<ConstantEntry>& entries = constant_entries[layer_index];
+
+        size_t j = 0;
+        for (; j<entries.size(); j++)
+        {
+            if (entries[j].key == key)
+                break;
+        }
+
+        if (j == entries.size())
+            return false;
+
+        for (size_t i=0; i<layer->tops.size(); i++)
+        {
+            blob_mats[layer->tops[i]] = entries[j].tops[i];
+        }
+    }
+
+    if (opt.lightmode)
+    {
+        // delete after taken in light mode
+        for (size_t i=0; i<layer->bottoms.size(); i++)
+        {
+            blob_mats[layer->bottoms[i]].release();
+        }
+    }
+
+    return true;
+}
+
+void Net::save_constant(int layer_index, const std::vector<int>& key, std::vector<Mat>& blob_mats) const
+{
+    const Layer* layer = layers[layer_index];
+
+    // the memo outlives the extractor allocators
+    ConstantEntry entry;
+    entry.key = key;
+    for (size_t i=0; i<layer->tops.size(); i++)
+    {
+        const Mat& top_blob = blob_mats[layer->tops[i]];
+        entry.tops.push_back(top_blob.clone());
+        if (entry.tops[i].empty() && !top_blob.empty())
+            return;
+    }
+
+    MutexLockGuard lock(constant_lock);
+
+    std::vector<ConstantEntry>& entries = constant_entries[layer_index];
+    for (size_t j=0; j<entries.size(); j++)
+    {
+        // another extractor got here first
+        if (entries[j].key == key)
+            return;
+    }
+
+    // keep the latest few shapes
+    if (entries.size() >= 8)
+        entries.erase(entries.begin());
+
+    entry.serial = constant_serial++;
+    entries.push_back(entry);
+
+    // hand out the memo so that the folded layers downstream find their key
+    for (size_t i=0; i<layer->tops.size(); i++)
+    {
+        blob_mats[layer->tops[i]] = entry.tops[i];
+    }
+}
+
+// counters are read outside the timestamps so that the syscall stays out of the layer time
+static double profile_begin(const Option& opt, bool profiling, HardwareCounters& counters)
+{
+    if (opt.profiler)
+        opt.profiler->read_counters(counters);
+
+    return profiling ? get_current_time() : 0;
+}
+
+static double profile_end(const Option& opt, bool profiling, HardwareCounters& counters)
+{
+    double end = profiling ? get_current_time() : 0;
+
+    if (opt.profiler)
+        opt.profiler->read_counters(counters);
+
+    return end;
+}
+
+// work units, a flop or four bytes moved, that make a thread worth starting
+// about the fork and join cost of a parallel region on a mobile core
+static const double adaptive_threads_grain = 100000;
+
+// the estimates are shared by the extractors running at once, so every access is atomic
+static inline int atomic_load(int* addr)
+{
+    return NCNN_XADD(addr, 0);
+}
+
+static inline void atomic_store(int* addr, int value)
+{
+    // the last writer wins, a reader sees either the old or the new estimate
+#if defined __GNUC__
+    int old = *(volatile int*)addr;
+    for (;;)
+    {
+        int seen = __sync_val_compare_and_swap(addr, old, value);
+        if (seen == old)
+            break;
+        old = seen;
+    }
+#elif defined _MSC_VER && !defined RC_INVOKED
+    _InterlockedExchange((long volatile*)addr, value);
+#else
+    // an aligned int store is not torn
+    *(volatile int*)addr = value;
+#endif
+}
+
+int Net::layer_num_threads(int layer_index, const Option& opt) const
+{
+    int num_threads = layer_index < (int)layer_threads.size() ? layer_threads[layer_index] : 0;
+
+    if (num_threads == 0 && opt.use_adaptive_threads && layer_index < (int)layer_adaptive_threads.size())
+        num_threads = atomic_load(&layer_adaptive_threads[layer_index]);
+
+    return num_threads > 0 ? std::min(num_threads, opt.num_threads) : opt.num_threads;
+}
+
+void Net::update_adaptive_threads(int layer_index, const std::vector<Mat>& bottom_blobs, const std::vector<Mat>& top_blobs) const
+{
+    if (layer_index >= (int)layer_adaptive_threads.size())
+        return;
+
+    LayerCost cost;
+    if (layers[layer_index]->get_cost(bottom_blobs, top_blobs, cost) != 0)
+        return;
+
+    const double work = cost.macs * 2.0 + cost.flops + (cost.weight_bytes + cost.bottom_bytes + cost.top_bytes) / 4.0;
+
+    atomic_store(&layer_adaptive_threads[layer_index], (int)std::min(std::max(work / adaptive_threads_grain, 1.0), 65536.0));
+}
+
 int Net::forward_layer(int layer_index, std::vector<Mat>& blob_mats, Option& opt) const
 {
     const Layer* layer = layers[layer_index];
 
 //     fprintf(stderr, "forward_layer %d %s\n", layer_index, layer->name.c_str());
 
+    // a constant layer reuses the top blobs memoised for the same bottom shapes
+    std::vector<int> constant_key;
+    if (!layer_constants.empty() && layer_constants[layer_index] != 0)
+    {
+        int ret = find_constant_key(layer_index, blob_mats, opt, constant_key);
+        if (ret != 0)
+            return ret;
+
+        if (!constant_key.empty() && load_constant(layer_index, constant_key, blob_mats, opt))
+            return 0;
+    }
+
+    // time the forward for the compile-time benchmark printout or the runtime profiler
+    const bool profiling = NCNN_BENCHMARK || opt.profiler;
+    const int layer_impl = layer_index < (int)layer_impls.size() ? layer_impls[layer_index] : 0;
+
+    Option opt_layer = opt;
+    opt_layer.num_threads = layer_num_threads(layer_index, opt);
+
     if (layer->one_blob_only)
     {
         // load bottom blob
@@ -1228,6 +2091,17 @@ int Net::forward_layer(int layer_index, std::vector<Mat>& blob_mats, Option& opt
 
         Mat bottom_blob = blob_mats[bottom_blob_index];
 
+        if (opt.use_fp16_storage && !layer->support_fp16_storage && bottom_blob.elemsize == 2u)
+        {
+            // cast to fp32 for layer without fp16 storage support
+            Mat bottom_blob_fp32;
+            ncnn::cast_float16_to_float32(bottom_blob, bottom_blob_fp32, opt.workspace_allocator, opt.num_threads);
+            if (bottom_blob_fp32.empty())
+                return -100;
+
+            bottom_blob = bottom_blob_fp32;
+        }
+
         if (opt.lightmode)
         {
             // delete after taken in light mode
@@ -1243,16 +2117,36 @@ int Net::forward_layer(int layer_index, std::vector<Mat>& blob_mats, Option& opt
         if (opt.lightmode && layer->support_inplace)
         {
             Mat& bottom_top_blob = bottom_blob;
+            HardwareCounters counters_start;
+            HardwareCounters counters_end;
+            double start = profile_begin(opt, profiling, counters_start);
+            int ret = layer->forward_inplace(bottom_top_blob, opt_layer);
+            double end = profile_end(opt, profiling, counters_end);
+            if (ret != 0)
+                return ret;
+
 #if NCNN_BENCHMARK
-            double start = get_current_time();
-            int ret = layer->forward_inplace(bottom_top_blob, opt);
-            double end = get_current_time();
             benchmark(layer, bottom_top_blob, bottom_top_blob, start, end);
-#else
-            int ret = layer->forward_inplace(bottom_top_blob, opt);
 #endif // NCNN_BENCHMARK
-            if (ret != 0)
-                return ret;
+            if (opt.profiler)
+            {
+                opt.profiler->record(layer_index, layer, std::vector<Mat>(1, bottom_top_blob), std::vector<Mat>(1, bottom_top_blob), start, end, counters_start, counters_end, opt_layer.num_threads, layer_impl);
+            }
+            if (opt.use_adaptive_threads)
+            {
+                update_adaptive_threads(layer_index, std::vector<Mat>(1, bottom_top_blob), std::vector<Mat>(1, bottom_top_blob));
+            }
+
+            if (opt.use_fp16_storage && bottom_top_blob.elemsize == 4u)
+            {
+                // cast to fp16 for storing
+                Mat bottom_top_blob_fp16;
+                ncnn::cast_float32_to_float16(bottom_top_blob, bottom_top_blob_fp16, opt.blob_allocator, opt.num_threads);
+                if (bottom_top_blob_fp16.empty())
+                    return -100;
+
+                bottom_top_blob = bottom_top_blob_fp16;
+            }
 
             // store top blob
             blob_mats[top_blob_index] = bottom_top_blob;
@@ -1260,16 +2154,36 @@ int Net::forward_layer(int layer_index, std::vector<Mat>& blob_mats, Option& opt
         else
         {
             Mat top_blob;
+            HardwareCounters counters_start;
+            HardwareCounters counters_end;
+            double start = profile_begin(opt, profiling, counters_start);
+            int ret = layer->forward(bottom_blob, top_blob, opt_layer);
+            double end = profile_end(opt, profiling, counters_end);
+            if (ret != 0)
+                return ret;
+
 #if NCNN_BENCHMARK
-            double start = get_current_time();
-            int ret = layer->forward(bottom_blob, top_blob, opt);
-            double end = get_current_time();
             benchmark(layer, bottom_blob, top_blob, start, end);
-#else
-            int ret = layer->forward(bottom_blob, top_blob, opt);
 #endif // NCNN_BENCHMARK
-            if (ret != 0)
-                return ret;
+            if (opt.profiler)
+            {
+                opt.profiler->record(layer_index, layer, std::vector<Mat>(1, bottom_blob), std::vector<Mat>(1, top_blob), start, end, counters_start, counters_end, opt_layer.num_threads, layer_impl);
+            }
+            if (opt.use_adaptive_threads)
+            {
+                update_adaptive_threads(layer_index, std::vector<Mat>(1, bottom_blob), std::vector<Mat>(1, top_blob));
+            }
+
+            if (opt.use_fp16_storage && top_blob.elemsize == 4u)
+            {
+                // cast to fp16 for storing
+                Mat top_blob_fp16;
+                ncnn::cast_float32_to_float16(top_blob, top_blob_fp16, opt.blob_allocator, opt.num_threads);
+                if (top_blob_fp16.empty())
+                    return -100;
+
+                top_blob = top_blob_fp16;
+            }
 
             // store top blob
             blob_mats[top_blob_index] = top_blob;
@@ -1293,6 +2207,28 @@ int Net::forward_layer(int layer_index, std::vector<Mat>& blob_mats, Option& opt
 
             bottom_blobs[i] = blob_mats[bottom_blob_index];
 
+            if (opt.use_fp16_storage && !layer->support_fp16_storage && bottom_blobs[i].elemsize == 2u)
+            {
+                // cast to fp32 for layer without fp16 storage support
+                Mat bottom_blob_fp32;
+                ncnn::cast_float16_to_float32(bottom_blobs[i], bottom_blob_fp32, opt.workspace_allocator, opt.num_threads);
+                if (bottom_blob_fp32.empty())
+                    return -100;
+
+                bottom_blobs[i] = bottom_blob_fp32;
+            }
+
+            if (opt.use_fp16_storage && layer->support_fp16_storage && bottom_blobs[i].elemsize == 4u)
+            {
+                // cast to fp16 so that the bottoms agree, the extractor input is stored in fp32
+                Mat bottom_blob_fp16;
+                ncnn::cast_float32_to_float16(bottom_blobs[i], bottom_blob_fp16, opt.workspace_allocator, opt.num_threads);
+                if (bottom_blob_fp16.empty())
+                    return -100;
+
+                bottom_blobs[i] = bottom_blob_fp16;
+            }
+
             if (opt.lightmode)
             {
                 // delete after taken in light mode
@@ -1309,49 +2245,94 @@ int Net::forward_layer(int layer_index, std::vector<Mat>& blob_mats, Option& opt
         if (opt.lightmode && layer->support_inplace)
         {
             std::vector<Mat>& bottom_top_blobs = bottom_blobs;
-#if NCNN_BENCHMARK
-            double start = get_current_time();
-            int ret = layer->forward_inplace(bottom_top_blobs, opt);
-            double end = get_current_time();
-            benchmark(layer, start, end);
-#else
-            int ret = layer->forward_inplace(bottom_top_blobs, opt);
-#endif // NCNN_BENCHMARK
+            HardwareCounters counters_start;
+            HardwareCounters counters_end;
+            double start = profile_begin(opt, profiling, counters_start);
+            int ret = layer->forward_inplace(bottom_top_blobs, opt_layer);
+            double end = profile_end(opt, profiling, counters_end);
             if (ret != 0)
                 return ret;
 
+#if NCNN_BENCHMARK
+            benchmark(layer, bottom_top_blobs, bottom_top_blobs, start, end);
+#endif // NCNN_BENCHMARK
+            if (opt.profiler)
+            {
+                opt.profiler->record(layer_index, layer, bottom_top_blobs, bottom_top_blobs, start, end, counters_start, counters_end, opt_layer.num_threads, layer_impl);
+            }
+            if (opt.use_adaptive_threads)
+            {
+                update_adaptive_threads(layer_index, bottom_top_blobs, bottom_top_blobs);
+            }
+
             // store top blobs
             for (size_t i=0; i<layer->tops.size(); i++)
             {
                 int top_blob_index = layer->tops[i];
 
+                if (opt.use_fp16_storage && bottom_top_blobs[i].elemsize == 4u)
+                {
+                    // cast to fp16 for storing
+                    Mat top_blob_fp16;
+                    ncnn::cast_float32_to_float16(bottom_top_blobs[i], top_blob_fp16, opt.blob_allocator, opt.num_threads);
+                    if (top_blob_fp16.empty())
+                        return -100;
+
+                    bottom_top_blobs[i] = top_blob_fp16;
+                }
+
                 blob_mats[top_blob_index] = bottom_top_blobs[i];
             }
         }
         else
         {
             std::vector<Mat> top_blobs(layer->tops.size());
-#if NCNN_BENCHMARK
-            double start = get_current_time();
-            int ret = layer->forward(bottom_blobs, top_blobs, opt);
-            double end = get_current_time();
-            benchmark(layer, start, end);
-#else
-            int ret = layer->forward(bottom_blobs, top_blobs, opt);
-#endif // NCNN_BENCHMARK
+            HardwareCounters counters_start;
+            HardwareCounters counters_end;
+            double start = profile_begin(opt, profiling, counters_start);
+            int ret = layer->forward(bottom_blobs, top_blobs, opt_layer);
+            double end = profile_end(opt, profiling, counters_end);
             if (ret != 0)
                 return ret;
 
+#if NCNN_BENCHMARK
+            benchmark(layer, bottom_blobs, top_blobs, start, end);
+#endif // NCNN_BENCHMARK
+            if (opt.profiler)
+            {
+                opt.profiler->record(layer_index, layer, bottom_blobs, top_blobs, start, end, counters_start, counters_end, opt_layer.num_threads, layer_impl);
+            }
+            if (opt.use_adaptive_threads)
+            {
+                update_adaptive_threads(layer_index, bottom_blobs, top_blobs);
+            }
+
             // store top blobs
             for (size_t i=0; i<layer->tops.size(); i++)
             {
                 int top_blob_index = layer->tops[i];
 
+                if (opt.use_fp16_storage && top_blobs[i].elemsize == 4u)
+                {
+                    // cast to fp16 for storing
+                    Mat top_blob_fp16;
+                    ncnn::cast_float32_to_float16(top_blobs[i], top_blob_fp16, opt.blob_allocator, opt.num_threads);
+                    if (top_blob_fp16.empty())
+                        return -100;
+
+                    top_blobs[i] = top_blob_fp16;
+                }
+
                 blob_mats[top_blob_index] = top_blobs[i];
             }
         }
     }
 
+    if (!constant_key.empty())
+    {
+        save_constant(layer_index, constant_key, blob_mats);
+    }
+
 //     fprintf(stderr, "forward_layer %d %s done\n", layer_index, layer->name.c_str());
 //     const Mat& blob = blob_mats[layer->tops[0]];
 //     fprintf(stderr, "[%-2d %-16s %-16s]  %d    blobs count = %-3d   size = %-3d x %-3d\n", layer_index, layer->type.c_str(), layer->name.c_str(), layer->tops[0], blob.c, blob.h, blob.w);
@@ -1815,6 +2796,8 @@ Extractor::Extractor(const Net* _net, int blob_count) : net(_net)
     blob_mats.resize(blob_count);
     opt = get_default_option();
 
+    thread_affinity_pending = false;
+
 #if NCNN_VULKAN
     opt.vulkan_compute = net->use_vulkan_compute;
 
@@ -1840,6 +2823,11 @@ void Extractor::set_num_threads(int num_threads)
     opt.num_threads = num_threads;
 }
 
+void Extractor::set_adaptive_threads(bool enable)
+{
+    opt.use_adaptive_threads = enable;
+}
+
 void Extractor::set_blob_allocator(Allocator* allocator)
 {
     opt.blob_allocator = allocator;
@@ -1850,6 +2838,27 @@ void Extractor::set_workspace_allocator(Allocator* allocator)
     opt.workspace_allocator = allocator;
 }
 
+void Extractor::set_fp16_storage(bool enable)
+{
+    opt.use_fp16_storage = enable;
+}
+
+void Extractor::set_profiler(Profiler* profiler)
+{
+    opt.profiler = profiler;
+}
+
+void Extractor::set_executor(ParallelExecutor* executor)
+{
+    opt.executor = executor;
+}
+
+void Extractor::set_cpu_affinity(const CpuSet& mask)
+{
+    thread_affinity_mask = mask;
+    thread_affinity_pending = true;
+}
+
 #if NCNN_VULKAN
 void Extractor::set_vulkan_compute(bool enable)
 {
@@ -1920,6 +2929,14 @@ int Extractor::extract(int blob_index, Mat& feat)
     {
         int layer_index = net->blobs[blob_index].producer;
 
+        if (thread_affinity_pending)
+        {
+            if (set_omp_thread_affinity(thread_affinity_mask, opt.num_threads) != 0)
+                fprintf(stderr, "set_omp_thread_affinity failed\n");
+
+            thread_affinity_pending = false;
+        }
+
 #if NCNN_VULKAN
         if (opt.vulkan_compute)
         {
@@ -1972,6 +2989,28 @@ int Extractor::extract(int blob_index, Mat& feat)
 
     feat = blob_mats[blob_index];
 
+    if (opt.use_fp16_storage && feat.elemsize == 2u)
+    {
+        // cast to fp32 for user
+        Mat feat_fp32;
+        ncnn::cast_float16_to_float32(feat, feat_fp32, opt.blob_allocator, opt.num_threads);
+        if (feat_fp32.empty())
+            return -100;
+
+        feat = feat_fp32;
+    }
+    else
+    {
+        // constant blobs are shared with the net memo
+        int producer = net->blobs[blob_index].producer;
+        if (producer >= 0 && producer < (int)net->layer_constants.size() && net->layer_constants[producer] != 0 && !feat.empty())
+        {
+            feat = feat.clone(opt.blob_allocator);
+            if (feat.empty())
+                return -100;
+        }
+    }
+
     return ret;
 }
 
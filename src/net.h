@@ -18,9 +18,11 @@
 #include <stdio.h>
 #include <vector>
 #include "blob.h"
+#include "cpu.h"
 #include "layer.h"
 #include "mat.h"
 #include "platform.h"
+#include "profiler.h"
 
 namespace ncnn {
 
@@ -79,6 +81,42 @@ public:
     // unload network structure and weight data
     void clear();
 
+    // time every kernel implementation of the tunable layers
+    // on a dummy input of the shape declared by the input layers
+    // and keep the fastest one for each layer
+    // should be called after loading network structure and weight
+    // return 0 if success
+    int autotune();
+
+#if NCNN_STDIO
+    // save the kernel implementation decisions to plain tune file
+    // return 0 if success
+    int save_tune(const char* tunepath) const;
+
+    // apply the kernel implementation decisions from plain tune file
+    // should be called after loading network structure and weight
+    // return 0 if success
+    int load_tune(const char* tunepath);
+#endif // NCNN_STDIO
+
+    // time every layer with 1, 2, 4 ... up to the default option thread count
+    // on a dummy input of the shape declared by the input layers
+    // and keep the fastest count for each layer
+    // should be called after loading network structure and weight
+    // return 0 if success
+    int autotune_num_threads();
+
+#if NCNN_STDIO
+    // save the per layer thread counts to plain file
+    // return 0 if success
+    int save_num_threads(const char* path) const;
+
+    // apply the per layer thread counts from plain file
+    // should be called after loading network structure and weight
+    // return 0 if success
+    int load_num_threads(const char* path);
+#endif // NCNN_STDIO
+
     // construct an Extractor from network
     Extractor create_extractor() const;
 
@@ -104,6 +142,38 @@ public:
     // enable vulkan compute
     int use_vulkan_compute;
 
+    // keep convolution, innerproduct and lstm weight in half-precision
+    // halve weight memory, computation stays in float32
+    // changes should be applied before loading network structure and weight
+    // disabled by default
+    int use_fp16_storage;
+
+    // keep convolution and innerproduct weight in bfloat16
+    // halve weight memory with the float32 exponent range, computation stays in float32
+    // takes precedence over use_fp16_storage
+    // changes should be applied before loading network structure and weight
+    // disabled by default
+    int use_bf16_storage;
+
+    // keep innerproduct and lstm weight in int8 with one float scale per row
+    // weight-only quantization, activations stay in float32 and need no calibration
+    // quarter weight memory and bandwidth, takes precedence over use_fp16_storage and use_bf16_storage
+    // changes should be applied before loading network structure and weight
+    // disabled by default
+    int use_int8_weight_storage;
+
+    // same as use_int8_weight_storage with two 4-bit weights packed in a byte
+    // takes precedence over use_int8_weight_storage
+    // disabled by default
+    int use_int4_weight_storage;
+
+    // run 1x1 convolution and innerproduct on the sparse kernels when their weight is mostly zero
+    // for pruned models, such as the ones ncnnoptimize writes sparse
+    // takes precedence over the other weight storage
+    // changes should be applied before loading network structure and weight
+    // disabled by default
+    int use_sparse_weight;
+
 #if NCNN_VULKAN
 
     void set_vulkan_device(const VulkanDevice* vkdev);
@@ -115,6 +185,10 @@ protected:
     // fuse int8 op dequantize and quantize by requantize
     void fuse_network();
 
+    // mark the shape-only layers and the layers reading their constant blobs only
+    // and drop the memoised top blobs of the previous weight
+    void find_constant_layers();
+
 #if NCNN_VULKAN
 
     int upload_model();
@@ -134,6 +208,16 @@ protected:
 #endif // NCNN_STRING
     Layer* create_custom_layer(int index);
     int forward_layer(int layer_index, std::vector<Mat>& blob_mats, Option& opt) const;
+    int find_constant_key(int layer_index, std::vector<Mat>& blob_mats, Option& opt, std::vector<int>& key) const;
+    bool load_constant(int layer_index, const std::vector<int>& key, std::vector<Mat>& blob_mats, const Option& opt) const;
+    void save_constant(int layer_index, const std::vector<int>& key, std::vector<Mat>& blob_mats) const;
+
+    // forward the dummy input of the declared shape and keep every blob, for autotune
+    int forward_tune_input(std::vector<Mat>& blob_mats, Option& opt) const;
+
+    // the thread count a layer runs with
+    int layer_num_threads(int layer_index, const Option& opt) const;
+    void update_adaptive_threads(int layer_index, const std::vector<Mat>& bottom_blobs, const std::vector<Mat>& top_blobs) const;
 
 #if NCNN_VULKAN
     int forward_layer(int layer_index, std::vector<Mat>& blob_mats, std::vector<VkMat>& blob_mats_gpu, VkCompute& cmd, Option& opt) const;
@@ -143,6 +227,32 @@ protected:
     std::vector<Blob> blobs;
     std::vector<Layer*> layers;
 
+    // kernel implementation of each layer, 0 for the default heuristic
+    std::vector<int> layer_impls;
+
+    // 1 for shape-only layers, 2 for layers reading constant blobs only, 0 otherwise
+    std::vector<int> layer_constants;
+
+    // thread count of each layer, 0 for the option thread count
+    std::vector<int> layer_threads;
+
+    // thread count estimated from the work of the last forward, 0 before the first
+    // read and written atomically, the extractors running at once share it
+    mutable std::vector<int> layer_adaptive_threads;
+
+    // memoised top blobs of a constant layer
+    // keyed by the bottom shapes of a shape-only layer, by the entries of the bottoms otherwise
+    struct ConstantEntry
+    {
+        int serial;
+        std::vector<int> key;
+        std::vector<Mat> tops;
+    };
+
+    mutable std::vector< std::vector<ConstantEntry> > constant_entries;
+    mutable int constant_serial;
+    mutable Mutex constant_lock;
+
     std::vector<layer_registry_entry> custom_layer_registry;
 
 #if NCNN_VULKAN
@@ -172,12 +282,35 @@ public:
     // default count is system depended
     void set_num_threads(int num_threads);
 
+    // let every layer take fewer threads when its work is small
+    // disabled by default
+    void set_adaptive_threads(bool enable);
+
     // set blob memory allocator
     void set_blob_allocator(Allocator* allocator);
 
     // set workspace memory allocator
     void set_workspace_allocator(Allocator* allocator);
 
+    // store intermediate blobs in half precision
+    // halve blob memory, extracted blobs are float32
+    // disabled by default
+    void set_fp16_storage(bool enable);
+
+    // record the time, shapes and kernel of every forwarded layer into profiler
+    // export with Profiler::save_json or Profiler::save_trace
+    // null disables profiling, the default
+    void set_profiler(Profiler* profiler);
+
+    // run the parallel loops of the layers on executor, such as a ThreadPool
+    // null runs them on openmp, the default
+    void set_executor(ParallelExecutor* executor);
+
+    // bind the calling thread and its openmp threads to the cpus in mask, such as one slot of get_cpu_slots
+    // applied on the first extract, the threads stay bound afterwards
+    // the workers of a ThreadPool executor are bound with ThreadPool::set_thread_affinity
+    void set_cpu_affinity(const CpuSet& mask);
+
 #if NCNN_VULKAN
     void set_vulkan_compute(bool enable);
 
@@ -235,6 +368,9 @@ private:
     std::vector<Mat> blob_mats;
     Option opt;
 
+    CpuSet thread_affinity_mask;
+    bool thread_affinity_pending;
+
 #if NCNN_VULKAN
     std::vector<VkMat> blob_mats_gpu;
 #endif // NCNN_VULKAN
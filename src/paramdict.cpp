@@ -26,6 +26,11 @@ ParamDict::ParamDict()
     use_sgemm_convolution = 1;
     use_int8_inference = 1;
     use_vulkan_compute = 0;
+    use_fp16_storage = 0;
+    use_bf16_storage = 0;
+    use_int8_weight_storage = 0;
+    use_int4_weight_storage = 0;
+    use_sparse_weight = 0;
 
     clear();
 }
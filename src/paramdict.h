@@ -50,6 +50,11 @@ public:
     int use_sgemm_convolution;
     int use_int8_inference;
     int use_vulkan_compute;
+    int use_fp16_storage;
+    int use_bf16_storage;
+    int use_int8_weight_storage;
+    int use_int4_weight_storage;
+    int use_sparse_weight;
 
 protected:
     friend class Net;
@@ -0,0 +1,563 @@
+// Tencent is pleased to support the open source community by making ncnn available.
+//
+// Copyright (C) 2019 THL A29 Limited, a Tencent company. All rights reserved.
+//
+// Licensed under the BSD 3-Clause License (the "License"); you may not use this file except
+// in compliance with the License. You may obtain a copy of the License at
+//
+// https://opensource.org/licenses/BSD-3-Clause
+//
+// Unless required by applicable law or agreed to in writing, software distributed
+// under the License is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR
+// CONDITIONS OF ANY KIND, either express or implied. See the License for the
+// specific language governing permissions and limitations under the License.
+
+#include "profiler.h"
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+#elif defined __linux__
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#else
+#include <pthread.h>
+#endif // _WIN32
+
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
+#include <stdio.h>
+#include <string.h>
+#include "benchmark.h"
+#include "layer.h"
+#include "threadpool.h"
+
+namespace ncnn {
+
+static int get_current_thread_id()
+{
+#ifdef _WIN32
+    return (int)GetCurrentThreadId();
+#elif defined __linux__
+    // the kernel thread id, the same as in perf and top
+    return (int)syscall(SYS_gettid);
+#else
+    return (int)((size_t)pthread_self() & 0x7fffffff);
+#endif
+}
+
+static BlobShape blob_shape(const Mat& m)
+{
+    BlobShape shape;
+    shape.dims = m.dims;
+    shape.w = m.w;
+    shape.h = m.h;
+    shape.c = m.c;
+    shape.elemsize = m.elemsize;
+    return shape;
+}
+
+HardwareCounters::HardwareCounters()
+{
+    cycles = 0;
+    instructions = 0;
+    llc_misses = 0;
+    branch_misses = 0;
+    fp_ops = 0;
+}
+
+// counter slot order of the perf_event groups
+enum
+{
+    COUNTER_CYCLES = 0,
+    COUNTER_INSTRUCTIONS = 1,
+    COUNTER_LLC_MISSES = 2,
+    COUNTER_BRANCH_MISSES = 3,
+    COUNTER_FP_OPS = 4,
+    COUNTER_COUNT = 5
+};
+
+static unsigned long long& counter_value(HardwareCounters& counters, int slot)
+{
+    switch (slot)
+    {
+    case COUNTER_CYCLES: return counters.cycles;
+    case COUNTER_INSTRUCTIONS: return counters.instructions;
+    case COUNTER_LLC_MISSES: return counters.llc_misses;
+    case COUNTER_BRANCH_MISSES: return counters.branch_misses;
+    default: return counters.fp_ops;
+    }
+}
+
+static void add_counters(HardwareCounters& sum, const HardwareCounters& counters)
+{
+    sum.cycles += counters.cycles;
+    sum.instructions += counters.instructions;
+    sum.llc_misses += counters.llc_misses;
+    sum.branch_misses += counters.branch_misses;
+    sum.fp_ops += counters.fp_ops;
+}
+
+static void add_cost(LayerCost& sum, const LayerCost& cost)
+{
+    sum.macs += cost.macs;
+    sum.flops += cost.flops;
+    sum.weight_bytes += cost.weight_bytes;
+    sum.bottom_bytes += cost.bottom_bytes;
+    sum.top_bytes += cost.top_bytes;
+}
+
+#if defined __linux__
+static int perf_event_open_counter(unsigned int type, unsigned long long config, int group_fd)
+{
+    struct perf_event_attr attr;
+    memset(&attr, 0, sizeof(attr));
+    attr.size = sizeof(attr);
+    attr.type = type;
+    attr.config = config;
+    attr.disabled = group_fd == -1 ? 1 : 0;
+    attr.exclude_kernel = 1;
+    attr.exclude_hv = 1;
+    attr.read_format = PERF_FORMAT_GROUP;
+
+    // pid 0 and cpu -1 follow the calling thread on any cpu
+    return (int)syscall(SYS_perf_event_open, &attr, 0, -1, group_fd, 0);
+}
+
+// open one group on the calling thread, the events the cpu lacks are left out
+static void open_counter_group(unsigned long long fp_raw_event, std::vector<int>& fds, std::vector<int>& slots)
+{
+    const unsigned int types[COUNTER_COUNT] = {
+        PERF_TYPE_HARDWARE, PERF_TYPE_HARDWARE, PERF_TYPE_HARDWARE, PERF_TYPE_HARDWARE, PERF_TYPE_RAW
+    };
+    const unsigned long long configs[COUNTER_COUNT] = {
+        PERF_COUNT_HW_CPU_CYCLES, PERF_COUNT_HW_INSTRUCTIONS, PERF_COUNT_HW_CACHE_MISSES, PERF_COUNT_HW_BRANCH_MISSES, fp_raw_event
+    };
+
+    for (int i=0; i<COUNTER_COUNT; i++)
+    {
+        if (i == COUNTER_FP_OPS && fp_raw_event == 0)
+            break;
+
+        int fd = perf_event_open_counter(types[i], configs[i], fds.empty() ? -1 : fds[0]);
+        if (fd == -1)
+            continue;
+
+        fds.push_back(fd);
+        slots.push_back(i);
+    }
+
+    if (fds.empty())
+        return;
+
+    ioctl(fds[0], PERF_EVENT_IOC_RESET, PERF_IOC_FLAG_GROUP);
+    ioctl(fds[0], PERF_EVENT_IOC_ENABLE, PERF_IOC_FLAG_GROUP);
+}
+
+// open one group on every executor thread but the caller, which has one from the openmp team
+class OpenCounterGroupTask : public ParallelTask
+{
+public:
+    OpenCounterGroupTask(unsigned long long _fp_raw_event, int _caller_thread_id, std::vector<std::vector<int> >& _fds, std::vector<std::vector<int> >& _slots)
+        : fp_raw_event(_fp_raw_event), caller_thread_id(_caller_thread_id), fds(_fds), slots(_slots)
+    {
+    }
+
+    virtual void execute(int /*begin*/, int /*end*/, int thread_id) const
+    {
+        if (get_current_thread_id() == caller_thread_id || !fds[thread_id].empty())
+            return;
+
+        open_counter_group(fp_raw_event, fds[thread_id], slots[thread_id]);
+    }
+
+private:
+    unsigned long long fp_raw_event;
+    int caller_thread_id;
+    std::vector<std::vector<int> >& fds;
+    std::vector<std::vector<int> >& slots;
+};
+#endif // __linux__
+
+Profiler::Profiler()
+{
+    origin = get_current_time();
+}
+
+Profiler::~Profiler()
+{
+    disable_hardware_counters();
+}
+
+void Profiler::clear()
+{
+    MutexLockGuard guard(lock);
+
+    profiles.clear();
+    origin = get_current_time();
+}
+
+std::vector<LayerProfile> Profiler::layer_profiles() const
+{
+    MutexLockGuard guard(lock);
+
+    return profiles;
+}
+
+std::vector<LayerTypeProfile> Profiler::layer_type_profiles() const
+{
+    MutexLockGuard guard(lock);
+
+    std::vector<LayerTypeProfile> type_profiles;
+    for (size_t i=0; i<profiles.size(); i++)
+    {
+        const LayerProfile& profile = profiles[i];
+
+        size_t j = 0;
+        for (; j<type_profiles.size(); j++)
+        {
+#if NCNN_STRING
+            if (type_profiles[j].type == profile.type)
+                break;
+#else
+            if (type_profiles[j].typeindex == profile.typeindex)
+                break;
+#endif // NCNN_STRING
+        }
+
+        if (j == type_profiles.size())
+        {
+            LayerTypeProfile type_profile;
+            type_profile.typeindex = profile.typeindex;
+#if NCNN_STRING
+            type_profile.type = profile.type;
+#endif // NCNN_STRING
+            type_profile.count = 0;
+            type_profile.time = 0;
+            type_profiles.push_back(type_profile);
+        }
+
+        LayerTypeProfile& type_profile = type_profiles[j];
+        type_profile.count++;
+        type_profile.time += profile.time;
+        add_cost(type_profile.cost, profile.cost);
+        add_counters(type_profile.counters, profile.counters);
+    }
+
+    return type_profiles;
+}
+
+double Profiler::total_time() const
+{
+    MutexLockGuard guard(lock);
+
+    double sum = 0;
+    for (size_t i=0; i<profiles.size(); i++)
+    {
+        sum += profiles[i].time;
+    }
+
+    return sum;
+}
+
+int Profiler::enable_hardware_counters(int num_threads, unsigned long long fp_raw_event, ParallelExecutor* executor)
+{
+    disable_hardware_counters();
+
+#if defined __linux__
+    if (num_threads < 1)
+        num_threads = 1;
+
+    // the openmp team first, then the executor threads
+    std::vector<std::vector<int> > fds(num_threads * 2);
+    std::vector<std::vector<int> > slots(num_threads * 2);
+
+    // perf_event follows a single thread, open one group on every worker of the team
+#ifdef _OPENMP
+    #pragma omp parallel num_threads(num_threads)
+    {
+        int i = omp_get_thread_num();
+        open_counter_group(fp_raw_event, fds[i], slots[i]);
+    }
+#else
+    open_counter_group(fp_raw_event, fds[0], slots[0]);
+#endif // _OPENMP
+
+    // the executor workers are threads of their own, one item per thread
+    if (executor)
+    {
+        std::vector<std::vector<int> > executor_fds(num_threads);
+        std::vector<std::vector<int> > executor_slots(num_threads);
+
+        OpenCounterGroupTask task(fp_raw_event, get_current_thread_id(), executor_fds, executor_slots);
+        executor->parallel_for(num_threads, task, num_threads, ParallelSchedule_STATIC);
+
+        for (int i=0; i<num_threads; i++)
+        {
+            fds[num_threads + i].swap(executor_fds[i]);
+            slots[num_threads + i].swap(executor_slots[i]);
+        }
+    }
+
+    for (int i=0; i<num_threads * 2; i++)
+    {
+        if (fds[i].empty())
+            continue;
+
+        counter_fds.push_back(fds[i]);
+        counter_slots.push_back(slots[i]);
+    }
+
+    if (counter_fds.empty())
+    {
+        fprintf(stderr, "perf_event_open failed, check /proc/sys/kernel/perf_event_paranoid\n");
+        return -1;
+    }
+
+    return 0;
+#else
+    (void)num_threads;
+    (void)fp_raw_event;
+    (void)executor;
+    fprintf(stderr, "hardware counters need linux perf_event_open\n");
+    return -1;
+#endif // __linux__
+}
+
+void Profiler::disable_hardware_counters()
+{
+#if defined __linux__
+    for (size_t i=0; i<counter_fds.size(); i++)
+    {
+        for (size_t j=0; j<counter_fds[i].size(); j++)
+        {
+            close(counter_fds[i][j]);
+        }
+    }
+#endif // __linux__
+
+    counter_fds.clear();
+    counter_slots.clear();
+}
+
+bool Profiler::has_hardware_counters() const
+{
+    return !counter_fds.empty();
+}
+
+void Profiler::read_counters(HardwareCounters& counters) const
+{
+#if defined __linux__
+    for (size_t i=0; i<counter_fds.size(); i++)
+    {
+        const std::vector<int>& slots = counter_slots[i];
+
+        // PERF_FORMAT_GROUP layout, the event count then one value per event
+        unsigned long long values[1 + COUNTER_COUNT];
+        ssize_t nread = read(counter_fds[i][0], values, sizeof(values));
+        if (nread < (ssize_t)sizeof(unsigned long long))
+            continue;
+
+        for (size_t j=0; j<slots.size() && j<values[0]; j++)
+        {
+            counter_value(counters, slots[j]) += values[1 + j];
+        }
+    }
+#else
+    (void)counters;
+#endif // __linux__
+}
+
+void Profiler::record(int layer_index, const Layer* layer, const std::vector<Mat>& bottom_blobs, const std::vector<Mat>& top_blobs, double start, double end, const HardwareCounters& counters_start, const HardwareCounters& counters_end, int num_threads, int impl)
+{
+    LayerProfile profile;
+    profile.layer_index = layer_index;
+    profile.typeindex = layer->typeindex;
+#if NCNN_STRING
+    profile.type = layer->type;
+    profile.name = layer->name;
+#endif // NCNN_STRING
+    profile.time = end - start;
+    profile.thread_id = get_current_thread_id();
+    profile.num_threads = num_threads;
+    profile.impl = impl;
+    profile.bytes = 0;
+
+    layer->get_cost(bottom_blobs, top_blobs, profile.cost);
+
+    profile.counters.cycles = counters_end.cycles - counters_start.cycles;
+    profile.counters.instructions = counters_end.instructions - counters_start.instructions;
+    profile.counters.llc_misses = counters_end.llc_misses - counters_start.llc_misses;
+    profile.counters.branch_misses = counters_end.branch_misses - counters_start.branch_misses;
+    profile.counters.fp_ops = counters_end.fp_ops - counters_start.fp_ops;
+
+    for (size_t i=0; i<bottom_blobs.size(); i++)
+    {
+        profile.bottoms.push_back(blob_shape(bottom_blobs[i]));
+    }
+
+    for (size_t i=0; i<top_blobs.size(); i++)
+    {
+        const Mat& m = top_blobs[i];
+        profile.tops.push_back(blob_shape(m));
+
+        // inplace and split tops share the memory of a bottom or another top
+        bool shared = false;
+        for (size_t j=0; j<bottom_blobs.size(); j++)
+        {
+            if (bottom_blobs[j].data == m.data)
+                shared = true;
+        }
+        for (size_t j=0; j<i; j++)
+        {
+            if (top_blobs[j].data == m.data)
+                shared = true;
+        }
+
+        if (!shared)
+            profile.bytes += m.total() * m.elemsize;
+    }
+
+    MutexLockGuard guard(lock);
+
+    profile.start = start - origin;
+    profiles.push_back(profile);
+}
+
+#if NCNN_STDIO
+// layer names come from the param file, keep the json valid
+static void fprint_json_string(FILE* fp, const std::string& s)
+{
+    fputc('"', fp);
+    for (size_t i=0; i<s.size(); i++)
+    {
+        unsigned char ch = s[i];
+        if (ch == '"' || ch == '\\')
+            fprintf(fp, "\\%c", ch);
+        else if (ch < 0x20)
+            fprintf(fp, "\\u%04x", ch);
+        else
+            fputc(ch, fp);
+    }
+    fputc('"', fp);
+}
+
+static void fprint_json_shapes(FILE* fp, const std::vector<BlobShape>& shapes)
+{
+    fprintf(fp, "[");
+    for (size_t i=0; i<shapes.size(); i++)
+    {
+        const BlobShape& shape = shapes[i];
+        fprintf(fp, "%s{\"dims\": %d, \"w\": %d, \"h\": %d, \"c\": %d, \"elemsize\": %d}", i == 0 ? "" : ", ", shape.dims, shape.w, shape.h, shape.c, (int)shape.elemsize);
+    }
+    fprintf(fp, "]");
+}
+
+static void fprint_json_counters(FILE* fp, const HardwareCounters& counters)
+{
+    fprintf(fp, ", \"cycles\": %llu, \"instructions\": %llu, \"llc_misses\": %llu, \"branch_misses\": %llu, \"fp_ops\": %llu",
+            counters.cycles, counters.instructions, counters.llc_misses, counters.branch_misses, counters.fp_ops);
+}
+
+static void fprint_json_cost(FILE* fp, const LayerCost& cost)
+{
+    fprintf(fp, ", \"macs\": %llu, \"flops\": %llu, \"weight_bytes\": %lu, \"bottom_bytes\": %lu, \"top_bytes\": %lu",
+            cost.macs, cost.flops, (unsigned long)cost.weight_bytes, (unsigned long)cost.bottom_bytes, (unsigned long)cost.top_bytes);
+}
+
+static void fprint_json_layer_name(FILE* fp, const LayerProfile& profile)
+{
+#if NCNN_STRING
+    fprintf(fp, "\"type\": ");
+    fprint_json_string(fp, profile.type);
+    fprintf(fp, ", \"name\": ");
+    fprint_json_string(fp, profile.name);
+#else
+    fprintf(fp, "\"type\": \"%d\", \"name\": \"%d\"", profile.typeindex, profile.layer_index);
+#endif // NCNN_STRING
+}
+
+int Profiler::save_json(const char* path) const
+{
+    FILE* fp = fopen(path, "wb");
+    if (!fp)
+    {
+        fprintf(stderr, "fopen %s failed\n", path);
+        return -1;
+    }
+
+    std::vector<LayerProfile> records = layer_profiles();
+
+    fprintf(fp, "[\n");
+    for (size_t i=0; i<records.size(); i++)
+    {
+        const LayerProfile& profile = records[i];
+
+        fprintf(fp, "  {\"index\": %d, ", profile.layer_index);
+        fprint_json_layer_name(fp, profile);
+        fprintf(fp, ", \"start\": %.6f, \"time\": %.6f, \"thread_id\": %d, \"num_threads\": %d, \"impl\": %d, \"bytes\": %lu, \"bottoms\": ",
+                profile.start, profile.time, profile.thread_id, profile.num_threads, profile.impl, (unsigned long)profile.bytes);
+        fprint_json_shapes(fp, profile.bottoms);
+        fprintf(fp, ", \"tops\": ");
+        fprint_json_shapes(fp, profile.tops);
+        fprint_json_cost(fp, profile.cost);
+        if (has_hardware_counters())
+            fprint_json_counters(fp, profile.counters);
+        fprintf(fp, "}%s\n", i + 1 == records.size() ? "" : ",");
+    }
+    fprintf(fp, "]\n");
+
+    fclose(fp);
+
+    return 0;
+}
+
+int Profiler::save_trace(const char* path) const
+{
+    FILE* fp = fopen(path, "wb");
+    if (!fp)
+    {
+        fprintf(stderr, "fopen %s failed\n", path);
+        return -1;
+    }
+
+    std::vector<LayerProfile> records = layer_profiles();
+
+    // complete events, timestamps in microseconds
+    fprintf(fp, "{\"traceEvents\": [\n");
+    for (size_t i=0; i<records.size(); i++)
+    {
+        const LayerProfile& profile = records[i];
+
+        fprintf(fp, "  {\"ph\": \"X\", \"pid\": 0, \"tid\": %d, \"ts\": %.3f, \"dur\": %.3f, ", profile.thread_id, profile.start * 1000, profile.time * 1000);
+#if NCNN_STRING
+        fprintf(fp, "\"name\": ");
+        fprint_json_string(fp, profile.name);
+        fprintf(fp, ", \"cat\": ");
+        fprint_json_string(fp, profile.type);
+#else
+        fprintf(fp, "\"name\": \"%d\", \"cat\": \"%d\"", profile.layer_index, profile.typeindex);
+#endif // NCNN_STRING
+        fprintf(fp, ", \"args\": {\"index\": %d, \"num_threads\": %d, \"impl\": %d, \"bytes\": %lu, \"bottoms\": ",
+                profile.layer_index, profile.num_threads, profile.impl, (unsigned long)profile.bytes);
+        fprint_json_shapes(fp, profile.bottoms);
+        fprintf(fp, ", \"tops\": ");
+        fprint_json_shapes(fp, profile.tops);
+        fprint_json_cost(fp, profile.cost);
+        if (has_hardware_counters())
+            fprint_json_counters(fp, profile.counters);
+        fprintf(fp, "}}%s\n", i + 1 == records.size() ? "" : ",");
+    }
+    fprintf(fp, "], \"displayTimeUnit\": \"ms\"}\n");
+
+    fclose(fp);
+
+    return 0;
+}
+#endif // NCNN_STDIO
+
+} // namespace ncnn
@@ -0,0 +1,173 @@
+// Tencent is pleased to support the open source community by making ncnn available.
+//
+// Copyright (C) 2019 THL A29 Limited, a Tencent company. All rights reserved.
+//
+// Licensed under the BSD 3-Clause License (the "License"); you may not use this file except
+// in compliance with the License. You may obtain a copy of the License at
+//
+// https://opensource.org/licenses/BSD-3-Clause
+//
+// Unless required by applicable law or agreed to in writing, software distributed
+// under the License is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR
+// CONDITIONS OF ANY KIND, either express or implied. See the License for the
+// specific language governing permissions and limitations under the License.
+
+#ifndef NCNN_PROFILER_H
+#define NCNN_PROFILER_H
+
+#include <string>
+#include <vector>
+#include "platform.h"
+#include "allocator.h"
+#include "layer.h"
+#include "mat.h"
+
+namespace ncnn {
+
+class ParallelExecutor;
+
+// hardware counter values, zero for the events the cpu or kernel does not provide
+class HardwareCounters
+{
+public:
+    HardwareCounters();
+
+    unsigned long long cycles;
+    unsigned long long instructions;
+    unsigned long long llc_misses;
+    unsigned long long branch_misses;
+
+    // the optional raw event, usually a floating point operation count
+    unsigned long long fp_ops;
+};
+
+// shape of a bottom or top blob
+class BlobShape
+{
+public:
+    int dims;
+    int w;
+    int h;
+    int c;
+    size_t elemsize;
+};
+
+// one forwarded layer
+class LayerProfile
+{
+public:
+    int layer_index;
+    int typeindex;
+#if NCNN_STRING
+    std::string type;
+    std::string name;
+#endif // NCNN_STRING
+
+    // milliseconds, start is relative to the profiler clock origin
+    double start;
+    double time;
+
+    // calling thread and the thread count of the extractor
+    int thread_id;
+    int num_threads;
+
+    // kernel implementation, 0 for the default heuristic
+    int impl;
+
+    // bytes of the top blobs allocated by this layer, inplace and shared tops count zero
+    size_t bytes;
+
+    std::vector<BlobShape> bottoms;
+    std::vector<BlobShape> tops;
+
+    // analytical macs and bytes from Layer::get_cost
+    LayerCost cost;
+
+    // summed over the worker threads, all zero without hardware counters
+    HardwareCounters counters;
+};
+
+// records of one layer type added up
+class LayerTypeProfile
+{
+public:
+    int typeindex;
+#if NCNN_STRING
+    std::string type;
+#endif // NCNN_STRING
+
+    int count;
+    double time;
+    LayerCost cost;
+    HardwareCounters counters;
+};
+
+// per-layer profiler, attach to an extractor with Extractor::set_profiler
+// one profiler may collect from several extractors and threads
+class Profiler
+{
+public:
+    // clock origin is the construction time
+    Profiler();
+    ~Profiler();
+
+    // drop the records and reset the clock origin
+    void clear();
+
+    // records in forward order
+    std::vector<LayerProfile> layer_profiles() const;
+
+    // records added up per layer type, in the order each type first ran
+    std::vector<LayerTypeProfile> layer_type_profiles() const;
+
+    // sum of the layer time in milliseconds
+    double total_time() const;
+
+    // read cycles, instructions, llc misses and branch misses around every layer with linux perf_event_open
+    // the counters follow the calling thread and the openmp team of num_threads it forwards with,
+    // so enable from the thread that runs the extractor and keep opt.num_threads the same
+    // pass the executor set on the extractor, such as a ThreadPool, to follow its workers as well
+    // fp_raw_event is a model specific PERF_TYPE_RAW config for fp_ops, 0 to skip
+    // return 0 if success, -1 if perf_event_open is not available
+    int enable_hardware_counters(int num_threads, unsigned long long fp_raw_event = 0, ParallelExecutor* executor = 0);
+
+    void disable_hardware_counters();
+
+    bool has_hardware_counters() const;
+
+#if NCNN_STDIO
+    // save the records as a json array
+    // return 0 if success
+    int save_json(const char* path) const;
+
+    // save the records in chrome trace_event format
+    // open with chrome://tracing or perfetto
+    // return 0 if success
+    int save_trace(const char* path) const;
+#endif // NCNN_STDIO
+
+public:
+    // called by net around each layer forward, left zero without hardware counters
+    void read_counters(HardwareCounters& counters) const;
+
+    // called by net after each layer forward, start and end from get_current_time()
+    void record(int layer_index, const Layer* layer, const std::vector<Mat>& bottom_blobs, const std::vector<Mat>& top_blobs, double start, double end, const HardwareCounters& counters_start, const HardwareCounters& counters_end, int num_threads, int impl);
+
+private:
+    // owns the counter file descriptors
+    Profiler(const Profiler&);
+    Profiler& operator=(const Profiler&);
+
+    mutable Mutex lock;
+    double origin;
+    std::vector<LayerProfile> profiles;
+
+    // one perf_event group per worker thread, leader first
+    // each entry is the group fd list and the counter slot of every fd
+    std::vector<std::vector<int> > counter_fds;
+    std::vector<std::vector<int> > counter_slots;
+};
+
+} // namespace ncnn
+
+#endif // NCNN_PROFILER_H
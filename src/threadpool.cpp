@@ -0,0 +1,384 @@
+// Tencent is pleased to support the open source community by making ncnn available.
+//
+// Copyright (C) 2019 THL A29 Limited, a Tencent company. All rights reserved.
+//
+// Licensed under the BSD 3-Clause License (the "License"); you may not use this file except
+// in compliance with the License. You may obtain a copy of the License at
+//
+// https://opensource.org/licenses/BSD-3-Clause
+//
+// Unless required by applicable law or agreed to in writing, software distributed
+// under the License is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR
+// CONDITIONS OF ANY KIND, either express or implied. See the License for the
+// specific language governing permissions and limitations under the License.
+
+#include "threadpool.h"
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+#else
+#include <pthread.h>
+#endif // _WIN32
+
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
+#include <algorithm>
+
+namespace ncnn {
+
+ParallelTask::~ParallelTask()
+{
+}
+
+ParallelExecutor::~ParallelExecutor()
+{
+}
+
+class ThreadPoolWorker
+{
+public:
+    ThreadPoolWorker(ThreadPool* _pool, int _worker_id) : pool(_pool), worker_id(_worker_id)
+    {
+        generation = 0;
+        sleeping = 0;
+
+#ifdef _WIN32
+        thread = CreateThread(0, 0, start, this, 0, 0);
+#else
+        pthread_create(&thread, 0, start, this);
+#endif
+    }
+
+    void join()
+    {
+#ifdef _WIN32
+        WaitForSingleObject(thread, INFINITE);
+        CloseHandle(thread);
+#else
+        pthread_join(thread, 0);
+#endif
+    }
+
+    // hand a loop to this worker, write the loop before
+    void wake()
+    {
+        NCNN_XADD(&generation, 1);
+
+        // the worker marks itself sleeping before it checks generation, so one of the two sees the other
+        if (NCNN_XADD(&sleeping, 0))
+        {
+            lock.lock();
+            condition.signal();
+            lock.unlock();
+        }
+    }
+
+    ThreadPool* pool;
+    int worker_id;
+
+    // atomic counters, generation is bumped for every loop this worker takes part in
+    int generation;
+    int sleeping;
+
+    // guards the sleeping worker
+    Mutex lock;
+    ConditionVariable condition;
+
+private:
+#ifdef _WIN32
+    static DWORD WINAPI start(LPVOID args)
+#else
+    static void* start(void* args)
+#endif
+    {
+        ThreadPoolWorker* worker = (ThreadPoolWorker*)args;
+        worker->pool->worker_main(worker);
+        return 0;
+    }
+
+#ifdef _WIN32
+    HANDLE thread;
+#else
+    pthread_t thread;
+#endif
+};
+
+// atomic load with a full barrier
+static inline int atomic_load(int* addr)
+{
+    return NCNN_XADD(addr, 0);
+}
+
+ThreadPool::ThreadPool(int num_threads)
+{
+    spin_count = 10000;
+
+    task = 0;
+    task_size = 0;
+    task_threads = 0;
+    task_schedule = ParallelSchedule_STATIC;
+
+    next_item = 0;
+    pending_workers = 0;
+    stop = 0;
+    affinity_serial = 0;
+
+    for (int i=1; i<num_threads; i++)
+    {
+        workers.push_back(new ThreadPoolWorker(this, i));
+    }
+}
+
+ThreadPool::~ThreadPool()
+{
+    NCNN_XADD(&stop, 1);
+
+    for (size_t i=0; i<workers.size(); i++)
+    {
+        workers[i]->lock.lock();
+        workers[i]->condition.signal();
+        workers[i]->lock.unlock();
+    }
+
+    for (size_t i=0; i<workers.size(); i++)
+    {
+        workers[i]->join();
+        delete workers[i];
+    }
+}
+
+int ThreadPool::get_num_threads() const
+{
+    return (int)workers.size() + 1;
+}
+
+void ThreadPool::set_spin_count(int _spin_count)
+{
+    spin_count = _spin_count;
+}
+
+// wakes every worker and does nothing
+class NoopTask : public ParallelTask
+{
+public:
+    virtual void execute(int /*begin*/, int /*end*/, int /*thread_id*/) const {}
+};
+
+void ThreadPool::set_thread_affinity(const CpuSet& mask)
+{
+    lock.lock();
+    thread_affinity_mask = mask;
+    NCNN_XADD(&affinity_serial, 1);
+    lock.unlock();
+
+    // a loop on every thread wakes all the workers, the busy pool hands the mask over on its next loop instead
+    NoopTask noop;
+    parallel_for(get_num_threads(), noop, get_num_threads(), ParallelSchedule_STATIC);
+}
+
+void ThreadPool::parallel_for(int n, const ParallelTask& _task, int num_threads, int schedule)
+{
+    if (n <= 0)
+        return;
+
+    num_threads = std::min(num_threads, get_num_threads());
+    num_threads = std::min(num_threads, n);
+
+    // busy with another loop, or nested in a task of this pool
+    if (num_threads <= 1 || !dispatch_lock.trylock())
+    {
+        _task.execute(0, n, 0);
+        return;
+    }
+
+    task = &_task;
+    task_size = n;
+    task_threads = num_threads;
+    task_schedule = schedule;
+    next_item = 0;
+
+    // only the workers of this loop are woken, the others keep sleeping
+    // a worker acknowledges before the next loop can bump its generation again
+    pending_workers = num_threads - 1;
+
+    for (int i=0; i<num_threads-1; i++)
+    {
+        workers[i]->wake();
+    }
+
+    run_share(0);
+
+    for (int i=0; i<spin_count && *(volatile int*)&pending_workers > 0; i++)
+    {
+    }
+
+    if (atomic_load(&pending_workers) > 0)
+    {
+        lock.lock();
+        while (atomic_load(&pending_workers) > 0)
+        {
+            done_condition.wait(lock);
+        }
+        lock.unlock();
+    }
+
+    task = 0;
+
+    dispatch_lock.unlock();
+}
+
+void ThreadPool::worker_main(ThreadPoolWorker* worker)
+{
+    int seen = 0;
+    int seen_affinity = 0;
+
+    // the spin follows the gap between loops, it halves when the worker ends up sleeping
+    // and doubles back up to spin_count when the next loop comes in while spinning
+    int spin_limit = spin_count;
+
+    for (;;)
+    {
+        // spin for the next loop, then sleep
+        const int max_spin = *(volatile int*)&spin_count;
+        spin_limit = std::min(spin_limit, max_spin);
+
+        int i = 0;
+        for (; i<spin_limit; i++)
+        {
+            if (*(volatile int*)&worker->generation != seen || *(volatile int*)&stop)
+                break;
+        }
+
+        if (i < spin_limit)
+        {
+            spin_limit = std::min(spin_limit * 2, max_spin);
+        }
+        else
+        {
+            spin_limit = std::max(spin_limit / 2, std::min(max_spin, 1000));
+
+            worker->lock.lock();
+            NCNN_XADD(&worker->sleeping, 1);
+            while (atomic_load(&worker->generation) == seen && !atomic_load(&stop))
+            {
+                worker->condition.wait(worker->lock);
+            }
+            NCNN_XADD(&worker->sleeping, -1);
+            worker->lock.unlock();
+        }
+
+        if (atomic_load(&stop))
+            break;
+
+        seen = atomic_load(&worker->generation);
+
+        if (atomic_load(&affinity_serial) != seen_affinity)
+        {
+            lock.lock();
+            CpuSet mask = thread_affinity_mask;
+            seen_affinity = atomic_load(&affinity_serial);
+            lock.unlock();
+
+            set_cpu_thread_affinity(mask);
+        }
+
+        run_share(worker->worker_id);
+
+        if (NCNN_XADD(&pending_workers, -1) == 1)
+        {
+            lock.lock();
+            done_condition.signal();
+            lock.unlock();
+        }
+    }
+}
+
+void ThreadPool::run_share(int thread_id)
+{
+    if (task_schedule == ParallelSchedule_GUIDED)
+    {
+        // half of the even share of what is left, at least one item
+        for (;;)
+        {
+            int begin = NCNN_XADD(&next_item, 0);
+            int remaining = task_size - begin;
+            if (remaining <= 0)
+                break;
+
+            int chunk = std::max(remaining / (task_threads * 2), 1);
+            begin = NCNN_XADD(&next_item, chunk);
+            if (begin >= task_size)
+                break;
+
+            task->execute(begin, std::min(begin + chunk, task_size), thread_id);
+        }
+
+        return;
+    }
+
+    int begin = (int)((long long)task_size * thread_id / task_threads);
+    int end = (int)((long long)task_size * (thread_id + 1) / task_threads);
+    if (begin < end)
+        task->execute(begin, end, thread_id);
+}
+
+static Mutex g_default_thread_pool_lock;
+static ThreadPool* g_default_thread_pool = 0;
+
+class DefaultThreadPoolHolder
+{
+public:
+    ~DefaultThreadPoolHolder() { delete g_default_thread_pool; }
+};
+static DefaultThreadPoolHolder g_default_thread_pool_holder;
+
+ThreadPool* get_default_thread_pool()
+{
+    MutexLockGuard guard(g_default_thread_pool_lock);
+
+    if (!g_default_thread_pool)
+        g_default_thread_pool = new ThreadPool(get_cpu_count());
+
+    return g_default_thread_pool;
+}
+
+void parallel_for(int n, const ParallelTask& task, const Option& opt, int schedule)
+{
+    if (opt.executor)
+    {
+        opt.executor->parallel_for(n, task, opt.num_threads, schedule);
+        return;
+    }
+
+#ifdef _OPENMP
+    if (schedule == ParallelSchedule_GUIDED)
+    {
+        #pragma omp parallel for schedule(guided) num_threads(opt.num_threads)
+        for (int i=0; i<n; i++)
+        {
+            task.execute(i, i + 1, omp_get_thread_num());
+        }
+
+        return;
+    }
+
+    const int num_threads = std::max(std::min(opt.num_threads, n), 1);
+
+    #pragma omp parallel for num_threads(num_threads)
+    for (int t=0; t<num_threads; t++)
+    {
+        int begin = (int)((long long)n * t / num_threads);
+        int end = (int)((long long)n * (t + 1) / num_threads);
+        if (begin < end)
+            task.execute(begin, end, t);
+    }
+#else
+    if (n > 0)
+        task.execute(0, n, 0);
+#endif // _OPENMP
+}
+
+} // namespace ncnn
@@ -0,0 +1,130 @@
+// Tencent is pleased to support the open source community by making ncnn available.
+//
+// Copyright (C) 2019 THL A29 Limited, a Tencent company. All rights reserved.
+//
+// Licensed under the BSD 3-Clause License (the "License"); you may not use this file except
+// in compliance with the License. You may obtain a copy of the License at
+//
+// https://opensource.org/licenses/BSD-3-Clause
+//
+// Unless required by applicable law or agreed to in writing, software distributed
+// under the License is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR
+// CONDITIONS OF ANY KIND, either express or implied. See the License for the
+// specific language governing permissions and limitations under the License.
+
+#ifndef NCNN_THREADPOOL_H
+#define NCNN_THREADPOOL_H
+
+#include <vector>
+#include "platform.h"
+#include "allocator.h"
+#include "cpu.h"
+#include "layer.h"
+
+namespace ncnn {
+
+// how the items are split over the threads
+enum ParallelSchedule
+{
+    // one contiguous range per thread
+    ParallelSchedule_STATIC = 0,
+    // shrinking chunks taken on demand, for items of uneven cost
+    ParallelSchedule_GUIDED = 1
+};
+
+// the body of a parallel loop
+class ParallelTask
+{
+public:
+    virtual ~ParallelTask();
+
+    // run the items [begin, end)
+    // thread_id is in [0, num_threads) and unique among the threads of one loop
+    virtual void execute(int begin, int end, int thread_id) const = 0;
+};
+
+// runs parallel loops, implement it to hand the layers to an external thread pool
+class ParallelExecutor
+{
+public:
+    virtual ~ParallelExecutor();
+
+    // run the items [0, n) of task on at most num_threads threads
+    // return after every item is done
+    virtual void parallel_for(int n, const ParallelTask& task, int num_threads, int schedule) = 0;
+};
+
+class ThreadPoolWorker;
+
+// persistent workers that spin for a while after a loop and then sleep
+// the calling thread takes part as thread 0, a loop on num_threads threads wakes the first num_threads - 1 workers only
+// a loop issued while another one runs, from another thread or from inside a task, runs on the calling thread alone
+class ThreadPool : public ParallelExecutor
+{
+public:
+    // num_threads - 1 workers are started
+    ThreadPool(int num_threads);
+    virtual ~ThreadPool();
+
+    int get_num_threads() const;
+
+    // busy polls before sleeping, for the workers waiting for a loop and for the caller waiting for the workers
+    // a worker spins less while the loops come in further apart than this, and no less than 1000 polls
+    // default 10000
+    void set_spin_count(int spin_count);
+
+    // bind the workers to the cpus in mask, such as one slot of get_cpu_slots
+    // the calling threads are not bound here, the extractor or set_cpu_thread_affinity binds them
+    // the workers pick the mask up before their next loop
+    void set_thread_affinity(const CpuSet& mask);
+
+    virtual void parallel_for(int n, const ParallelTask& task, int num_threads, int schedule);
+
+protected:
+    friend class ThreadPoolWorker;
+    void worker_main(ThreadPoolWorker* worker);
+
+    // run the share of thread_id in the current loop
+    void run_share(int thread_id);
+
+private:
+    // not copyable
+    ThreadPool(const ThreadPool&);
+    ThreadPool& operator=(const ThreadPool&);
+
+    std::vector<ThreadPoolWorker*> workers;
+    int spin_count;
+
+    // one loop at a time
+    Mutex dispatch_lock;
+
+    // guards the sleeping caller, and the affinity mask
+    Mutex lock;
+    ConditionVariable done_condition;
+
+    // the current loop, written before the workers are woken
+    const ParallelTask* task;
+    int task_size;
+    int task_threads;
+    int task_schedule;
+
+    // guarded by lock, the workers apply it when affinity_serial changes
+    CpuSet thread_affinity_mask;
+
+    // atomic counters
+    int next_item;
+    int pending_workers;
+    int stop;
+    int affinity_serial;
+};
+
+// the process wide pool with get_cpu_count() threads, created on first use
+ThreadPool* get_default_thread_pool();
+
+// run the items [0, n) of task on opt.executor with opt.num_threads threads
+// without an executor the loop runs on openmp
+void parallel_for(int n, const ParallelTask& task, const Option& opt, int schedule = ParallelSchedule_STATIC);
+
+} // namespace ncnn
+
+#endif // NCNN_THREADPOOL_H
@@ -0,0 +1,880 @@
+// Tencent is pleased to support the open source community by making ncnn available.
+//
+// Copyright (C) 2019 THL A29 Limited, a Tencent company. All rights reserved.
+//
+// Licensed under the BSD 3-Clause License (the "License"); you may not use this file except
+// in compliance with the License. You may obtain a copy of the License at
+//
+// https://opensource.org/licenses/BSD-3-Clause
+//
+// Unless required by applicable law or agreed to in writing, software distributed
+// under the License is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR
+// CONDITIONS OF ANY KIND, either express or implied. See the License for the
+// specific language governing permissions and limitations under the License.
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <algorithm>
+#include <map>
+#include <string>
+#include <vector>
+
+#if _WIN32
+#include <io.h>
+#else
+#include <dirent.h>
+#endif
+
+// ncnn public header
+#include "net.h"
+#include "layer.h"
+#include "modelbin.h"
+
+// ncnn private header
+#include "layer/convolution.h"
+#include "layer/convolutiondepthwise.h"
+#include "layer/eltwise.h"
+#include "layer/innerproduct.h"
+
+// 8-bit binary portable pixmap P6 or graymap P5
+// returns the pixel type or 0 on failure
+static int read_pnm(const char* path, std::vector<unsigned char>& pixels, int& w, int& h)
+{
+    FILE* fp = fopen(path, "rb");
+    if (!fp)
+        return 0;
+
+    char magic[3] = {0};
+    int maxval = 0;
+    if (fread(magic, 1, 2, fp) != 2 || magic[0] != 'P' || (magic[1] != '5' && magic[1] != '6'))
+    {
+        fclose(fp);
+        return 0;
+    }
+
+    int* fields[3] = { &w, &h, &maxval };
+    for (int i=0; i<3; i++)
+    {
+        // skip whitespace and comment lines
+        int c = fgetc(fp);
+        while (c == '#' || c == ' ' || c == '\t' || c == '\r' || c == '\n')
+        {
+            if (c == '#')
+            {
+                while (c != '\n' && c != EOF)
+                    c = fgetc(fp);
+            }
+            c = fgetc(fp);
+        }
+        ungetc(c, fp);
+
+        if (fscanf(fp, "%d", fields[i]) != 1)
+        {
+            fclose(fp);
+            return 0;
+        }
+    }
+
+    // single whitespace before the raster
+    fgetc(fp);
+
+    if (w <= 0 || h <= 0 || maxval <= 0 || maxval > 255)
+    {
+        fclose(fp);
+        return 0;
+    }
+
+    const int elempack = magic[1] == '6' ? 3 : 1;
+    pixels.resize((size_t)w * h * elempack);
+    size_t nread = fread(pixels.data(), 1, pixels.size(), fp);
+    fclose(fp);
+
+    if (nread != pixels.size())
+        return 0;
+
+    return magic[1] == '6' ? ncnn::Mat::PIXEL_RGB : ncnn::Mat::PIXEL_GRAY;
+}
+
+static void list_directory(const char* dirpath, std::vector<std::string>& paths)
+{
+#if _WIN32
+    std::string pattern = std::string(dirpath) + "\\*";
+
+    struct _finddata_t fd;
+    intptr_t handle = _findfirst(pattern.c_str(), &fd);
+    if (handle == -1)
+        return;
+
+    do
+    {
+        if (!(fd.attrib & _A_SUBDIR))
+            paths.push_back(std::string(dirpath) + "\\" + fd.name);
+    }
+    while (_findnext(handle, &fd) == 0);
+
+    _findclose(handle);
+#else
+    DIR* dir = opendir(dirpath);
+    if (!dir)
+        return;
+
+    struct dirent* ent;
+    while ((ent = readdir(dir)) != 0)
+    {
+        if (ent->d_name[0] == '.')
+            continue;
+
+        paths.push_back(std::string(dirpath) + "/" + ent->d_name);
+    }
+
+    closedir(dir);
+#endif
+
+    std::sort(paths.begin(), paths.end());
+}
+
+// records the file bytes and the mat of every load call
+class ModelBinRecord : public ncnn::ModelBinFromStdio
+{
+public:
+    ModelBinRecord(FILE* binfp) : ncnn::ModelBinFromStdio(binfp) {}
+
+    virtual ncnn::Mat load(int w, int type) const
+    {
+        long begin = ftell(binfp);
+
+        ncnn::Mat m = ncnn::ModelBinFromStdio::load(w, type);
+
+        long end = ftell(binfp);
+
+        std::vector<unsigned char> bytes(end - begin);
+        fseek(binfp, begin, SEEK_SET);
+        size_t nread = fread(bytes.data(), 1, bytes.size(), binfp);
+        fseek(binfp, end, SEEK_SET);
+
+        if (nread != bytes.size())
+            return ncnn::Mat();
+
+        chunks.push_back(bytes);
+        mats.push_back(m.clone());
+
+        return m;
+    }
+
+public:
+    mutable std::vector< std::vector<unsigned char> > chunks;
+    mutable std::vector<ncnn::Mat> mats;
+};
+
+class NetQuantize : public ncnn::Net
+{
+public:
+    // 0=kl 1=percentile 2=minmax
+    int method;
+    float percentile;
+
+    // non-negative convolution / innerproduct bottoms use the full int8 range with a zero point
+    int asymmetric;
+
+    int target_w;
+    int target_h;
+    int pixel_type;
+    float mean_vals[3];
+    float norm_vals[3];
+    int num_threads;
+
+public:
+    int load_model_record(const char* binpath);
+
+    int calibrate(const std::vector<std::string>& imagepaths);
+
+    int save(const char* parampath, const char* inparampath, const char* binpath);
+
+protected:
+    bool is_quantizable(int layer_index) const;
+    bool is_eltwise_quantizable(int layer_index) const;
+
+    int input_image(ncnn::Extractor& ex, const char* path) const;
+
+    float threshold_kl(const std::vector<float>& histogram, float interval) const;
+    float threshold_percentile(const std::vector<float>& histogram, float interval) const;
+
+public:
+    // per layer raw chunks and mats in load order
+    std::vector< std::vector< std::vector<unsigned char> > > layer_chunks;
+    std::vector< std::vector<ncnn::Mat> > layer_mats;
+
+    // bottom blob index to activation scale
+    std::map<int, float> blob_scales;
+
+    // bottom blob index to activation zero point, absent for symmetric blobs
+    std::map<int, int> blob_zero_points;
+};
+
+int NetQuantize::load_model_record(const char* binpath)
+{
+    FILE* fp = fopen(binpath, "rb");
+    if (!fp)
+    {
+        fprintf(stderr, "fopen %s failed\n", binpath);
+        return -1;
+    }
+
+    layer_chunks.resize(layers.size());
+    layer_mats.resize(layers.size());
+
+    int ret = 0;
+    for (size_t i=0; i<layers.size(); i++)
+    {
+        ModelBinRecord mb(fp);
+
+        int lret = layers[i]->load_model(mb);
+        if (lret != 0)
+        {
+            fprintf(stderr, "layer load_model %d failed\n", (int)i);
+            ret = -1;
+            break;
+        }
+
+        layer_chunks[i] = mb.chunks;
+        layer_mats[i] = mb.mats;
+    }
+
+    fclose(fp);
+
+    return ret;
+}
+
+bool NetQuantize::is_quantizable(int layer_index) const
+{
+    const ncnn::Layer* layer = layers[layer_index];
+
+    // float weight without int8 scales yet
+    int int8_scale_term;
+    if (layer->type == "Convolution")
+        int8_scale_term = ((const ncnn::Convolution*)layer)->int8_scale_term;
+    else if (layer->type == "ConvolutionDepthWise")
+    {
+        // int8 group convolution takes one scale per output, keep it float
+        const ncnn::ConvolutionDepthWise* convolutiondepthwise = (const ncnn::ConvolutionDepthWise*)layer;
+        if (convolutiondepthwise->group != convolutiondepthwise->num_output)
+            return false;
+
+        int8_scale_term = convolutiondepthwise->int8_scale_term;
+    }
+    else if (layer->type == "InnerProduct")
+        int8_scale_term = ((const ncnn::InnerProduct*)layer)->int8_scale_term;
+    else
+        return false;
+
+    if (int8_scale_term != 0)
+        return false;
+
+    const std::vector<ncnn::Mat>& mats = layer_mats[layer_index];
+    return !mats.empty() && mats[0].elemsize == 4;
+}
+
+// eltwise sum takes int8 bottoms when every bottom scale is known
+bool NetQuantize::is_eltwise_quantizable(int layer_index) const
+{
+    const ncnn::Layer* layer = layers[layer_index];
+    if (layer->type != "Eltwise")
+        return false;
+
+    const ncnn::Eltwise* eltwise = (const ncnn::Eltwise*)layer;
+    return eltwise->op_type == ncnn::Eltwise::Operation_SUM && eltwise->bottom_blob_int8_scales.w == 0;
+}
+
+int NetQuantize::input_image(ncnn::Extractor& ex, const char* path) const
+{
+    std::vector<unsigned char> pixels;
+    int w;
+    int h;
+    int type = read_pnm(path, pixels, w, h);
+    if (type == 0)
+        return -1;
+
+    // convert to the model pixel order
+    if (type != pixel_type)
+        type |= pixel_type << ncnn::Mat::PIXEL_CONVERT_SHIFT;
+
+    ncnn::Mat in = ncnn::Mat::from_pixels_resize(pixels.data(), type, w, h, target_w, target_h);
+    in.substract_mean_normalize(mean_vals, norm_vals);
+
+    // the first input layer feeds the network
+    for (size_t i=0; i<layers.size(); i++)
+    {
+        if (layers[i]->type == "Input")
+            return ex.input(layers[i]->tops[0], in);
+    }
+
+    return -1;
+}
+
+float NetQuantize::threshold_kl(const std::vector<float>& histogram, float interval) const
+{
+    // search the clip threshold whose 128 level quantized distribution is the closest
+    const int num_bins = (int)histogram.size();
+    const int target_bins = 128;
+
+    int best_threshold = num_bins;
+    float best_kl = 3.4e38f;
+
+    for (int threshold=target_bins; threshold<num_bins; threshold++)
+    {
+        // reference distribution with the outliers clipped into the last bin
+        std::vector<float> clip(histogram.begin(), histogram.begin() + threshold);
+        for (int i=threshold; i<num_bins; i++)
+        {
+            clip[threshold - 1] += histogram[i];
+        }
+
+        // merge into target_bins levels and expand back over the nonzero bins
+        std::vector<float> expand(threshold, 0.f);
+
+        const float bins_per_level = (float)threshold / target_bins;
+        for (int j=0; j<target_bins; j++)
+        {
+            const float start = j * bins_per_level;
+            const float end = start + bins_per_level;
+
+            const int left_upper = (int)ceil(start);
+            const int right_lower = std::min((int)floor(end), threshold);
+            const float left_scale = left_upper - start;
+            const float right_scale = end - right_lower;
+
+            float sum = 0.f;
+            float count = 0.f;
+
+            if (left_scale > 0.f)
+            {
+                sum += left_scale * histogram[left_upper - 1];
+                if (histogram[left_upper - 1] != 0.f)
+                    count += left_scale;
+            }
+            for (int k=left_upper; k<right_lower; k++)
+            {
+                sum += histogram[k];
+                if (histogram[k] != 0.f)
+                    count += 1.f;
+            }
+            if (right_scale > 0.f && right_lower < threshold)
+            {
+                sum += right_scale * histogram[right_lower];
+                if (histogram[right_lower] != 0.f)
+                    count += right_scale;
+            }
+
+            if (count == 0.f)
+                continue;
+
+            const float value = sum / count;
+
+            if (left_scale > 0.f && histogram[left_upper - 1] != 0.f)
+                expand[left_upper - 1] += value * left_scale;
+            for (int k=left_upper; k<right_lower; k++)
+            {
+                if (histogram[k] != 0.f)
+                    expand[k] += value;
+            }
+            if (right_scale > 0.f && right_lower < threshold && histogram[right_lower] != 0.f)
+                expand[right_lower] += value * right_scale;
+        }
+
+        // kl divergence of the normalized distributions
+        float clip_sum = 0.f;
+        float expand_sum = 0.f;
+        for (int i=0; i<threshold; i++)
+        {
+            clip_sum += clip[i];
+            expand_sum += expand[i];
+        }
+
+        if (clip_sum == 0.f || expand_sum == 0.f)
+            continue;
+
+        float kl = 0.f;
+        for (int i=0; i<threshold; i++)
+        {
+            const float p = clip[i] / clip_sum;
+            const float q = expand[i] / expand_sum;
+
+            if (p == 0.f)
+                continue;
+
+            // level missing in the quantized distribution
+            if (q == 0.f)
+            {
+                kl += 1.f;
+                continue;
+            }
+
+            kl += p * log(p / q);
+        }
+
+        if (kl < best_kl)
+        {
+            best_kl = kl;
+            best_threshold = threshold;
+        }
+    }
+
+    return (best_threshold + 0.5f) * interval;
+}
+
+float NetQuantize::threshold_percentile(const std::vector<float>& histogram, float interval) const
+{
+    const int num_bins = (int)histogram.size();
+
+    double total = 0.0;
+    for (int i=0; i<num_bins; i++)
+    {
+        total += histogram[i];
+    }
+
+    const double target = total * percentile / 100.0;
+
+    double sum = 0.0;
+    for (int i=0; i<num_bins; i++)
+    {
+        sum += histogram[i];
+        if (sum >= target)
+            return (i + 1) * interval;
+    }
+
+    return num_bins * interval;
+}
+
+int NetQuantize::calibrate(const std::vector<std::string>& imagepaths)
+{
+    std::vector<int> blob_indexes;
+
+    // depthwise and eltwise int8 kernels have no zero point
+    std::vector<int> symmetric_blob_indexes;
+
+    for (size_t i=0; i<layers.size(); i++)
+    {
+        std::vector<int> bottoms;
+        if (is_quantizable(i))
+            bottoms.push_back(layers[i]->bottoms[0]);
+        else if (is_eltwise_quantizable(i))
+            bottoms = layers[i]->bottoms;
+
+        if (layers[i]->type == "ConvolutionDepthWise" || layers[i]->type == "Eltwise")
+            symmetric_blob_indexes.insert(symmetric_blob_indexes.end(), bottoms.begin(), bottoms.end());
+
+        for (size_t j=0; j<bottoms.size(); j++)
+        {
+            if (std::find(blob_indexes.begin(), blob_indexes.end(), bottoms[j]) == blob_indexes.end())
+                blob_indexes.push_back(bottoms[j]);
+        }
+    }
+
+    const int num_bins = 2048;
+
+    std::vector<float> absmax(blob_indexes.size(), 0.f);
+    std::vector<float> minval(blob_indexes.size(), 0.f);
+    std::vector< std::vector<float> > histograms(blob_indexes.size(), std::vector<float>(num_bins, 0.f));
+
+    // pass 0 collects the absolute max of every blob, pass 1 the histogram of |x| over [0, absmax]
+    const int num_passes = method == 2 ? 1 : 2;
+    for (int pass=0; pass<num_passes; pass++)
+    {
+        int num_images = 0;
+
+        for (size_t i=0; i<imagepaths.size(); i++)
+        {
+            ncnn::Extractor ex = create_extractor();
+            ex.set_light_mode(false);
+            ex.set_num_threads(num_threads);
+
+            if (input_image(ex, imagepaths[i].c_str()) != 0)
+            {
+                if (pass == 0)
+                    fprintf(stderr, "skip %s, not a binary 8-bit ppm / pgm image\n", imagepaths[i].c_str());
+                continue;
+            }
+
+            num_images++;
+
+            for (size_t j=0; j<blob_indexes.size(); j++)
+            {
+                ncnn::Mat blob;
+                ex.extract(blob_indexes[j], blob);
+
+                const int size = blob.w * blob.h;
+                const float interval = absmax[j] / num_bins;
+
+                for (int q=0; q<blob.c; q++)
+                {
+                    const float* ptr = blob.channel(q);
+
+                    for (int k=0; k<size; k++)
+                    {
+                        const float v = fabs(ptr[k]);
+
+                        if (pass == 0)
+                        {
+                            absmax[j] = std::max(absmax[j], v);
+                            minval[j] = std::min(minval[j], ptr[k]);
+                            continue;
+                        }
+
+                        // zero carries no quantization error
+                        if (v == 0.f || interval == 0.f)
+                            continue;
+
+                        int index = std::min((int)(v / interval), num_bins - 1);
+                        histograms[j][index] += 1.f;
+                    }
+                }
+            }
+        }
+
+        if (num_images == 0)
+        {
+            fprintf(stderr, "no calibration image loaded\n");
+            return -1;
+        }
+
+        if (pass == 0)
+            fprintf(stderr, "calibrate with %d images\n", num_images);
+    }
+
+    for (size_t j=0; j<blob_indexes.size(); j++)
+    {
+        const float interval = absmax[j] / num_bins;
+
+        float threshold = absmax[j];
+        if (method == 0)
+            threshold = threshold_kl(histograms[j], interval);
+        else if (method == 1)
+            threshold = threshold_percentile(histograms[j], interval);
+
+        // a non-negative blob maps [0, threshold] to [-128, 127]
+        const bool is_asymmetric = asymmetric && minval[j] >= 0.f && threshold != 0.f
+            && std::find(symmetric_blob_indexes.begin(), symmetric_blob_indexes.end(), blob_indexes[j]) == symmetric_blob_indexes.end();
+
+        const float scale = threshold == 0.f ? 1.f : (is_asymmetric ? 255.f : 127.f) / threshold;
+
+        blob_scales[blob_indexes[j]] = scale;
+        if (is_asymmetric)
+            blob_zero_points[blob_indexes[j]] = -128;
+
+        fprintf(stderr, "%-32s absmax = %f threshold = %f scale = %f%s\n", blobs[blob_indexes[j]].name.c_str(), absmax[j], threshold, scale, is_asymmetric ? " zero_point = -128" : "");
+    }
+
+    return 0;
+}
+
+static void fwrite_aligned(const void* data, size_t size, FILE* bp)
+{
+    fwrite(data, 1, size, bp);
+
+    // pad to 32bit alignment
+    static const unsigned char padding[4] = {0, 0, 0, 0};
+    size_t alignsize = (size + 3) / 4 * 4;
+    fwrite(padding, 1, alignsize - size, bp);
+}
+
+int NetQuantize::save(const char* parampath, const char* inparampath, const char* binpath)
+{
+    FILE* ip = fopen(inparampath, "rb");
+    if (!ip)
+    {
+        fprintf(stderr, "fopen %s failed\n", inparampath);
+        return -1;
+    }
+
+    FILE* pp = fopen(parampath, "wb");
+    FILE* bp = fopen(binpath, "wb");
+    if (!pp || !bp)
+    {
+        fprintf(stderr, "fopen %s / %s failed\n", parampath, binpath);
+        fclose(ip);
+        if (pp) fclose(pp);
+        if (bp) fclose(bp);
+        return -1;
+    }
+
+    std::vector<bool> quantized(layers.size(), false);
+    for (size_t i=0; i<layers.size(); i++)
+    {
+        quantized[i] = is_quantizable(i) && blob_scales.find(layers[i]->bottoms[0]) != blob_scales.end();
+    }
+
+    // eltwise sum bottom scales in param 2
+    std::vector<std::string> eltwise_scales(layers.size());
+    for (size_t i=0; i<layers.size(); i++)
+    {
+        if (!is_eltwise_quantizable(i))
+            continue;
+
+        const std::vector<int>& bottoms = layers[i]->bottoms;
+
+        char tmp[64];
+        sprintf(tmp, " -23302=%d", (int)bottoms.size());
+        std::string param = tmp;
+        for (size_t j=0; j<bottoms.size(); j++)
+        {
+            sprintf(tmp, ",%e", blob_scales[bottoms[j]]);
+            param += tmp;
+        }
+
+        eltwise_scales[i] = param;
+    }
+
+    // the original param text with int8_scale_term appended to the quantized layers
+    char line[65536];
+    while (fgets(line, sizeof(line), ip))
+    {
+        size_t len = strlen(line);
+        while (len > 0 && (line[len - 1] == '\n' || line[len - 1] == '\r'))
+            line[--len] = '\0';
+
+        // layer line is type name bottom_count top_count ...
+        char layer_name[256] = {0};
+        std::string append;
+        if (sscanf(line, "%*s %255s", layer_name) == 1)
+        {
+            for (size_t i=0; i<layers.size(); i++)
+            {
+                if (layers[i]->name == layer_name)
+                {
+                    if (quantized[i])
+                        append = blob_zero_points.count(layers[i]->bottoms[0]) ? " 8=3" : " 8=1";
+                    else
+                        append = eltwise_scales[i];
+                    break;
+                }
+            }
+        }
+
+        fprintf(pp, "%s%s\n", line, append.c_str());
+    }
+
+    fclose(ip);
+
+    for (size_t i=0; i<layers.size(); i++)
+    {
+        const std::vector< std::vector<unsigned char> >& chunks = layer_chunks[i];
+
+        if (!quantized[i])
+        {
+            for (size_t j=0; j<chunks.size(); j++)
+            {
+                fwrite(chunks[j].data(), 1, chunks[j].size(), bp);
+            }
+            continue;
+        }
+
+        // weight scales of each output, one per group for depthwise
+        const ncnn::Mat& weight_data = layer_mats[i][0];
+
+        int num_scales;
+        if (layers[i]->type == "ConvolutionDepthWise")
+            num_scales = ((const ncnn::ConvolutionDepthWise*)layers[i])->group;
+        else if (layers[i]->type == "Convolution")
+            num_scales = ((const ncnn::Convolution*)layers[i])->num_output;
+        else
+            num_scales = ((const ncnn::InnerProduct*)layers[i])->num_output;
+
+        const int weight_data_size = weight_data.w;
+        const int slice_size = weight_data_size / num_scales;
+
+        std::vector<float> weight_scales(num_scales);
+        std::vector<signed char> weight_int8(weight_data_size);
+
+        for (int p=0; p<num_scales; p++)
+        {
+            const float* ptr = (const float*)weight_data + slice_size * p;
+
+            float absmax = 0.f;
+            for (int k=0; k<slice_size; k++)
+            {
+                absmax = std::max(absmax, (float)fabs(ptr[k]));
+            }
+
+            const float scale = absmax == 0.f ? 0.f : 127.f / absmax;
+            weight_scales[p] = scale;
+
+            for (int k=0; k<slice_size; k++)
+            {
+                int q = (int)round(ptr[k] * scale);
+                weight_int8[slice_size * p + k] = (signed char)std::min(std::max(q, -127), 127);
+            }
+        }
+
+        // int8 weight
+        const unsigned int tag = 0x000D4B38;
+        fwrite(&tag, sizeof(int), 1, bp);
+        fwrite_aligned(weight_int8.data(), weight_int8.size(), bp);
+
+        // bias untouched
+        for (size_t j=1; j<chunks.size(); j++)
+        {
+            fwrite(chunks[j].data(), 1, chunks[j].size(), bp);
+        }
+
+        const float bottom_blob_int8_scale = blob_scales[layers[i]->bottoms[0]];
+        fwrite(weight_scales.data(), sizeof(float), num_scales, bp);
+        fwrite(&bottom_blob_int8_scale, sizeof(float), 1, bp);
+
+        if (blob_zero_points.count(layers[i]->bottoms[0]))
+        {
+            const float bottom_blob_int8_zero_point = blob_zero_points[layers[i]->bottoms[0]];
+            fwrite(&bottom_blob_int8_zero_point, sizeof(float), 1, bp);
+        }
+    }
+
+    fclose(pp);
+    fclose(bp);
+
+    return 0;
+}
+
+static int parse_floats(const char* s, float* values, int count)
+{
+    int n = 0;
+    while (n < count && *s)
+    {
+        values[n++] = (float)atof(s);
+
+        const char* comma = strchr(s, ',');
+        if (!comma)
+            break;
+        s = comma + 1;
+    }
+
+    // broadcast the last value
+    for (int i=n; i<count; i++)
+    {
+        values[i] = n == 0 ? 0.f : values[n - 1];
+    }
+
+    return n;
+}
+
+int main(int argc, char** argv)
+{
+    if (argc < 6)
+    {
+        fprintf(stderr, "usage: %s [inparam] [inbin] [outparam] [outbin] [imagedir] [key=value]...\n", argv[0]);
+        fprintf(stderr, "method=kl|percentile|minmax  activation threshold, default kl\n");
+        fprintf(stderr, "percentile=99.99             percentile of |x| for method=percentile\n");
+        fprintf(stderr, "asymmetric=0|1               zero point for non-negative bottoms, default 0\n");
+        fprintf(stderr, "shape=224,224                input width,height\n");
+        fprintf(stderr, "mean=104,117,123             mean values\n");
+        fprintf(stderr, "norm=1,1,1                   norm values\n");
+        fprintf(stderr, "pixel=BGR|RGB|GRAY           input pixel order, default BGR\n");
+        fprintf(stderr, "thread=1                     number of threads\n");
+        fprintf(stderr, "images are binary 8-bit ppm (P6) or pgm (P5) files\n");
+        return -1;
+    }
+
+    const char* inparam = argv[1];
+    const char* inbin = argv[2];
+    const char* outparam = argv[3];
+    const char* outbin = argv[4];
+    const char* imagedir = argv[5];
+
+    NetQuantize quantizer;
+
+    quantizer.method = 0;
+    quantizer.percentile = 99.99f;
+    quantizer.asymmetric = 0;
+    quantizer.target_w = 224;
+    quantizer.target_h = 224;
+    quantizer.pixel_type = ncnn::Mat::PIXEL_BGR;
+    quantizer.num_threads = 1;
+    for (int i=0; i<3; i++)
+    {
+        quantizer.mean_vals[i] = 0.f;
+        quantizer.norm_vals[i] = 1.f;
+    }
+
+    for (int i=6; i<argc; i++)
+    {
+        const char* eq = strchr(argv[i], '=');
+        if (!eq)
+        {
+            fprintf(stderr, "invalid option %s\n", argv[i]);
+            return -1;
+        }
+
+        std::string key(argv[i], eq - argv[i]);
+        const char* value = eq + 1;
+
+        if (key == "method")
+        {
+            if (strcmp(value, "kl") == 0)
+                quantizer.method = 0;
+            else if (strcmp(value, "percentile") == 0)
+                quantizer.method = 1;
+            else if (strcmp(value, "minmax") == 0)
+                quantizer.method = 2;
+            else
+            {
+                fprintf(stderr, "unknown method %s\n", value);
+                return -1;
+            }
+        }
+        else if (key == "percentile")
+            quantizer.percentile = atof(value);
+        else if (key == "asymmetric")
+            quantizer.asymmetric = atoi(value);
+        else if (key == "shape")
+        {
+            float shape[2];
+            parse_floats(value, shape, 2);
+            quantizer.target_w = (int)shape[0];
+            quantizer.target_h = (int)shape[1];
+        }
+        else if (key == "mean")
+            parse_floats(value, quantizer.mean_vals, 3);
+        else if (key == "norm")
+            parse_floats(value, quantizer.norm_vals, 3);
+        else if (key == "pixel")
+        {
+            if (strcmp(value, "BGR") == 0)
+                quantizer.pixel_type = ncnn::Mat::PIXEL_BGR;
+            else if (strcmp(value, "RGB") == 0)
+                quantizer.pixel_type = ncnn::Mat::PIXEL_RGB;
+            else if (strcmp(value, "GRAY") == 0)
+                quantizer.pixel_type = ncnn::Mat::PIXEL_GRAY;
+            else
+            {
+                fprintf(stderr, "unknown pixel %s\n", value);
+                return -1;
+            }
+        }
+        else if (key == "thread")
+            quantizer.num_threads = atoi(value);
+        else
+        {
+            fprintf(stderr, "unknown option %s\n", key.c_str());
+            return -1;
+        }
+    }
+
+    std::vector<std::string> imagepaths;
+    list_directory(imagedir, imagepaths);
+    if (imagepaths.empty())
+    {
+        fprintf(stderr, "no image found in %s\n", imagedir);
+        return -1;
+    }
+
+    if (quantizer.load_param(inparam) != 0)
+        return -1;
+
+    if (quantizer.load_model_record(inbin) != 0)
+        return -1;
+
+    if (quantizer.calibrate(imagepaths) != 0)
+        return -1;
+
+    return quantizer.save(outparam, inparam, outbin);
+}
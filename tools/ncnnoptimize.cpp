@@ -12,6 +12,8 @@
 // CONDITIONS OF ANY KIND, either express or implied. See the License for the
 // specific language governing permissions and limitations under the License.
 
+#include <math.h>
+#include <algorithm>
 #include <set>
 #include <vector>
 
@@ -41,6 +43,7 @@
 #include "layer/interp.h"
 #include "layer/log.h"
 #include "layer/lrn.h"
+#include "layer/lstm.h"
 #include "layer/mvn.h"
 #include "layer/normalize.h"
 #include "layer/padding.h"
@@ -70,6 +73,13 @@
 
 class NetOptimize : public ncnn::Net
 {
+public:
+    // 0=fp32 1=fp16 2=bf16 3=int8 4=int4
+    int storage_type;
+
+    // weight with at least this fraction of zeros is written sparse, 0 = never
+    float sparse_threshold;
+
 public:
     int fuse_batchnorm_scale();
     int fuse_convolution_batchnorm();
@@ -91,6 +101,9 @@ public:
 
     int fwrite_weight_tag(int tag, FILE* bp);
     int fwrite_weight_data(const ncnn::Mat& data, FILE* bp);
+    int fwrite_weight_tag_data(int tag, const ncnn::Mat& data, FILE* bp);
+    int fwrite_weight_sparse_data(const ncnn::Mat& data, FILE* bp);
+    int fwrite_weight_quantized_data(int bits, const ncnn::Mat& data, int rows, FILE* bp);
 
     int save(const char* parampath, const char* binpath);
 };
@@ -991,6 +1004,152 @@ int NetOptimize::fwrite_weight_data(const ncnn::Mat& data, FILE* bp)
     return 0;
 }
 
+int NetOptimize::fwrite_weight_tag_data(int tag, const ncnn::Mat& data, FILE* bp)
+{
+    int p0 = ftell(bp);
+
+    ncnn::Mat data_flattened = data.reshape(data.w * data.h * data.c);
+    if (data_flattened.elemsize != 4)
+    {
+        // keep quantized weight as is
+        tag = 0;
+    }
+    else if (sparse_threshold > 0.f)
+    {
+        const float* ptr = data_flattened;
+
+        int nnz = 0;
+        for (int i=0; i<data_flattened.w; i++)
+        {
+            if (ptr[i] != 0.f)
+                nnz++;
+        }
+
+        if (data_flattened.w - nnz >= sparse_threshold * data_flattened.w)
+            return fwrite_weight_sparse_data(data_flattened, bp);
+    }
+
+    if (data_flattened.elemsize == 4)
+    {
+        if (tag == 0x01306B47)
+        {
+            // half-precision
+            ncnn::Mat data_flattened_fp16;
+            ncnn::cast_float32_to_float16(data_flattened, data_flattened_fp16);
+            data_flattened = data_flattened_fp16;
+        }
+        else if (tag == 0x0002BF16)
+        {
+            // bfloat16
+            ncnn::Mat data_flattened_bf16;
+            ncnn::cast_float32_to_bfloat16(data_flattened, data_flattened_bf16);
+            data_flattened = data_flattened_bf16;
+        }
+    }
+
+    fwrite(&tag, sizeof(int), 1, bp);
+    fwrite(data_flattened.data, data_flattened.elemsize, data_flattened.w, bp);
+
+    // padding to 32bit align
+    int nwrite = ftell(bp) - p0;
+    int nalign = ncnn::alignSize(nwrite, 4);
+    unsigned char padding[4] = {0x00, 0x00, 0x00, 0x00};
+    fwrite(padding, sizeof(unsigned char), nalign - nwrite, bp);
+
+    return 0;
+}
+
+int NetOptimize::fwrite_weight_sparse_data(const ncnn::Mat& data, FILE* bp)
+{
+    // tag, nonzero count, bitmask of the nonzero positions, nonzero values
+    const int size = data.w;
+    const float* ptr = data;
+
+    std::vector<unsigned char> mask(ncnn::alignSize((size + 7) / 8, 4), 0);
+    std::vector<float> values;
+    for (int i=0; i<size; i++)
+    {
+        if (ptr[i] == 0.f)
+            continue;
+
+        mask[i / 8] |= 1 << (i % 8);
+        values.push_back(ptr[i]);
+    }
+
+    int tag = 0x0005BA5E;
+    int nnz = values.size();
+    fwrite(&tag, sizeof(int), 1, bp);
+    fwrite(&nnz, sizeof(int), 1, bp);
+    fwrite(mask.data(), sizeof(unsigned char), mask.size(), bp);
+    fwrite(values.data(), sizeof(float), values.size(), bp);
+
+    return 0;
+}
+
+int NetOptimize::fwrite_weight_quantized_data(int bits, const ncnn::Mat& data, int rows, FILE* bp)
+{
+    ncnn::Mat data_flattened = data.reshape(data.w * data.h * data.c);
+    if (bits == 0 || data_flattened.elemsize != 4 || data_flattened.w % rows != 0)
+        return fwrite_weight_tag_data(0, data, bp);
+
+    if (sparse_threshold > 0.f)
+    {
+        const float* ptr = data_flattened;
+
+        int nnz = 0;
+        for (int i=0; i<data_flattened.w; i++)
+        {
+            if (ptr[i] != 0.f)
+                nnz++;
+        }
+
+        if (data_flattened.w - nnz >= sparse_threshold * data_flattened.w)
+            return fwrite_weight_sparse_data(data_flattened, bp);
+    }
+
+    // tag, row count, one scale per row, int8 or packed int4 rows
+    const int K = data_flattened.w / rows;
+    const int row_bytes = bits == 4 ? (K + 1) / 2 : K;
+    const int qmax = bits == 4 ? 7 : 127;
+
+    std::vector<float> scales(rows);
+    std::vector<unsigned char> quantized(ncnn::alignSize(row_bytes * rows, 4), 0);
+
+    for (int p=0; p<rows; p++)
+    {
+        const float* ptr = (const float*)data_flattened + K * p;
+        unsigned char* qptr = quantized.data() + row_bytes * p;
+
+        float absmax = 0.f;
+        for (int k=0; k<K; k++)
+        {
+            absmax = std::max(absmax, (float)fabs(ptr[k]));
+        }
+
+        scales[p] = absmax / qmax;
+        const float scale_inv = absmax == 0.f ? 0.f : qmax / absmax;
+
+        for (int k=0; k<K; k++)
+        {
+            int q = (int)round(ptr[k] * scale_inv);
+            q = std::min(std::max(q, -qmax), qmax);
+
+            if (bits == 4)
+                qptr[k / 2] |= (q & 15) << (k % 2 * 4);
+            else
+                qptr[k] = (unsigned char)(signed char)q;
+        }
+    }
+
+    int tag = bits == 4 ? 0x0051D004 : 0x0051D008;
+    fwrite(&tag, sizeof(int), 1, bp);
+    fwrite(&rows, sizeof(int), 1, bp);
+    fwrite(scales.data(), sizeof(float), rows, bp);
+    fwrite(quantized.data(), sizeof(unsigned char), quantized.size(), bp);
+
+    return 0;
+}
+
 int NetOptimize::save(const char* parampath, const char* binpath)
 {
     FILE* pp = fopen(parampath, "wb");
@@ -998,6 +1157,20 @@ int NetOptimize::save(const char* parampath, const char* binpath)
 
     fprintf(pp, "7767517\n");
 
+    // convolution and innerproduct weight storage
+    int weight_tag = 0;
+    if (storage_type == 1)
+        weight_tag = 0x01306B47;
+    if (storage_type == 2)
+        weight_tag = 0x0002BF16;
+
+    // innerproduct and lstm weight quantized per row
+    int weight_bits = 0;
+    if (storage_type == 3)
+        weight_bits = 8;
+    if (storage_type == 4)
+        weight_bits = 4;
+
     const int layer_count = layers.size();
 
     int layer_count_fused = 0;
@@ -1125,8 +1298,7 @@ int NetOptimize::save(const char* parampath, const char* binpath)
             fprintf_param_value(" 9=%d", activation_type)
             { if (!op->activation_params.empty()) fprintf_param_int_array(10, op->activation_params, pp); }
 
-            fwrite_weight_tag(0, bp);
-            fwrite_weight_data(op->weight_data, bp);
+            fwrite_weight_tag_data(weight_tag, op->weight_data, bp);
             fwrite_weight_data(op->bias_data, bp);
         }
         else if (layer->type == "ConvolutionDepthWise")
@@ -1150,8 +1322,7 @@ int NetOptimize::save(const char* parampath, const char* binpath)
             fprintf_param_value(" 9=%d", activation_type)
             { if (!op->activation_params.empty()) fprintf_param_int_array(10, op->activation_params, pp); }
 
-            fwrite_weight_tag(0, bp);
-            fwrite_weight_data(op->weight_data, bp);
+            fwrite_weight_tag_data(weight_tag, op->weight_data, bp);
             fwrite_weight_data(op->bias_data, bp);
         }
         else if (layer->type == "Crop")
@@ -1185,8 +1356,7 @@ int NetOptimize::save(const char* parampath, const char* binpath)
             fprintf_param_value(" 9=%d", activation_type)
             { if (!op->activation_params.empty()) fprintf_param_int_array(10, op->activation_params, pp); }
 
-            fwrite_weight_tag(0, bp);
-            fwrite_weight_data(op->weight_data, bp);
+            fwrite_weight_tag_data(weight_tag, op->weight_data, bp);
             fwrite_weight_data(op->bias_data, bp);
         }
         else if (layer->type == "DeconvolutionDepthWise")
@@ -1209,8 +1379,7 @@ int NetOptimize::save(const char* parampath, const char* binpath)
             fprintf_param_value(" 9=%d", activation_type)
             { if (!op->activation_params.empty()) fprintf_param_int_array(10, op->activation_params, pp); }
 
-            fwrite_weight_tag(0, bp);
-            fwrite_weight_data(op->weight_data, bp);
+            fwrite_weight_tag_data(weight_tag, op->weight_data, bp);
             fwrite_weight_data(op->bias_data, bp);
         }
         else if (layer->type == "DetectionOutput")
@@ -1241,7 +1410,8 @@ int NetOptimize::save(const char* parampath, const char* binpath)
             ncnn::Eltwise* op_default = (ncnn::Eltwise*)layer_default;
 
             fprintf_param_value(" 0=%d", op_type)
-            { if (!op->coeffs.empty()) fprintf_param_int_array(1, op->coeffs, pp); }
+            { if (!op->coeffs.empty()) fprintf_param_float_array(1, op->coeffs, pp); }
+            { if (!op->bottom_blob_int8_scales.empty()) fprintf_param_float_array(2, op->bottom_blob_int8_scales, pp); }
         }
         else if (layer->type == "ELU")
         {
@@ -1271,8 +1441,10 @@ int NetOptimize::save(const char* parampath, const char* binpath)
             fprintf_param_value(" 9=%d", activation_type)
             { if (!op->activation_params.empty()) fprintf_param_int_array(10, op->activation_params, pp); }
 
-            fwrite_weight_tag(0, bp);
-            fwrite_weight_data(op->weight_data, bp);
+            if (weight_bits)
+                fwrite_weight_quantized_data(weight_bits, op->weight_data, op->num_output, bp);
+            else
+                fwrite_weight_tag_data(weight_tag, op->weight_data, bp);
             fwrite_weight_data(op->bias_data, bp);
         }
         else if (layer->type == "Input")
@@ -1323,6 +1495,24 @@ int NetOptimize::save(const char* parampath, const char* binpath)
             fprintf_param_value(" 3=%f", beta)
             fprintf_param_value(" 4=%f", bias)
         }
+        else if (layer->type == "LSTM")
+        {
+            ncnn::LSTM* op = (ncnn::LSTM*)layer;
+            ncnn::LSTM* op_default = (ncnn::LSTM*)layer_default;
+
+            fprintf_param_value(" 0=%d", num_output)
+            fprintf_param_value(" 1=%d", weight_data_size)
+
+            if (weight_bits)
+                fwrite_weight_quantized_data(weight_bits, op->weight_xc_data, op->num_output * 4, bp);
+            else
+                fwrite_weight_tag_data(weight_tag, op->weight_xc_data, bp);
+            fwrite_weight_tag_data(0, op->bias_c_data, bp);
+            if (weight_bits)
+                fwrite_weight_quantized_data(weight_bits, op->weight_hc_data, op->num_output * 4, bp);
+            else
+                fwrite_weight_tag_data(weight_tag, op->weight_hc_data, bp);
+        }
         else if (layer->type == "MVN")
         {
             ncnn::MVN* op = (ncnn::MVN*)layer;
@@ -1604,7 +1794,13 @@ int NetOptimize::save(const char* parampath, const char* binpath)
 
 int main(int argc, char** argv)
 {
-    // in in out out 65535
+    if (argc != 6 && argc != 7)
+    {
+        fprintf(stderr, "usage: %s [inparam] [inbin] [outparam] [outbin] [flag] [sparsity]\n", argv[0]);
+        fprintf(stderr, "flag: 0=fp32 1=fp16 weight 2=bf16 weight 3=int8 weight-only 4=int4 weight-only\n");
+        fprintf(stderr, "sparsity: write weight with at least this fraction of zeros sparse, eg. 0.7\n");
+        return -1;
+    }
 
     const char* inparam = argv[1];
     const char* inbin = argv[2];
@@ -1613,6 +1809,9 @@ int main(int argc, char** argv)
     int flag = atoi(argv[5]);
 
     NetOptimize optimizer;
+
+    optimizer.storage_type = flag;
+    optimizer.sparse_threshold = argc == 7 ? atof(argv[6]) : 0.f;
     optimizer.load_param(inparam);
     optimizer.load_model(inbin);
 
@@ -0,0 +1,273 @@
+// Tencent is pleased to support the open source community by making ncnn available.
+//
+// Copyright (C) 2019 THL A29 Limited, a Tencent company. All rights reserved.
+//
+// Licensed under the BSD 3-Clause License (the "License"); you may not use this file except
+// in compliance with the License. You may obtain a copy of the License at
+//
+// https://opensource.org/licenses/BSD-3-Clause
+//
+// Unless required by applicable law or agreed to in writing, software distributed
+// under the License is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR
+// CONDITIONS OF ANY KIND, either express or implied. See the License for the
+// specific language governing permissions and limitations under the License.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <algorithm>
+#include <vector>
+
+// ncnn public header
+#include "cpu.h"
+#include "net.h"
+#include "layer.h"
+#include "profiler.h"
+
+// ncnn private header
+#include "layer/input.h"
+
+// constant weight for a param without bin
+// not zero, so that the weight does not look pruned to use_sparse_weight
+class ModelBinFromConstant : public ncnn::ModelBin
+{
+public:
+    virtual ncnn::Mat load(int w, int /*type*/) const { ncnn::Mat m(w); m.fill(0.001f); return m; }
+};
+
+class NetRoofline : public ncnn::Net
+{
+public:
+    int load_constant_model();
+
+    // the shapes come from a forward pass, ncnn has no separate shape inference
+    // the memoised constant layers are computed in the untimed pass and are not listed
+    int run(int w, int h, int c, int loop_count, ncnn::Profiler& profiler) const;
+};
+
+int NetRoofline::load_constant_model()
+{
+    ModelBinFromConstant mb;
+    for (size_t i=0; i<layers.size(); i++)
+    {
+        int ret = layers[i]->load_model(mb);
+        if (ret != 0)
+        {
+            fprintf(stderr, "layer load_model %d failed\n", (int)i);
+            return -1;
+        }
+    }
+
+    fuse_network();
+
+    find_constant_layers();
+
+    return 0;
+}
+
+int NetRoofline::run(int w, int h, int c, int loop_count, ncnn::Profiler& profiler) const
+{
+    // feed every Input layer, extract every blob nothing consumes
+    std::vector<int> input_blobs;
+    std::vector<ncnn::Mat> input_mats;
+    std::vector<int> output_blobs;
+
+    for (size_t i=0; i<layers.size(); i++)
+    {
+        const ncnn::Layer* layer = layers[i];
+        if (layer->type != "Input")
+            continue;
+
+        const ncnn::Input* input = (const ncnn::Input*)layer;
+
+        // the command line shape wins over the one written in the param
+        int inw = w > 0 ? w : input->w;
+        int inh = h > 0 ? h : input->h;
+        int inc = c > 0 ? c : input->c;
+        if (inw <= 0 || inh <= 0 || inc <= 0)
+        {
+            fprintf(stderr, "input %s has no shape, pass one as w,h,c\n", layer->name.c_str());
+            return -1;
+        }
+
+        ncnn::Mat in(inw, inh, inc);
+        in.fill(0.5f);
+
+        input_blobs.push_back(layer->tops[0]);
+        input_mats.push_back(in);
+    }
+
+    for (size_t i=0; i<blobs.size(); i++)
+    {
+        if (blobs[i].consumers.empty())
+            output_blobs.push_back((int)i);
+    }
+
+    // one untimed pass for the allocator pools and the constant layers
+    for (int i=0; i<=loop_count; i++)
+    {
+        ncnn::Extractor ex = create_extractor();
+        ex.set_light_mode(false);
+        if (i > 0)
+            ex.set_profiler(&profiler);
+
+        for (size_t j=0; j<input_blobs.size(); j++)
+        {
+            ex.input(input_blobs[j], input_mats[j]);
+        }
+
+        for (size_t j=0; j<output_blobs.size(); j++)
+        {
+            ncnn::Mat out;
+            int ret = ex.extract(output_blobs[j], out);
+            if (ret != 0)
+            {
+                fprintf(stderr, "extract %s failed\n", blobs[output_blobs[j]].name.c_str());
+                return -1;
+            }
+        }
+    }
+
+    return 0;
+}
+
+// one layer summed over the loops
+struct LayerRoofline
+{
+    int layer_index;
+    int count;
+    double time;
+    ncnn::LayerProfile profile;
+};
+
+static double layer_flops(const ncnn::LayerCost& cost)
+{
+    return cost.macs * 2.0 + cost.flops;
+}
+
+static double layer_bytes(const ncnn::LayerCost& cost)
+{
+    return (double)cost.weight_bytes + cost.bottom_bytes + cost.top_bytes;
+}
+
+static void print_roofline(const char* name, const char* type, double flops, double bytes, double time, double peak_gflops, double peak_gbps)
+{
+    const double intensity = bytes > 0 ? flops / bytes : 0;
+    const double gflops = time > 0 ? flops / time / 1e6 : 0;
+
+    fprintf(stdout, "%-32s %-22s %10.3f %10.1f %10.2f %8.3f %9.2f", name, type, flops / 1e6, bytes / 1024, intensity, time, gflops);
+
+    if (peak_gflops > 0 && peak_gbps > 0)
+    {
+        // attainable throughput under the roofline
+        const double attainable = std::min(peak_gflops, intensity * peak_gbps);
+        fprintf(stdout, " %9.2f %7.1f%% %s", attainable, attainable > 0 ? gflops / attainable * 100 : 0, intensity * peak_gbps < peak_gflops ? "memory" : "compute");
+    }
+
+    fprintf(stdout, "\n");
+}
+
+int main(int argc, char** argv)
+{
+    if (argc < 3 || argc > 8)
+    {
+        fprintf(stderr, "usage: %s [inparam] [inbin] [w,h,c] [loop count] [num threads] [peak GFLOP/s] [peak GB/s]\n", argv[0]);
+        fprintf(stderr, "inbin: - for constant weight\n");
+        fprintf(stderr, "w,h,c: input shape, - for the shape in the Input layer param\n");
+        return -1;
+    }
+
+    const char* inparam = argv[1];
+    const char* inbin = argv[2];
+
+    int w = 0;
+    int h = 0;
+    int c = 0;
+    if (argc >= 4 && strcmp(argv[3], "-") != 0)
+    {
+        if (sscanf(argv[3], "%d,%d,%d", &w, &h, &c) != 3)
+        {
+            fprintf(stderr, "malformed shape %s\n", argv[3]);
+            return -1;
+        }
+    }
+
+    int loop_count = argc >= 5 ? atoi(argv[4]) : 4;
+    int num_threads = argc >= 6 ? atoi(argv[5]) : ncnn::get_cpu_count();
+    double peak_gflops = argc >= 7 ? atof(argv[6]) : 0;
+    double peak_gbps = argc >= 8 ? atof(argv[7]) : 0;
+
+    loop_count = std::max(loop_count, 1);
+
+    ncnn::Option opt = ncnn::get_default_option();
+    opt.num_threads = num_threads;
+    ncnn::set_default_option(opt);
+
+    NetRoofline net;
+
+    if (net.load_param(inparam) != 0)
+        return -1;
+
+    int ret = strcmp(inbin, "-") == 0 ? net.load_constant_model() : net.load_model(inbin);
+    if (ret != 0)
+        return -1;
+
+    ncnn::Profiler profiler;
+    if (net.run(w, h, c, loop_count, profiler) != 0)
+        return -1;
+
+    // sum the loops per layer, in forward order
+    const std::vector<ncnn::LayerProfile> profiles = profiler.layer_profiles();
+
+    std::vector<LayerRoofline> rooflines;
+    for (size_t i=0; i<profiles.size(); i++)
+    {
+        const ncnn::LayerProfile& profile = profiles[i];
+
+        size_t j = 0;
+        for (; j<rooflines.size(); j++)
+        {
+            if (rooflines[j].layer_index == profile.layer_index)
+                break;
+        }
+
+        if (j == rooflines.size())
+        {
+            LayerRoofline roofline;
+            roofline.layer_index = profile.layer_index;
+            roofline.count = 0;
+            roofline.time = 0;
+            roofline.profile = profile;
+            rooflines.push_back(roofline);
+        }
+
+        rooflines[j].count++;
+        rooflines[j].time += profile.time;
+    }
+
+    fprintf(stdout, "%-32s %-22s %10s %10s %10s %8s %9s", "layer", "type", "MFLOP", "KB", "FLOP/B", "ms", "GFLOP/s");
+    if (peak_gflops > 0 && peak_gbps > 0)
+        fprintf(stdout, " %9s %8s %s", "roof", "achieved", "bound");
+    fprintf(stdout, "\n");
+
+    double total_flops = 0;
+    double total_bytes = 0;
+    double total_time = 0;
+    for (size_t i=0; i<rooflines.size(); i++)
+    {
+        const LayerRoofline& roofline = rooflines[i];
+        const ncnn::LayerCost& cost = roofline.profile.cost;
+
+        const double time = roofline.time / roofline.count;
+
+        print_roofline(roofline.profile.name.c_str(), roofline.profile.type.c_str(), layer_flops(cost), layer_bytes(cost), time, peak_gflops, peak_gbps);
+
+        total_flops += layer_flops(cost);
+        total_bytes += layer_bytes(cost);
+        total_time += time;
+    }
+
+    print_roofline("total", "", total_flops, total_bytes, total_time, peak_gflops, peak_gbps);
+
+    return 0;
+}